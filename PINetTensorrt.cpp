@@ -1,92 +1,117 @@
-#include "argsParser.h"
+#include "annotationWriter.h"
+#include "batching.h"
+#include "cpuEngine.h"
+#include "directoryScanner.h"
+#include "frame.h"
+#include "framePool.h"
+#include "imageDecode.h"
+#include "imageShard.h"
+#include "inputCache.h"
+#include "laneExtraction.h"
+#include "laneModel.h"
+#include "laneTracker.h"
+#include "logger.h"
+#include "onnxModel.h"
+#include "onnxOptimizer.h"
+#include "opencvBackend.h"
+#include "outputPlan.h"
+#include "pinetArgs.h"
+#include "pipeline.h"
+#include "preprocess.h"
+#include "replayBackend.h"
+#include "stageTiming.h"
+#include "tensorView.h"
+#include "videoSource.h"
+
+#if PINET_WITH_TENSORRT
 #include "buffers.h"
 #include "common.h"
-#include "logger.h"
+#include "engineCache.h"
 #include "parserOnnxConfig.h"
+#include "tensorrtBackend.h"
 
 #include "NvInfer.h"
 #include <cuda_runtime_api.h>
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <chrono>
-#include <dirent.h>
+#include <map>
+#include <thread>
 #include <string.h>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#if PINET_WITH_TENSORRT
 using namespace nvinfer1;
 using samplesCommon::SampleUniquePtr;
+#else
+// The ASSERT of common.h, which needs TensorRT
+#define ASSERT(condition)                                                           \
+    do                                                                              \
+    {                                                                               \
+        if (!(condition))                                                           \
+        {                                                                           \
+            sample::gLogError << "Assertion failure: " << #condition << std::endl;  \
+            abort();                                                                \
+        }                                                                           \
+    } while (0)
+#endif
+
+//!
+//! \brief The PINetParams structure groups the parameters of the PINet sample.
+//!
+struct PINetParams : public samplesCommon::OnnxSampleParams
+{
+    std::string backend{"tensorrt"}; //!< Inference backend, tensorrt, cpu, opencv or replay
+    std::string recordFileName;      //!< File the network outputs are recorded to, empty to disable
+    std::string replayFileName;      //!< Recording replayed by the replay backend
+    int32_t decodeThreads{1};        //!< Number of decode workers, each one gets its own file buffer
+    bool fullDecode{false};          //!< Decode images at full size instead of letting the JPEG decoder reduce them
+    std::string inputCache;          //!< Directory of the cached network inputs, empty to always preprocess
+    pinet::InputCacheFormat inputCacheFormat{pinet::InputCacheFormat::kUINT8}; //!< Element type of the cached inputs
+    int64_t inputCacheBytes{0};      //!< Size the cached inputs take at most on disk
+    int32_t inferThreads{1};         //!< Number of infer workers, each one gets its own backend
+    int32_t cpuThreads{0};           //!< Threads of each cpu backend, 0 to share the cores among the infer workers
+    pinet::DnnTarget dnnTarget{pinet::DnnTarget::kCPU}; //!< Device and precision of the opencv backend
+    int32_t dnnThreads{0};           //!< Threads cv::dnn runs on, 0 for the OpenCV default
+    int32_t postprocessThreads{1};   //!< Number of postprocess workers, each one gets its own scratch buffers
+    int32_t trackInterval{0};        //!< Frames of a clip between two inferred frames, 0 to infer every frame
+    int32_t fitDegree{0};            //!< Degree of the polynomials lane lines are fitted with, 0 to skip fitting
+    std::string laneModelFileName;   //!< File the fitted lane models are written to, empty to disable
+    pinet::AnnotationOptions annotation; //!< Sampling and output directory of the annotated images
+    bool show{false};                //!< Show every annotated image in a window
+    std::string engineCache;         //!< Directory of the serialized engines, empty to always build
+    std::string loadEngine;          //!< Serialized engine used instead of building one, empty to build
+    std::string saveEngine;          //!< File the serialized engine is also written to, empty to skip
+    std::vector<std::string> laneOutputNames; //!< Confidence, offset and instance outputs read by post-processing
+    pinet::OutputSelection outputSelection{pinet::OutputSelection::kLANES}; //!< Outputs kept by the network
+};
 
 namespace {
     const std::string gSampleName = "TensorRT.onnx_PINet";
 
-    const int output_base_index = 3;
-    const float threshold_point = 0.81f;
-    const float threshold_instance = 0.22f;
+    const float threshold_point = pinet::kPOINT_THRESHOLD;
+    const float threshold_instance = pinet::kINSTANCE_THRESHOLD;
     const int resize_ratio = 8;
 
-    int64 total_inference_execute_elasped_time = 0;
-    int64 total_inference_execute_times = 0;
-
-    using LaneLine = std::vector<cv::Point2f>;
-    using LaneLines = std::vector<LaneLine>;
-
-    cv::Mat chwDataToMat(int channelNum, int height, int width, float* data, cv::Mat& mask) {
-        std::vector<cv::Mat> channels(channelNum);
-        int data_size = width * height;
-        for (int c = 0; c < channelNum; ++c) {
-            float* channel_data = data + data_size * c;
-            cv::Mat channel(height, width, CV_32FC1);
-            for (int h = 0; h < height; ++h) {
-                for (int w = 0; w < width; ++w, ++channel_data) {
-                    channel.at<float>(h, w) = *channel_data * (int)mask.at<uchar>(h, w);
-                }
-            }
-            channels[c] = channel;
-        }
+    using pinet::LaneLine;
+    using pinet::LaneLines;
+    using FloatView = pinet::PlanarView<const float>;
 
-        cv::Mat mergedMat;
-        cv::merge(channels.data(), channelNum, mergedMat);
-        return mergedMat;
-    }
-
-    void getFiles(std::string root_dir, std::string ext, std::vector<std::string>& files) {
-        DIR *dir;
-        struct dirent *ptr;
-
-        if ((dir = opendir(root_dir.c_str())) == NULL) {
-            sample::gLogInfo << "Open dir error..." << std::endl;
-            return;
-        }
-    
-        while ((ptr = readdir(dir)) != NULL) {
-            if (strcmp(ptr->d_name,".") == 0 || strcmp(ptr->d_name,"..") == 0) {
-                continue;
-            } else if(ptr->d_type == 8)  {// file
-                char* dot = strchr(ptr->d_name, '.');
-                if (dot && !strcasecmp(dot, ext.c_str())) {
-                    std::string filename(root_dir);
-                    filename.append("/").append(ptr->d_name);
-                    files.push_back(filename);
-                }
-            } else if(ptr->d_type == 10) { // link file  
-                continue;
-            } else if(ptr->d_type == 4)  {// dir
-                std::string dir_path(root_dir);
-                dir_path.append("/").append(ptr->d_name);
-                getFiles(dir_path.c_str(), ext, files);
-            }  
-        }
-
-        closedir(dir);  
+    //! Maps a point of the output grid of size dim to the pixel it covers in image
+    cv::Point2f toImagePoint(const cv::Point2f& point, const std::vector<int32_t>& dim, const cv::Mat& image) {
+        return cv::Point2f(point.x * image.cols / dim[3], point.y * image.rows / dim[2]);
     }
 }
 
@@ -97,35 +122,120 @@ namespace {
 class PINetTensorrt
 {
 public:
-    PINetTensorrt(const samplesCommon::OnnxSampleParams& params)
+    PINetTensorrt(const PINetParams& params)
         : mParams(params)
-        , mEngine(nullptr)
     {
     }
 
     //!
-    //! \brief Function builds the network engine
+    //! \brief Function builds the network engine, or loads the recording of the replay backend,
+    //!        and creates one backend per infer worker
     //!
     bool build();
 
     //!
-    //! \brief Runs the TensorRT inference engine for this sample
+    //! \brief Reads the image of frame from disk, or its network input from the input cache
+    //!
+    bool decode(int32_t worker, pinet::Frame& frame);
+
+    //!
+    //! \brief Resizes and normalizes the image of frame into its network input, unless it was cached
+    //!
+    bool processInput(pinet::Frame& frame);
+
+    //!
+    //! \brief Runs the network on the inputs of frames as one batch with the backend of the given infer worker
     //!
-    bool infer();
+    bool infer(int32_t worker, const std::vector<pinet::Frame*>& frames);
 
-    void setImageFile(const std::string& imageFileName) {
-        mImageFileName = imageFileName;
+    //!
+    //! \brief Extracts the lane lines of frame with the scratch buffers of the given postprocess worker
+    //!
+    bool verifyOutput(int32_t worker, pinet::Frame& frame);
+
+    //!
+    //! \brief Carries the lane lines over to a frame which is not inferred, or takes those of one which is.
+    //!        Frames have to be passed in input order
+    //!
+    //! \return the tracking confidence of the frame, 1 if it was inferred
+    //!
+    float track(pinet::Frame& frame);
+
+    //!
+    //! \brief Records the outputs and lane models of frame and hands it to the annotation writer, frames have to
+    //!        be passed in input order
+    //!
+    //! \param anomaly Whether something went wrong with the frame, for the annotation writer to sample it
+    //!
+    bool writeOutput(const pinet::Frame& frame, bool anomaly);
+
+    //!
+    //! \brief Waits for the annotated images queued so far to be written
+    //!
+    void closeOutputs()
+    {
+        mAnnotationWriter.close();
+    }
+
+    const pinet::InputCache& getInputCache() const
+    {
+        return mInputCache;
     }
 
+    const pinet::LaneModelWriter& getLaneModelWriter() const
+    {
+        return mLaneModelWriter;
+    }
+
+    const pinet::AnnotationWriter& getAnnotationWriter() const
+    {
+        return mAnnotationWriter;
+    }
+
+    //!
+    //! \brief Returns the time the cpu backends of all infer workers spent in each layer, empty for other backends
+    //!
+    std::vector<pinet::LayerTiming> getLayerTimings() const;
+
 private:
-    samplesCommon::OnnxSampleParams mParams; //!< The parameters for the sample.
+    PINetParams mParams; //!< The parameters for the sample.
 
-    nvinfer1::Dims mInputDims;  //!< The dimensions of the input to the network.
-    std::vector<nvinfer1::Dims> mOutputDims; //!< The dimensions of the output to the network.
-    std::string mImageFileName;            //!< The number to classify
-    cv::Mat mInputImage;
+    pinet::TensorDesc mInputDims;  //!< The dimensions of the input of one image.
+    std::vector<pinet::TensorDesc> mOutputDims; //!< The dimensions of the outputs of one image.
+    pinet::OutputPlan mOutputPlan; //!< The outputs kept marked in the network and those unmarked
+    pinet::LaneHeads mLaneHeads;   //!< The index in mOutputDims of each output read by post-processing
 
+#if PINET_WITH_TENSORRT
     std::shared_ptr<nvinfer1::ICudaEngine> mEngine; //!< The TensorRT engine used to run the network
+#endif
+    std::unique_ptr<pinet::ReplayBackend> mReplay;  //!< The loaded recording if the replay backend is used
+    std::shared_ptr<const pinet::CpuNetwork> mCpuNetwork; //!< The loaded model if the cpu backend is used
+    std::vector<std::unique_ptr<pinet::InferenceBackend>> mBackends; //!< The executors, one per infer worker
+    pinet::OutputRecorder mRecorder;                 //!< Records the outputs if recordFileName is set
+    pinet::LaneModelWriter mLaneModelWriter;         //!< Writes the lane models if laneModelFileName is set
+    pinet::AnnotationWriter mAnnotationWriter;       //!< Writes annotated images if annotation.directory is set
+
+    std::vector<pinet::LaneExtractor> mLaneExtractors;   //!< One per postprocess worker
+    std::vector<std::vector<uint8_t>> mDecodeBuffers;    //!< Content of the current file of each decode worker
+    pinet::InputCache mInputCache;                       //!< Network inputs of earlier runs, if inputCache is set
+    pinet::NormalizeParams mNormalize;                   //!< Normalization the model input expects, see build()
+    pinet::LaneTracker mTracker;                         //!< Lane lines of the current clip, if trackInterval is set
+
+#if PINET_WITH_TENSORRT
+    //!
+    //! \brief Creates the TensorRT engine, from a serialized engine if possible and from the ONNX model otherwise
+    //!
+    bool buildEngine();
+
+    //!
+    //! \brief Builds the serialized TensorRT engine from the ONNX model
+    //!
+    bool buildPlan(SampleUniquePtr<nvinfer1::IHostMemory>& plan);
+
+    //!
+    //! \brief Creates mEngine from a serialized engine
+    //!
+    bool deserializeEngine(const void* plan, size_t size);
 
     //!
     //! \brief Parses an ONNX model for MNIST and creates a TensorRT network
@@ -133,30 +243,287 @@ private:
     bool constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
         SampleUniquePtr<nvinfer1::INetworkDefinition>& network, SampleUniquePtr<nvinfer1::IBuilderConfig>& config,
         SampleUniquePtr<nvonnxparser::IParser>& parser);
+#endif
 
     //!
-    //! \brief Reads the input  and stores the result in a managed buffer
+    //! \brief Creates the backend of one infer worker
     //!
-    bool processInput(const samplesCommon::BufferManager& buffers);
+    //! \return the backend, null if it cannot be created
     //!
-    //! \brief Classifies digits and verify result
+    std::unique_ptr<pinet::InferenceBackend> createBackend() const;
+
     //!
-    bool verifyOutput(const samplesCommon::BufferManager& buffers);
+    //! \brief Fits the lane lines of frame with polynomials of degree fitDegree
+    //!
+    void fitLaneLines(pinet::Frame& frame) const;
 
-    void generatePostData(float* confidance_data, float* offsets_data, float* instance_data, cv::Mat& mask, cv::Mat& offsets, cv::Mat& features);
+    void showPostData(const FloatView& confidance, const FloatView& offsets, const FloatView& features, const cv::Mat& image) const;
 
-    LaneLines generateLaneLine(float* confidance_data, float* offsets_data, float* instance_data);
+    void generateLaneLine(const FloatView& confidance, const FloatView& offsets, const FloatView& features, pinet::Frame& frame, pinet::LaneExtractor& extractor) const;
 };
 
 //!
-//! \brief Creates the network, configures the builder and creates the network engine
+//! \brief Creates the backend selected by the parameters
 //!
-//! \details This function creates the Onnx MNIST network by parsing the Onnx model and builds
-//!          the engine that will be used to run MNIST (mEngine)
+//! \details The tensorrt backend needs the engine built by buildEngine(), the cpu backend loads the
+//!          ONNX model into its own engine, the opencv backend imports it into one cv::dnn::Net per infer
+//!          worker and the replay backend only loads its recording.
 //!
-//! \return true if the engine was created successfully and false otherwise
+//! \return true if the backend was created successfully and false otherwise
 //!
 bool PINetTensorrt::build()
+{
+    // The outputs of the model, a truncated model only has those of the first hourglass. A model with the
+    // normalization folded into its first convolution takes pixel values as they are, a loaded engine is assumed
+    // to be built from the model given with --onnx if there is one
+    bool const readOutputs = mParams.loadEngine.empty();
+    int64_t modified = 0;
+    int64_t size = 0;
+    if (mParams.backend != "replay" && (readOutputs || pinet::getFileStatus(mParams.onnxFileName, modified, size)))
+    {
+        pinet::ProtoMessage model;
+        std::string normalization;
+        if (!pinet::readModel(mParams.onnxFileName, model) || (readOutputs && !pinet::getGraphOutputs(model, mParams.outputTensorNames))
+            || !pinet::getInputNormalization(model, mNormalize))
+        {
+            return false;
+        }
+        if (pinet::getMetadata(model, pinet::kINPUT_NORMALIZATION_KEY, normalization))
+        {
+            sample::gLogInfo << mParams.onnxFileName << " expects its input normalized as " << normalization << std::endl;
+        }
+    }
+
+    if (!pinet::planOutputs(mParams.outputTensorNames, mParams.laneOutputNames, mParams.outputSelection, mOutputPlan))
+    {
+        sample::gLogError << "The outputs read by post-processing are not outputs of the network, a model truncated after the first hourglass needs --stack=1" << std::endl;
+        return false;
+    }
+
+    if (mParams.backend == "replay")
+    {
+        mReplay.reset(new pinet::ReplayBackend(mParams.replayFileName, mParams.batchSize));
+        if (!mReplay->load())
+        {
+            return false;
+        }
+    }
+    else if (mParams.backend == "cpu")
+    {
+        std::shared_ptr<pinet::CpuNetwork> network(new pinet::CpuNetwork);
+        if (!network->load(mParams.onnxFileName, mOutputPlan.bound))
+        {
+            return false;
+        }
+        sample::gLogInfo << mParams.onnxFileName << ": " << network->getNodeCount() << " nodes run as "
+                         << network->getLayers().size() << " cpu layers, GEMM with "
+                         << (pinet::isGemmVectorized() ? "AVX2" : "plain loops") << std::endl;
+        mCpuNetwork = network;
+    }
+    else if (mParams.backend == "opencv")
+    {
+        // The threads of cv::dnn are those of cv::parallel_for_, which preprocessing uses as well
+        if (mParams.dnnThreads)
+        {
+            cv::setNumThreads(mParams.dnnThreads);
+        }
+        sample::gLogInfo << "Running " << mParams.onnxFileName << " with cv::dnn on the "
+                         << pinet::toString(mParams.dnnTarget) << " target, " << cv::getNumThreads() << " threads"
+                         << std::endl;
+    }
+#if PINET_WITH_TENSORRT
+    else if (!buildEngine())
+    {
+        return false;
+    }
+#else
+    else
+    {
+        sample::gLogError << "The " << mParams.backend << " backend needs a build with PINET_WITH_TENSORRT" << std::endl;
+        return false;
+    }
+#endif
+
+    for (int32_t i = 0; i < std::max(mParams.inferThreads, 1); ++i)
+    {
+        mBackends.push_back(createBackend());
+        if (!mBackends.back())
+        {
+            return false;
+        }
+    }
+
+    ASSERT(mBackends[0]->getBatchSize() == mParams.batchSize);
+    mInputDims = pinet::imageDesc(mBackends[0]->getInput());
+    ASSERT(mInputDims.dims.size() == 4);
+
+    mOutputDims.clear();
+    for (const auto& output : mBackends[0]->getOutputs()) {
+        mOutputDims.push_back(pinet::imageDesc(output));
+    }
+    for (const auto& dim : mOutputDims) {
+        ASSERT(dim.dims.size() == 4);
+    }
+    if (!pinet::findLaneHeads(mOutputDims, mParams.laneOutputNames, mLaneHeads))
+    {
+        sample::gLogError << "The " << mBackends[0]->getName() << " backend lacks outputs read by post-processing" << std::endl;
+        return false;
+    }
+    sample::gLogInfo << "Using " << mOutputDims.size() << " of " << mParams.outputTensorNames.size() << " outputs, "
+                     << pinet::getOutputBytes(mBackends[0]->getOutputs()) / 1024 << " KiB copied to the host per batch" << std::endl;
+
+    mDecodeBuffers.resize(std::max(mParams.decodeThreads, 1));
+    const std::vector<int32_t>& gridDims = mOutputDims[mLaneHeads.confidence].dims;
+    mLaneExtractors.assign(std::max(mParams.postprocessThreads, 1), pinet::LaneExtractor(gridDims[2] * gridDims[3]));
+    mTracker = pinet::LaneTracker(gridDims[3], gridDims[2]);
+
+    if (!mParams.recordFileName.empty() && !mRecorder.open(mParams.recordFileName, mInputDims, mOutputDims))
+    {
+        return false;
+    }
+    if (!mParams.laneModelFileName.empty() && !mLaneModelWriter.open(mParams.laneModelFileName, gridDims[3], gridDims[2]))
+    {
+        return false;
+    }
+    if (!mAnnotationWriter.open(mParams.annotation, gridDims[3], gridDims[2]))
+    {
+        return false;
+    }
+
+    // Inputs depend on how images are decoded and on the normalization the model expects, the resize is fixed
+    const std::vector<int32_t> inputChw(mInputDims.dims.begin() + 1, mInputDims.dims.end());
+    const std::string inputSettings = mParams.fullDecode ? "decode=full" : "decode=reduced";
+    if (!mParams.inputCache.empty() && !mInputCache.open(mParams.inputCache, mParams.inputCacheFormat,
+            mParams.inputCacheBytes, inputChw, mNormalize, inputSettings))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<pinet::InferenceBackend> PINetTensorrt::createBackend() const
+{
+    if (mReplay)
+    {
+        return std::unique_ptr<pinet::InferenceBackend>(new pinet::ReplayBackend(*mReplay));
+    }
+    if (mCpuNetwork)
+    {
+        // Infer workers run concurrently, by default each one gets its share of the cores
+        const int32_t cores = std::max(static_cast<int32_t>(std::thread::hardware_concurrency()), 1);
+        const int32_t threads = mParams.cpuThreads ? mParams.cpuThreads : std::max(cores / std::max(mParams.inferThreads, 1), 1);
+        return std::unique_ptr<pinet::InferenceBackend>(new pinet::CpuBackend(mCpuNetwork, mParams.batchSize, threads));
+    }
+    if (mParams.backend == "opencv")
+    {
+        std::unique_ptr<pinet::OpenCVBackend> backend(
+            new pinet::OpenCVBackend(mParams.onnxFileName, mOutputPlan.bound, mParams.batchSize, mParams.dnnTarget));
+        if (!backend->load())
+        {
+            return nullptr;
+        }
+        return backend;
+    }
+
+#if PINET_WITH_TENSORRT
+    return std::unique_ptr<pinet::InferenceBackend>(
+        new pinet::TensorRTBackend(mEngine, mParams.inputTensorNames[0], mOutputPlan.bound));
+#else
+    return nullptr;
+#endif
+}
+
+std::vector<pinet::LayerTiming> PINetTensorrt::getLayerTimings() const
+{
+    std::vector<pinet::LayerTiming> total;
+    for (const auto& backend : mBackends)
+    {
+        if (const auto* cpu = dynamic_cast<const pinet::CpuBackend*>(backend.get()))
+        {
+            pinet::addLayerTimings(cpu->getLayerTimings(), total);
+        }
+    }
+    return total;
+}
+
+#if PINET_WITH_TENSORRT
+//!
+//! \brief Creates the network engine, reusing a serialized engine when one matches
+//!
+//! \details A file given with --loadEngine is used as is. Otherwise the engine cache is looked up with
+//!          the hash of the ONNX model and the build options, and the engine is only built from the
+//!          model on a miss, or when the cached plan cannot be deserialized. A built plan is stored in
+//!          the cache and written to the --saveEngine file.
+//!
+//! \return true if the engine was created successfully and false otherwise
+//!
+bool PINetTensorrt::buildEngine()
+{
+    if (!mParams.loadEngine.empty())
+    {
+        std::vector<char> plan;
+        if (!pinet::readPlan(mParams.loadEngine, plan) || !deserializeEngine(plan.data(), plan.size()))
+        {
+            sample::gLogError << "Cannot load the engine from " << mParams.loadEngine << std::endl;
+            return false;
+        }
+        sample::gLogInfo << "Loaded the engine from " << mParams.loadEngine << std::endl;
+        return true;
+    }
+
+    std::unique_ptr<pinet::EngineCache> cache;
+    pinet::EngineKey key;
+    if (!mParams.engineCache.empty())
+    {
+        if (!pinet::hashFile(mParams.onnxFileName, key.modelHash, key.modelSize))
+        {
+            return false;
+        }
+        key.fp16 = mParams.fp16;
+        key.int8 = mParams.int8;
+        key.dlaCore = mParams.dlaCore;
+        key.batchSize = mParams.batchSize;
+        key.builderVersion = getInferLibVersion();
+        key.outputsHash = pinet::hashNames(mOutputPlan.bound);
+        cache.reset(new pinet::EngineCache(mParams.engineCache));
+
+        std::vector<char> plan;
+        if (cache->load(key, plan)) {
+            if (deserializeEngine(plan.data(), plan.size())) {
+                sample::gLogInfo << "Loaded the engine from " << cache->getPath(key) << std::endl;
+                return true;
+            }
+            sample::gLogWarning << "Cannot deserialize " << cache->getPath(key) << ", building it again" << std::endl;
+        }
+    }
+
+    SampleUniquePtr<IHostMemory> plan;
+    if (!buildPlan(plan) || !deserializeEngine(plan->data(), plan->size()))
+    {
+        return false;
+    }
+
+    // Failing to save only costs the next start a build
+    if (cache && cache->store(key, plan->data(), plan->size())) {
+        sample::gLogInfo << "Cached the engine in " << cache->getPath(key) << std::endl;
+    }
+    if (!mParams.saveEngine.empty() && pinet::writePlan(mParams.saveEngine, plan->data(), plan->size())) {
+        sample::gLogInfo << "Saved the engine to " << mParams.saveEngine << std::endl;
+    }
+
+    return true;
+}
+
+//!
+//! \brief Creates the network, configures the builder and builds the serialized network engine
+//!
+//! \details This function creates the Onnx PINet network by parsing the Onnx model and builds
+//!          the plan that mEngine is deserialized from
+//!
+//! \return true if the plan was built successfully and false otherwise
+//!
+bool PINetTensorrt::buildPlan(SampleUniquePtr<nvinfer1::IHostMemory>& plan)
 {
     auto builder = SampleUniquePtr<nvinfer1::IBuilder>(nvinfer1::createInferBuilder(sample::gLogger.getTRTLogger()));
     if (!builder)
@@ -197,25 +564,12 @@ bool PINetTensorrt::build()
     }
     config->setProfileStream(*profileStream);
 
-    SampleUniquePtr<IHostMemory> plan{builder->buildSerializedNetwork(*network, *config)};
+    plan.reset(builder->buildSerializedNetwork(*network, *config));
     if (!plan)
     {
         return false;
     }
 
-    SampleUniquePtr<IRuntime> runtime{createInferRuntime(sample::gLogger.getTRTLogger())};
-    if (!runtime)
-    {
-        return false;
-    }   
-
-    mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
-        runtime->deserializeCudaEngine(plan->data(), plan->size()), samplesCommon::InferDeleter());
-    if (!mEngine)
-    {
-       return false;
-    }
-
     if (sample::gLogger.getReportableSeverity() == sample::Logger::Severity::kVERBOSE) {
         for (int i = 0; i < network->getNbInputs(); ++i) {
             nvinfer1::Dims dim = network->getInput(i)->getDimensions();
@@ -229,14 +583,45 @@ bool PINetTensorrt::build()
     }
 
     ASSERT(network->getNbInputs() == 1);
-    mInputDims = network->getInput(0)->getDimensions();
-    ASSERT(mInputDims.nbDims == 4);
+    ASSERT(network->getNbOutputs() == static_cast<int32_t>(mOutputPlan.bound.size()));
+
+    return true;
+}
+
+//!
+//! \brief Deserializes plan into mEngine
+//!
+//! \return true if the engine was created successfully and false otherwise
+//!
+bool PINetTensorrt::deserializeEngine(const void* plan, size_t size)
+{
+    SampleUniquePtr<IRuntime> runtime{createInferRuntime(sample::gLogger.getTRTLogger())};
+    if (!runtime)
+    {
+        return false;
+    }
+
+    if (mParams.dlaCore >= 0)
+    {
+        runtime->setDLACore(mParams.dlaCore);
+    }
 
-    ASSERT(network->getNbOutputs() == 6);
-    for (int i = 0; i < network->getNbOutputs(); ++i) {
-        nvinfer1::Dims dim = network->getOutput(i)->getDimensions();
-        mOutputDims.push_back(dim);
-        ASSERT(dim.nbDims == 4);
+    mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
+        runtime->deserializeCudaEngine(plan, size), samplesCommon::InferDeleter());
+    if (!mEngine)
+    {
+       return false;
+    }
+
+    // A plan built elsewhere may lack outputs the sample expects
+    for (const auto& name : mOutputPlan.bound)
+    {
+        if (mEngine->getBindingIndex(name.c_str()) == -1)
+        {
+            sample::gLogError << "The engine has no output " << name << std::endl;
+            mEngine.reset();
+            return false;
+        }
     }
 
     return true;
@@ -260,6 +645,15 @@ bool PINetTensorrt::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builde
         return false;
     }
 
+    // The model is exported with a batch of one image, all its layers work on any batch size
+    if (mParams.batchSize > 1)
+    {
+        nvinfer1::ITensor* input = network->getInput(0);
+        nvinfer1::Dims dims = input->getDimensions();
+        dims.d[0] = mParams.batchSize;
+        input->setDimensions(dims);
+    }
+
     if (mParams.fp16)
     {
         config->setFlag(BuilderFlag::kFP16);
@@ -270,287 +664,323 @@ bool PINetTensorrt::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builde
         samplesCommon::setAllDynamicRanges(network.get(), 127.0f, 127.0f);
     }
 
+    // Heads nobody reads are unmarked, so they get no bindings and TensorRT can drop the layers computing them
+    for (int32_t i = network->getNbOutputs() - 1; i >= 0; --i)
+    {
+        nvinfer1::ITensor* output = network->getOutput(i);
+        const auto& unmarked = mOutputPlan.unmarked;
+        if (std::find(unmarked.begin(), unmarked.end(), output->getName()) != unmarked.end())
+        {
+            network->unmarkOutput(*output);
+        }
+    }
+
     samplesCommon::enableDLA(builder.get(), config.get(), mParams.dlaCore);
 
     return true;
 }
+#endif // PINET_WITH_TENSORRT
 
 //!
-//! \brief Runs the TensorRT inference engine for this sample
+//! \brief Decodes the image of frame, from its shard or else from disk
 //!
-//! \details This function is the main execution function of the sample. It allocates the buffer,
-//!          sets inputs and executes the engine.
+//! \details JPEG images are scaled down by the decoder as far as they still cover the network input, unless
+//!          fullDecode is set. Video frames are decoded by their capture already.
 //!
-bool PINetTensorrt::infer()
+bool PINetTensorrt::decode(int32_t worker, pinet::Frame& frame)
 {
-    // Create RAII buffer manager object
-    samplesCommon::BufferManager buffers(mEngine);
+    if (!frame.image.empty()) {
+        return true;
+    }
 
-    auto context = SampleUniquePtr<nvinfer1::IExecutionContext>(mEngine->createExecutionContext());
-    if (!context)
-    {
-        return false;
+    // A cached input replaces both decoding and preprocessing, it is keyed by the file the image is read from
+    int64_t modified = 0;
+    int64_t size = 0;
+    if (frame.shard) {
+        modified = frame.shard->getModifiedTime();
+        size = frame.shard->getFileSize();
+    }
+    // Frames which are not inferred still need their image, lanes are tracked on it
+    if (mInputCache.isOpen() && !frame.tracked && (frame.shard || pinet::getFileStatus(frame.fileName, modified, size))) {
+        frame.inputKey = mInputCache.getKey(frame.fileName, modified, size);
+        frame.input.resize(mInputDims.volume());
+        if (mInputCache.load(frame.inputKey, frame.input.data())) {
+            frame.inputCached = true;
+            // The tracker takes the markings of inferred frames as the reference of the frames that follow
+            if (!mParams.trackInterval) {
+                return true;
+            }
+        }
     }
 
-    // Read the input data into the managed buffers
-    ASSERT(mParams.inputTensorNames.size() == 1);
-    if (!processInput(buffers))
-    {
-        return false;
+    // No image covers the largest size, so it is decoded at full size
+    const int32_t minWidth = mParams.fullDecode ? INT32_MAX : mInputDims.dims[3];
+    const int32_t minHeight = mParams.fullDecode ? INT32_MAX : mInputDims.dims[2];
+    if (frame.shard) {
+        return pinet::decodeImage(frame.shard->getData(frame.shardImage), frame.shard->getImage(frame.shardImage).size,
+            minWidth, minHeight, frame.image);
     }
+    return pinet::decodeImage(frame.fileName, minWidth, minHeight, mDecodeBuffers[worker], frame.image);
+}
 
-    auto inferenceBeginTime = std::chrono::high_resolution_clock::now();
-    // Memcpy from host input buffers to device input buffers
-    buffers.copyInputToDevice();
+//!
+//! \brief Runs the TensorRT inference engine for this sample
+//!
+//! \details This function is the main execution function of the sample. It packs the inputs of the frames
+//!          into the batch of the backend of the worker, executes it and splits the outputs back per frame.
+//!
+bool PINetTensorrt::infer(int32_t worker, const std::vector<pinet::Frame*>& frames)
+{
+    pinet::InferenceBackend& backend = *mBackends[worker];
+    pinet::packBatch(frames, backend);
 
-    bool status = context->executeV2(buffers.getDeviceBindings().data());
-    if (!status)
+    // Copies the input, executes the network and copies the outputs back
+    if (!backend.infer())
     {
         return false;
     }
 
-    // Memcpy from device output buffers to host output buffers
-    buffers.copyOutputToHost();
-
-    auto inference_execute_elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - inferenceBeginTime);
-    total_inference_execute_elasped_time += inference_execute_elapsed_time.count();
-    ++total_inference_execute_times;
+    pinet::unpackBatch(backend, frames);
 
-    //sample::gLogInfo << "inference elapsed time: " << inference_execute_elapsed_time.count() / 1000.f << " milliseconds" << std::endl;
-
-    // Verify results
-    if (!verifyOutput(buffers))
-    {
-        return false;
+    // Every frame of the batch waits for the whole batch
+    const pinet::InferenceTiming& timing = backend.getLastTiming();
+    for (auto* frame : frames) {
+        frame->times[pinet::Stage::kH2D] = timing.h2d;
+        frame->times[pinet::Stage::kEXECUTE] = timing.execute;
+        frame->times[pinet::Stage::kD2H] = timing.d2h;
     }
 
     return true;
 }
 
 //!
-//! \brief Reads the input and stores the result in a managed buffer
+//! \brief Resizes and normalizes the image of frame into its network input
 //!
-bool PINetTensorrt::processInput(const samplesCommon::BufferManager& buffers)
+//! \details The image itself keeps its decoded size, lane lines are drawn at that resolution. The input is
+//!          stored in the input cache if it has a key.
+//!
+bool PINetTensorrt::processInput(pinet::Frame& frame)
 {
-    const int inputC = mInputDims.d[1];
-    const int inputH = mInputDims.d[2];
-    const int inputW = mInputDims.d[3];
+    if (frame.inputCached || frame.tracked) {
+        return true;
+    }
 
-    cv::Mat image = cv::imread(mImageFileName, 1);
+    const int inputC = mInputDims.dims[1];
+    const int inputH = mInputDims.dims[2];
+    const int inputW = mInputDims.dims[3];
+
+    const cv::Mat& image = frame.image;
     assert(inputC == image.channels());
-    cv::resize(image, image, cv::Size(inputW, inputH));
 
-    mInputImage = image;
+    // Resizing, normalization and the HWC to CHW layout change are done in a single pass, a model with the
+    // normalization folded in only gets the pixels converted to floats
+    frame.input.resize(mInputDims.volume());
+    pinet::resizeNormalizeHwcToChw(image.ptr<uchar>(), image.cols, image.rows, image.step, frame.input.data(), inputW, inputH, mNormalize);
 
-    float* hostDataBuffer = static_cast<float*>(buffers.getHostBuffer(mParams.inputTensorNames[0]));
-    uchar* imageData = image.ptr<uchar>();
-    for (int c = 0; c < inputC; ++c) {
-        for (unsigned j = 0, volChl = inputW * inputH; j < volChl; ++j) {
-            hostDataBuffer[c * volChl + j] = float(imageData[j * inputC + c]) / 255.f;
-        }
+    // A full cache directory only costs the rest of the run its speedup
+    if (frame.inputKey) {
+        mInputCache.store(frame.inputKey, frame.input.data());
     }
 
     return true;
 }
 
-void PINetTensorrt::generatePostData(float* confidance_data, float* offsets_data, float* instance_data, cv::Mat& mask, cv::Mat& offsets, cv::Mat& features)
+//!
+//! \brief Prints and shows the key points, offsets and instance features above the confidence threshold
+//!
+void PINetTensorrt::showPostData(const FloatView& confidance, const FloatView& offsets, const FloatView& features, const cv::Mat& image) const
 {
-    const nvinfer1::Dims& dim            = mOutputDims[output_base_index + 0];//1 32 64
-    const nvinfer1::Dims& offset_dim     = mOutputDims[output_base_index + 1];//2 32 64
-    const nvinfer1::Dims& instance_dim   = mOutputDims[output_base_index + 2];//4 32 64
-
-    mask = cv::Mat::zeros(dim.d[2], dim.d[3], CV_8UC1);
-    float* confidance_ptr = confidance_data;
-    for (int i = 0; i < dim.d[2]; ++i) {
-        for (int j = 0; j < dim.d[3]; ++j, ++confidance_ptr) {
-            if (*confidance_ptr > threshold_point) {
-                mask.at<uchar>(i, j) = 1;
-            }
+    const std::vector<int32_t>& dim = mOutputDims[mLaneHeads.confidence].dims;//1 32 64
+    auto isKeyPoint = [&confidance](int i, int j) {
+        return confidance(0, i, j) > threshold_point;
+    };
+
+    sample::gLogInfo << "Output mask:" << std::endl;
+    for (int i = 0; i < dim[2]; ++i) {
+        for (int j = 0; j < dim[3]; ++j) {
+            sample::gLogInfo << (int)isKeyPoint(i, j);
         }
+        sample::gLogInfo << std::endl;
     }
 
-    if (sample::gLogger.getReportableSeverity() == sample::Logger::Severity::kVERBOSE) {
-        sample::gLogInfo << "Output mask:" << std::endl;
-        for (int i = 0; i < dim.d[2]; ++i) {
-            for (int j = 0; j < dim.d[3]; ++j) {
-                sample::gLogInfo << (int)mask.at<uchar>(i, j);
+    cv::Mat maskImage = image.clone();
+    cv::Scalar color(0, 0, 255);
+    for (int i = 0; i < dim[2]; ++i) {
+        for (int j = 0; j < dim[3]; ++j) {
+            if (isKeyPoint(i, j)) {
+                cv::circle(maskImage, toImagePoint(cv::Point2f(j, i), dim, image), 3, color, -1);
             }
-            sample::gLogInfo << std::endl;
         }
+    }
+    cv::imshow("mask", maskImage);
+    cv::waitKey(0);
 
-        cv::Mat maskImage = mInputImage.clone();
-        cv::Scalar color(0, 0, 255);
-        for (int i = 0; i < dim.d[2]; ++i) {
-            for (int j = 0; j < dim.d[3]; ++j) {
-                if ((int)mask.at<uchar>(i, j)) {
-                    cv::circle(maskImage, cv::Point2f(j * 8, i * 8), 3, color, -1);
-                }
-            }
+    sample::gLogInfo << "Output offset:" << std::endl;
+    for (int i = 0; i < dim[2]; ++i) {
+        for (int j = 0; j < dim[3]; ++j) {
+            sample::gLogInfo << (isKeyPoint(i, j) && offsets(0, i, j) ? 1 : 0);
         }
-        cv::imshow("mask", maskImage);
-        cv::waitKey(0);
+        sample::gLogInfo << std::endl;
     }
 
-    offsets  = chwDataToMat(offset_dim.d[1], offset_dim.d[2], offset_dim.d[3], offsets_data, mask);
-    features = chwDataToMat(instance_dim.d[1], instance_dim.d[2], instance_dim.d[3], instance_data, mask);    
-
-    if (sample::gLogger.getReportableSeverity() == sample::Logger::Severity::kVERBOSE) {
-        sample::gLogInfo << "Output offset:" << std::endl;
-        for (int i = 0; i < dim.d[2]; ++i) {
-            for (int j = 0; j < dim.d[3]; ++j) {
-                sample::gLogInfo << (offsets.at<cv::Vec2f>(i, j)[0] ? 1 : 0);
+    cv::Mat offsetImage = image.clone();
+    for (int i = 0; i < dim[2]; ++i) {
+        for (int j = 0; j < dim[3]; ++j) {
+            if (isKeyPoint(i, j)) {
+                cv::Point2f point(offsets(0, i, j) + j, offsets(1, i, j) + i);
+                cv::circle(offsetImage, toImagePoint(point, dim, image), 3, color, -1);
             }
-            sample::gLogInfo << std::endl;
         }
+    }
+    cv::imshow("offset", offsetImage);
+    cv::waitKey(0);
 
-        cv::Mat offsetImage = mInputImage.clone();
-        cv::Scalar color(0, 0, 255);
-        for (int i = 0; i < dim.d[2]; ++i) {
-            for (int j = 0; j < dim.d[3]; ++j) {
-                if ((int)mask.at<uchar>(i, j)) {
-                    cv::Vec2f pointOffset = offsets.at<cv::Vec2f>(i, j);
-                    cv::Point2f point(pointOffset[0] + j, pointOffset[1] + i);
-                    cv::circle(offsetImage, point * 8, 3, color, -1);
-                }
-            }
+    sample::gLogInfo << "Output instance:" << std::endl;
+    for (int i = 0; i < dim[2]; ++i) {
+        for (int j = 0; j < dim[3]; ++j) {
+            sample::gLogInfo << (isKeyPoint(i, j) && features(0, i, j) ? 1 : 0);
         }
-        cv::imshow("offset", offsetImage);
-        cv::waitKey(0);
+        sample::gLogInfo << std::endl;
+    }
+}
 
-        sample::gLogInfo << "Output instance:" << std::endl;
-        for (int i = 0; i < dim.d[2]; ++i) {
-            for (int j = 0; j < dim.d[3]; ++j) {
-                sample::gLogInfo << (features.at<cv::Vec4f>(i, j)[0] ? 1 : 0);
-            }
-            sample::gLogInfo << std::endl;
+//!
+//! \brief Clusters the key points above the confidence threshold into the lane lines of frame by instance feature
+//!
+//! \details Reads the planar outputs in place and only visits the key point candidates. The lane lines reuse the
+//!          vectors of those of earlier images of the frame, nothing is allocated once the frames are warmed up.
+//!
+void PINetTensorrt::generateLaneLine(const FloatView& confidance, const FloatView& offsets, const FloatView& features, pinet::Frame& frame, pinet::LaneExtractor& extractor) const
+{
+    if (sample::gLogger.getReportableSeverity() == sample::Logger::Severity::kVERBOSE) {
+        if (!frame.image.empty()) {
+            showPostData(confidance, offsets, features, frame.image);
         }
     }
+
+    extractor.extract(confidance, offsets, features, threshold_point, threshold_instance, frame.laneLines, frame.spareLaneLines);
 }
 
-LaneLines PINetTensorrt::generateLaneLine(float* confidance_data, float* offsets_data, float* instance_data)
+//!
+//! \brief verify result
+//!
+//! \details Frames which are not inferred get their lane lines from track(), which also fits them when
+//!          tracking. Lane lines are drawn by the annotation writer, images stay as they were captured.
+//!
+//! \return whether output matches expectations
+//!
+bool PINetTensorrt::verifyOutput(int32_t worker, pinet::Frame& frame)
 {
-    const nvinfer1::Dims& dim = mOutputDims[output_base_index];//1 32 64
-
-    cv::Mat mask, offsets, features;
-    generatePostData(confidance_data, offsets_data, instance_data, mask, offsets, features);
-    
-    LaneLines laneLines;
-    std::vector<cv::Vec4f> laneFeatures;
-
-    auto findNearestFeature = [&laneFeatures](const cv::Vec4f& feature) -> std::pair<int, float> {
-        int index=-1;
-        float min_feature_dis = 10000.;
-        for (int i = 0; i < laneFeatures.size(); ++i) {
-            auto delta = laneFeatures[i] - feature;
-            auto alpha = pow(delta[0],2)+pow(delta[1],2)+pow(delta[2],2)+pow(delta[3],2);
-            if (sqrt(alpha) <= min_feature_dis){
-                index = i;
-                min_feature_dis = sqrt(alpha);
-            }
-        }
-        return std::pair<int, float>(index, min_feature_dis);
-    };
+    if (frame.tracked) {
+        return true;
+    }
 
-    for (int i = 0; i < dim.d[2]; ++i) {
-        for (int j = 0; j < dim.d[3]; ++j) {
-            if ((int)mask.at<uchar>(i, j) == 0) {
-                continue;
-            }
+    const FloatView confidance(frame.outputs[mLaneHeads.confidence].data(), mOutputDims[mLaneHeads.confidence]);
+    const FloatView offset(frame.outputs[mLaneHeads.offset].data(), mOutputDims[mLaneHeads.offset]);
+    const FloatView instance(frame.outputs[mLaneHeads.instance].data(), mOutputDims[mLaneHeads.instance]);
 
-            const cv::Vec2f& offset = offsets.at<cv::Vec2f>(i, j);
-            cv::Point2f point(offset[0] + j, offset[1] + i);
-            if (point.x > dim.d[3] || point.x < 0.f) continue;
-            if (point.y > dim.d[2] || point.y < 0.f) continue;
-
-            const cv::Vec4f& feature = features.at<cv::Vec4f>(i, j);
-            std::pair<int, float> lane_index = findNearestFeature(feature); 
-
-            if (lane_index.first == -1) {
-                laneLines.emplace_back(LaneLine({point}));
-                laneFeatures.emplace_back(feature);
-            } 
-            else if (lane_index.second <= threshold_instance ) {
-
-                auto& laneline = laneLines[lane_index.first ];
-                auto& lanefeature = laneFeatures[lane_index.first ];
-                if (lane_index.second <= threshold_instance ){                    
-                    auto point_size = laneline.size(); 
-                    lanefeature = lanefeature.mul(cv::Vec4f::all(point_size)) + feature;
-                    lanefeature = lanefeature.mul(cv::Vec4f::all(1.f / (point_size + 1)));
-                    laneline.emplace_back(point);
-                }
-            }
-            else{
-                laneLines.emplace_back(LaneLine({point}));
-                laneFeatures.emplace_back(feature);
-            }
-        }
+    assert(confidance.channels() == 1);
+    assert(offset.channels()     == 2);
+    assert(instance.channels()   == 4);
+
+    auto start = pinet::Clock::now();
+    generateLaneLine(confidance, offset, instance, frame, mLaneExtractors[worker]);
+    frame.times[pinet::Stage::kPOSTPROCESS] = pinet::elapsedMs(start);
+    if (frame.laneLines.empty())
+        return false;
+
+    if (!mParams.trackInterval) {
+        fitLaneLines(frame);
     }
 
-    for (auto itr = laneLines.begin(); itr != laneLines.end();) {
-        if ((*itr).size() < 2) {
-            itr = laneLines.erase(itr);
-        } else {
-            ++itr;
-        }
+    return true;
+}
+
+//!
+//! \brief Fits the lane lines of frame with polynomials of degree fitDegree
+//!
+//! \details Lane models are kept in grid coordinates like the lane lines they are fitted to.
+//!
+void PINetTensorrt::fitLaneLines(pinet::Frame& frame) const
+{
+    if (!mParams.fitDegree) {
+        return;
     }
 
-    return laneLines;
+    auto start = pinet::Clock::now();
+    frame.laneModels.resize(frame.laneLines.size());
+    for (size_t i = 0; i < frame.laneLines.size(); ++i) {
+        const LaneLine& laneLine = frame.laneLines[i];
+        pinet::fitLaneModel(laneLine.data(), static_cast<int32_t>(laneLine.size()), mParams.fitDegree, frame.laneModels[i]);
+    }
+    frame.times[pinet::Stage::kFIT] = pinet::elapsedMs(start);
 }
 
 //!
-//! \brief verify result
+//! \brief Carries the lane lines over to a frame which is not inferred, or takes those of one which is
 //!
-//! \return whether output matches expectations
+//! \details Runs on the sink of the pipeline only, the tracker follows the frames of each clip in order.
 //!
-bool PINetTensorrt::verifyOutput(const samplesCommon::BufferManager& buffers)
+float PINetTensorrt::track(pinet::Frame& frame)
 {
-    float *confidance, *offset, *instance;
-    confidance = static_cast<float*>(buffers.getHostBuffer(mParams.outputTensorNames[output_base_index + 0]));    
-    offset     = static_cast<float*>(buffers.getHostBuffer(mParams.outputTensorNames[output_base_index + 1]));    
-    instance   = static_cast<float*>(buffers.getHostBuffer(mParams.outputTensorNames[output_base_index + 2]));    
- 
-    nvinfer1::Dims confidanceDims = mOutputDims[output_base_index + 0];
-    nvinfer1::Dims offsetDims     = mOutputDims[output_base_index + 1];
-    nvinfer1::Dims instanceDims   = mOutputDims[output_base_index + 2];
-    
-    assert(confidanceDims.d[1] == 1);
-    assert(offsetDims.d[1]     == 2);
-    assert(instanceDims.d[1]   == 4);
-
-    LaneLines lanelines = generateLaneLine(confidance, offset, instance);
-    if (lanelines.empty())
-        return false;
+    auto start = pinet::Clock::now();
+    if (frame.clipStart) {
+        mTracker.reset();
+    }
+    float confidence = 1.f;
+    if (frame.tracked) {
+        confidence = mTracker.propagate(frame.image, frame.laneLines);
+    } else {
+        mTracker.update(frame.laneLines, frame.image);
+    }
+    frame.times[pinet::Stage::kTRACK] = pinet::elapsedMs(start);
 
-    cv::Scalar color[] = {{255,   0,   0}, {  0, 255,   0}, {  0,   0, 255}, 
-                        {255, 255,   0}, {255,   0, 255}, {  0, 255, 255}, 
-                        {255, 255, 255}, {100, 255,   0}, {100,   0, 255}, 
-                        {255, 100,   0}, {  0, 100, 255}, {255,   0, 100}, 
-                        {  0, 255, 100}};
+    fitLaneLines(frame);
+    return confidence;
+}
 
-    cv::Mat lanelineImage = mInputImage;
-    for (int i = 0; i < lanelines.size(); ++i) {
-        for (const auto& point : lanelines[i]) {
-            cv::circle(lanelineImage, cv::Point2f(point * 8), 3, color[i], -1);
-        }
+//!
+//! \brief Records the outputs and lane models of frame and hands it to the annotation writer
+//!
+//! \details Runs on the sink of the pipeline only, so the recording, the lane models and the window follow the
+//!          input order. Every frame gets its lane models, none if it failed. Annotated images are drawn and
+//!          written in the background, only the window of --show holds the pipeline up.
+//!
+bool PINetTensorrt::writeOutput(const pinet::Frame& frame, bool anomaly)
+{
+    if (!mParams.recordFileName.empty() && frame.inferred && !mRecorder.write(frame.outputs))
+    {
+        sample::gLogError << "Cannot record outputs to " << mParams.recordFileName << std::endl;
+        return false;
+    }
+    if (!mParams.laneModelFileName.empty() && !mLaneModelWriter.write(frame.index, frame.laneModels))
+    {
+        sample::gLogError << "Cannot write lane models to " << mParams.laneModelFileName << std::endl;
+        return false;
     }
 
-    if (sample::gLogger.getReportableSeverity() == sample::Logger::Severity::kINFO) {
-        cv::imwrite("lanelines.jpg", lanelineImage);
+    // The writer draws on the image later, the window gets its own copy first
+    if (mParams.show && !frame.image.empty()) {
+        const std::vector<int32_t>& gridDims = mOutputDims[mLaneHeads.confidence].dims;
+        cv::Mat shown = frame.image.clone();
+        pinet::drawLanes(shown, frame.laneLines, frame.laneModels, gridDims[3], gridDims[2]);
 
-        cv::imshow("lanelines", lanelineImage);
-        cv::waitKey(0);
+        // Video frames play on, images wait for a key
+        cv::imshow("lanelines", shown);
+        cv::waitKey(frame.captured == pinet::Clock::time_point() ? 0 : 1);
     }
+    mAnnotationWriter.submit(frame, anomaly);
 
-    return true;
+    return !frame.failedStage;
 }
+
 //!
 //! \brief Initializes members of the params struct using the command line args
 //!
-samplesCommon::OnnxSampleParams initializeSampleParams(const samplesCommon::Args& args)
+PINetParams initializeSampleParams(const pinet::Args& args)
 {
-    samplesCommon::OnnxSampleParams params;
-    if (args.dataDirs.empty()) // Use default directories if user hasn't provided directory paths
+    PINetParams params;
+    if (args.dataDirs.empty() && args.shards.empty() && args.video.empty()) // Use default directories if user hasn't provided any input
     {
         params.dataDirs.push_back("./data/1492638000682869180");
     } 
@@ -562,7 +992,7 @@ samplesCommon::OnnxSampleParams initializeSampleParams(const samplesCommon::Args
     char pwd[1024] = {0};
     getcwd(pwd, sizeof(pwd));
 
-    params.onnxFileName = "pinet.onnx";
+    params.onnxFileName = args.onnx;
     params.inputTensorNames.push_back("input.1");
     //params.outputTensorNames.push_back("1431");
     params.outputTensorNames.push_back("input.672");
@@ -572,9 +1002,35 @@ samplesCommon::OnnxSampleParams initializeSampleParams(const samplesCommon::Args
     params.outputTensorNames.push_back("input.1332");
     params.outputTensorNames.push_back("1686");
     params.outputTensorNames.push_back("1693");
+    // Lane lines are read from the heads of the hourglass selected with --stack
+    const std::vector<std::string> stackOutputNames[] = {{"input.672", "1438", "1445"}, {"input.1332", "1686", "1693"}};
+    params.laneOutputNames = stackOutputNames[args.stack - 1];
+    params.outputSelection = args.outputSelection;
     params.dlaCore = args.useDLACore;
     params.int8 = args.runInInt8;
     params.fp16 = args.runInFp16;
+    params.backend = args.backend;
+    params.recordFileName = args.recordOutputs;
+    params.replayFileName = args.replayOutputs;
+    params.inferThreads = args.inferThreads;
+    params.cpuThreads = args.cpuThreads;
+    params.dnnTarget = args.dnnTarget;
+    params.dnnThreads = args.dnnThreads;
+    params.decodeThreads = args.decodeThreads;
+    params.fullDecode = args.fullDecode;
+    params.inputCache = args.inputCache;
+    params.inputCacheFormat = args.inputCacheFormat;
+    params.inputCacheBytes = static_cast<int64_t>(args.inputCacheSize) << 20;
+    params.postprocessThreads = args.postprocessThreads;
+    params.trackInterval = args.trackInterval;
+    params.fitDegree = args.fitDegree;
+    params.laneModelFileName = args.laneModels;
+    params.annotation = args.annotation;
+    params.show = args.show;
+    params.batchSize = args.batch;
+    params.engineCache = args.engineCache;
+    params.loadEngine = args.loadEngine;
+    params.saveEngine = args.saveEngine;
 
     return params;
 }
@@ -585,17 +1041,66 @@ samplesCommon::OnnxSampleParams initializeSampleParams(const samplesCommon::Args
 void printHelpInfo()
 {
     std::cout << "Usage: ./pinettensorrt [-h or --help] [-d or --datadir=<path to data path>] [--useDLACore=<int>]" << std::endl;
+    std::cout << "                       [--backend=<tensorrt|cpu|opencv|replay>] [--recordOutputs=<file>] [--replayOutputs=<file>]" << std::endl;
+    std::cout << "                       [--batch=N] [--decodeThreads=N] [--preprocessThreads=N] [--inferThreads=N] [--cpuThreads=N] [--dnnTarget=<target>] [--dnnThreads=N] [--postprocessThreads=N] [--queueSize=N]" << std::endl;
+    std::cout << "                       [--engineCache=<dir>] [--noEngineCache] [--loadEngine=<file>] [--saveEngine=<file>] [--outputs=<lanes|all>]" << std::endl;
+    std::cout << "                       [--onnx=<file>] [--stack=<1|2>] [--scanThreads=N] [--unsorted] [--fullDecode]" << std::endl;
+    std::cout << "                       [--shard=<file>] [--inputCache=<dir>] [--inputCacheFormat=<uint8|fp16>] [--inputCacheSize=<MiB>]" << std::endl;
+    std::cout << "                       [--video=<input>] [--videoPolicy=<block|dropOldest|latest>] [--videoBuffer=N] [--videoFrames=N] [--videoRealtime]" << std::endl;
+    std::cout << "                       [--track=K] [--trackConfidence=F] [--fitLanes=N] [--laneModels=<file>]" << std::endl;
+    std::cout << "                       [--saveOutputs=<dir>] [--saveEvery=N] [--saveAnomalies] [--saveThreads=N] [--saveQueue=N] [--show]" << std::endl;
     std::cout << "--help          Display help information" << std::endl;
     std::cout << "--datadir       Specify path to a data path, overriding the default. This option can be used multiple times to add multiple directories. If no data directories are given, the default is to use (data/samples/mnist/, data/mnist/)" << std::endl;
+    std::cout << "--shard=<file>  Read the images packed in the given shard by packShard, before those of --datadir. This option can be used multiple times, the default data path is only used without --datadir and --shard." << std::endl;
+    std::cout << "--video=<input> Read the frames of a video file, a camera device path or index, a stream URL, or synthetic[:<width>x<height>@<fps>], a generated road at a steady rate, after the images of --shard and --datadir. The default data path is not used with --video." << std::endl;
     std::cout << "--useDLACore=N  Specify a DLA engine for layers that support DLA. Value can range from 0 to n-1, where n is the number of DLA engines on the platform." << std::endl;
     std::cout << "--int8          Run in Int8 mode." << std::endl;
     std::cout << "--fp16          Run in FP16 mode." << std::endl;
+    std::cout << "--backend       Inference backend. tensorrt runs the engine built from pinet.onnx, cpu runs pinet.onnx on the CPU with the built-in engine, opencv runs it with cv::dnn, replay replays the outputs recorded with --recordOutputs on the CPU. Default is " << pinet::kDEFAULT_BACKEND << ", tensorrt needs a build with PINET_WITH_TENSORRT." << std::endl;
+    std::cout << "--recordOutputs Record the network outputs of every image to the given file." << std::endl;
+    std::cout << "--replayOutputs Recording replayed by the replay backend, frames are replayed in order and wrap around." << std::endl;
+    std::cout << "--batch=N              Number of images run by one inference call. Default is 1." << std::endl;
+    std::cout << "--decodeThreads=N      Number of threads reading images. Default is 1." << std::endl;
+    std::cout << "--fullDecode           Decode JPEG images at full size. By default the decoder scales them down by 2, 4 or 8 as far as they still cover the network input, and lane lines are drawn at that size." << std::endl;
+    std::cout << "--preprocessThreads=N  Number of threads resizing and normalizing images. Default is 1." << std::endl;
+    std::cout << "--inferThreads=N       Number of threads running the network, each one with its own backend. Default is 1." << std::endl;
+    std::cout << "--cpuThreads=N         Number of threads of the cpu backend of each infer worker. Default is the number of cores divided by --inferThreads." << std::endl;
+    std::cout << "--dnnTarget=<target>   Device and precision of the opencv backend: cpu, opencl, opencl_fp16, cuda or cuda_fp16. OpenCV falls back to the CPU if it lacks the device. Default is cpu." << std::endl;
+    std::cout << "--dnnThreads=N         Number of threads cv::dnn runs the layers on, shared by all infer workers and the resizing of the preprocess stage. Default is OpenCV's, all cores." << std::endl;
+    std::cout << "--postprocessThreads=N Number of threads extracting and drawing lane lines. Default is 1." << std::endl;
+    std::cout << "--queueSize=N          Number of images buffered between two stages. Default is 4." << std::endl;
+    std::cout << "--videoPolicy=P        What the capture does with a new video frame while the pipeline is busy. block waits for room, dropOldest drops the oldest buffered frame, latest keeps only the newest one. Default is block." << std::endl;
+    std::cout << "--videoBuffer=N        Number of video frames buffered between the capture and the pipeline, always 1 with latest. Default is 4." << std::endl;
+    std::cout << "--videoFrames=N        Stop the video after N frames, dropped frames included. Default is the whole input." << std::endl;
+    std::cout << "--videoRealtime        Read video files at their frame rate like a camera, instead of as fast as the pipeline takes them." << std::endl;
+    std::cout << "--inputCache=<dir>     Keep the network input of every image in the given directory, keyed by the image, the modification time and size of its file and the preprocessing. Later runs load it instead of decoding and preprocessing the image, lane lines are then not drawn." << std::endl;
+    std::cout << "--inputCacheFormat=F   Element type of the cached inputs, uint8 is lossless, fp16 keeps any normalization. Default is uint8." << std::endl;
+    std::cout << "--inputCacheSize=N     Size in MiB the cached inputs take at most, the least recently used ones are removed past it. Default is 4096." << std::endl;
+    std::cout << "--track=K              Infer one frame in K of each clip, i.e. images of a directory, shard clip or video, and carry its lane lines over the frames in between, moving them as they moved between inferred frames and refining them on the image. Default is to infer every frame." << std::endl;
+    std::cout << "--trackConfidence=F    Share of the lane markings of the last inferred frame still found by the tracker below which the next frame is inferred, between 0 and 1. Default is 0.5." << std::endl;
+    std::cout << "--fitLanes=N           Fit every lane line with a polynomial of degree N, 1 to 3, by least squares, annotated images show the curve over the points. Default is to keep only the points, or 2 with --laneModels." << std::endl;
+    std::cout << "--laneModels=<file>    Write the fitted lane models of every frame to the given file in a compact binary format, see laneModel.h." << std::endl;
+    std::cout << "--saveOutputs=<dir>    Draw the lane lines onto the images and write them to the given directory in the background, one file per input named after its path. Nothing is written by default." << std::endl;
+    std::cout << "--saveEvery=N          Write every Nth frame only. Default is every frame, or none but the anomalies with --saveAnomalies." << std::endl;
+    std::cout << "--saveAnomalies        Write the frames with an anomaly: a failed frame, one the tracker lost or one whose number of lanes changed." << std::endl;
+    std::cout << "--saveThreads=N        Number of threads drawing and writing images. Default is 1." << std::endl;
+    std::cout << "--saveQueue=N          Number of frames waiting to be written, past which new frames are dropped rather than holding the pipeline up. Default is 8." << std::endl;
+    std::cout << "--show                 Show the lane lines of every frame in a window, images wait for a key." << std::endl;
+    std::cout << "--scanThreads=N        Number of threads looking for .jpg images in the data directories, images are processed as they are found. Default is 2." << std::endl;
+    std::cout << "--unsorted             Process the images in the order they are found instead of in natural name order, directory by directory." << std::endl;
+    std::cout << "--engineCache=<dir>    Directory of the built engines, keyed by the hash of pinet.onnx, the precision, the DLA core, the batch and the TensorRT version. An engine found there is loaded instead of built, a built one is written there. Default is no cache, the engine is built on every run and nothing is written." << std::endl;
+    std::cout << "--noEngineCache        Always build the engine from pinet.onnx, overriding --engineCache." << std::endl;
+    std::cout << "--loadEngine=<file>    Load the engine from the given file instead of building it." << std::endl;
+    std::cout << "--saveEngine=<file>    Also write the built engine to the given file." << std::endl;
+    std::cout << "--onnx=<file>          ONNX model the engine is built from. Default is pinet.onnx. Images are normalized as its metadata asks, see foldNormalization." << std::endl;
+    std::cout << "--stack=<1|2>          Hourglass stack whose heads post-processing reads. 1 exits after the first stack, the layers of the second one are dropped from the engine unless --outputs=all. Default is 2." << std::endl;
+    std::cout << "--outputs=<lanes|all>  Outputs kept by the network. lanes keeps the three heads post-processing reads, all keeps the six heads of both hourglasses, e.g. to record them. Default is lanes." << std::endl;
 }
 
 int main(int argc, char** argv)
 {
-    samplesCommon::Args args;
-    bool argsOK = samplesCommon::parseArgs(args, argc, argv);
+    pinet::Args args;
+    bool argsOK = pinet::parseArgs(args, argc, argv);
     if (!argsOK)
     {
         sample::gLogError << "Invalid arguments" << std::endl;
@@ -613,47 +1118,230 @@ int main(int argc, char** argv)
 
     sample::gLogger.reportTestStart(test);
 
-    samplesCommon::OnnxSampleParams onnx_args = initializeSampleParams(args);
+    PINetParams onnx_args = initializeSampleParams(args);
     PINetTensorrt sample(onnx_args);
 
-    sample::gLogInfo << "Building and running a GPU inference engine for Onnx PINet" << std::endl;
+    if (onnx_args.backend == "tensorrt") {
+        sample::gLogInfo << "Building and running a GPU inference engine for Onnx PINet" << std::endl;
+    } else {
+        sample::gLogInfo << "Running Onnx PINet with the " << onnx_args.backend << " backend" << std::endl;
+    }
+    sample::gLogInfo << "Preprocessing with " << pinet::toString(pinet::getSimdLevel()) << " kernels" << std::endl;
+
+    // Shards are mapped, their images are decoded in place
+    std::vector<std::unique_ptr<pinet::ShardReader>> shards;
+    for (const auto& fileName : args.shards) {
+        shards.emplace_back(new pinet::ShardReader);
+        if (!shards.back()->open(fileName)) {
+            return sample::gLogger.reportFail(test);
+        }
+        sample::gLogInfo << fileName << ": " << shards.back()->getImageCount() << " images" << std::endl;
+    }
+
+    // The images are looked for while the engine is built, then streamed to the pipeline as they are found
+    pinet::DirectoryScanner scanner(onnx_args.dataDirs, ".jpg", args.scanThreads, args.sortFiles);
 
     if (!sample.build())
     {
         return sample::gLogger.reportFail(test);
     }
 
-    std::vector<std::string> filenames;
-    filenames.reserve(20480);
-    for (size_t i = 0; i < onnx_args.dataDirs.size(); i++) {
-        getFiles(onnx_args.dataDirs[i], ".jpg", filenames);
+    // The capture starts once the engine is ready, so that no frame waits for the build
+    pinet::VideoSource video;
+    if (!args.video.empty() && !video.open(args.video, args.videoOptions)) {
+        return sample::gLogger.reportFail(test);
     }
 
-    auto inference_begin_time = std::chrono::high_resolution_clock::now();
+    using FramePtr = std::unique_ptr<pinet::Frame>;
+    auto stage = [](const char* name, std::function<bool(int32_t, pinet::Frame&)> work) {
+        return [name, work](int32_t worker, FramePtr& frame) {
+            if (!frame->failedStage && !work(worker, *frame)) {
+                frame->failedStage = name;
+            }
+        };
+    };
+
+    auto timed = [](pinet::Stage id, std::function<bool(int32_t, pinet::Frame&)> work) {
+        return [id, work](int32_t worker, pinet::Frame& frame) {
+            auto start = pinet::Clock::now();
+            bool status = work(worker, frame);
+            frame.times[id] = pinet::elapsedMs(start);
+            return status;
+        };
+    };
 
-    for (const auto& filename : filenames) {
-        sample.setImageFile(filename);
-        if (!sample.infer()) {
-            sample::gLogger.reportFail(test);
+    pinet::Pipeline<FramePtr> pipeline(args.queueSize);
+    pipeline.addStage("decode", args.decodeThreads, stage("decode", timed(pinet::Stage::kDECODE, [&sample](int32_t worker, pinet::Frame& frame) {
+        return sample.decode(worker, frame);
+    })));
+    pipeline.addStage("preprocess", args.preprocessThreads, stage("preprocess", timed(pinet::Stage::kPREPROCESS, [&sample](int32_t, pinet::Frame& frame) {
+        return sample.processInput(frame);
+    })));
+    // Frames of the current batch of each infer worker, kept so that running a batch does not allocate
+    std::vector<std::vector<pinet::Frame*>> batchFrames(args.inferThreads);
+    pipeline.addBatchStage("infer", args.inferThreads, args.batch, [&sample, &batchFrames](int32_t worker, std::vector<FramePtr>& batch) {
+        std::vector<pinet::Frame*>& frames = batchFrames[worker];
+        frames.clear();
+        for (auto& frame : batch) {
+            if (!frame->failedStage && !frame->tracked) {
+                frames.push_back(frame.get());
+            }
         }
-    }
+        if (!frames.empty() && !sample.infer(worker, frames)) {
+            for (auto* frame : frames) {
+                frame->failedStage = "infer";
+            }
+        }
+    });
+    pipeline.addStage("postprocess", args.postprocessThreads, stage("postprocess", [&sample](int32_t worker, pinet::Frame& frame) {
+        return sample.verifyOutput(worker, frame);
+    }));
+
+    // Frames the sink is done with go back to the source, with the buffers they were inferred into
+    pinet::FramePool framePool;
+    int64_t nextFile = 0;
+    size_t shard = 0;
+    int64_t nextShardImage = 0;
+    // Frames of a clip are inferred every trackInterval frames, or sooner once the sink lost the lanes
+    std::string trackedClip;
+    int32_t sinceInferred = 0;
+    int64_t inferredFrames = 0;
+    int64_t lostFrames = 0;
+    std::atomic<bool> lanesLost{false};
+    auto source = [&](FramePtr& frame) {
+        while (shard < shards.size() && nextShardImage == shards[shard]->getImageCount()) {
+            ++shard;
+            nextShardImage = 0;
+        }
+        std::string fileName;
+        std::string clip;
+        const pinet::ShardReader* shardReader = nullptr;
+        int64_t shardImage = 0;
+        pinet::CapturedFrame captured;
+        if (shard < shards.size()) {
+            const pinet::ShardReader& reader = *shards[shard];
+            fileName = args.shards[shard] + ":" + reader.getName(nextShardImage);
+            clip = args.shards[shard] + ":" + reader.getClip(nextShardImage);
+            shardReader = &reader;
+            shardImage = nextShardImage++;
+        } else if (scanner.next(fileName)) {
+            clip = fileName.substr(0, fileName.rfind('/') + 1);
+        } else {
+            if (args.video.empty() || !video.next(captured)) {
+                return false;
+            }
+            fileName = args.video + "#" + std::to_string(captured.sequence);
+            clip = args.video;
+        }
+        const bool clipStart = clip != trackedClip;
+        const bool inferred = !args.trackInterval || clipStart || ++sinceInferred >= args.trackInterval || lanesLost;
+        if (inferred) {
+            trackedClip = clip;
+            sinceInferred = 0;
+            lanesLost = false;
+            ++inferredFrames;
+        }
+        frame = framePool.acquire();
+        frame->tracked = !inferred;
+        frame->clipStart = clipStart;
+        frame->created = pinet::Clock::now();
+        frame->captured = captured.captured;
+        frame->index = nextFile++;
+        frame->fileName = std::move(fileName);
+        frame->shard = shardReader;
+        frame->shardImage = shardImage;
+        frame->image = std::move(captured.image);
+        return true;
+    };
+
+    // Frames leave the stages in completion order, the sink restores the input order
+    std::map<int64_t, FramePtr> pending;
+    int64_t nextFrame = 0;
+    pinet::LatencyReport latencies;
+    int64_t previousLaneCount = -1;
+    auto sink = [&](FramePtr& frame) {
+        pending.emplace(frame->index, std::move(frame));
+        for (auto itr = pending.begin(); itr != pending.end() && itr->first == nextFrame; itr = pending.erase(itr), ++nextFrame) {
+            pinet::Frame& done = *itr->second;
+            // Latency up to the lane lines being available in input order, i.e. including reordering
+            done.times[pinet::Stage::kFRAME] = pinet::elapsedMs(done.created);
+            if (done.captured != pinet::Clock::time_point()) {
+                done.times[pinet::Stage::kGLASS] = pinet::elapsedMs(done.captured);
+            }
+            latencies.add(done.times);
+            if (done.failedStage && strcmp(done.failedStage, "postprocess")) {
+                sample::gLogError << done.fileName << ": " << done.failedStage << " failed" << std::endl;
+            }
+            const bool lost = args.trackInterval && sample.track(done) < args.trackConfidence;
+            if (lost) {
+                lanesLost = true;
+                ++lostFrames;
+            }
+            // Anomalies are failed frames, frames the tracker lost and frames gaining or losing a lane
+            const int64_t laneCount = static_cast<int64_t>(done.laneLines.size());
+            const bool anomaly = done.failedStage || lost || (previousLaneCount >= 0 && laneCount != previousLaneCount);
+            previousLaneCount = laneCount;
+            if (!sample.writeOutput(done, anomaly)) {
+                sample::gLogger.reportFail(test);
+            }
+            framePool.release(std::move(itr->second));
+        }
+    };
+
+    auto inference_begin_time = std::chrono::high_resolution_clock::now();
+
+    pipeline.run(source, sink);
 
     auto inference_elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - inference_begin_time);
 
+    // Images still queued are written after the timing, they are not part of the inference
+    sample.closeOutputs();
+
+    if (onnx_args.backend == "cpu") {
+        pinet::printLayerTimings(sample.getLayerTimings(), 10, std::cout);
+    }
+
+    if (!args.video.empty()) {
+        const pinet::VideoSource::Statistics capture = video.getStatistics();
+        sample::gLogInfo << "Video: " << capture.captured << " frames captured, " << capture.dropped << " dropped by the "
+                         << pinet::toString(args.videoOptions.policy) << " policy" << std::endl;
+    }
+    if (args.trackInterval) {
+        sample::gLogInfo << "Tracking: " << inferredFrames << " of " << nextFile << " frames inferred, " << lostFrames
+                         << " frames below the tracking confidence" << std::endl;
+    }
+    if (!args.laneModels.empty()) {
+        const pinet::LaneModelWriter& writer = sample.getLaneModelWriter();
+        sample::gLogInfo << "Lane models: " << writer.getModelBytes() << " bytes written for " << writer.getPointBytes()
+                         << " bytes of lane line points" << std::endl;
+    }
+    if (!args.annotation.directory.empty()) {
+        const pinet::AnnotationWriter::Statistics annotated = sample.getAnnotationWriter().getStatistics();
+        sample::gLogInfo << "Annotated images: " << annotated.written << " written to " << args.annotation.directory << ", "
+                         << annotated.dropped << " dropped with the queue full, " << annotated.failed << " failed" << std::endl;
+    }
+    for (auto const& error : scanner.getErrors()) {
+        sample::gLogWarning << "Cannot read directory " << error << std::endl;
+    }
+    if (sample.getInputCache().isOpen()) {
+        const pinet::InputCache::Statistics cache = sample.getInputCache().getStatistics();
+        sample::gLogInfo << "Input cache: " << cache.hits << " hits, " << cache.misses << " misses, " << cache.stores << " stored, "
+                         << cache.evictions << " evicted, " << cache.bytes / (1 << 20) << " MiB" << std::endl;
+    }
+
     sample::gLogger.reportPass(test);
 
     sample::gLogInfo << std::endl;
 
     sample::gLogInfo <<     "totally inference time      : " << inference_elapsed_time.count() / 1000.f << " milliseconds" << std::endl;
-    if (filenames.size()) {
-        sample::gLogInfo << "totally inference times     : " << filenames.size() << std::endl;
-        sample::gLogInfo << "average inference time      : " << inference_elapsed_time.count() / filenames.size() / 1000.f << " milliseconds"<< std::endl;
+    if (nextFile) {
+        sample::gLogInfo << "totally inference times     : " << nextFile << std::endl;
+        sample::gLogInfo << "average inference time      : " << inference_elapsed_time.count() / nextFile / 1000.f << " milliseconds"<< std::endl;
     }
 
-    if (total_inference_execute_times > 0) {
-        sample::gLogInfo << "totally execute elapsed time: " << total_inference_execute_elasped_time / 1000.f << " milliseconds" << std::endl << std::endl;
-        sample::gLogInfo << "inference execute times     : " << total_inference_execute_times << std::endl;
-        sample::gLogInfo << "average execute elapsed time: " << total_inference_execute_elasped_time / total_inference_execute_times / 1000.f << " milliseconds" << std::endl << std::endl;
+    if (nextFile) {
+        sample::gLogInfo << std::endl;
+        latencies.print(sample::gLogInfo);
     }
 
     return 0;
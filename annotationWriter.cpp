@@ -0,0 +1,193 @@
+#include "annotationWriter.h"
+#include "logger.h"
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/stat.h>
+
+namespace pinet
+{
+
+namespace
+{
+
+cv::Scalar const kCOLORS[] = {{255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 0}, {255, 0, 255}, {0, 255, 255},
+    {255, 255, 255}, {100, 255, 0}, {100, 0, 255}, {255, 100, 0}, {0, 100, 255}, {255, 0, 100}, {0, 255, 100}};
+constexpr size_t kCOLOR_COUNT = sizeof(kCOLORS) / sizeof(kCOLORS[0]);
+
+//!
+//! \brief Maps a point of the output grid onto the image, scale being the size of a grid cell in pixels.
+//!
+cv::Point2f toImagePoint(cv::Point2f const& point, cv::Point2f const& scale)
+{
+    return cv::Point2f(point.x * scale.x, point.y * scale.y);
+}
+
+} // namespace
+
+void drawLanes(cv::Mat& image, LaneLines const& laneLines, std::vector<LaneModel> const& laneModels,
+    int32_t gridWidth, int32_t gridHeight)
+{
+    if (image.empty())
+    {
+        return;
+    }
+
+    cv::Point2f const scale(static_cast<float>(image.cols) / gridWidth, static_cast<float>(image.rows) / gridHeight);
+    for (size_t i = 0; i < laneLines.size(); ++i)
+    {
+        for (auto const& point : laneLines[i])
+        {
+            cv::circle(image, toImagePoint(point, scale), 3, kCOLORS[i % kCOLOR_COUNT], -1);
+        }
+    }
+
+    // Fitted curves are drawn over the points they were fitted to, sampled every half row
+    for (size_t i = 0; i < laneModels.size(); ++i)
+    {
+        LaneModel const& model = laneModels[i];
+        cv::Point2f previous = toImagePoint(cv::Point2f(evaluateLaneModel(model, model.yMin), model.yMin), scale);
+        for (float y = model.yMin + 0.5f; y < model.yMax + 0.5f; y += 0.5f)
+        {
+            float const row = std::min(y, model.yMax);
+            cv::Point2f const point = toImagePoint(cv::Point2f(evaluateLaneModel(model, row), row), scale);
+            cv::line(image, previous, point, kCOLORS[i % kCOLOR_COUNT], 2);
+            previous = point;
+        }
+    }
+}
+
+std::string getAnnotatedName(std::string const& directory, std::string const& fileName)
+{
+    // Leading ./, ../ and / say nothing about the input
+    size_t begin = 0;
+    for (;;)
+    {
+        if (fileName.compare(begin, 2, "./") == 0)
+        {
+            begin += 2;
+        }
+        else if (fileName.compare(begin, 3, "../") == 0)
+        {
+            begin += 3;
+        }
+        else if (fileName.compare(begin, 1, "/") == 0)
+        {
+            begin += 1;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    std::string name = fileName.substr(begin);
+    std::replace_if(name.begin(), name.end(), [](char c) { return c == '/' || c == ':' || c == '#'; }, '_');
+    if (name.size() < 4 || name.compare(name.size() - 4, 4, ".jpg") != 0)
+    {
+        name += ".jpg";
+    }
+    return directory + "/" + name;
+}
+
+AnnotationWriter::~AnnotationWriter()
+{
+    close();
+}
+
+bool AnnotationWriter::open(AnnotationOptions const& options, int32_t gridWidth, int32_t gridHeight)
+{
+    if (options.directory.empty())
+    {
+        return true;
+    }
+    if (mkdir(options.directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        sample::gLogError << "Cannot create " << options.directory << std::endl;
+        return false;
+    }
+
+    mOptions = options;
+    mOptions.threads = std::max(mOptions.threads, 1);
+    mOptions.queueSize = std::max(mOptions.queueSize, 1);
+    mGridWidth = gridWidth;
+    mGridHeight = gridHeight;
+    for (int32_t t = 0; t < mOptions.threads; ++t)
+    {
+        mThreads.emplace_back(&AnnotationWriter::work, this);
+    }
+    return true;
+}
+
+bool AnnotationWriter::submit(Frame const& frame, bool anomaly)
+{
+    bool const sampled = (mOptions.every && frame.index % mOptions.every == 0) || (mOptions.anomalies && anomaly);
+    if (!isOpen() || !sampled || frame.image.empty())
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mJobs.size() >= static_cast<size_t>(mOptions.queueSize))
+    {
+        ++mStatistics.dropped;
+        return false;
+    }
+    mJobs.push_back(Job{frame.fileName, frame.image, frame.laneLines, frame.laneModels});
+    mChanged.notify_one();
+    return true;
+}
+
+void AnnotationWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+    }
+    mChanged.notify_all();
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+}
+
+AnnotationWriter::Statistics AnnotationWriter::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
+
+void AnnotationWriter::work()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mChanged.wait(lock, [this] { return !mJobs.empty() || mClosed; });
+            if (mJobs.empty())
+            {
+                return;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        drawLanes(job.image, job.laneLines, job.laneModels, mGridWidth, mGridHeight);
+        std::string const name = getAnnotatedName(mOptions.directory, job.fileName);
+        bool const written = cv::imwrite(name, job.image);
+        if (!written)
+        {
+            sample::gLogWarning << "Cannot write " << name << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++(written ? mStatistics.written : mStatistics.failed);
+    }
+}
+
+} // namespace pinet
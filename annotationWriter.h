@@ -0,0 +1,131 @@
+#ifndef PINET_ANNOTATION_WRITER_H
+#define PINET_ANNOTATION_WRITER_H
+
+#include "frame.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Draws lane lines and the curves fitted to them onto image.
+//!
+//! \param gridWidth Width of the output grid the lane lines and models are given in.
+//! \param gridHeight Height of the output grid.
+//!
+void drawLanes(cv::Mat& image, LaneLines const& laneLines, std::vector<LaneModel> const& laneModels,
+    int32_t gridWidth, int32_t gridHeight);
+
+//!
+//! \brief Returns the file in directory the annotated image of an input is written to.
+//!
+//! \details The name is the path of the input with its separators replaced by '_', so that inputs of
+//!          different directories, shards and videos do not collide, e.g. data/clip/1.jpg gives
+//!          data_clip_1.jpg and a frame video.mp4#12 gives video.mp4_12.jpg.
+//!
+std::string getAnnotatedName(std::string const& directory, std::string const& fileName);
+
+//!
+//! \brief The AnnotationOptions structure configures an AnnotationWriter.
+//!
+struct AnnotationOptions
+{
+    std::string directory;   //!< Directory the annotated images are written to, empty to write none
+    int32_t every{0};        //!< Write every Nth frame, 0 for none but the anomalies
+    bool anomalies{false};   //!< Write the frames with an anomaly as well
+    int32_t threads{1};      //!< Number of threads drawing and encoding images
+    int32_t queueSize{8};    //!< Frames waiting for a thread, past which new ones are dropped
+};
+
+//!
+//! \brief  The AnnotationWriter class draws the lane lines of sampled frames onto their images and writes them
+//!         as JPEG files on a pool of threads.
+//!
+//! \details submit() never blocks, a frame coming while the queue is full is dropped, so that writing images
+//!          cannot slow the pipeline down. Frames are sampled by their index, every Nth one, and by anomaly.
+//!
+class AnnotationWriter
+{
+public:
+    AnnotationWriter() = default;
+
+    ~AnnotationWriter();
+
+    AnnotationWriter(AnnotationWriter const&) = delete;
+    AnnotationWriter& operator=(AnnotationWriter const&) = delete;
+
+    //!
+    //! \brief Creates the output directory and starts the threads, nothing is written if it is not set.
+    //!
+    bool open(AnnotationOptions const& options, int32_t gridWidth, int32_t gridHeight);
+
+    bool isOpen() const
+    {
+        return !mThreads.empty();
+    }
+
+    //!
+    //! \brief Queues frame if it is sampled and has an image. The image is shared and drawn on later, the caller
+    //!        must not modify it any more.
+    //!
+    //! \param anomaly Whether something went wrong with the frame, see AnnotationOptions::anomalies.
+    //!
+    //! \return false if the frame was dropped because the queue is full
+    //!
+    bool submit(Frame const& frame, bool anomaly);
+
+    //!
+    //! \brief Writes the queued frames and stops the threads.
+    //!
+    void close();
+
+    //!
+    //! \brief The Statistics structure counts the frames of the writer.
+    //!
+    struct Statistics
+    {
+        int64_t written{0};
+        int64_t dropped{0}; //!< Sampled frames dropped with the queue full
+        int64_t failed{0};  //!< Frames which could not be written
+    };
+
+    Statistics getStatistics() const;
+
+private:
+    //!
+    //! \brief The Job structure is what a thread needs of a frame.
+    //!
+    struct Job
+    {
+        std::string fileName;
+        cv::Mat image;
+        LaneLines laneLines;
+        std::vector<LaneModel> laneModels;
+    };
+
+    void work();
+
+    AnnotationOptions mOptions;
+    int32_t mGridWidth{0};
+    int32_t mGridHeight{0};
+
+    mutable std::mutex mMutex;
+    std::condition_variable mChanged;
+    std::deque<Job> mJobs;
+    bool mClosed{false};
+    Statistics mStatistics;
+    std::vector<std::thread> mThreads;
+};
+
+} // namespace pinet
+
+#endif // PINET_ANNOTATION_WRITER_H
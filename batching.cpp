@@ -0,0 +1,69 @@
+#include "batching.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace pinet
+{
+
+TensorDesc imageDesc(TensorDesc desc)
+{
+    desc.dims[0] = 1;
+    return desc;
+}
+
+void packBatch(std::vector<Frame*> const& frames, InferenceBackend& backend)
+{
+    int32_t const batchSize = backend.getBatchSize();
+    assert(static_cast<int32_t>(frames.size()) <= batchSize);
+
+    size_t const imageVolume = backend.getInput().volume() / batchSize;
+    float* input = backend.getInputBuffer();
+    for (auto const* frame : frames)
+    {
+        assert(frame->input.size() == imageVolume);
+        input = std::copy(frame->input.begin(), frame->input.end(), input);
+    }
+    std::fill(input, backend.getInputBuffer() + batchSize * imageVolume, 0.f);
+
+    for (size_t b = 0; b < frames.size(); ++b)
+    {
+        backend.setSequenceNumber(static_cast<int32_t>(b), frames[b]->index);
+    }
+}
+
+void unpackBatch(InferenceBackend const& backend, std::vector<Frame*> const& frames)
+{
+    int32_t const batchSize = backend.getBatchSize();
+    auto const& outputs = backend.getOutputs();
+    for (size_t b = 0; b < frames.size(); ++b)
+    {
+        Frame& frame = *frames[b];
+        frame.outputs.resize(outputs.size());
+        for (size_t i = 0; i < outputs.size(); ++i)
+        {
+            size_t const imageVolume = outputs[i].volume() / batchSize;
+            float const* output = backend.getOutputBuffer(i) + b * imageVolume;
+            frame.outputs[i].assign(output, output + imageVolume);
+        }
+        frame.inferred = true;
+    }
+}
+
+bool inferBatch(InferenceBackend& backend, std::vector<Frame*> const& frames)
+{
+    if (frames.empty())
+    {
+        return true;
+    }
+
+    packBatch(frames, backend);
+    if (!backend.infer())
+    {
+        return false;
+    }
+    unpackBatch(backend, frames);
+    return true;
+}
+
+} // namespace pinet
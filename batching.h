@@ -0,0 +1,41 @@
+#ifndef PINET_BATCHING_H
+#define PINET_BATCHING_H
+
+#include "frame.h"
+#include "inferenceBackend.h"
+
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Returns desc with its batch dimension set to one, i.e. the description of a single image.
+//!
+TensorDesc imageDesc(TensorDesc desc);
+
+//!
+//! \brief Copies the inputs of frames into consecutive slots of the NCHW input buffer of backend.
+//!
+//! \details frames must not hold more images than the batch size of backend. The slots of a partial
+//!          batch which are not used are zero filled.
+//!
+void packBatch(std::vector<Frame*> const& frames, InferenceBackend& backend);
+
+//!
+//! \brief Splits every output of backend per image and stores the slices in the outputs of frames.
+//!
+//! \details The outputs of recycled frames are overwritten in place, without allocating.
+//!
+void unpackBatch(InferenceBackend const& backend, std::vector<Frame*> const& frames);
+
+//!
+//! \brief Runs frames as a single batch on backend.
+//!
+//! \return true if the outputs of all frames were filled
+//!
+bool inferBatch(InferenceBackend& backend, std::vector<Frame*> const& frames);
+
+} // namespace pinet
+
+#endif // PINET_BATCHING_H
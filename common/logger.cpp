@@ -16,10 +16,14 @@
  */
 
 #include "logger.h"
+#if PINET_WITH_TENSORRT
 #include "ErrorRecorder.h"
+#endif
 #include "logging.h"
 
+#if PINET_WITH_TENSORRT
 SampleErrorRecorder gRecorder;
+#endif
 namespace sample
 {
 Logger gLogger{Logger::Severity::kINFO};
@@ -18,8 +18,12 @@
 #ifndef TENSORRT_LOGGING_H
 #define TENSORRT_LOGGING_H
 
+#if PINET_WITH_TENSORRT
 #include "NvInferRuntimeCommon.h"
 #include "sampleOptions.h"
+#else
+#include "standaloneLogger.h"
+#endif
 #include <cassert>
 #include <ctime>
 #include <iomanip>
@@ -232,6 +236,7 @@ inline LogStreamConsumer& operator<<(LogStreamConsumer& logger, std::ostream& (*
     return logger;
 }
 
+#if PINET_WITH_TENSORRT
 inline LogStreamConsumer& operator<<(LogStreamConsumer& logger, const nvinfer1::Dims& dims)
 {
     if (logger.getShouldLog())
@@ -245,6 +250,7 @@ inline LogStreamConsumer& operator<<(LogStreamConsumer& logger, const nvinfer1::
     }
     return logger;
 }
+#endif
 
 //!
 //! \class Logger
@@ -379,8 +385,12 @@ public:
     //!
     static TestAtom defineTest(const std::string& name, int32_t argc, char const* const* argv)
     {
+#if PINET_WITH_TENSORRT
         // Append TensorRT version as info
         const std::string vname = name + " [TensorRT v" + std::to_string(NV_TENSORRT_VERSION) + "]";
+#else
+        const std::string& vname = name;
+#endif
         auto cmdline = genCmdlineString(argc, argv);
         return defineTest(vname, cmdline);
     }
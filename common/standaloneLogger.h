@@ -0,0 +1,33 @@
+#ifndef PINET_STANDALONE_LOGGER_H
+#define PINET_STANDALONE_LOGGER_H
+
+#include <cstdint>
+
+namespace nvinfer1
+{
+
+//!
+//! \brief The part of the TensorRT logger interface logging.h derives sample::Logger from, for targets built
+//!        without TensorRT. Severities keep the values TensorRT gives them.
+//!
+class ILogger
+{
+public:
+    enum class Severity : int32_t
+    {
+        kINTERNAL_ERROR = 0,
+        kERROR = 1,
+        kWARNING = 2,
+        kINFO = 3,
+        kVERBOSE = 4,
+    };
+
+    virtual void log(Severity severity, char const* msg) noexcept = 0;
+
+protected:
+    virtual ~ILogger() = default;
+};
+
+} // namespace nvinfer1
+
+#endif // PINET_STANDALONE_LOGGER_H
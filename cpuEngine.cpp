@@ -0,0 +1,770 @@
+#include "cpuEngine.h"
+#include "logger.h"
+#include "onnxModel.h"
+#include "stageTiming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <set>
+
+namespace pinet
+{
+
+namespace
+{
+
+//!
+//! \brief The Initializer structure holds a constant tensor of the model.
+//!
+struct Initializer
+{
+    std::vector<int64_t> dims;
+    std::vector<float> values; //!< Empty if the tensor does not hold floats
+};
+
+//!
+//! \brief The Node structure holds what the engine reads of a node of the graph.
+//!
+struct Node
+{
+    std::string op;
+    std::string name;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::map<std::string, ProtoMessage> attributes;
+};
+
+bool readInitializer(ProtoMessage const& tensor, Initializer& initializer)
+{
+    std::string const name = tensor.getString(onnx::kTENSOR_NAME);
+    if (tensor.getInt(onnx::kTENSOR_DATA_LOCATION) != 0)
+    {
+        sample::gLogError << "Initializer " << name << " is stored outside of the model, which is not supported"
+                          << std::endl;
+        return false;
+    }
+    initializer.dims = tensor.getInts(onnx::kTENSOR_DIMS);
+    if (tensor.getInt(onnx::kTENSOR_DATA_TYPE) != onnx::kDATA_TYPE_FLOAT)
+    {
+        return true;
+    }
+
+    int64_t volume = 1;
+    for (int64_t d : initializer.dims)
+    {
+        volume *= d;
+    }
+    std::string const raw = tensor.getString(onnx::kTENSOR_RAW_DATA);
+    if (!raw.empty())
+    {
+        if (static_cast<int64_t>(raw.size()) != volume * static_cast<int64_t>(sizeof(float)))
+        {
+            sample::gLogError << "Initializer " << name << " holds " << raw.size() << " bytes for " << volume
+                              << " floats" << std::endl;
+            return false;
+        }
+        initializer.values.resize(volume);
+        std::memcpy(initializer.values.data(), raw.data(), raw.size());
+        return true;
+    }
+
+    // float_data is usually packed, but may also be a list of 32-bit fields
+    for (auto const& field : tensor.getFields())
+    {
+        if (field.number != onnx::kTENSOR_FLOAT_DATA)
+        {
+            continue;
+        }
+        if (field.wireType == ProtoMessage::kBYTES)
+        {
+            size_t const offset = initializer.values.size();
+            size_t const count = field.bytes.size() / sizeof(float);
+            initializer.values.resize(offset + count);
+            std::memcpy(initializer.values.data() + offset, field.bytes.data(), count * sizeof(float));
+        }
+        else if (field.wireType == ProtoMessage::kFIXED32)
+        {
+            uint32_t const bits = static_cast<uint32_t>(field.scalar);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            initializer.values.push_back(value);
+        }
+    }
+    if (static_cast<int64_t>(initializer.values.size()) != volume)
+    {
+        sample::gLogError << "Initializer " << name << " holds " << initializer.values.size() << " floats instead of "
+                          << volume << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool readNode(std::string const& data, Node& node)
+{
+    ProtoMessage message;
+    if (!message.parse(data))
+    {
+        sample::gLogError << "The graph holds an invalid node" << std::endl;
+        return false;
+    }
+    node.op = message.getString(onnx::kNODE_OP_TYPE);
+    node.inputs = message.getStrings(onnx::kNODE_INPUT);
+    node.outputs = message.getStrings(onnx::kNODE_OUTPUT);
+    node.name = message.getString(onnx::kNODE_NAME);
+    if (node.name.empty() && !node.outputs.empty())
+    {
+        node.name = node.outputs[0];
+    }
+    for (auto const& data : message.getStrings(onnx::kNODE_ATTRIBUTE))
+    {
+        ProtoMessage attribute;
+        if (!attribute.parse(data))
+        {
+            sample::gLogError << "Node " << node.name << " holds an invalid attribute" << std::endl;
+            return false;
+        }
+        node.attributes[attribute.getString(onnx::kATTRIBUTE_NAME)] = std::move(attribute);
+    }
+    return true;
+}
+
+std::vector<int64_t> getInts(Node const& node, std::string const& name, std::vector<int64_t> const& fallback)
+{
+    auto const attribute = node.attributes.find(name);
+    return attribute == node.attributes.end() ? fallback : attribute->second.getInts(onnx::kATTRIBUTE_INTS);
+}
+
+int64_t getInt(Node const& node, std::string const& name, int64_t fallback)
+{
+    auto const attribute = node.attributes.find(name);
+    return attribute == node.attributes.end() ? fallback : attribute->second.getInt(onnx::kATTRIBUTE_INT, fallback);
+}
+
+float getFloat(Node const& node, std::string const& name, float fallback)
+{
+    auto const attribute = node.attributes.find(name);
+    return attribute == node.attributes.end() ? fallback
+                                              : attribute->second.getFloat(onnx::kATTRIBUTE_FLOAT, fallback);
+}
+
+//!
+//! \brief Reads the 2D window attributes shared by convolutions and pooling.
+//!
+bool readGeometry(Node const& node, std::vector<int64_t> const& kernel, ConvGeometry& geometry)
+{
+    std::vector<int64_t> const strides = getInts(node, "strides", {1, 1});
+    std::vector<int64_t> const pads = getInts(node, "pads", {0, 0, 0, 0});
+    std::vector<int64_t> const dilations = getInts(node, "dilations", {1, 1});
+    std::vector<int64_t> const outputPadding = getInts(node, "output_padding", {0, 0});
+    auto const autoPad = node.attributes.find("auto_pad");
+    bool const explicitPads = autoPad == node.attributes.end()
+        || autoPad->second.getString(onnx::kATTRIBUTE_STRING) == "NOTSET"
+        || autoPad->second.getString(onnx::kATTRIBUTE_STRING).empty();
+    if (kernel.size() != 2 || strides.size() != 2 || pads.size() != 4 || dilations.size() != 2
+        || outputPadding.size() != 2 || !explicitPads || node.attributes.count("output_shape"))
+    {
+        sample::gLogError << node.op << " node " << node.name
+                          << " is not a 2D window with explicit padding, the only kind supported" << std::endl;
+        return false;
+    }
+    for (int32_t axis = 0; axis < 2; ++axis)
+    {
+        geometry.kernel[axis] = static_cast<int32_t>(kernel[axis]);
+        geometry.strides[axis] = static_cast<int32_t>(strides[axis]);
+        geometry.dilations[axis] = static_cast<int32_t>(dilations[axis]);
+        geometry.outputPadding[axis] = static_cast<int32_t>(outputPadding[axis]);
+    }
+    for (int32_t p = 0; p < 4; ++p)
+    {
+        geometry.pads[p] = static_cast<int32_t>(pads[p]);
+    }
+    return true;
+}
+
+//!
+//! \brief Computes the factor and offset per channel a BatchNormalization node applies.
+//!
+bool readBatchNormalization(Node const& node, std::map<std::string, Initializer> const& initializers,
+    int32_t channels, std::vector<float>& scale, std::vector<float>& shift)
+{
+    std::vector<float> const* params[4]{};
+    for (int32_t i = 0; i < 4; ++i)
+    {
+        auto const initializer
+            = node.inputs.size() == 5 ? initializers.find(node.inputs[i + 1]) : initializers.end();
+        if (initializer == initializers.end() || initializer->second.values.size() != static_cast<size_t>(channels))
+        {
+            sample::gLogError << "BatchNormalization node " << node.name << " needs " << channels
+                              << " constant scales, biases, means and variances" << std::endl;
+            return false;
+        }
+        params[i] = &initializer->second.values;
+    }
+
+    float const epsilon = getFloat(node, "epsilon", 1e-5f);
+    scale.resize(channels);
+    shift.resize(channels);
+    for (int32_t c = 0; c < channels; ++c)
+    {
+        scale[c] = (*params[0])[c] / std::sqrt((*params[3])[c] + epsilon);
+        shift[c] = (*params[1])[c] - (*params[2])[c] * scale[c];
+    }
+    return true;
+}
+
+} // namespace
+
+bool CpuNetwork::load(std::string const& fileName, std::vector<std::string> const& outputs)
+{
+    ProtoMessage model;
+    if (!readModel(fileName, model))
+    {
+        return false;
+    }
+    PruneResult pruned;
+    if (!outputs.empty() && !pruneGraph(model, outputs, pruned))
+    {
+        return false;
+    }
+    ProtoMessage graph;
+    if (!graph.parse(model.getString(onnx::kMODEL_GRAPH)))
+    {
+        sample::gLogError << fileName << " has no valid graph" << std::endl;
+        return false;
+    }
+
+    std::map<std::string, Initializer> initializers;
+    for (auto const& data : graph.getStrings(onnx::kGRAPH_INITIALIZER))
+    {
+        ProtoMessage tensor;
+        if (!tensor.parse(data) || !readInitializer(tensor, initializers[tensor.getString(onnx::kTENSOR_NAME)]))
+        {
+            return false;
+        }
+    }
+
+    std::vector<Node> nodes;
+    std::map<std::string, std::vector<int32_t>> consumers;
+    for (auto const& data : graph.getStrings(onnx::kGRAPH_NODE))
+    {
+        nodes.emplace_back();
+        if (!readNode(data, nodes.back()))
+        {
+            return false;
+        }
+        for (auto const& input : nodes.back().inputs)
+        {
+            consumers[input].push_back(static_cast<int32_t>(nodes.size() - 1));
+        }
+    }
+    std::vector<std::string> outputNames;
+    for (auto const& data : graph.getStrings(onnx::kGRAPH_OUTPUT))
+    {
+        ProtoMessage valueInfo;
+        valueInfo.parse(data);
+        outputNames.push_back(valueInfo.getString(onnx::kVALUE_INFO_NAME));
+    }
+    std::set<std::string> const graphOutputs(outputNames.begin(), outputNames.end());
+
+    mTensors.clear();
+    mLayers.clear();
+    mOutputs.clear();
+    mNodeCount = 0;
+    std::map<std::string, int32_t> tensorIndices;
+    auto const addTensor = [this, &tensorIndices](std::string const& name, int32_t channels, int32_t height,
+                               int32_t width) {
+        tensorIndices[name] = static_cast<int32_t>(mTensors.size());
+        mTensors.push_back(CpuTensor{name, channels, height, width});
+        return static_cast<int32_t>(mTensors.size() - 1);
+    };
+
+    std::vector<std::string> inputNames;
+    std::vector<std::vector<int64_t>> inputDims;
+    getGraphInputs(model, inputNames, inputDims);
+    if (inputNames.size() != 1 || inputDims[0].size() != 4)
+    {
+        sample::gLogError << "The CPU engine needs a single NCHW input, " << fileName << " does not have one"
+                          << std::endl;
+        return false;
+    }
+    std::vector<int64_t> const& shape = inputDims[0];
+    mInput = addTensor(inputNames[0], static_cast<int32_t>(shape[1]), static_cast<int32_t>(shape[2]),
+        static_cast<int32_t>(shape[3]));
+
+    // A node can be fused into the one before if it reads its output and nothing else does
+    std::vector<bool> fused(nodes.size(), false);
+    auto const getSoleConsumer = [&](std::string const& name, char const* op) {
+        auto const readers = consumers.find(name);
+        if (graphOutputs.count(name) || readers == consumers.end() || readers->second.size() != 1
+            || nodes[readers->second[0]].op != op || nodes[readers->second[0]].outputs.size() != 1)
+        {
+            return -1;
+        }
+        return readers->second[0];
+    };
+    auto const fuseRelu = [&](CpuLayer& layer, std::string& outputName) {
+        int32_t const relu = getSoleConsumer(outputName, "Relu");
+        if (relu >= 0)
+        {
+            fused[relu] = true;
+            layer.relu = true;
+            layer.ops += "+Relu";
+            outputName = nodes[relu].outputs[0];
+            ++mNodeCount;
+        }
+    };
+
+    for (size_t n = 0; n < nodes.size(); ++n)
+    {
+        if (fused[n])
+        {
+            continue;
+        }
+        Node const& node = nodes[n];
+        CpuLayer layer;
+        layer.name = node.name;
+        layer.ops = node.op;
+        ++mNodeCount;
+
+        // Inputs are the tensors computed so far, constants are read by the layers themselves
+        for (auto const& input : node.inputs)
+        {
+            auto const tensor = tensorIndices.find(input);
+            if (tensor != tensorIndices.end())
+            {
+                layer.inputs.push_back(tensor->second);
+            }
+            else if (!input.empty() && !initializers.count(input))
+            {
+                sample::gLogError << "Input " << input << " of node " << node.name << " is not computed before it"
+                                  << std::endl;
+                return false;
+            }
+        }
+        if (layer.inputs.empty() || node.outputs.empty())
+        {
+            sample::gLogError << node.op << " node " << node.name << " reads only constants, fold them first"
+                              << std::endl;
+            return false;
+        }
+        CpuTensor const input = mTensors[layer.inputs[0]];
+        std::string outputName = node.outputs[0];
+        int32_t channels = input.channels;
+        int32_t height = input.height;
+        int32_t width = input.width;
+
+        if (node.op == "Conv" || node.op == "ConvTranspose")
+        {
+            bool const transposed = node.op == "ConvTranspose";
+            auto const weights = node.inputs.size() > 1 ? initializers.find(node.inputs[1]) : initializers.end();
+            if (weights == initializers.end() || weights->second.dims.size() != 4 || weights->second.values.empty()
+                || layer.inputs.size() != 1)
+            {
+                sample::gLogError << node.op << " node " << node.name << " needs constant 2D float weights"
+                                  << std::endl;
+                return false;
+            }
+            std::vector<int64_t> const& dims = weights->second.dims;
+            int32_t const inChannels = static_cast<int32_t>(transposed ? dims[0] : dims[1]);
+            int32_t const outChannels = static_cast<int32_t>(transposed ? dims[1] : dims[0]);
+            ConvGeometry geometry;
+            if (getInt(node, "group", 1) != 1 || inChannels != input.channels)
+            {
+                sample::gLogError << node.op << " node " << node.name
+                                  << " is grouped or does not match its input, which is not supported" << std::endl;
+                return false;
+            }
+            if (!readGeometry(node, getInts(node, "kernel_shape", {dims[2], dims[3]}), geometry))
+            {
+                return false;
+            }
+
+            std::vector<float> kernel = weights->second.values;
+            std::vector<float> bias(outChannels, 0.f);
+            if (node.inputs.size() > 2 && !node.inputs[2].empty())
+            {
+                auto const constant = initializers.find(node.inputs[2]);
+                if (constant == initializers.end() || constant->second.values.size() != bias.size())
+                {
+                    sample::gLogError << node.op << " node " << node.name << " needs a constant bias" << std::endl;
+                    return false;
+                }
+                bias = constant->second.values;
+            }
+
+            // y = scale * (W x + b) + shift is a convolution with weights scale * W and bias scale * b + shift
+            int32_t const batchNorm = getSoleConsumer(outputName, "BatchNormalization");
+            if (batchNorm >= 0)
+            {
+                std::vector<float> scale, shift;
+                if (!readBatchNormalization(nodes[batchNorm], initializers, outChannels, scale, shift))
+                {
+                    return false;
+                }
+                int64_t const kernelSize = geometry.kernel[0] * geometry.kernel[1];
+                for (size_t i = 0; i < kernel.size(); ++i)
+                {
+                    int64_t const channel = transposed ? i / kernelSize % outChannels : i / (kernelSize * inChannels);
+                    kernel[i] *= scale[channel];
+                }
+                for (int32_t c = 0; c < outChannels; ++c)
+                {
+                    bias[c] = bias[c] * scale[c] + shift[c];
+                }
+                fused[batchNorm] = true;
+                layer.ops += "+BatchNormalization";
+                outputName = nodes[batchNorm].outputs[0];
+                ++mNodeCount;
+            }
+            fuseRelu(layer, outputName);
+
+            layer.type = CpuLayer::Type::kCONV;
+            layer.conv = packConvolution(geometry, inChannels, outChannels, transposed, kernel.data(), bias.data());
+            channels = outChannels;
+            height = geometry.getOutputSize(0, input.height, transposed);
+            width = geometry.getOutputSize(1, input.width, transposed);
+            layer.macs = static_cast<int64_t>(inChannels) * outChannels * geometry.kernel[0] * geometry.kernel[1]
+                * (transposed ? input.height * input.width : height * width);
+        }
+        else if (node.op == "MaxPool")
+        {
+            if (getInt(node, "ceil_mode", 0) != 0 || (node.outputs.size() > 1 && !node.outputs[1].empty()))
+            {
+                sample::gLogError << "MaxPool node " << node.name << " rounds up or returns indices" << std::endl;
+                return false;
+            }
+            if (!readGeometry(node, getInts(node, "kernel_shape", {}), layer.window))
+            {
+                return false;
+            }
+            layer.type = CpuLayer::Type::kMAX_POOL;
+            height = layer.window.getOutputSize(0, input.height, false);
+            width = layer.window.getOutputSize(1, input.width, false);
+        }
+        else if (node.op == "Add")
+        {
+            if (layer.inputs.size() != 2 || mTensors[layer.inputs[1]].volume() != input.volume()
+                || mTensors[layer.inputs[1]].channels != input.channels)
+            {
+                sample::gLogError << "Add node " << node.name << " broadcasts, which is not supported" << std::endl;
+                return false;
+            }
+            layer.type = CpuLayer::Type::kADD;
+            fuseRelu(layer, outputName);
+        }
+        else if (node.op == "BatchNormalization")
+        {
+            if (!readBatchNormalization(node, initializers, input.channels, layer.scale, layer.shift))
+            {
+                return false;
+            }
+            layer.type = CpuLayer::Type::kSCALE;
+            fuseRelu(layer, outputName);
+        }
+        else if (node.op == "Relu")
+        {
+            layer.type = CpuLayer::Type::kSCALE;
+            layer.relu = true;
+        }
+        else if (node.op == "PRelu")
+        {
+            auto const slopes = node.inputs.size() == 2 ? initializers.find(node.inputs[1]) : initializers.end();
+            size_t const count = slopes == initializers.end() ? 0 : slopes->second.values.size();
+            if (count != 1 && count != static_cast<size_t>(input.channels))
+            {
+                sample::gLogError << "PRelu node " << node.name << " needs a constant slope per channel" << std::endl;
+                return false;
+            }
+            layer.type = CpuLayer::Type::kSCALE;
+            layer.slopes.assign(input.channels, slopes->second.values[0]);
+            std::copy(slopes->second.values.begin(), slopes->second.values.end(), layer.slopes.begin());
+        }
+        else if (node.op == "Concat")
+        {
+            int64_t const axis = getInt(node, "axis", 0);
+            channels = 0;
+            for (int32_t index : layer.inputs)
+            {
+                CpuTensor const& part = mTensors[index];
+                if ((axis != 1 && axis != -3) || part.height != height || part.width != width)
+                {
+                    sample::gLogError << "Concat node " << node.name << " does not join tensors along the channels"
+                                      << std::endl;
+                    return false;
+                }
+                channels += part.channels;
+            }
+            layer.type = CpuLayer::Type::kCONCAT;
+        }
+        else
+        {
+            sample::gLogError << "Operator " << node.op << " of node " << node.name
+                              << " is not supported by the CPU engine" << std::endl;
+            return false;
+        }
+
+        if (channels <= 0 || height <= 0 || width <= 0)
+        {
+            sample::gLogError << node.op << " node " << node.name << " has an empty output" << std::endl;
+            return false;
+        }
+        layer.output = addTensor(outputName, channels, height, width);
+        mLayers.push_back(std::move(layer));
+    }
+
+    for (auto const& name : outputs.empty() ? outputNames : outputs)
+    {
+        auto const tensor = tensorIndices.find(name);
+        if (tensor == tensorIndices.end() || tensor->second == mInput)
+        {
+            sample::gLogError << "Output " << name << " is not computed by the CPU engine" << std::endl;
+            return false;
+        }
+        mOutputs.push_back(tensor->second);
+    }
+
+    planBuffers();
+    return true;
+}
+
+void CpuNetwork::planBuffers()
+{
+    std::vector<int32_t> lastRead(mTensors.size(), -1);
+    for (size_t l = 0; l < mLayers.size(); ++l)
+    {
+        for (int32_t input : mLayers[l].inputs)
+        {
+            lastRead[input] = static_cast<int32_t>(l);
+        }
+    }
+    std::vector<bool> dedicated(mTensors.size(), false);
+    dedicated[mInput] = true;
+    for (int32_t output : mOutputs)
+    {
+        dedicated[output] = true;
+    }
+
+    mSlotSizes.clear();
+    mScratchSize = 0;
+    std::vector<int32_t> freeSlots;
+    for (size_t l = 0; l < mLayers.size(); ++l)
+    {
+        CpuLayer const& layer = mLayers[l];
+        CpuTensor& output = mTensors[layer.output];
+        if (layer.type == CpuLayer::Type::kCONV)
+        {
+            CpuTensor const& input = mTensors[layer.inputs[0]];
+            mScratchSize = std::max(mScratchSize, getConvScratchSize(layer.conv, input.height, input.width));
+        }
+
+        // The smallest free buffer large enough, or else the largest one which is grown
+        if (!dedicated[layer.output])
+        {
+            auto best = freeSlots.end();
+            for (auto slot = freeSlots.begin(); slot != freeSlots.end(); ++slot)
+            {
+                bool const fits = mSlotSizes[*slot] >= output.volume();
+                bool const bestFits = best != freeSlots.end() && mSlotSizes[*best] >= output.volume();
+                if (best == freeSlots.end() || (fits && (!bestFits || mSlotSizes[*slot] < mSlotSizes[*best]))
+                    || (!fits && !bestFits && mSlotSizes[*slot] > mSlotSizes[*best]))
+                {
+                    best = slot;
+                }
+            }
+            if (best == freeSlots.end())
+            {
+                output.slot = static_cast<int32_t>(mSlotSizes.size());
+                mSlotSizes.push_back(output.volume());
+            }
+            else
+            {
+                output.slot = *best;
+                mSlotSizes[*best] = std::max(mSlotSizes[*best], output.volume());
+                freeSlots.erase(best);
+            }
+        }
+
+        // Inputs are released once the output is placed, a layer never writes over what it reads
+        for (int32_t input : layer.inputs)
+        {
+            if (lastRead[input] == static_cast<int32_t>(l) && mTensors[input].slot >= 0
+                && std::find(freeSlots.begin(), freeSlots.end(), mTensors[input].slot) == freeSlots.end())
+            {
+                freeSlots.push_back(mTensors[input].slot);
+            }
+        }
+        if (lastRead[layer.output] < 0 && output.slot >= 0)
+        {
+            freeSlots.push_back(output.slot);
+        }
+    }
+}
+
+CpuBackend::CpuBackend(std::shared_ptr<CpuNetwork const> network, int32_t batchSize, int32_t threadCount)
+    : mNetwork(std::move(network))
+    , mBatchSize(batchSize)
+    , mPool(threadCount)
+{
+    std::vector<CpuTensor> const& tensors = mNetwork->getTensors();
+    auto const getDesc = [batchSize](CpuTensor const& tensor) {
+        return TensorDesc{tensor.name, {batchSize, tensor.channels, tensor.height, tensor.width}};
+    };
+
+    mInput = getDesc(tensors[mNetwork->getInput()]);
+    mInputBuffer.assign(mInput.volume(), 0.f);
+    mOutputOfTensor.assign(tensors.size(), -1);
+    for (int32_t output : mNetwork->getOutputs())
+    {
+        mOutputOfTensor[output] = static_cast<int32_t>(mOutputs.size());
+        mOutputs.push_back(getDesc(tensors[output]));
+        mOutputBuffers.emplace_back(mOutputs.back().volume(), 0.f);
+    }
+    for (int64_t size : mNetwork->getSlotSizes())
+    {
+        mSlots.emplace_back(size * batchSize, 0.f);
+    }
+    mScratch.assign(mNetwork->getScratchSize(), 0.f);
+
+    for (auto const& layer : mNetwork->getLayers())
+    {
+        LayerTiming timing;
+        timing.name = layer.name;
+        timing.ops = layer.ops;
+        timing.macs = layer.macs;
+        mLayerTimings.push_back(timing);
+    }
+}
+
+float* CpuBackend::getTensorData(int32_t index)
+{
+    if (index == mNetwork->getInput())
+    {
+        return mInputBuffer.data();
+    }
+    if (mOutputOfTensor[index] >= 0)
+    {
+        return mOutputBuffers[mOutputOfTensor[index]].data();
+    }
+    return mSlots[mNetwork->getTensors()[index].slot].data();
+}
+
+bool CpuBackend::infer()
+{
+    auto const start = Clock::now();
+    std::vector<CpuLayer> const& layers = mNetwork->getLayers();
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        auto const layerStart = Clock::now();
+        runLayer(layers[l]);
+        mLayerTimings[l].totalMs += elapsedMs(layerStart);
+        ++mLayerTimings[l].runs;
+    }
+    mLastTiming.execute = elapsedMs(start);
+    return true;
+}
+
+void CpuBackend::runLayer(CpuLayer const& layer)
+{
+    std::vector<CpuTensor> const& tensors = mNetwork->getTensors();
+    CpuTensor const& input = tensors[layer.inputs[0]];
+    CpuTensor const& output = tensors[layer.output];
+    float const* src = getTensorData(layer.inputs[0]);
+    float* dst = getTensorData(layer.output);
+
+    switch (layer.type)
+    {
+    case CpuLayer::Type::kCONV:
+        for (int32_t b = 0; b < mBatchSize; ++b)
+        {
+            convolve(layer.conv, layer.relu, src + b * input.volume(), input.height, input.width,
+                dst + b * output.volume(), mScratch.data(), mPool);
+        }
+        break;
+    case CpuLayer::Type::kMAX_POOL:
+        maxPool(layer.window, src, mBatchSize * input.channels, input.height, input.width, dst, mPool);
+        break;
+    case CpuLayer::Type::kADD:
+        add(src, getTensorData(layer.inputs[1]), mBatchSize * input.volume(), layer.relu, dst, mPool);
+        break;
+    case CpuLayer::Type::kSCALE:
+        scaleChannels(src, mBatchSize * input.channels, input.channels,
+            static_cast<int64_t>(input.height) * input.width, layer.scale.empty() ? nullptr : layer.scale.data(),
+            layer.shift.empty() ? nullptr : layer.shift.data(), layer.relu,
+            layer.slopes.empty() ? nullptr : layer.slopes.data(), dst, mPool);
+        break;
+    case CpuLayer::Type::kCONCAT:
+        for (int32_t b = 0; b < mBatchSize; ++b)
+        {
+            float* part = dst + b * output.volume();
+            for (int32_t index : layer.inputs)
+            {
+                int64_t const volume = tensors[index].volume();
+                float const* data = getTensorData(index) + b * volume;
+                part = std::copy(data, data + volume, part);
+            }
+        }
+        break;
+    }
+}
+
+void addLayerTimings(std::vector<LayerTiming> const& timings, std::vector<LayerTiming>& total)
+{
+    if (total.empty())
+    {
+        total = timings;
+        return;
+    }
+    for (size_t l = 0; l < timings.size() && l < total.size(); ++l)
+    {
+        total[l].totalMs += timings[l].totalMs;
+        total[l].runs += timings[l].runs;
+    }
+}
+
+void printLayerTimings(std::vector<LayerTiming> const& timings, int32_t count, std::ostream& os)
+{
+    double totalMs = 0.0;
+    int64_t runs = 0;
+    std::map<std::string, double> opsMs;
+    for (auto const& timing : timings)
+    {
+        totalMs += timing.totalMs;
+        runs = std::max(runs, timing.runs);
+        opsMs[timing.ops] += timing.totalMs;
+    }
+    if (runs == 0 || totalMs <= 0.0)
+    {
+        return;
+    }
+
+    std::vector<LayerTiming> sorted = timings;
+    std::sort(sorted.begin(), sorted.end(),
+        [](LayerTiming const& a, LayerTiming const& b) { return a.totalMs > b.totalMs; });
+    sorted.resize(std::min(sorted.size(), static_cast<size_t>(std::max(count, 0))));
+
+    os << "=== Time per layer over " << runs << " runs, " << std::fixed << std::setprecision(3) << totalMs / runs
+       << " ms per run ===" << std::endl;
+    os << std::right << std::setw(10) << "ms/run" << std::setw(8) << "share" << std::setw(10) << "GMAC/s"
+       << "  " << std::left << std::setw(40) << "operators" << "layer" << std::endl;
+    for (auto const& timing : sorted)
+    {
+        double const ms = timing.totalMs / std::max<int64_t>(timing.runs, 1);
+        os << std::right << std::setprecision(3) << std::setw(10) << ms << std::setprecision(1) << std::setw(7)
+           << 100.0 * timing.totalMs / totalMs << "%" << std::setw(10)
+           << (timing.macs && ms > 0.0 ? timing.macs / (ms * 1e6) : 0.0) << "  " << std::left << std::setw(40)
+           << timing.ops << timing.name << std::endl;
+    }
+
+    os << "=== Time per operator ===" << std::endl;
+    for (auto const& ops : opsMs)
+    {
+        os << std::right << std::setprecision(3) << std::setw(10) << ops.second / runs << std::setprecision(1)
+           << std::setw(7) << 100.0 * ops.second / totalMs << "%" << "  " << std::left << ops.first << std::endl;
+    }
+    os << std::right << std::defaultfloat;
+}
+
+} // namespace pinet
@@ -0,0 +1,241 @@
+#ifndef PINET_CPU_ENGINE_H
+#define PINET_CPU_ENGINE_H
+
+#include "cpuKernels.h"
+#include "inferenceBackend.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief The CpuTensor structure describes a tensor of the CPU engine for one image.
+//!
+struct CpuTensor
+{
+    std::string name;
+    int32_t channels{0};
+    int32_t height{0};
+    int32_t width{0};
+    int32_t slot{-1}; //!< Buffer the tensor is stored in, -1 for the input and the outputs which have their own
+
+    int64_t volume() const
+    {
+        return static_cast<int64_t>(channels) * height * width;
+    }
+};
+
+//!
+//! \brief  The CpuLayer structure is a step of the CPU engine, made of one ONNX node and those fused into it.
+//!
+struct CpuLayer
+{
+    enum class Type : int32_t
+    {
+        kCONV,     //!< Conv or ConvTranspose, with the BatchNormalization following it folded into its weights
+        kMAX_POOL, //!< MaxPool
+        kADD,      //!< Add of two tensors of the same shape
+        kSCALE,    //!< BatchNormalization, Relu or PRelu which could not be fused into the layer before
+        kCONCAT,   //!< Concat along the channels
+    };
+
+    Type type{Type::kCONV};
+    std::string name;            //!< Name of the first node, or of its output if the node has none
+    std::string ops;             //!< Operators of the nodes run, e.g. Conv+BatchNormalization+Relu
+    std::vector<int32_t> inputs; //!< Indices of the input tensors
+    int32_t output{0};           //!< Index of the output tensor
+    bool relu{false};            //!< Whether a ReLU is applied to the output
+    ConvWeights conv;            //!< Weights of a kCONV layer
+    ConvGeometry window;         //!< Window of a kMAX_POOL layer
+    std::vector<float> scale;    //!< Factor per channel of a kSCALE layer, empty for 1
+    std::vector<float> shift;    //!< Offset per channel of a kSCALE layer, empty for 0
+    std::vector<float> slopes;   //!< Slope of the negative values per channel of a PRelu, empty for none
+    int64_t macs{0};             //!< Multiply-accumulates of a kCONV layer per image
+};
+
+//!
+//! \brief  The CpuNetwork class is an ONNX model turned into layers the CPU engine runs.
+//!
+//! \details The model is read with the ProtoMessage parser of onnxModel.h, so it needs neither the protobuf
+//!          library nor TensorRT. A BatchNormalization following a convolution is folded into its weights and
+//!          bias, and a Relu following a convolution, a BatchNormalization or an Add is applied by the layer
+//!          before it, provided that the intermediate tensor is read by nothing else. Tensors are planned
+//!          into a few buffers, a tensor reusing the buffer of one nothing reads any more. A network is
+//!          immutable once loaded and is shared by the backends of all infer workers.
+//!
+class CpuNetwork
+{
+public:
+    //!
+    //! \brief Loads the model in fileName, running only what outputs depend on.
+    //!
+    //! \param outputs Outputs of the network in the order the backend returns them, empty for all graph outputs.
+    //!
+    //! \return false if the model cannot be read or holds an operator or attribute the engine does not support
+    //!
+    bool load(std::string const& fileName, std::vector<std::string> const& outputs = {});
+
+    //!
+    //! \brief Returns the index of the input tensor.
+    //!
+    int32_t getInput() const
+    {
+        return mInput;
+    }
+
+    //!
+    //! \brief Returns the indices of the output tensors.
+    //!
+    std::vector<int32_t> const& getOutputs() const
+    {
+        return mOutputs;
+    }
+
+    std::vector<CpuTensor> const& getTensors() const
+    {
+        return mTensors;
+    }
+
+    std::vector<CpuLayer> const& getLayers() const
+    {
+        return mLayers;
+    }
+
+    //!
+    //! \brief Returns the size of each buffer of intermediate tensors, in floats per image.
+    //!
+    std::vector<int64_t> const& getSlotSizes() const
+    {
+        return mSlotSizes;
+    }
+
+    //!
+    //! \brief Returns the floats of scratch the convolutions need, for one image at a time.
+    //!
+    int64_t getScratchSize() const
+    {
+        return mScratchSize;
+    }
+
+    //!
+    //! \brief Returns the number of ONNX nodes the layers run.
+    //!
+    int32_t getNodeCount() const
+    {
+        return mNodeCount;
+    }
+
+private:
+    //!
+    //! \brief Assigns every intermediate tensor a buffer, reusing those of tensors read for the last time.
+    //!
+    void planBuffers();
+
+    std::vector<CpuTensor> mTensors;
+    std::vector<CpuLayer> mLayers;
+    int32_t mInput{-1};
+    std::vector<int32_t> mOutputs;
+    std::vector<int64_t> mSlotSizes;
+    int64_t mScratchSize{0};
+    int32_t mNodeCount{0};
+};
+
+//!
+//! \brief The LayerTiming structure accumulates the time the CPU engine spent in one layer.
+//!
+struct LayerTiming
+{
+    std::string name;
+    std::string ops;
+    double totalMs{0.0};
+    int64_t runs{0};
+    int64_t macs{0}; //!< Multiply-accumulates of one run, 0 for layers which are not convolutions
+};
+
+//!
+//! \brief  The CpuBackend class runs a CpuNetwork on the CPU with a pool of threads.
+//!
+//! \details Each backend owns its input, output and intermediate buffers, allocated by the constructor,
+//!          and its own thread pool, so the backends of several infer workers run concurrently. Layers run
+//!          one after the other, each one spreading its work over the threads of the pool. The time spent
+//!          in each layer is accumulated over all calls to infer().
+//!
+class CpuBackend : public InferenceBackend
+{
+public:
+    CpuBackend(std::shared_ptr<CpuNetwork const> network, int32_t batchSize, int32_t threadCount);
+
+    std::string getName() const override
+    {
+        return "cpu";
+    }
+
+    TensorDesc const& getInput() const override
+    {
+        return mInput;
+    }
+
+    std::vector<TensorDesc> const& getOutputs() const override
+    {
+        return mOutputs;
+    }
+
+    float* getInputBuffer() override
+    {
+        return mInputBuffer.data();
+    }
+
+    float const* getOutputBuffer(int32_t index) const override
+    {
+        return mOutputBuffers[index].data();
+    }
+
+    bool infer() override;
+
+    //!
+    //! \brief Returns the time spent in each layer so far, in the order the layers run.
+    //!
+    std::vector<LayerTiming> const& getLayerTimings() const
+    {
+        return mLayerTimings;
+    }
+
+private:
+    //!
+    //! \brief Returns the buffer of the batch of tensor index.
+    //!
+    float* getTensorData(int32_t index);
+
+    void runLayer(CpuLayer const& layer);
+
+    std::shared_ptr<CpuNetwork const> mNetwork;
+    int32_t mBatchSize;
+    CpuThreadPool mPool;
+    TensorDesc mInput;
+    std::vector<TensorDesc> mOutputs;
+    std::vector<float> mInputBuffer;
+    std::vector<std::vector<float>> mOutputBuffers;
+    std::vector<std::vector<float>> mSlots;   //!< Buffers of the intermediate tensors
+    std::vector<int32_t> mOutputOfTensor;     //!< Index in mOutputs of each tensor, -1 if it is not an output
+    std::vector<float> mScratch;
+    std::vector<LayerTiming> mLayerTimings;
+};
+
+//!
+//! \brief Adds timings, those of the backend of one infer worker, to the timings of the same layers in total.
+//!
+void addLayerTimings(std::vector<LayerTiming> const& timings, std::vector<LayerTiming>& total);
+
+//!
+//! \brief Prints the count layers the most time was spent in and the time spent per operator.
+//!
+void printLayerTimings(std::vector<LayerTiming> const& timings, int32_t count, std::ostream& os);
+
+} // namespace pinet
+
+#endif // PINET_CPU_ENGINE_H
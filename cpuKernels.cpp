@@ -0,0 +1,588 @@
+#include "cpuKernels.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PINET_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr int32_t kTILE_COLS = 16;     //!< Columns of the tiles of C computed by the kernels
+constexpr int32_t kBLOCK_DEPTH = 256;  //!< Inner dimension of the blocks of A and B multiplied at once
+constexpr int32_t kTASK_PANELS = 8;    //!< Panels of A, i.e. row tiles of C, one task computes
+constexpr int32_t kTASK_COLS = 256;    //!< Columns of C one task computes
+constexpr int64_t kTASK_ELEMENTS = 1 << 16; //!< Elements one task of an elementwise kernel processes
+
+//!
+//! \brief Computes a tile of up to kGEMM_PANEL_ROWS x kTILE_COLS elements of C over depth columns of A.
+//!
+//! \param a The block of a panel of A, kGEMM_PANEL_ROWS values per column.
+//! \param b The block of a strip of B, kTILE_COLS values per row, zero padded.
+//! \param first Whether this is the first block of the inner dimension, C then starts from the bias instead of
+//!        its current values.
+//! \param relu Whether to apply a ReLU, only set on the last block of the inner dimension.
+//!
+void computeTileScalar(int32_t depth, float const* a, float const* b, float* c, int64_t ldc, int32_t rows,
+    int32_t cols, float const* bias, bool first, bool relu)
+{
+    float tile[kGEMM_PANEL_ROWS][kTILE_COLS];
+    for (int32_t r = 0; r < kGEMM_PANEL_ROWS; ++r)
+    {
+        for (int32_t j = 0; j < kTILE_COLS; ++j)
+        {
+            bool const valid = r < rows && j < cols;
+            tile[r][j] = !valid ? 0.f : first ? (bias ? bias[r] : 0.f) : c[r * ldc + j];
+        }
+    }
+
+    for (int32_t k = 0; k < depth; ++k, a += kGEMM_PANEL_ROWS, b += kTILE_COLS)
+    {
+        for (int32_t r = 0; r < kGEMM_PANEL_ROWS; ++r)
+        {
+            for (int32_t j = 0; j < kTILE_COLS; ++j)
+            {
+                tile[r][j] += a[r] * b[j];
+            }
+        }
+    }
+
+    for (int32_t r = 0; r < rows; ++r)
+    {
+        for (int32_t j = 0; j < cols; ++j)
+        {
+            c[r * ldc + j] = relu ? std::max(tile[r][j], 0.f) : tile[r][j];
+        }
+    }
+}
+
+#if PINET_X86_SIMD
+
+//!
+//! \brief Same as computeTileScalar for tiles of kTILE_COLS columns, the accumulators being held in 12 registers.
+//!
+__attribute__((target("avx2,fma"))) void computeTileAvx2(int32_t depth, float const* a, float const* b, float* c,
+    int64_t ldc, int32_t rows, float const* bias, bool first, bool relu)
+{
+    static_assert(kGEMM_PANEL_ROWS == 6 && kTILE_COLS == 16, "The kernel is unrolled for 6 x 16 tiles");
+    __m256 acc[kGEMM_PANEL_ROWS][2];
+    for (int32_t r = 0; r < kGEMM_PANEL_ROWS; ++r)
+    {
+        if (!first && r < rows)
+        {
+            acc[r][0] = _mm256_loadu_ps(c + r * ldc);
+            acc[r][1] = _mm256_loadu_ps(c + r * ldc + 8);
+        }
+        else
+        {
+            acc[r][0] = acc[r][1] = _mm256_set1_ps(first && bias && r < rows ? bias[r] : 0.f);
+        }
+    }
+
+    __m256 c00 = acc[0][0], c01 = acc[0][1], c10 = acc[1][0], c11 = acc[1][1], c20 = acc[2][0], c21 = acc[2][1];
+    __m256 c30 = acc[3][0], c31 = acc[3][1], c40 = acc[4][0], c41 = acc[4][1], c50 = acc[5][0], c51 = acc[5][1];
+    for (int32_t k = 0; k < depth; ++k, a += kGEMM_PANEL_ROWS, b += kTILE_COLS)
+    {
+        __m256 const b0 = _mm256_loadu_ps(b);
+        __m256 const b1 = _mm256_loadu_ps(b + 8);
+        __m256 value = _mm256_broadcast_ss(a);
+        c00 = _mm256_fmadd_ps(value, b0, c00);
+        c01 = _mm256_fmadd_ps(value, b1, c01);
+        value = _mm256_broadcast_ss(a + 1);
+        c10 = _mm256_fmadd_ps(value, b0, c10);
+        c11 = _mm256_fmadd_ps(value, b1, c11);
+        value = _mm256_broadcast_ss(a + 2);
+        c20 = _mm256_fmadd_ps(value, b0, c20);
+        c21 = _mm256_fmadd_ps(value, b1, c21);
+        value = _mm256_broadcast_ss(a + 3);
+        c30 = _mm256_fmadd_ps(value, b0, c30);
+        c31 = _mm256_fmadd_ps(value, b1, c31);
+        value = _mm256_broadcast_ss(a + 4);
+        c40 = _mm256_fmadd_ps(value, b0, c40);
+        c41 = _mm256_fmadd_ps(value, b1, c41);
+        value = _mm256_broadcast_ss(a + 5);
+        c50 = _mm256_fmadd_ps(value, b0, c50);
+        c51 = _mm256_fmadd_ps(value, b1, c51);
+    }
+
+    __m256 const result[kGEMM_PANEL_ROWS][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+    __m256 const zero = _mm256_setzero_ps();
+    for (int32_t r = 0; r < rows; ++r)
+    {
+        _mm256_storeu_ps(c + r * ldc, relu ? _mm256_max_ps(result[r][0], zero) : result[r][0]);
+        _mm256_storeu_ps(c + r * ldc + 8, relu ? _mm256_max_ps(result[r][1], zero) : result[r][1]);
+    }
+}
+
+#endif
+
+//!
+//! \brief Copies depth rows of the columns [colBegin, colEnd) of B into strips of kTILE_COLS columns, each strip
+//!        holding its rows one after the other and the last one being padded with zeros.
+//!
+//! \details The rows of B are often a power of two floats apart, so that reading a tile straight from B would
+//!          hit the same few cache sets over and over.
+//!
+void packStrips(float const* b, int64_t ldb, int32_t depth, int32_t colBegin, int32_t colEnd, float* strips)
+{
+    for (int32_t k = 0; k < depth; ++k)
+    {
+        float const* row = b + k * ldb;
+        for (int32_t col = colBegin; col < colEnd; col += kTILE_COLS)
+        {
+            int32_t const cols = std::min(kTILE_COLS, colEnd - col);
+            float* dst = strips + ((col - colBegin) * depth + k * kTILE_COLS);
+            std::copy(row + col, row + col + cols, dst);
+            std::fill(dst + cols, dst + kTILE_COLS, 0.f);
+        }
+    }
+}
+
+//!
+//! \brief Returns the range [begin, end) of the outputs o for which o * stride + offset lies in [0, size),
+//!        clamped to [0, count).
+//!
+void getValidRange(int32_t offset, int32_t stride, int32_t size, int32_t count, int32_t& begin, int32_t& end)
+{
+    // Ceiling divisions of possibly negative numerators by a positive stride
+    auto const ceilDiv
+        = [stride](int32_t value) { return value >= 0 ? (value + stride - 1) / stride : -(-value / stride); };
+    begin = std::min(std::max(ceilDiv(-offset), 0), count);
+    end = std::max(std::min(ceilDiv(size - offset), count), begin);
+}
+
+//!
+//! \brief Gathers the patches of one input image into rows of columns, row (c, ky, kx) holding the input
+//!        element kernel element (ky, kx) of channel c is multiplied with at each output position.
+//!
+void im2col(ConvWeights const& conv, float const* input, int32_t height, int32_t width, int32_t outHeight,
+    int32_t outWidth, float* columns, CpuThreadPool& pool)
+{
+    ConvGeometry const& g = conv.geometry;
+    int32_t const kernelSize = g.kernel[0] * g.kernel[1];
+    int64_t const outSize = static_cast<int64_t>(outHeight) * outWidth;
+    pool.parallelFor(conv.inChannels * kernelSize, [&](int32_t row) {
+        int32_t const channel = row / kernelSize;
+        int32_t const ky = row % kernelSize / g.kernel[1];
+        int32_t const kx = row % g.kernel[1];
+        float const* plane = input + static_cast<int64_t>(channel) * height * width;
+        float* dst = columns + row * outSize;
+
+        int32_t const xOffset = kx * g.dilations[1] - g.pads[1];
+        int32_t xBegin, xEnd;
+        getValidRange(xOffset, g.strides[1], width, outWidth, xBegin, xEnd);
+        for (int32_t oy = 0; oy < outHeight; ++oy, dst += outWidth)
+        {
+            int32_t const iy = oy * g.strides[0] + ky * g.dilations[0] - g.pads[0];
+            if (iy < 0 || iy >= height)
+            {
+                std::fill(dst, dst + outWidth, 0.f);
+                continue;
+            }
+            float const* src = plane + static_cast<int64_t>(iy) * width;
+            std::fill(dst, dst + xBegin, 0.f);
+            if (g.strides[1] == 1)
+            {
+                std::copy(src + xBegin + xOffset, src + xEnd + xOffset, dst + xBegin);
+            }
+            else
+            {
+                for (int32_t ox = xBegin; ox < xEnd; ++ox)
+                {
+                    dst[ox] = src[ox * g.strides[1] + xOffset];
+                }
+            }
+            std::fill(dst + xEnd, dst + outWidth, 0.f);
+        }
+    });
+}
+
+//!
+//! \brief Adds the rows of the product of the weights of a transposed convolution and its input to the
+//!        output positions their kernel elements land on, starting from the bias.
+//!
+void col2im(ConvWeights const& conv, bool relu, float const* columns, int32_t height, int32_t width,
+    int32_t outHeight, int32_t outWidth, float* output, CpuThreadPool& pool)
+{
+    ConvGeometry const& g = conv.geometry;
+    int64_t const inSize = static_cast<int64_t>(height) * width;
+    int64_t const outSize = static_cast<int64_t>(outHeight) * outWidth;
+    pool.parallelFor(conv.outChannels, [&](int32_t channel) {
+        float* plane = output + channel * outSize;
+        std::fill(plane, plane + outSize, conv.bias[channel]);
+        for (int32_t ky = 0; ky < g.kernel[0]; ++ky)
+        {
+            for (int32_t kx = 0; kx < g.kernel[1]; ++kx)
+            {
+                float const* row = columns + ((channel * g.kernel[0] + ky) * g.kernel[1] + kx) * inSize;
+                int32_t const xOffset = kx * g.dilations[1] - g.pads[1];
+                int32_t xBegin, xEnd;
+                getValidRange(xOffset, g.strides[1], outWidth, width, xBegin, xEnd);
+                for (int32_t iy = 0; iy < height; ++iy)
+                {
+                    int32_t const oy = iy * g.strides[0] + ky * g.dilations[0] - g.pads[0];
+                    if (oy < 0 || oy >= outHeight)
+                    {
+                        continue;
+                    }
+                    float* dst = plane + static_cast<int64_t>(oy) * outWidth;
+                    float const* src = row + static_cast<int64_t>(iy) * width;
+                    for (int32_t ix = xBegin; ix < xEnd; ++ix)
+                    {
+                        dst[ix * g.strides[1] + xOffset] += src[ix];
+                    }
+                }
+            }
+        }
+        if (relu)
+        {
+            for (int64_t i = 0; i < outSize; ++i)
+            {
+                plane[i] = std::max(plane[i], 0.f);
+            }
+        }
+    });
+}
+
+bool isPointwise(ConvWeights const& conv)
+{
+    ConvGeometry const& g = conv.geometry;
+    return !conv.transposed && g.kernel[0] == 1 && g.kernel[1] == 1 && g.strides[0] == 1 && g.strides[1] == 1
+        && !g.pads[0] && !g.pads[1] && !g.pads[2] && !g.pads[3];
+}
+
+} // namespace
+
+CpuThreadPool::CpuThreadPool(int32_t threadCount)
+{
+    for (int32_t t = 1; t < threadCount; ++t)
+    {
+        mThreads.emplace_back(&CpuThreadPool::work, this);
+    }
+}
+
+CpuThreadPool::~CpuThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mStarted.notify_all();
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+void CpuThreadPool::parallelFor(int32_t count, std::function<void(int32_t)> const& task)
+{
+    if (mThreads.empty() || count <= 1)
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mCount = count;
+        mNext = 0;
+        mBusy = static_cast<int32_t>(mThreads.size());
+        ++mGeneration;
+    }
+    mStarted.notify_all();
+    for (int32_t i = mNext++; i < count; i = mNext++)
+    {
+        task(i);
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFinished.wait(lock, [this] { return mBusy == 0; });
+}
+
+void CpuThreadPool::work()
+{
+    int64_t generation = 0;
+    for (;;)
+    {
+        std::function<void(int32_t)> const* task{nullptr};
+        int32_t count{0};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStarted.wait(lock, [this, generation] { return mStopping || mGeneration != generation; });
+            if (mStopping)
+            {
+                return;
+            }
+            generation = mGeneration;
+            task = mTask;
+            count = mCount;
+        }
+
+        for (int32_t i = mNext++; i < count; i = mNext++)
+        {
+            (*task)(i);
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mBusy == 0)
+        {
+            mFinished.notify_one();
+        }
+    }
+}
+
+PackedMatrix packMatrix(float const* source, int32_t rows, int32_t cols, int64_t rowStride, int64_t colStride)
+{
+    PackedMatrix packed;
+    packed.rows = rows;
+    packed.cols = cols;
+    int32_t const panels = (rows + kGEMM_PANEL_ROWS - 1) / kGEMM_PANEL_ROWS;
+    packed.data.assign(static_cast<size_t>(panels) * cols * kGEMM_PANEL_ROWS, 0.f);
+    for (int32_t r = 0; r < rows; ++r)
+    {
+        float* panel = packed.data.data() + static_cast<int64_t>(r / kGEMM_PANEL_ROWS) * cols * kGEMM_PANEL_ROWS;
+        for (int32_t c = 0; c < cols; ++c)
+        {
+            panel[c * kGEMM_PANEL_ROWS + r % kGEMM_PANEL_ROWS] = source[r * rowStride + c * colStride];
+        }
+    }
+    return packed;
+}
+
+bool isGemmVectorized()
+{
+#if PINET_X86_SIMD
+    static bool const vectorized = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return vectorized;
+#else
+    return false;
+#endif
+}
+
+void gemm(PackedMatrix const& a, float const* b, int64_t ldb, int32_t n, float* c, int64_t ldc, float const* bias,
+    bool relu, CpuThreadPool& pool)
+{
+    int32_t const panels = (a.rows + kGEMM_PANEL_ROWS - 1) / kGEMM_PANEL_ROWS;
+    int32_t const rowTasks = (panels + kTASK_PANELS - 1) / kTASK_PANELS;
+    int32_t const colTasks = (n + kTASK_COLS - 1) / kTASK_COLS;
+    bool const vectorized = isGemmVectorized();
+
+    pool.parallelFor(rowTasks * colTasks, [&](int32_t task) {
+        int32_t const panelBegin = task / colTasks * kTASK_PANELS;
+        int32_t const panelEnd = std::min(panelBegin + kTASK_PANELS, panels);
+        int32_t const colBegin = task % colTasks * kTASK_COLS;
+        int32_t const colEnd = std::min(colBegin + kTASK_COLS, n);
+
+        thread_local std::vector<float> strips;
+        strips.resize(static_cast<size_t>(kBLOCK_DEPTH) * kTASK_COLS);
+
+        // Each block of the inner dimension is added to the tiles the previous blocks left in C
+        for (int32_t k = 0; k < a.cols; k += kBLOCK_DEPTH)
+        {
+            int32_t const depth = std::min(kBLOCK_DEPTH, a.cols - k);
+            bool const first = k == 0;
+            bool const last = k + depth == a.cols;
+            packStrips(b + k * ldb, ldb, depth, colBegin, colEnd, strips.data());
+            for (int32_t col = colBegin; col < colEnd; col += kTILE_COLS)
+            {
+                int32_t const cols = std::min(kTILE_COLS, colEnd - col);
+                float const* blockB = strips.data() + (col - colBegin) * depth;
+                for (int32_t panel = panelBegin; panel < panelEnd; ++panel)
+                {
+                    int32_t const row = panel * kGEMM_PANEL_ROWS;
+                    int32_t const rows = std::min(kGEMM_PANEL_ROWS, a.rows - row);
+                    float const* blockA = a.data.data() + (static_cast<int64_t>(panel) * a.cols + k) * kGEMM_PANEL_ROWS;
+                    float* tile = c + row * ldc + col;
+                    float const* tileBias = bias ? bias + row : nullptr;
+#if PINET_X86_SIMD
+                    if (vectorized && cols == kTILE_COLS)
+                    {
+                        computeTileAvx2(depth, blockA, blockB, tile, ldc, rows, tileBias, first, last && relu);
+                        continue;
+                    }
+#endif
+                    computeTileScalar(depth, blockA, blockB, tile, ldc, rows, cols, tileBias, first, last && relu);
+                }
+            }
+        }
+    });
+}
+
+int32_t ConvGeometry::getOutputSize(int32_t axis, int32_t size, bool transposed) const
+{
+    int32_t const extent = dilations[axis] * (kernel[axis] - 1) + 1;
+    if (transposed)
+    {
+        return (size - 1) * strides[axis] - pads[axis] - pads[axis + 2] + extent + outputPadding[axis];
+    }
+    return (size + pads[axis] + pads[axis + 2] - extent) / strides[axis] + 1;
+}
+
+ConvWeights packConvolution(ConvGeometry const& geometry, int32_t inChannels, int32_t outChannels, bool transposed,
+    float const* weights, float const* bias)
+{
+    ConvWeights conv;
+    conv.geometry = geometry;
+    conv.inChannels = inChannels;
+    conv.outChannels = outChannels;
+    conv.transposed = transposed;
+    int32_t const kernelSize = geometry.kernel[0] * geometry.kernel[1];
+    if (transposed)
+    {
+        // Row (o, ky, kx) of the matrix is column (o, ky, kx) of the inChannels rows of weights
+        int32_t const rows = outChannels * kernelSize;
+        conv.weights = packMatrix(weights, rows, inChannels, 1, rows);
+    }
+    else
+    {
+        conv.weights = packMatrix(weights, outChannels, inChannels * kernelSize, inChannels * kernelSize, 1);
+    }
+    conv.bias.assign(outChannels, 0.f);
+    if (bias)
+    {
+        std::copy(bias, bias + outChannels, conv.bias.begin());
+    }
+    return conv;
+}
+
+int64_t getConvScratchSize(ConvWeights const& conv, int32_t height, int32_t width)
+{
+    if (isPointwise(conv))
+    {
+        return 0;
+    }
+    int64_t const kernelSize = conv.geometry.kernel[0] * conv.geometry.kernel[1];
+    if (conv.transposed)
+    {
+        return conv.outChannels * kernelSize * height * width;
+    }
+    return conv.inChannels * kernelSize * conv.geometry.getOutputSize(0, height, false)
+        * conv.geometry.getOutputSize(1, width, false);
+}
+
+void convolve(ConvWeights const& conv, bool relu, float const* input, int32_t height, int32_t width, float* output,
+    float* scratch, CpuThreadPool& pool)
+{
+    int32_t const outHeight = conv.geometry.getOutputSize(0, height, conv.transposed);
+    int32_t const outWidth = conv.geometry.getOutputSize(1, width, conv.transposed);
+    if (conv.transposed)
+    {
+        int32_t const inSize = height * width;
+        gemm(conv.weights, input, inSize, inSize, scratch, inSize, nullptr, false, pool);
+        col2im(conv, relu, scratch, height, width, outHeight, outWidth, output, pool);
+        return;
+    }
+
+    int32_t const outSize = outHeight * outWidth;
+    float const* columns = input;
+    if (!isPointwise(conv))
+    {
+        im2col(conv, input, height, width, outHeight, outWidth, scratch, pool);
+        columns = scratch;
+    }
+    gemm(conv.weights, columns, outSize, outSize, output, outSize, conv.bias.data(), relu, pool);
+}
+
+void maxPool(ConvGeometry const& geometry, float const* input, int32_t planes, int32_t height, int32_t width,
+    float* output, CpuThreadPool& pool)
+{
+    int32_t const outHeight = geometry.getOutputSize(0, height, false);
+    int32_t const outWidth = geometry.getOutputSize(1, width, false);
+    // The 2x2 windows of stride 2 halving the resolution of the hourglass networks
+    bool const halving = geometry.kernel[0] == 2 && geometry.kernel[1] == 2 && geometry.strides[0] == 2
+        && geometry.strides[1] == 2 && !geometry.pads[0] && !geometry.pads[1] && geometry.dilations[0] == 1
+        && geometry.dilations[1] == 1;
+    pool.parallelFor(planes, [&](int32_t plane) {
+        float const* src = input + static_cast<int64_t>(plane) * height * width;
+        float* dst = output + static_cast<int64_t>(plane) * outHeight * outWidth;
+        if (halving)
+        {
+            for (int32_t oy = 0; oy < outHeight; ++oy, dst += outWidth)
+            {
+                float const* top = src + 2 * oy * width;
+                float const* bottom = top + width;
+                for (int32_t ox = 0; ox < outWidth; ++ox)
+                {
+                    dst[ox] = std::max(std::max(top[2 * ox], top[2 * ox + 1]), std::max(bottom[2 * ox], bottom[2 * ox + 1]));
+                }
+            }
+            return;
+        }
+        for (int32_t oy = 0; oy < outHeight; ++oy)
+        {
+            for (int32_t ox = 0; ox < outWidth; ++ox)
+            {
+                float maximum = -std::numeric_limits<float>::infinity();
+                for (int32_t ky = 0; ky < geometry.kernel[0]; ++ky)
+                {
+                    int32_t const iy = oy * geometry.strides[0] + ky * geometry.dilations[0] - geometry.pads[0];
+                    if (iy < 0 || iy >= height)
+                    {
+                        continue;
+                    }
+                    for (int32_t kx = 0; kx < geometry.kernel[1]; ++kx)
+                    {
+                        int32_t const ix = ox * geometry.strides[1] + kx * geometry.dilations[1] - geometry.pads[1];
+                        if (ix >= 0 && ix < width)
+                        {
+                            maximum = std::max(maximum, src[iy * width + ix]);
+                        }
+                    }
+                }
+                dst[oy * outWidth + ox] = maximum;
+            }
+        }
+    });
+}
+
+void add(float const* a, float const* b, int64_t count, bool relu, float* output, CpuThreadPool& pool)
+{
+    int32_t const tasks = static_cast<int32_t>((count + kTASK_ELEMENTS - 1) / kTASK_ELEMENTS);
+    pool.parallelFor(tasks, [&](int32_t task) {
+        int64_t const begin = task * kTASK_ELEMENTS;
+        int64_t const end = std::min(begin + kTASK_ELEMENTS, count);
+        if (relu)
+        {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                output[i] = std::max(a[i] + b[i], 0.f);
+            }
+        }
+        else
+        {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                output[i] = a[i] + b[i];
+            }
+        }
+    });
+}
+
+void scaleChannels(float const* input, int32_t planes, int32_t channels, int64_t planeSize, float const* scale,
+    float const* shift, bool relu, float const* slopes, float* output, CpuThreadPool& pool)
+{
+    pool.parallelFor(planes, [&](int32_t plane) {
+        int32_t const channel = plane % channels;
+        float const factor = scale ? scale[channel] : 1.f;
+        float const offset = shift ? shift[channel] : 0.f;
+        float const slope = slopes ? slopes[channel] : relu ? 0.f : 1.f;
+        float const* src = input + plane * planeSize;
+        float* dst = output + plane * planeSize;
+        for (int64_t i = 0; i < planeSize; ++i)
+        {
+            float const value = src[i] * factor + offset;
+            dst[i] = value < 0.f ? value * slope : value;
+        }
+    });
+}
+
+} // namespace pinet
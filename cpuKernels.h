@@ -0,0 +1,185 @@
+#ifndef PINET_CPU_KERNELS_H
+#define PINET_CPU_KERNELS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief  The CpuThreadPool class runs the iterations of loops on a fixed set of threads.
+//!
+//! \details The calling thread takes part in every loop, so a pool of N threads starts N - 1 of them.
+//!          Iterations are handed out one at a time from a shared counter and should each hold enough
+//!          work to make that negligible. Loops of one pool must not be nested or run concurrently.
+//!
+class CpuThreadPool
+{
+public:
+    explicit CpuThreadPool(int32_t threadCount);
+
+    ~CpuThreadPool();
+
+    CpuThreadPool(CpuThreadPool const&) = delete;
+    CpuThreadPool& operator=(CpuThreadPool const&) = delete;
+
+    int32_t getThreadCount() const
+    {
+        return static_cast<int32_t>(mThreads.size()) + 1;
+    }
+
+    //!
+    //! \brief Calls task(i) for every i in [0, count) and returns once all calls returned.
+    //!
+    void parallelFor(int32_t count, std::function<void(int32_t)> const& task);
+
+private:
+    void work();
+
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mStarted;
+    std::condition_variable mFinished;
+    std::function<void(int32_t)> const* mTask{nullptr};
+    int32_t mCount{0};
+    std::atomic<int32_t> mNext{0};
+    int32_t mBusy{0};        //!< Threads which have not finished the current loop
+    int64_t mGeneration{0};  //!< Number of loops started, threads wait for it to change
+    bool mStopping{false};
+};
+
+//!
+//! \brief Rows of the blocks a PackedMatrix is stored in, and of the tiles the GEMM kernel computes.
+//!
+constexpr int32_t kGEMM_PANEL_ROWS = 6;
+
+//!
+//! \brief  The PackedMatrix structure holds the left operand of gemm() in the order the kernel reads it.
+//!
+//! \details Rows are grouped into panels of kGEMM_PANEL_ROWS, the last one padded with zeros. A panel
+//!          stores its columns one after the other, so element (r, c) of panel p is
+//!          data[(p * cols + c) * kGEMM_PANEL_ROWS + r].
+//!
+struct PackedMatrix
+{
+    int32_t rows{0};
+    int32_t cols{0};
+    std::vector<float> data;
+};
+
+//!
+//! \brief Packs the rows x cols matrix whose element (r, c) is source[r * rowStride + c * colStride].
+//!
+PackedMatrix packMatrix(float const* source, int32_t rows, int32_t cols, int64_t rowStride, int64_t colStride);
+
+//!
+//! \brief Computes C = A * B + bias, optionally followed by a ReLU.
+//!
+//! \param a The rows x cols left operand.
+//! \param b First element of the a.cols x n right operand, ldb floats apart from one row to the next.
+//! \param c First element of the a.rows x n result, ldc floats apart from one row to the next.
+//! \param bias One value per row of C, added to all of its elements, nullptr for none.
+//!
+//! \details Tiles of kGEMM_PANEL_ROWS x 16 elements of C are computed by the threads of pool, with AVX2
+//!          and FMA if the CPU supports them and with plain loops otherwise. The inner dimension is split
+//!          into blocks so that the panels of A and B a tile reads stay in the L1 cache.
+//!
+void gemm(PackedMatrix const& a, float const* b, int64_t ldb, int32_t n, float* c, int64_t ldc, float const* bias,
+    bool relu, CpuThreadPool& pool);
+
+//!
+//! \brief Returns whether gemm() runs on AVX2 and FMA.
+//!
+bool isGemmVectorized();
+
+//!
+//! \brief The ConvGeometry structure holds the spatial attributes of a convolution, as ONNX defines them.
+//!
+struct ConvGeometry
+{
+    int32_t kernel[2]{1, 1};        //!< Height and width of the kernel
+    int32_t strides[2]{1, 1};
+    int32_t pads[4]{0, 0, 0, 0};     //!< Top, left, bottom and right padding
+    int32_t dilations[2]{1, 1};
+    int32_t outputPadding[2]{0, 0}; //!< Rows and columns added to the bottom and right of a transposed output
+
+    //!
+    //! \brief Returns the size of the output along axis 0 (height) or 1 (width) for an input of size.
+    //!
+    int32_t getOutputSize(int32_t axis, int32_t size, bool transposed) const;
+};
+
+//!
+//! \brief  The ConvWeights structure holds a convolution or transposed convolution ready to run.
+//!
+//! \details The weights of a convolution are packed as the outChannels x (inChannels * kernel size)
+//!          matrix multiplied with the columns of the input, those of a transposed convolution as the
+//!          (outChannels * kernel size) x inChannels matrix whose product with the input is scattered
+//!          onto the output.
+//!
+struct ConvWeights
+{
+    ConvGeometry geometry;
+    int32_t inChannels{0};
+    int32_t outChannels{0};
+    bool transposed{false};
+    PackedMatrix weights;
+    std::vector<float> bias; //!< One per output channel
+};
+
+//!
+//! \brief Packs the weights of a convolution given in ONNX layout.
+//!
+//! \param weights outChannels x inChannels x kernel, or inChannels x outChannels x kernel if transposed.
+//! \param bias outChannels values, nullptr for none.
+//!
+ConvWeights packConvolution(ConvGeometry const& geometry, int32_t inChannels, int32_t outChannels, bool transposed,
+    float const* weights, float const* bias);
+
+//!
+//! \brief Returns the number of floats convolve() needs as scratch for an input of height x width.
+//!
+int64_t getConvScratchSize(ConvWeights const& conv, int32_t height, int32_t width);
+
+//!
+//! \brief Runs a convolution on one image, optionally followed by a ReLU.
+//!
+//! \param input inChannels planes of height x width.
+//! \param output outChannels planes of the output size given by the geometry.
+//! \param scratch At least getConvScratchSize() floats.
+//!
+//! \details A convolution gathers the input patches into columns, except for 1x1 kernels with a unit stride
+//!          and no padding which read the input in place, and multiplies them with the weights. A
+//!          transposed convolution multiplies the weights with the input and adds each resulting row
+//!          to the output positions its kernel element lands on.
+//!
+void convolve(ConvWeights const& conv, bool relu, float const* input, int32_t height, int32_t width, float* output,
+    float* scratch, CpuThreadPool& pool);
+
+//!
+//! \brief Takes the maximum of every window of planes of height x width, padding being ignored.
+//!
+void maxPool(ConvGeometry const& geometry, float const* input, int32_t planes, int32_t height, int32_t width,
+    float* output, CpuThreadPool& pool);
+
+//!
+//! \brief Computes output = a + b elementwise, optionally followed by a ReLU, output may alias a or b.
+//!
+void add(float const* a, float const* b, int64_t count, bool relu, float* output, CpuThreadPool& pool);
+
+//!
+//! \brief Computes output = x * scale[c] + shift[c] on planes of planeSize elements, c being the plane index
+//!        modulo channels, with a ReLU or, if slopes is set, a PReLU with one slope per channel.
+//!
+void scaleChannels(float const* input, int32_t planes, int32_t channels, int64_t planeSize, float const* scale,
+    float const* shift, bool relu, float const* slopes, float* output, CpuThreadPool& pool);
+
+} // namespace pinet
+
+#endif // PINET_CPU_KERNELS_H
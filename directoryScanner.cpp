@@ -0,0 +1,281 @@
+#include "directoryScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+namespace pinet
+{
+
+bool naturalLess(std::string const& a, std::string const& b)
+{
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size())
+    {
+        if (!std::isdigit(static_cast<unsigned char>(a[i])) || !std::isdigit(static_cast<unsigned char>(b[j])))
+        {
+            if (a[i] != b[j])
+            {
+                return a[i] < b[j];
+            }
+            ++i;
+            ++j;
+            continue;
+        }
+        // Leading zeros aside, the longer run is the larger number, runs of the same length compare as text
+        while (i < a.size() && a[i] == '0')
+        {
+            ++i;
+        }
+        while (j < b.size() && b[j] == '0')
+        {
+            ++j;
+        }
+        size_t endA = i;
+        size_t endB = j;
+        while (endA < a.size() && std::isdigit(static_cast<unsigned char>(a[endA])))
+        {
+            ++endA;
+        }
+        while (endB < b.size() && std::isdigit(static_cast<unsigned char>(b[endB])))
+        {
+            ++endB;
+        }
+        if (endA - i != endB - j)
+        {
+            return endA - i < endB - j;
+        }
+        int32_t const order = a.compare(i, endA - i, b, j, endB - j);
+        if (order != 0)
+        {
+            return order < 0;
+        }
+        i = endA;
+        j = endB;
+    }
+    if (a.size() - i != b.size() - j)
+    {
+        return a.size() - i < b.size() - j;
+    }
+    // Names equal but for leading zeros keep a strict order
+    return a < b;
+}
+
+DirectoryScanner::DirectoryScanner(
+    std::vector<std::string> const& roots, std::string extension, int32_t threads, bool sorted)
+    : mExtension(std::move(extension))
+    , mSorted(sorted)
+{
+    // The roots are the subdirectories of a directory which is already listed, in the given order
+    mDirectories.emplace_back(new Directory);
+    Directory* top = mDirectories.back().get();
+    top->listed = true;
+    for (auto const& root : roots)
+    {
+        mDirectories.emplace_back(new Directory);
+        std::string& path = mDirectories.back()->path;
+        path = root;
+        while (path.size() > 1 && path.back() == '/')
+        {
+            path.pop_back();
+        }
+        top->entries.push_back({root, mDirectories.back().get()});
+    }
+    for (auto entry = top->entries.rbegin(); entry != top->entries.rend(); ++entry)
+    {
+        mPending.push_back(entry->child);
+    }
+    mActive = static_cast<int32_t>(mPending.size());
+    mWalk.emplace_back(top, 0);
+
+    for (int32_t t = 0; t < std::max(threads, 1); ++t)
+    {
+        mThreads.emplace_back(&DirectoryScanner::work, this);
+    }
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mChanged.notify_all();
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+bool DirectoryScanner::next(std::string& path)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (!mSorted)
+    {
+        mChanged.wait(lock, [this] { return !mFound.empty() || mActive == 0; });
+        if (mFound.empty())
+        {
+            return false;
+        }
+        path = std::move(mFound.front());
+        mFound.pop_front();
+        return true;
+    }
+
+    while (!mWalk.empty())
+    {
+        Directory* directory = mWalk.back().first;
+        mChanged.wait(lock, [directory] { return directory->listed; });
+        size_t& position = mWalk.back().second;
+        if (position == directory->entries.size())
+        {
+            // Names are not needed once returned, the tree only keeps the directories
+            std::vector<Entry>().swap(directory->entries);
+            mWalk.pop_back();
+            continue;
+        }
+        Entry& entry = directory->entries[position++];
+        if (entry.child)
+        {
+            mWalk.emplace_back(entry.child, 0);
+            continue;
+        }
+        path = directory->path + "/" + entry.name;
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string> DirectoryScanner::getErrors() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mErrors;
+}
+
+void DirectoryScanner::work()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mChanged.wait(lock, [this] { return mStop || !mPending.empty() || mActive == 0; });
+        if (mStop || mPending.empty())
+        {
+            return;
+        }
+        Directory& directory = *mPending.back();
+        mPending.pop_back();
+
+        std::vector<Entry> entries;
+        std::vector<std::unique_ptr<Directory>> children;
+        lock.unlock();
+        list(directory, entries, children);
+        lock.lock();
+
+        // Subdirectories are queued last first, so the first one is listed next, as the walk needs it
+        for (auto& child : children)
+        {
+            mDirectories.push_back(std::move(child));
+        }
+        for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry)
+        {
+            if (entry->child)
+            {
+                mPending.push_back(entry->child);
+                ++mActive;
+            }
+        }
+
+        if (mSorted)
+        {
+            directory.entries = std::move(entries);
+        }
+        else
+        {
+            for (auto const& entry : entries)
+            {
+                if (!entry.child)
+                {
+                    mFound.push_back(directory.path + "/" + entry.name);
+                }
+            }
+        }
+        directory.listed = true;
+        --mActive;
+        mChanged.notify_all();
+    }
+}
+
+void DirectoryScanner::list(
+    Directory const& directory, std::vector<Entry>& entries, std::vector<std::unique_ptr<Directory>>& children)
+{
+    DIR* dir = opendir(directory.path.c_str());
+    if (!dir)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mErrors.push_back(directory.path + ": " + std::strerror(errno));
+        return;
+    }
+
+    struct stat status;
+    if (fstat(dirfd(dir), &status) == 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mVisited.emplace(static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino)).second)
+        {
+            closedir(dir);
+            return;
+        }
+    }
+
+    while (dirent const* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        bool isFile = entry->d_type == DT_REG;
+        bool isDirectory = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+        {
+            // stat follows links, a dangling one is neither
+            std::string const path = directory.path + "/" + name;
+            if (stat(path.c_str(), &status) == 0)
+            {
+                isFile = S_ISREG(status.st_mode);
+                isDirectory = S_ISDIR(status.st_mode);
+            }
+        }
+        if (isDirectory)
+        {
+            children.emplace_back(new Directory);
+            children.back()->path = directory.path + "/" + name;
+            entries.push_back({std::move(name), children.back().get()});
+        }
+        else if (isFile && matches(name))
+        {
+            entries.push_back({std::move(name), nullptr});
+        }
+    }
+    closedir(dir);
+
+    if (mSorted)
+    {
+        std::sort(entries.begin(), entries.end(),
+            [](Entry const& a, Entry const& b) { return naturalLess(a.name, b.name); });
+    }
+}
+
+bool DirectoryScanner::matches(std::string const& name) const
+{
+    // The extension starts with the only dot it holds, so matching the end of name matches at its last dot
+    return name.size() > mExtension.size()
+        && strcasecmp(name.c_str() + name.size() - mExtension.size(), mExtension.c_str()) == 0;
+}
+
+} // namespace pinet
@@ -0,0 +1,109 @@
+#ifndef PINET_DIRECTORY_SCANNER_H
+#define PINET_DIRECTORY_SCANNER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Compares names in natural order, runs of digits compare by their value, e.g. 2.jpg before 10.jpg.
+//!
+bool naturalLess(std::string const& a, std::string const& b);
+
+//!
+//! \brief  The DirectoryScanner class finds the files with a given extension under directories, in the
+//!         background, and hands them out as soon as they are found.
+//!
+//! \details Worker threads list directories depth first, so files show up before the whole tree is walked.
+//!          Entries whose type readdir does not report, i.e. DT_UNKNOWN on some network and overlay file
+//!          systems, and symbolic links are resolved with stat. Directories are identified by device and
+//!          inode, so one reached through several links is scanned once and link cycles end. Extensions are
+//!          matched case-insensitively at the last dot of the name.
+//!
+//!          When sorted, files are returned as a walk visiting the entries of each directory in natural name
+//!          order would return them, whatever the number of threads, so the numbered frames of a clip come in
+//!          sequence. Otherwise they are returned in the order they are found.
+//!
+class DirectoryScanner
+{
+public:
+    //!
+    //! \brief Starts scanning roots, which are visited in the given order when sorted.
+    //!
+    DirectoryScanner(std::vector<std::string> const& roots, std::string extension, int32_t threads, bool sorted);
+
+    ~DirectoryScanner();
+
+    DirectoryScanner(DirectoryScanner const&) = delete;
+    DirectoryScanner& operator=(DirectoryScanner const&) = delete;
+
+    //!
+    //! \brief Waits for the next file.
+    //!
+    //! \return false once every file was returned
+    //!
+    bool next(std::string& path);
+
+    //!
+    //! \brief Returns the directories which could not be read so far, with the reason.
+    //!
+    std::vector<std::string> getErrors() const;
+
+private:
+    struct Directory;
+
+    //!
+    //! \brief An entry of a listed directory, child is set for subdirectories only.
+    //!
+    struct Entry
+    {
+        std::string name;
+        Directory* child{nullptr};
+    };
+
+    struct Directory
+    {
+        std::string path;
+        bool listed{false};
+        std::vector<Entry> entries;
+    };
+
+    void work();
+
+    //!
+    //! \brief Reads the entries of directory, with a new Directory for each subdirectory in children.
+    //!
+    void list(
+        Directory const& directory, std::vector<Entry>& entries, std::vector<std::unique_ptr<Directory>>& children);
+
+    bool matches(std::string const& name) const;
+
+    std::string mExtension;
+    bool mSorted;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mChanged;
+    std::vector<std::unique_ptr<Directory>> mDirectories; //!< Every directory found, owned here
+    std::vector<Directory*> mPending;                      //!< Directories waiting for a worker, the last first
+    int32_t mActive{0};                                    //!< Directories queued or being listed
+    std::set<std::pair<uint64_t, uint64_t>> mVisited;      //!< Device and inode of the directories listed
+    std::deque<std::string> mFound;                        //!< Files found and not returned yet, when not sorted
+    std::vector<std::pair<Directory*, size_t>> mWalk;      //!< Position of next() in the tree, when sorted
+    std::vector<std::string> mErrors;
+    bool mStop{false};
+    std::vector<std::thread> mThreads;
+};
+
+} // namespace pinet
+
+#endif // PINET_DIRECTORY_SCANNER_H
@@ -0,0 +1,206 @@
+#include "engineCache.h"
+#include "common.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr uint64_t kFNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t kFNV_PRIME = 1099511628211ULL;
+
+//!
+//! \brief Continues the FNV-1a hash of a stream of bytes.
+//!
+uint64_t hashBytes(uint64_t hash, char const* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * kFNV_PRIME;
+    }
+    return hash;
+}
+
+//!
+//! \brief Creates directory unless it exists.
+//!
+bool makeDirectory(std::string const& directory)
+{
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        sample::gLogError << "Cannot create " << directory << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Returns the directory of fileName, . if it has none.
+//!
+std::string getDirectory(std::string const& fileName)
+{
+    size_t const slash = fileName.rfind('/');
+    if (slash == std::string::npos)
+    {
+        return ".";
+    }
+    return slash == 0 ? "/" : fileName.substr(0, slash);
+}
+
+//!
+//! \brief Writes plan to a temporary file named after the process and renames it over fileName.
+//!
+bool replaceFile(std::string const& fileName, void const* plan, size_t size)
+{
+    // Another writer can only race us after the lock file is unlinked, the name keeps it from sharing our file
+    std::string const temporaryName = fileName + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream file(temporaryName, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<char const*>(plan), size);
+        file.close();
+        if (!file)
+        {
+            sample::gLogError << "Cannot write " << temporaryName << std::endl;
+            std::remove(temporaryName.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporaryName.c_str(), fileName.c_str()) != 0)
+    {
+        sample::gLogError << "Cannot rename " << temporaryName << " to " << fileName << std::endl;
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool hashFile(std::string const& fileName, uint64_t& hash, int64_t& size)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        sample::gLogError << "Cannot open " << fileName << std::endl;
+        return false;
+    }
+
+    hash = kFNV_OFFSET_BASIS;
+    size = 0;
+    std::vector<char> chunk(1 << 20);
+    while (file)
+    {
+        file.read(chunk.data(), chunk.size());
+        std::streamsize const count = file.gcount();
+        hash = hashBytes(hash, chunk.data(), count);
+        size += count;
+    }
+    if (!file.eof())
+    {
+        sample::gLogError << "Cannot read " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t hashNames(std::vector<std::string> const& names)
+{
+    uint64_t hash = kFNV_OFFSET_BASIS;
+    for (auto const& name : names)
+    {
+        // The terminating zero separates the names, so that {"ab", "c"} and {"a", "bc"} differ
+        hash = hashBytes(hash, name.c_str(), name.size() + 1);
+    }
+    return hash;
+}
+
+std::string toFileName(EngineKey const& key)
+{
+    std::ostringstream name;
+    name << "pinet-" << std::hex << std::setw(16) << std::setfill('0') << key.modelHash << std::dec << "-"
+         << key.modelSize << (key.int8 ? "-int8" : "") << (key.fp16 ? "-fp16" : "") << (key.int8 || key.fp16 ? "" : "-fp32");
+    if (key.dlaCore >= 0)
+    {
+        name << "-dla" << key.dlaCore;
+    }
+    name << "-b" << key.batchSize << "-trt" << key.builderVersion << "-o" << std::hex << std::setw(8)
+         << static_cast<uint32_t>(key.outputsHash ^ (key.outputsHash >> 32)) << ".plan";
+    return name.str();
+}
+
+bool readPlan(std::string const& fileName, std::vector<char>& plan)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    file.seekg(0, std::ifstream::end);
+    std::streamoff const size = file.tellg();
+    file.seekg(0, std::ifstream::beg);
+    plan.resize(size);
+    file.read(plan.data(), size);
+    if (!file || size == 0)
+    {
+        sample::gLogError << "Cannot read " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writePlan(std::string const& fileName, void const* plan, size_t size)
+{
+    // One lock per directory, samplesCommon::FileLock appends .lock to the name
+    std::string const lockName = getDirectory(fileName) + "/.pinet-plans";
+    bool replaced = false;
+    try
+    {
+        samplesCommon::FileLock lock(lockName);
+        replaced = replaceFile(fileName, plan, size);
+        // Unlinked while still held, the lock file does not outlive the write
+        std::remove((lockName + ".lock").c_str());
+    }
+    catch (std::runtime_error const& e)
+    {
+        sample::gLogError << e.what() << std::endl;
+        return false;
+    }
+    return replaced;
+}
+
+EngineCache::EngineCache(std::string directory)
+    : mDirectory(std::move(directory))
+{
+}
+
+std::string EngineCache::getPath(EngineKey const& key) const
+{
+    return mDirectory + "/" + toFileName(key);
+}
+
+bool EngineCache::load(EngineKey const& key, std::vector<char>& plan) const
+{
+    std::string const path = getPath(key);
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        return false;
+    }
+    return readPlan(path, plan);
+}
+
+bool EngineCache::store(EngineKey const& key, void const* plan, size_t size) const
+{
+    return makeDirectory(mDirectory) && writePlan(getPath(key), plan, size);
+}
+
+} // namespace pinet
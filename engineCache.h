@@ -0,0 +1,97 @@
+#ifndef PINET_ENGINE_CACHE_H
+#define PINET_ENGINE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief The EngineKey structure holds everything a serialized engine depends on.
+//!
+//! \details Two builds with equal keys produce interchangeable plans, so a plan cached under a key can be
+//!          deserialized instead of building the engine again.
+//!
+struct EngineKey
+{
+    uint64_t modelHash{0};     //!< FNV-1a hash of the bytes of the ONNX model
+    int64_t modelSize{0};      //!< Size of the ONNX model in bytes
+    bool fp16{false};          //!< Whether FP16 kernels are allowed
+    bool int8{false};          //!< Whether INT8 kernels are allowed
+    int32_t dlaCore{-1};       //!< DLA core the engine runs on, -1 for the GPU only
+    int32_t batchSize{1};      //!< Batch size of the network input
+    int32_t builderVersion{0}; //!< Version of the TensorRT library building the plan, see getInferLibVersion()
+    uint64_t outputsHash{0};   //!< hashNames() of the outputs left marked in the network
+};
+
+//!
+//! \brief Hashes the content of a file with 64-bit FNV-1a and returns its size.
+//!
+//! \return false if the file cannot be read
+//!
+bool hashFile(std::string const& fileName, uint64_t& hash, int64_t& size);
+
+//!
+//! \brief Hashes a list of tensor names with 64-bit FNV-1a.
+//!
+uint64_t hashNames(std::vector<std::string> const& names);
+
+//!
+//! \brief Returns the file name of the plan cached under key,
+//!        e.g. pinet-<hash>-<size>-fp16-dla0-b1-trt8401-o<outputs hash>.plan.
+//!
+std::string toFileName(EngineKey const& key);
+
+//!
+//! \brief Reads a serialized engine, without a lock since writePlan() only ever renames complete plans in place.
+//!
+//! \return false if the file cannot be read
+//!
+bool readPlan(std::string const& fileName, std::vector<char>& plan);
+
+//!
+//! \brief Writes a serialized engine, holding a samplesCommon::FileLock of the directory of the file.
+//!
+//! \details The plan is written to a temporary file next to fileName which is then renamed over it, so
+//!          readers never see a partially written plan even if the writer dies. The lock file is removed
+//!          once the plan is in place.
+//!
+//! \return false if the file cannot be written
+//!
+bool writePlan(std::string const& fileName, void const* plan, size_t size);
+
+//!
+//! \brief  The EngineCache class stores serialized engines in a directory, one file per EngineKey.
+//!
+class EngineCache
+{
+public:
+    explicit EngineCache(std::string directory);
+
+    //!
+    //! \brief Returns the path of the plan cached under key.
+    //!
+    std::string getPath(EngineKey const& key) const;
+
+    //!
+    //! \brief Reads the plan cached under key.
+    //!
+    //! \return false on a cache miss
+    //!
+    bool load(EngineKey const& key, std::vector<char>& plan) const;
+
+    //!
+    //! \brief Caches plan under key, creating the directory if needed and replacing any previous plan.
+    //!
+    bool store(EngineKey const& key, void const* plan, size_t size) const;
+
+private:
+    std::string mDirectory;
+};
+
+} // namespace pinet
+
+#endif // PINET_ENGINE_CACHE_H
@@ -0,0 +1,50 @@
+#ifndef PINET_FRAME_H
+#define PINET_FRAME_H
+
+#include "imageShard.h"
+#include "laneModel.h"
+#include "stageTiming.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+using LaneLine = std::vector<cv::Point2f>;
+using LaneLines = std::vector<LaneLine>;
+
+//!
+//! \brief The Frame structure carries one image and its intermediate results through the pipeline.
+//!
+struct Frame
+{
+    int64_t index{0};                        //!< Position of the image in the input list
+    std::string fileName;                    //!< Path of the image, shard and name of a packed image, or video#frame
+    ShardReader const* shard{nullptr};       //!< Shard holding the encoded image, null to read fileName
+    int64_t shardImage{0};                   //!< Index of the image in shard
+    bool tracked{false};                     //!< Lane lines are carried over by the lane tracker, not inferred
+    bool clipStart{false};                   //!< First frame of a clip, the lane tracker starts over
+    uint64_t inputKey{0};                    //!< Key of input in the input cache, 0 if it is not cached
+    bool inputCached{false};                 //!< input was loaded from the input cache, image is only decoded to track
+    cv::Mat image;                           //!< Decoded image, possibly scaled down by the JPEG decoder, or empty.
+                                             //!< Video frames come with their image
+    std::vector<float> input;                //!< Normalized CHW network input
+    std::vector<std::vector<float>> outputs; //!< Network outputs in backend output order
+    bool inferred{false};                    //!< outputs were filled for this image, a recycled frame keeps
+                                             //!< those of an earlier image otherwise
+    LaneLines laneLines;                     //!< Lane lines in output grid coordinates
+    LaneLines spareLaneLines;                //!< Vectors of lane lines of earlier images, kept for their capacity
+    std::vector<LaneModel> laneModels;       //!< Polynomials fitted to laneLines, if lane lines are fitted
+    char const* failedStage{nullptr};        //!< Name of the stage that failed, later stages skip the frame
+    Clock::time_point created;               //!< When the source created the frame
+    Clock::time_point captured;              //!< When a video frame was captured, the epoch for images
+    FrameTime times;                         //!< Time spent in each stage
+};
+
+} // namespace pinet
+
+#endif // PINET_FRAME_H
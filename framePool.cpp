@@ -0,0 +1,59 @@
+#include "framePool.h"
+#include "laneExtraction.h"
+
+#include <utility>
+
+namespace pinet
+{
+
+std::unique_ptr<Frame> FramePool::acquire()
+{
+    std::unique_ptr<Frame> frame;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mFrames.empty())
+        {
+            frame = std::move(mFrames.back());
+            mFrames.pop_back();
+        }
+    }
+    if (!frame)
+    {
+        frame.reset(new Frame);
+    }
+    return frame;
+}
+
+void FramePool::release(std::unique_ptr<Frame> frame)
+{
+    if (!frame)
+    {
+        return;
+    }
+    reset(*frame);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFrames.push_back(std::move(frame));
+}
+
+void FramePool::reset(Frame& frame)
+{
+    frame.index = 0;
+    frame.fileName.clear();
+    frame.shard = nullptr;
+    frame.shardImage = 0;
+    frame.tracked = false;
+    frame.clipStart = false;
+    frame.inputKey = 0;
+    frame.inputCached = false;
+    // decode() skips frames which come with an image, and decoded images are not reused anyway
+    frame.image.release();
+    frame.inferred = false;
+    resizeLaneLines(frame.laneLines, frame.spareLaneLines, 0);
+    frame.laneModels.clear();
+    frame.failedStage = nullptr;
+    frame.created = Clock::time_point();
+    frame.captured = Clock::time_point();
+    frame.times = FrameTime();
+}
+
+} // namespace pinet
@@ -0,0 +1,46 @@
+#ifndef PINET_FRAME_POOL_H
+#define PINET_FRAME_POOL_H
+
+#include "frame.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief  The FramePool class recycles the frames the sink of the pipeline is done with back to its source.
+//!
+//! \details A recycled frame gets the fields describing its image reset but keeps the buffers of its input,
+//!          outputs and lane lines, so once the pool holds as many frames as the pipeline has in flight,
+//!          neither the frames nor the buffers they are inferred and post-processed into are allocated again.
+//!          acquire() and release() can be called from several threads.
+//!
+class FramePool
+{
+public:
+    //!
+    //! \brief Returns a frame released earlier, reset, or a new one if none is left.
+    //!
+    std::unique_ptr<Frame> acquire();
+
+    //!
+    //! \brief Takes frame back for a later acquire().
+    //!
+    void release(std::unique_ptr<Frame> frame);
+
+    //!
+    //! \brief Resets the fields of frame describing its image, its buffers keep their size and capacity.
+    //!
+    static void reset(Frame& frame);
+
+private:
+    std::mutex mMutex;
+    std::vector<std::unique_ptr<Frame>> mFrames; //!< Frames released and not acquired again
+};
+
+} // namespace pinet
+
+#endif // PINET_FRAME_POOL_H
@@ -0,0 +1,137 @@
+#include "imageDecode.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <fstream>
+
+namespace pinet
+{
+
+bool getJpegSize(uint8_t const* data, size_t size, int32_t& width, int32_t& height)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+    {
+        return false;
+    }
+
+    // Walk the marker segments up to the first start of frame, which holds the size
+    size_t offset = 2;
+    while (offset + 4 <= size)
+    {
+        if (data[offset] != 0xFF)
+        {
+            return false;
+        }
+        uint8_t const marker = data[offset + 1];
+        if (marker == 0xFF)
+        {
+            ++offset; // Fill byte
+            continue;
+        }
+        offset += 2;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+        {
+            continue; // Markers without a segment
+        }
+        if (marker == 0xD9 || marker == 0xDA)
+        {
+            return false; // End of image or start of scan before any frame header
+        }
+
+        size_t const length = (static_cast<size_t>(data[offset]) << 8) | data[offset + 1];
+        bool const isFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isFrame)
+        {
+            // Length, sample precision, height and width
+            if (length < 7 || offset + 7 > size)
+            {
+                return false;
+            }
+            height = (data[offset + 3] << 8) | data[offset + 4];
+            width = (data[offset + 5] << 8) | data[offset + 6];
+            return width > 0 && height > 0;
+        }
+        if (length < 2)
+        {
+            return false;
+        }
+        offset += length;
+    }
+    return false;
+}
+
+int32_t getReducedScale(int32_t width, int32_t height, int32_t minWidth, int32_t minHeight)
+{
+    int32_t scale = 1;
+    for (int32_t next = 2; next <= 8; next *= 2)
+    {
+        if ((width + next - 1) / next < minWidth || (height + next - 1) / next < minHeight)
+        {
+            break;
+        }
+        scale = next;
+    }
+    return scale;
+}
+
+int32_t getReducedFlags(int32_t scale)
+{
+    switch (scale)
+    {
+    case 2: return cv::IMREAD_REDUCED_COLOR_2;
+    case 4: return cv::IMREAD_REDUCED_COLOR_4;
+    case 8: return cv::IMREAD_REDUCED_COLOR_8;
+    default: return cv::IMREAD_COLOR;
+    }
+}
+
+bool decodeImage(std::string const& fileName, int32_t minWidth, int32_t minHeight, std::vector<uint8_t>& buffer,
+    cv::Mat& image, int32_t* scale)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    std::streamoff const size = file.tellg();
+    buffer.resize(static_cast<size_t>(size));
+    if (size <= 0 || !file.seekg(0).read(reinterpret_cast<char*>(buffer.data()), size))
+    {
+        return false;
+    }
+    return decodeImage(buffer.data(), buffer.size(), minWidth, minHeight, image, scale);
+}
+
+bool decodeImage(uint8_t const* data, size_t size, int32_t minWidth, int32_t minHeight, cv::Mat& image,
+    int32_t* scale)
+{
+    // imdecode only reads the bytes, the wrapper does not copy them
+    cv::Mat const encoded(1, static_cast<int32_t>(size), CV_8UC1, const_cast<uint8_t*>(data));
+
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t reduced = 1;
+    if (getJpegSize(data, size, width, height))
+    {
+        reduced = getReducedScale(width, height, minWidth, minHeight);
+    }
+    if (reduced > 1)
+    {
+        image = cv::imdecode(encoded, getReducedFlags(reduced));
+        if (image.cols < minWidth || image.rows < minHeight)
+        {
+            reduced = 1;
+        }
+    }
+    if (reduced == 1)
+    {
+        image = cv::imdecode(encoded, cv::IMREAD_COLOR);
+    }
+    if (scale)
+    {
+        *scale = reduced;
+    }
+    return !image.empty();
+}
+
+} // namespace pinet
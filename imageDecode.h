@@ -0,0 +1,57 @@
+#ifndef PINET_IMAGE_DECODE_H
+#define PINET_IMAGE_DECODE_H
+
+#include <opencv2/core/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Reads the size of a JPEG image from its frame header.
+//!
+//! \return false if data does not start like a JPEG image or ends before its frame header
+//!
+bool getJpegSize(uint8_t const* data, size_t size, int32_t& width, int32_t& height);
+
+//!
+//! \brief Returns the largest of 1, 2, 4 and 8 by which a JPEG decoder can scale down an image of width x height
+//!        while it still covers minWidth x minHeight.
+//!
+//! \details Decoders scale in the DCT domain and round the size up, an image is decoded at ceil(width / scale).
+//!
+int32_t getReducedScale(int32_t width, int32_t height, int32_t minWidth, int32_t minHeight);
+
+//!
+//! \brief Returns the cv::imread flags decoding a color image scaled down by scale, 1, 2, 4 or 8.
+//!
+int32_t getReducedFlags(int32_t scale);
+
+//!
+//! \brief Reads a color image, letting the JPEG decoder scale it down as far as it still covers
+//!        minWidth x minHeight.
+//!
+//! \param buffer Receives the content of the file, kept by the caller so that it is not allocated per image.
+//! \param scale If not null, receives the scale the image was reduced by, 1 if it was decoded at full size.
+//!
+//! \details Scaling down while decoding skips most of the inverse DCT and color conversion work, the remaining
+//!          resize to the network input then only interpolates between close samples. Images which are not
+//!          JPEG, or which the decoder rotates according to their EXIF orientation so that the reduced image
+//!          would not cover the minimum size, are decoded at full size.
+//!
+bool decodeImage(std::string const& fileName, int32_t minWidth, int32_t minHeight, std::vector<uint8_t>& buffer,
+    cv::Mat& image, int32_t* scale = nullptr);
+
+//!
+//! \brief Same as decodeImage but decodes an encoded image in memory, e.g. in a mapped shard.
+//!
+bool decodeImage(uint8_t const* data, size_t size, int32_t minWidth, int32_t minHeight, cv::Mat& image,
+    int32_t* scale = nullptr);
+
+} // namespace pinet
+
+#endif // PINET_IMAGE_DECODE_H
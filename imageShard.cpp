@@ -0,0 +1,213 @@
+#include "imageShard.h"
+#include "logger.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr uint64_t kHEADER_SIZE = 32;
+constexpr uint64_t kINDEX_ENTRY_SIZE = 20;
+
+template <typename T>
+void writeValue(std::ostream& os, T const& value)
+{
+    os.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+//!
+//! \brief Reads a value at offset of a mapping and advances offset, the mapping has to hold it.
+//!
+template <typename T>
+T readValue(uint8_t const* data, uint64_t& offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+} // namespace
+
+bool ShardWriter::open(std::string const& fileName)
+{
+    mFileName = fileName;
+    mFile.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!mFile)
+    {
+        sample::gLogError << "Cannot create shard " << fileName << std::endl;
+        return false;
+    }
+    // The header is written last, once the offsets are known
+    mFile.write(std::string(kHEADER_SIZE, '\0').data(), kHEADER_SIZE);
+    mOffset = kHEADER_SIZE;
+    return static_cast<bool>(mFile);
+}
+
+bool ShardWriter::add(std::string const& clip, uint32_t frameId, char const* data, size_t size)
+{
+    if (size > UINT32_MAX)
+    {
+        sample::gLogError << "An image of clip " << clip << " is too large for a shard" << std::endl;
+        return false;
+    }
+    auto const found = mClipIndices.emplace(clip, static_cast<uint32_t>(mClips.size()));
+    if (found.second)
+    {
+        mClips.push_back(clip);
+    }
+    // Images are named and cached by clip and frame id, see ShardReader::getName()
+    if (!mFrames.emplace(found.first->second, frameId).second)
+    {
+        sample::gLogError << "Clip " << clip << " already holds frame " << frameId << std::endl;
+        return false;
+    }
+
+    ShardImage image;
+    image.offset = mOffset;
+    image.size = static_cast<uint32_t>(size);
+    image.clip = found.first->second;
+    image.frameId = frameId;
+    mImages.push_back(image);
+
+    mFile.write(data, size);
+    mOffset += size;
+    return static_cast<bool>(mFile);
+}
+
+bool ShardWriter::finish()
+{
+    uint64_t const indexOffset = mOffset;
+    for (auto const& image : mImages)
+    {
+        writeValue(mFile, image.offset);
+        writeValue(mFile, image.size);
+        writeValue(mFile, image.clip);
+        writeValue(mFile, image.frameId);
+    }
+    uint64_t const clipsOffset = indexOffset + mImages.size() * kINDEX_ENTRY_SIZE;
+    for (auto const& clip : mClips)
+    {
+        writeValue(mFile, static_cast<uint32_t>(clip.size()));
+        mFile.write(clip.data(), clip.size());
+    }
+
+    mFile.seekp(0);
+    writeValue(mFile, kSHARD_MAGIC);
+    writeValue(mFile, kSHARD_VERSION);
+    writeValue(mFile, static_cast<uint32_t>(mImages.size()));
+    writeValue(mFile, static_cast<uint32_t>(mClips.size()));
+    writeValue(mFile, indexOffset);
+    writeValue(mFile, clipsOffset);
+    mFile.close();
+    if (!mFile)
+    {
+        sample::gLogError << "Cannot write shard " << mFileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ShardReader::~ShardReader()
+{
+    close();
+}
+
+void ShardReader::close()
+{
+    if (mData)
+    {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mImages.clear();
+    mClips.clear();
+}
+
+bool ShardReader::open(std::string const& fileName)
+{
+    close();
+    int32_t const fd = ::open(fileName.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0)
+    {
+        sample::gLogError << "Cannot open shard " << fileName << std::endl;
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+    mFileName = fileName;
+    mModified = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+    mSize = static_cast<size_t>(status.st_size);
+    void* mapping = mSize >= kHEADER_SIZE ? mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        sample::gLogError << "Cannot map shard " << fileName << std::endl;
+        mSize = 0;
+        return false;
+    }
+    mData = static_cast<uint8_t const*>(mapping);
+    // Images are mostly read in order, once
+    madvise(mapping, mSize, MADV_SEQUENTIAL);
+
+    uint64_t offset = 0;
+    uint32_t const magic = readValue<uint32_t>(mData, offset);
+    uint32_t const version = readValue<uint32_t>(mData, offset);
+    uint32_t const imageCount = readValue<uint32_t>(mData, offset);
+    uint32_t const clipCount = readValue<uint32_t>(mData, offset);
+    uint64_t const indexOffset = readValue<uint64_t>(mData, offset);
+    uint64_t clipsOffset = readValue<uint64_t>(mData, offset);
+    bool valid = magic == kSHARD_MAGIC && version == kSHARD_VERSION && indexOffset >= kHEADER_SIZE
+        && indexOffset <= mSize && (mSize - indexOffset) / kINDEX_ENTRY_SIZE >= imageCount
+        && clipsOffset == indexOffset + imageCount * kINDEX_ENTRY_SIZE;
+
+    for (uint32_t c = 0; valid && c < clipCount; ++c)
+    {
+        valid = mSize - clipsOffset >= sizeof(uint32_t);
+        uint32_t const length = valid ? readValue<uint32_t>(mData, clipsOffset) : 0;
+        valid = valid && mSize - clipsOffset >= length;
+        if (valid)
+        {
+            mClips.emplace_back(reinterpret_cast<char const*>(mData + clipsOffset), length);
+            clipsOffset += length;
+        }
+    }
+
+    offset = indexOffset;
+    mImages.resize(valid ? imageCount : 0);
+    for (auto& image : mImages)
+    {
+        image.offset = readValue<uint64_t>(mData, offset);
+        image.size = readValue<uint32_t>(mData, offset);
+        image.clip = readValue<uint32_t>(mData, offset);
+        image.frameId = readValue<uint32_t>(mData, offset);
+        valid = valid && image.offset >= kHEADER_SIZE && image.offset <= indexOffset
+            && image.size <= indexOffset - image.offset && image.clip < clipCount;
+    }
+
+    if (!valid)
+    {
+        sample::gLogError << fileName << " is not a valid shard" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+std::string ShardReader::getName(int64_t index) const
+{
+    return getClip(index) + "/" + std::to_string(mImages[index].frameId) + ".jpg";
+}
+
+} // namespace pinet
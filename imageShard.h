@@ -0,0 +1,163 @@
+#ifndef PINET_IMAGE_SHARD_H
+#define PINET_IMAGE_SHARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Layout of a shard of encoded images, all fields little endian:
+//!
+//!        header: uint32 magic ("PNSH"), uint32 version, uint32 number of images, uint32 number of clips,
+//!        uint64 offset of the index, uint64 offset of the clip table,
+//!        followed by the encoded images back to back, as they were read from their files,
+//!        index: per image uint64 offset, uint32 size in bytes, uint32 clip, uint32 frame id,
+//!        clip table: per clip uint32 name length, name bytes.
+//!
+//!        Images are stored in the order they were added, which is the order they are read in.
+//!
+constexpr uint32_t kSHARD_MAGIC = 0x48534e50; // "PNSH"
+constexpr uint32_t kSHARD_VERSION = 1;
+
+//!
+//! \brief The ShardImage structure describes one image of a shard.
+//!
+struct ShardImage
+{
+    uint64_t offset{0}; //!< Position of the encoded image in the shard
+    uint32_t size{0};   //!< Size of the encoded image in bytes
+    uint32_t clip{0};   //!< Index of the clip in the clip table
+    uint32_t frameId{0};
+};
+
+//!
+//! \brief  The ShardWriter class packs encoded images into a shard.
+//!
+class ShardWriter
+{
+public:
+    //!
+    //! \brief Creates the shard file and reserves its header.
+    //!
+    bool open(std::string const& fileName);
+
+    //!
+    //! \brief Appends an encoded image of clip, clips get their index in the order they first appear.
+    //!
+    //! \return false if the file cannot be written or clip already holds an image of frameId
+    //!
+    bool add(std::string const& clip, uint32_t frameId, char const* data, size_t size);
+
+    //!
+    //! \brief Writes the index, the clip table and the header, then closes the file.
+    //!
+    bool finish();
+
+    int64_t getImageCount() const
+    {
+        return static_cast<int64_t>(mImages.size());
+    }
+
+private:
+    std::string mFileName;
+    std::ofstream mFile;
+    uint64_t mOffset{0};
+    std::vector<ShardImage> mImages;
+    std::vector<std::string> mClips;
+    std::map<std::string, uint32_t> mClipIndices;
+    std::set<std::pair<uint32_t, uint32_t>> mFrames; //!< Clip index and frame id of every image added
+};
+
+//!
+//! \brief  The ShardReader class maps a shard into memory and hands out its images in place.
+//!
+//! \details The index and the clip table are checked and parsed on open, the images are read only when
+//!          they are accessed, so the page cache and read-ahead do the I/O of a sequential pass. The mapping
+//!          is read-only and can be shared by threads.
+//!
+class ShardReader
+{
+public:
+    ShardReader() = default;
+
+    ~ShardReader();
+
+    ShardReader(ShardReader const&) = delete;
+    ShardReader& operator=(ShardReader const&) = delete;
+
+    //!
+    //! \return false if the file cannot be mapped or is not a valid shard
+    //!
+    bool open(std::string const& fileName);
+
+    int64_t getImageCount() const
+    {
+        return static_cast<int64_t>(mImages.size());
+    }
+
+    ShardImage const& getImage(int64_t index) const
+    {
+        return mImages[index];
+    }
+
+    //!
+    //! \brief Returns the first byte of the encoded image index, valid as long as the reader.
+    //!
+    uint8_t const* getData(int64_t index) const
+    {
+        return mData + mImages[index].offset;
+    }
+
+    std::string const& getClip(int64_t index) const
+    {
+        return mClips[mImages[index].clip];
+    }
+
+    //!
+    //! \brief Returns a name for image index, <clip>/<frame id>.jpg.
+    //!
+    std::string getName(int64_t index) const;
+
+    std::string const& getFileName() const
+    {
+        return mFileName;
+    }
+
+    //!
+    //! \brief Returns the modification time of the shard file in nanoseconds.
+    //!
+    int64_t getModifiedTime() const
+    {
+        return mModified;
+    }
+
+    //!
+    //! \brief Returns the size of the shard file in bytes.
+    //!
+    int64_t getFileSize() const
+    {
+        return static_cast<int64_t>(mSize);
+    }
+
+private:
+    void close();
+
+    std::string mFileName;
+    int64_t mModified{0};
+    uint8_t const* mData{nullptr};
+    size_t mSize{0};
+    std::vector<ShardImage> mImages;
+    std::vector<std::string> mClips;
+};
+
+} // namespace pinet
+
+#endif // PINET_IMAGE_SHARD_H
@@ -0,0 +1,120 @@
+#ifndef PINET_INFERENCE_BACKEND_H
+#define PINET_INFERENCE_BACKEND_H
+
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief The TensorDesc structure names a network tensor and holds its NCHW dimensions.
+//!
+struct TensorDesc
+{
+    std::string name;
+    std::vector<int32_t> dims;
+
+    //!
+    //! \brief Returns the number of elements of the tensor.
+    //!
+    int64_t volume() const
+    {
+        return std::accumulate(dims.begin(), dims.end(), int64_t{1}, std::multiplies<int64_t>());
+    }
+};
+
+//!
+//! \brief The InferenceTiming structure holds the time the steps of the last infer() took, in milliseconds.
+//!
+//! \details Like FrameTime, steps a backend does not have keep a negative time, so backends without device
+//!          copies are left out of the h2d and d2h statistics.
+//!
+struct InferenceTiming
+{
+    float h2d{-1.f};  //!< Copying the input to the device
+    float execute{0}; //!< Running the network
+    float d2h{-1.f};  //!< Copying the outputs to the host
+};
+
+//!
+//! \brief  The InferenceBackend class is the interface between PINet pre/post-processing and an executor.
+//!
+//! \details A backend owns one host input buffer shaped like getInput() and one host output buffer for
+//!          each entry of getOutputs(). Callers write the preprocessed images into getInputBuffer(), call
+//!          infer() and then read the outputs in place. Outputs keep the network order, i.e. confidence,
+//!          offset and instance of the first hourglass stack followed by those of the second stack.
+//!          The first dimension of all tensors is the batch size, images of a batch are stored back to back.
+//!
+class InferenceBackend
+{
+public:
+    virtual ~InferenceBackend() = default;
+
+    //!
+    //! \brief Returns a short name of the backend used in logs.
+    //!
+    virtual std::string getName() const = 0;
+
+    //!
+    //! \brief Returns the description of the network input.
+    //!
+    virtual TensorDesc const& getInput() const = 0;
+
+    //!
+    //! \brief Returns the descriptions of the network outputs.
+    //!
+    virtual std::vector<TensorDesc> const& getOutputs() const = 0;
+
+    //!
+    //! \brief Returns the host buffer the input tensor has to be written to before infer().
+    //!
+    virtual float* getInputBuffer() = 0;
+
+    //!
+    //! \brief Returns the host buffer holding output index after infer().
+    //!
+    virtual float const* getOutputBuffer(int32_t index) const = 0;
+
+    //!
+    //! \brief Runs the network on the current input buffer.
+    //!
+    //! \return true if the output buffers hold the result of the inference
+    //!
+    virtual bool infer() = 0;
+
+    //!
+    //! \brief Returns the number of images run by one call to infer().
+    //!
+    int32_t getBatchSize() const
+    {
+        return getInput().dims[0];
+    }
+
+    //!
+    //! \brief Tells the backend the position in the input stream of the image in slot of the next batch.
+    //!
+    //! \details Executors ignore it. Stand-ins use it to return the same outputs for the same image no
+    //!          matter which worker runs it or which batch it ends up in. Slots are set in order from 0,
+    //!          the slots of a partial batch which are not set are padding.
+    //!
+    virtual void setSequenceNumber(int32_t /*slot*/, int64_t /*sequence*/) {}
+
+    //!
+    //! \brief Returns how long the steps of the last successful infer() took.
+    //!
+    InferenceTiming const& getLastTiming() const
+    {
+        return mLastTiming;
+    }
+
+protected:
+    InferenceTiming mLastTiming; //!< Set by infer() implementations, steps without a counterpart stay -1
+};
+
+} // namespace pinet
+
+#endif // PINET_INFERENCE_BACKEND_H
@@ -0,0 +1,435 @@
+#include "inputCache.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr size_t kHEADER_SIZE = 64;
+constexpr char const* kENTRY_SUFFIX = ".pnic";
+constexpr uint64_t kFNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t kFNV_PRIME = 1099511628211ULL;
+
+//!
+//! \brief Continues the FNV-1a hash of a stream of bytes.
+//!
+uint64_t hashBytes(uint64_t hash, void const* data, size_t size)
+{
+    auto const* bytes = static_cast<uint8_t const*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * kFNV_PRIME;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t hashValue(uint64_t hash, T const& value)
+{
+    return hashBytes(hash, &value, sizeof(T));
+}
+
+int64_t getNanoseconds(timespec const& time)
+{
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+int64_t now()
+{
+    timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return getNanoseconds(time);
+}
+
+//!
+//! \brief Rounds a float to the nearest half float, ties to even.
+//!
+uint16_t toHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t const sign = (bits >> 16) & 0x8000;
+    int32_t const exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31)
+    {
+        // Overflow to infinity, NaN stays NaN
+        bool const nan = ((bits >> 23) & 0xFF) == 0xFF && mantissa;
+        return static_cast<uint16_t>(sign | 0x7C00 | (nan ? 0x200 : 0));
+    }
+    if (exponent <= 0)
+    {
+        // Subnormal half, or zero if even the implicit bit is shifted out
+        if (exponent < -10)
+        {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        int32_t const shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t const rest = mantissa & ((1u << shift) - 1);
+        uint32_t const midpoint = 1u << (shift - 1);
+        half += rest > midpoint || (rest == midpoint && (half & 1));
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t const rest = mantissa & 0x1FFF;
+    // A carry into the exponent is the correct rounding, up to infinity
+    half += rest > 0x1000 || (rest == 0x1000 && (half & 1));
+    return static_cast<uint16_t>(sign | half);
+}
+
+float fromHalf(uint16_t half)
+{
+    uint32_t const sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 31)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Normalize the subnormal half, every half is a normal float
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//!
+//! \brief The fixed fields of an entry, followed by padding up to kHEADER_SIZE.
+//!
+struct EntryHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    int32_t dims[3];
+    uint64_t key;
+};
+
+} // namespace
+
+char const* toString(InputCacheFormat format)
+{
+    switch (format)
+    {
+    case InputCacheFormat::kUINT8: return "uint8";
+    case InputCacheFormat::kFP16: return "fp16";
+    }
+    return "unknown";
+}
+
+bool parseInputCacheFormat(std::string const& name, InputCacheFormat& format)
+{
+    for (auto const candidate : {InputCacheFormat::kUINT8, InputCacheFormat::kFP16})
+    {
+        if (name == toString(candidate))
+        {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getFileStatus(std::string const& fileName, int64_t& modified, int64_t& size)
+{
+    struct stat status;
+    if (stat(fileName.c_str(), &status) != 0)
+    {
+        return false;
+    }
+    modified = getNanoseconds(status.st_mtim);
+    size = static_cast<int64_t>(status.st_size);
+    return true;
+}
+
+bool InputCache::open(std::string const& directory, InputCacheFormat format, int64_t maxBytes,
+    std::vector<int32_t> const& dims, NormalizeParams const& params, std::string const& settings)
+{
+    if (dims.size() != 3 || dims[0] != 3)
+    {
+        sample::gLogError << "The input cache needs a 3-channel CHW input" << std::endl;
+        return false;
+    }
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        sample::gLogError << "Cannot create " << directory << std::endl;
+        return false;
+    }
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        sample::gLogError << "Cannot open input cache " << directory << std::endl;
+        return false;
+    }
+
+    mDirectory = directory;
+    mFormat = format;
+    mMaxBytes = maxBytes;
+    mDims = dims;
+    mDataSize = static_cast<size_t>(dims[0]) * dims[1] * dims[2] * (format == InputCacheFormat::kFP16 ? 2 : 1);
+    for (int32_t plane = 0; plane < 3; ++plane)
+    {
+        // The same transform as the preprocessing, which writes source channel c into plane c or 2 - c
+        int32_t const c = params.swapChannels ? 2 - plane : plane;
+        mScale[plane] = 1.f / (255.f * params.std[c]);
+        mBias[plane] = -params.mean[c] / params.std[c];
+    }
+    mSettingsHash = hashBytes(kFNV_OFFSET_BASIS, settings.data(), settings.size());
+    mSettingsHash = hashBytes(mSettingsHash, mScale, sizeof(mScale));
+    mSettingsHash = hashBytes(mSettingsHash, mBias, sizeof(mBias));
+
+    // Entries of earlier runs, their modification time is their last use
+    mEntries.clear();
+    mUses.clear();
+    mStatistics = Statistics();
+    size_t const suffixLength = std::strlen(kENTRY_SUFFIX);
+    while (dirent const* entry = readdir(dir))
+    {
+        std::string const name = entry->d_name;
+        if (name.size() != 16 + suffixLength || name.compare(16, suffixLength, kENTRY_SUFFIX) != 0)
+        {
+            continue;
+        }
+        int64_t modified = 0;
+        int64_t size = 0;
+        if (getFileStatus(directory + "/" + name, modified, size))
+        {
+            touch(std::strtoull(name.substr(0, 16).c_str(), nullptr, 16), modified, size);
+        }
+    }
+    closedir(dir);
+
+    sample::gLogInfo << "Input cache " << directory << ": " << mEntries.size() << " entries, "
+                     << mStatistics.bytes / (1 << 20) << " of " << mMaxBytes / (1 << 20) << " MiB, "
+                     << toString(mFormat) << std::endl;
+    return true;
+}
+
+uint64_t InputCache::getKey(std::string const& name, int64_t modified, int64_t size) const
+{
+    uint64_t hash = hashBytes(kFNV_OFFSET_BASIS, name.data(), name.size());
+    hash = hashValue(hash, modified);
+    hash = hashValue(hash, size);
+    hash = hashValue(hash, mSettingsHash);
+    hash = hashValue(hash, static_cast<int32_t>(mFormat));
+    return hashBytes(hash, mDims.data(), mDims.size() * sizeof(int32_t));
+}
+
+std::string InputCache::getPath(uint64_t key) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return mDirectory + "/" + name + kENTRY_SUFFIX;
+}
+
+void InputCache::touch(uint64_t key, int64_t time, int64_t bytes)
+{
+    auto const found = mEntries.find(key);
+    if (found != mEntries.end())
+    {
+        mUses.erase({found->second.first, key});
+        mStatistics.bytes -= found->second.second;
+    }
+    mEntries[key] = {time, bytes};
+    mUses.emplace(time, key);
+    mStatistics.bytes += bytes;
+}
+
+bool InputCache::load(uint64_t key, float* input)
+{
+    std::string const path = getPath(key);
+    int32_t const fd = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+    size_t const entrySize = kHEADER_SIZE + mDataSize;
+    void* mapping = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) == entrySize)
+    {
+        mapping = mmap(nullptr, entrySize, PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    bool valid = mapping != MAP_FAILED;
+    if (valid)
+    {
+        EntryHeader header;
+        std::memcpy(&header, mapping, sizeof(header));
+        valid = header.magic == kINPUT_CACHE_MAGIC && header.version == kINPUT_CACHE_VERSION
+            && header.format == static_cast<uint32_t>(mFormat) && header.key == key
+            && std::equal(mDims.begin(), mDims.end(), header.dims);
+    }
+    if (valid)
+    {
+        size_t const planeSize = static_cast<size_t>(mDims[1]) * mDims[2];
+        uint8_t const* data = static_cast<uint8_t const*>(mapping) + kHEADER_SIZE;
+        for (int32_t plane = 0; plane < 3; ++plane)
+        {
+            float* dst = input + plane * planeSize;
+            if (mFormat == InputCacheFormat::kUINT8)
+            {
+                uint8_t const* src = data + plane * planeSize;
+                for (size_t i = 0; i < planeSize; ++i)
+                {
+                    dst[i] = float(src[i]) * mScale[plane] + mBias[plane];
+                }
+            }
+            else
+            {
+                uint16_t half;
+                for (size_t i = 0; i < planeSize; ++i)
+                {
+                    std::memcpy(&half, data + 2 * (plane * planeSize + i), sizeof(half));
+                    dst[i] = fromHalf(half);
+                }
+            }
+        }
+        // The modification time of an entry is its last use
+        futimens(fd, nullptr);
+    }
+    if (mapping != MAP_FAILED)
+    {
+        munmap(mapping, entrySize);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (valid)
+    {
+        ++mStatistics.hits;
+        touch(key, now(), entrySize);
+    }
+    else
+    {
+        ++mStatistics.misses;
+    }
+    return valid;
+}
+
+bool InputCache::store(uint64_t key, float const* input)
+{
+    int64_t const entrySize = kHEADER_SIZE + mDataSize;
+    if (entrySize > mMaxBytes)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> entry(entrySize, 0);
+    EntryHeader header;
+    header.magic = kINPUT_CACHE_MAGIC;
+    header.version = kINPUT_CACHE_VERSION;
+    header.format = static_cast<uint32_t>(mFormat);
+    std::copy(mDims.begin(), mDims.end(), header.dims);
+    header.key = key;
+    std::memcpy(entry.data(), &header, sizeof(header));
+
+    size_t const planeSize = static_cast<size_t>(mDims[1]) * mDims[2];
+    uint8_t* data = entry.data() + kHEADER_SIZE;
+    for (int32_t plane = 0; plane < 3; ++plane)
+    {
+        float const* src = input + plane * planeSize;
+        if (mFormat == InputCacheFormat::kUINT8)
+        {
+            // Inputs are normalized 8-bit pixels, inverting the normalization finds them back exactly
+            uint8_t* dst = data + plane * planeSize;
+            for (size_t i = 0; i < planeSize; ++i)
+            {
+                float const pixel = std::round((src[i] - mBias[plane]) / mScale[plane]);
+                dst[i] = static_cast<uint8_t>(std::min(std::max(pixel, 0.f), 255.f));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < planeSize; ++i)
+            {
+                uint16_t const half = toHalf(src[i]);
+                std::memcpy(data + 2 * (plane * planeSize + i), &half, sizeof(half));
+            }
+        }
+    }
+
+    // Readers only ever see complete entries
+    std::string const path = getPath(key);
+    std::string temporary = mDirectory + "/.pnicXXXXXX";
+    int32_t const fd = mkstemp(&temporary[0]);
+    bool written = fd >= 0 && write(fd, entry.data(), entry.size()) == entrySize;
+    if (fd >= 0)
+    {
+        written = ::close(fd) == 0 && written;
+    }
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        if (fd >= 0)
+        {
+            std::remove(temporary.c_str());
+        }
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const found = mEntries.find(key);
+    int64_t const replaced = found != mEntries.end() ? found->second.second : 0;
+    while (mStatistics.bytes - replaced + entrySize > mMaxBytes && !mUses.empty())
+    {
+        uint64_t const oldest = mUses.begin()->second;
+        if (oldest == key)
+        {
+            break;
+        }
+        std::remove(getPath(oldest).c_str());
+        mStatistics.bytes -= mEntries[oldest].second;
+        mEntries.erase(oldest);
+        mUses.erase(mUses.begin());
+        ++mStatistics.evictions;
+    }
+    touch(key, now(), entrySize);
+    ++mStatistics.stores;
+    return true;
+}
+
+InputCache::Statistics InputCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
+
+} // namespace pinet
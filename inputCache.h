@@ -0,0 +1,139 @@
+#ifndef PINET_INPUT_CACHE_H
+#define PINET_INPUT_CACHE_H
+
+#include "preprocess.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Element types the network inputs are stored as in the input cache.
+//!
+enum class InputCacheFormat : int32_t
+{
+    kUINT8, //!< The 8-bit pixels the input is normalized from, lossless
+    kFP16,  //!< The normalized input as half floats
+};
+
+//!
+//! \brief Returns the name of format.
+//!
+char const* toString(InputCacheFormat format);
+
+//!
+//! \return false if name is neither uint8 nor fp16
+//!
+bool parseInputCacheFormat(std::string const& name, InputCacheFormat& format);
+
+//!
+//! \brief Reads the modification time in nanoseconds and the size in bytes of a file.
+//!
+bool getFileStatus(std::string const& fileName, int64_t& modified, int64_t& size);
+
+//!
+//! \brief Layout of an entry of the input cache, all fields little endian:
+//!
+//!        uint32 magic ("PNIC"), uint32 version, uint32 format, int32 channels, int32 height, int32 width,
+//!        uint64 key, padding to 64 bytes,
+//!        followed by the CHW input, one uint8 or fp16 value per element.
+//!
+constexpr uint32_t kINPUT_CACHE_MAGIC = 0x43494e50; // "PNIC"
+constexpr uint32_t kINPUT_CACHE_VERSION = 1;
+
+//!
+//! \brief  The InputCache class keeps the preprocessed network inputs of images in a directory, one file each.
+//!
+//! \details An entry is keyed by the hash of the image name, the modification time and size of the file it is
+//!          read from, the input size, the format and a description of the preprocessing, so changing any of
+//!          them misses instead of reading a stale input. Entries are memory mapped and converted straight
+//!          into the input buffer when loaded. They are written to a temporary file and renamed, so processes
+//!          can share a directory.
+//!
+//!          The entries take at most maxBytes on disk. Storing past it removes the least recently used entries,
+//!          the modification time of an entry is its last use, across runs. Entries which no longer match
+//!          their image are never used again and age out that way.
+//!
+//!          load() and store() can be called from several threads.
+//!
+class InputCache
+{
+public:
+    //!
+    //! \brief Enables the cache on directory, creating it if needed, and indexes the entries it holds.
+    //!
+    //! \param dims Channels, height and width of the input of one image.
+    //! \param settings Describes the preprocessing beyond params, e.g. how images are decoded.
+    //!
+    bool open(std::string const& directory, InputCacheFormat format, int64_t maxBytes, std::vector<int32_t> const& dims,
+        NormalizeParams const& params, std::string const& settings);
+
+    bool isOpen() const
+    {
+        return !mDirectory.empty();
+    }
+
+    //!
+    //! \brief Returns the key of the input of image name, read from a file modified at modified with size bytes.
+    //!
+    uint64_t getKey(std::string const& name, int64_t modified, int64_t size) const;
+
+    //!
+    //! \brief Reads the input stored with key into input, which holds channels * height * width floats.
+    //!
+    //! \return false if there is no valid entry for key
+    //!
+    bool load(uint64_t key, float* input);
+
+    //!
+    //! \brief Stores input with key, evicting entries as needed.
+    //!
+    bool store(uint64_t key, float const* input);
+
+    //!
+    //! \brief The Statistics structure counts the cache operations since open().
+    //!
+    struct Statistics
+    {
+        int64_t hits{0};
+        int64_t misses{0};
+        int64_t stores{0};
+        int64_t evictions{0};
+        int64_t bytes{0}; //!< Size of all entries
+    };
+
+    Statistics getStatistics() const;
+
+private:
+    std::string getPath(uint64_t key) const;
+
+    //!
+    //! \brief Records that the entry of key was used at time, under the lock.
+    //!
+    void touch(uint64_t key, int64_t time, int64_t bytes);
+
+    std::string mDirectory;
+    InputCacheFormat mFormat{InputCacheFormat::kUINT8};
+    int64_t mMaxBytes{0};
+    std::vector<int32_t> mDims;
+    uint64_t mSettingsHash{0};
+    float mScale[3];     //!< Normalization of each plane, input = pixel * scale + bias
+    float mBias[3];
+    size_t mDataSize{0}; //!< Size of the input in an entry, after the header
+
+    mutable std::mutex mMutex;
+    std::map<uint64_t, std::pair<int64_t, int64_t>> mEntries; //!< Last use and size of each entry
+    std::set<std::pair<int64_t, uint64_t>> mUses;             //!< Last use and key of each entry, oldest first
+    Statistics mStatistics;
+};
+
+} // namespace pinet
+
+#endif // PINET_INPUT_CACHE_H
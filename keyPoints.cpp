@@ -0,0 +1,139 @@
+#include "keyPoints.h"
+
+#if defined(__SSE2__)
+#define PINET_SSE2_COMPRESS 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define PINET_NEON_COMPRESS 1
+#include <arm_neon.h>
+#endif
+
+namespace pinet
+{
+
+namespace
+{
+
+//!
+//! \brief Lanes set in a 4-bit comparison mask packed to the front, e.g. 0b1010 gives {1, 3, ...}.
+//!
+alignas(16) constexpr int32_t kCOMPRESS_LANES[16][4] = {
+    {0, 0, 0, 0},
+    {0, 0, 0, 0},
+    {1, 0, 0, 0},
+    {0, 1, 0, 0},
+    {2, 0, 0, 0},
+    {0, 2, 0, 0},
+    {1, 2, 0, 0},
+    {0, 1, 2, 0},
+    {3, 0, 0, 0},
+    {0, 3, 0, 0},
+    {1, 3, 0, 0},
+    {0, 1, 3, 0},
+    {2, 3, 0, 0},
+    {0, 2, 3, 0},
+    {1, 2, 3, 0},
+    {0, 1, 2, 3},
+};
+
+//!
+//! \brief Number of lanes set in a 4-bit comparison mask.
+//!
+constexpr int32_t kCOMPRESS_COUNT[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+//!
+//! \brief Writes the indices of the values above threshold to indices and returns their number.
+//!
+//! \details Every step stores four indices but only advances by the number of passing values, so the
+//!          output never runs ahead of the input and indices needs room for size entries only.
+//!
+int32_t compressAboveThreshold(float const* values, int32_t size, float threshold, int32_t* indices)
+{
+    int32_t count = 0;
+    int32_t i = 0;
+#if PINET_SSE2_COMPRESS
+    __m128 const vThreshold = _mm_set1_ps(threshold);
+    for (; i + 4 <= size; i += 4)
+    {
+        int32_t const mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(values + i), vThreshold));
+        __m128i const lanes = _mm_load_si128(reinterpret_cast<__m128i const*>(kCOMPRESS_LANES[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + count), _mm_add_epi32(lanes, _mm_set1_epi32(i)));
+        count += kCOMPRESS_COUNT[mask];
+    }
+#elif PINET_NEON_COMPRESS
+    float32x4_t const vThreshold = vdupq_n_f32(threshold);
+    uint32_t const laneBits[4] = {1, 2, 4, 8};
+    uint32x4_t const vLaneBits = vld1q_u32(laneBits);
+    for (; i + 4 <= size; i += 4)
+    {
+        uint32x4_t const above = vcgtq_f32(vld1q_f32(values + i), vThreshold);
+        uint32_t const mask = vaddvq_u32(vandq_u32(above, vLaneBits));
+        vst1q_s32(indices + count, vaddq_s32(vld1q_s32(kCOMPRESS_LANES[mask]), vdupq_n_s32(i)));
+        count += kCOMPRESS_COUNT[mask];
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        indices[count] = i;
+        count += values[i] > threshold;
+    }
+    return count;
+}
+
+} // namespace
+
+void KeyPoints::reserve(int32_t cellCount)
+{
+    cells.resize(cellCount);
+    confidences.resize(cellCount);
+    xs.resize(cellCount);
+    ys.resize(cellCount);
+    for (auto& feature : features)
+    {
+        feature.resize(cellCount);
+    }
+}
+
+void extractKeyPoints(PlanarView<float const> const& confidence, PlanarView<float const> const& offsets,
+    PlanarView<float const> const& features, float threshold, KeyPoints& keyPoints)
+{
+    int32_t const width = confidence.width();
+    int32_t const height = confidence.height();
+    int32_t const cellCount = width * height;
+    if (static_cast<int32_t>(keyPoints.cells.size()) < cellCount)
+    {
+        keyPoints.reserve(cellCount);
+    }
+
+    int32_t const candidates
+        = compressAboveThreshold(confidence.plane(0), cellCount, threshold, keyPoints.cells.data());
+
+    float const* confidences = confidence.plane(0);
+    float const* offsetX = offsets.plane(0);
+    float const* offsetY = offsets.plane(1);
+    float const* feature[4] = {features.plane(0), features.plane(1), features.plane(2), features.plane(3)};
+
+    // Compacts in place, a candidate whose point leaves the grid is overwritten by the next one
+    int32_t count = 0;
+    for (int32_t k = 0; k < candidates; ++k)
+    {
+        int32_t const cell = keyPoints.cells[k];
+        int32_t const y = cell / width;
+        int32_t const x = cell - y * width;
+        float const pointX = offsetX[cell] + x;
+        float const pointY = offsetY[cell] + y;
+
+        keyPoints.cells[count] = cell;
+        keyPoints.confidences[count] = confidences[cell];
+        keyPoints.xs[count] = pointX;
+        keyPoints.ys[count] = pointY;
+        for (int32_t f = 0; f < 4; ++f)
+        {
+            keyPoints.features[f][count] = feature[f][cell];
+        }
+        count += !(pointX > width || pointX < 0.f) && !(pointY > height || pointY < 0.f);
+    }
+    keyPoints.count = count;
+}
+
+} // namespace pinet
@@ -0,0 +1,51 @@
+#ifndef PINET_KEY_POINTS_H
+#define PINET_KEY_POINTS_H
+
+#include "tensorView.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief The KeyPoints structure holds the key point candidates of one frame as a structure of arrays.
+//!
+//! \details Only the first count entries of the arrays are valid. Candidates keep the row-major order of
+//!          the output grid. The arrays only grow, so a KeyPoints reused across frames stops allocating once
+//!          it has seen a frame with all cells above the threshold, or right away after reserve().
+//!
+struct KeyPoints
+{
+    int32_t count{0};
+    std::vector<int32_t> cells;       //!< y * width + x of the grid cell the candidate was found in
+    std::vector<float> confidences;   //!< Confidence output of the cell
+    std::vector<float> xs;            //!< Cell column plus horizontal offset, in output grid coordinates
+    std::vector<float> ys;            //!< Cell row plus vertical offset, in output grid coordinates
+    std::vector<float> features[4];   //!< Instance feature of the cell, one array per feature dimension
+
+    //!
+    //! \brief Allocates room for cellCount candidates, i.e. the size of the output grid.
+    //!
+    void reserve(int32_t cellCount);
+};
+
+//!
+//! \brief Collects the cells whose confidence is above threshold and whose offset point lies on the grid.
+//!
+//! \details The confidence plane is compared a vector at a time, the indices of the passing cells are
+//!          compressed into a dense list through a table indexed by the comparison mask, and only these
+//!          cells have their offsets and features gathered. A point is on the grid if
+//!          0 <= x <= width and 0 <= y <= height.
+//!
+//! \param confidence 1 x H x W confidence output.
+//! \param offsets 2 x H x W offset output, x offset first.
+//! \param features 4 x H x W instance feature output.
+//!
+void extractKeyPoints(PlanarView<float const> const& confidence, PlanarView<float const> const& offsets,
+    PlanarView<float const> const& features, float threshold, KeyPoints& keyPoints);
+
+} // namespace pinet
+
+#endif // PINET_KEY_POINTS_H
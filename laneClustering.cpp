@@ -0,0 +1,183 @@
+#include "laneClustering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#define PINET_SSE2_CLUSTERING 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PINET_NEON_CLUSTERING 1
+#include <arm_neon.h>
+#endif
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr float kMAX_DISTANCE = 10000.f;   //!< Distance the original search started from, no lane is farther
+constexpr float kCANDIDATE_MARGIN = 1e-5f; //!< Relative margin on the float squared distances of the candidates
+
+} // namespace
+
+LaneClusterer::LaneClusterer(int32_t capacity)
+    : mCapacity(capacity)
+{
+    for (auto& mean : mMeans)
+    {
+        mean.resize(capacity);
+    }
+    mLaneSizes.resize(capacity);
+    mAssignments.resize(capacity);
+    mSquaredDistances.resize(capacity);
+}
+
+void LaneClusterer::cluster(KeyPoints const& keyPoints, float threshold)
+{
+    if (keyPoints.count > mCapacity)
+    {
+        *this = LaneClusterer(keyPoints.count);
+    }
+
+    mLaneCount = 0;
+    for (int32_t k = 0; k < keyPoints.count; ++k)
+    {
+        float const feature[4] = {keyPoints.features[0][k], keyPoints.features[1][k], keyPoints.features[2][k],
+            keyPoints.features[3][k]};
+        float distance = 0.f;
+        int32_t lane = findNearestLane(feature, distance);
+
+        if (lane < 0 || !(distance <= threshold))
+        {
+            lane = mLaneCount++;
+            for (int32_t f = 0; f < 4; ++f)
+            {
+                mMeans[f][lane] = feature[f];
+            }
+            mLaneSizes[lane] = 1;
+        }
+        else
+        {
+            // Rounded step by step like the original cv::Vec4f update, so that later assignments cannot drift
+            float const size = static_cast<float>(mLaneSizes[lane]);
+            float const inverse = 1.f / static_cast<float>(mLaneSizes[lane] + 1);
+            for (int32_t f = 0; f < 4; ++f)
+            {
+                float const sum = mMeans[f][lane] * size + feature[f];
+                mMeans[f][lane] = sum * inverse;
+            }
+            ++mLaneSizes[lane];
+        }
+        mAssignments[k] = lane;
+    }
+}
+
+int32_t LaneClusterer::findNearestLane(float const* feature, float& distance)
+{
+    // Squared distances in float, four lanes at a time, only serve to find the lanes which can be the nearest
+    float* squaredDistances = mSquaredDistances.data();
+    float best = std::numeric_limits<float>::infinity();
+    int32_t lane = 0;
+
+#if PINET_SSE2_CLUSTERING
+    if (mLaneCount >= 4)
+    {
+        __m128 const f0 = _mm_set1_ps(feature[0]);
+        __m128 const f1 = _mm_set1_ps(feature[1]);
+        __m128 const f2 = _mm_set1_ps(feature[2]);
+        __m128 const f3 = _mm_set1_ps(feature[3]);
+        __m128 bests = _mm_set1_ps(best);
+        for (; lane + 4 <= mLaneCount; lane += 4)
+        {
+            __m128 delta = _mm_sub_ps(_mm_loadu_ps(mMeans[0].data() + lane), f0);
+            __m128 distances = _mm_mul_ps(delta, delta);
+            delta = _mm_sub_ps(_mm_loadu_ps(mMeans[1].data() + lane), f1);
+            distances = _mm_add_ps(distances, _mm_mul_ps(delta, delta));
+            delta = _mm_sub_ps(_mm_loadu_ps(mMeans[2].data() + lane), f2);
+            distances = _mm_add_ps(distances, _mm_mul_ps(delta, delta));
+            delta = _mm_sub_ps(_mm_loadu_ps(mMeans[3].data() + lane), f3);
+            distances = _mm_add_ps(distances, _mm_mul_ps(delta, delta));
+            _mm_storeu_ps(squaredDistances + lane, distances);
+            bests = _mm_min_ps(bests, distances);
+        }
+
+        alignas(16) float slotBests[4];
+        _mm_store_ps(slotBests, bests);
+        best = std::min(std::min(slotBests[0], slotBests[1]), std::min(slotBests[2], slotBests[3]));
+    }
+#elif PINET_NEON_CLUSTERING
+    if (mLaneCount >= 4)
+    {
+        float32x4_t const f0 = vdupq_n_f32(feature[0]);
+        float32x4_t const f1 = vdupq_n_f32(feature[1]);
+        float32x4_t const f2 = vdupq_n_f32(feature[2]);
+        float32x4_t const f3 = vdupq_n_f32(feature[3]);
+        float32x4_t bests = vdupq_n_f32(best);
+        for (; lane + 4 <= mLaneCount; lane += 4)
+        {
+            float32x4_t delta = vsubq_f32(vld1q_f32(mMeans[0].data() + lane), f0);
+            float32x4_t distances = vmulq_f32(delta, delta);
+            delta = vsubq_f32(vld1q_f32(mMeans[1].data() + lane), f1);
+            distances = vaddq_f32(distances, vmulq_f32(delta, delta));
+            delta = vsubq_f32(vld1q_f32(mMeans[2].data() + lane), f2);
+            distances = vaddq_f32(distances, vmulq_f32(delta, delta));
+            delta = vsubq_f32(vld1q_f32(mMeans[3].data() + lane), f3);
+            distances = vaddq_f32(distances, vmulq_f32(delta, delta));
+            vst1q_f32(squaredDistances + lane, distances);
+            bests = vminq_f32(bests, distances);
+        }
+
+        float slotBests[4];
+        vst1q_f32(slotBests, bests);
+        best = std::min(std::min(slotBests[0], slotBests[1]), std::min(slotBests[2], slotBests[3]));
+    }
+#endif
+
+    for (; lane < mLaneCount; ++lane)
+    {
+        float squared = 0.f;
+        for (int32_t f = 0; f < 4; ++f)
+        {
+            float const delta = mMeans[f][lane] - feature[f];
+            squared += delta * delta;
+        }
+        squaredDistances[lane] = squared;
+        best = std::min(best, squared);
+    }
+
+    // The float squares are within a few ulps of the exact ones, and the lane the original scan picks is within
+    // one float rounding of the nearest one. Lanes beyond the margin can neither be picked nor change the pick.
+    float const limit = best * (1.f + kCANDIDATE_MARGIN) + std::numeric_limits<float>::min();
+
+    // The candidates are scanned as the original cv::Vec4f code did: squares summed in double, the square root
+    // compared with the float rounded minimum so far, ties going to the later lane
+    float minimum = kMAX_DISTANCE;
+    int32_t nearest = -1;
+    for (lane = 0; lane < mLaneCount; ++lane)
+    {
+        if (!(squaredDistances[lane] <= limit))
+        {
+            continue;
+        }
+        double squared = 0.0;
+        for (int32_t f = 0; f < 4; ++f)
+        {
+            double const delta = mMeans[f][lane] - feature[f];
+            squared += delta * delta;
+        }
+        double const exact = std::sqrt(squared);
+        if (exact <= minimum)
+        {
+            nearest = lane;
+            minimum = static_cast<float>(exact);
+        }
+    }
+
+    distance = minimum;
+    return nearest;
+}
+
+} // namespace pinet
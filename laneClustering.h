@@ -0,0 +1,73 @@
+#ifndef PINET_LANE_CLUSTERING_H
+#define PINET_LANE_CLUSTERING_H
+
+#include "keyPoints.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief  The LaneClusterer class groups key points into lanes by the distance of their instance features.
+//!
+//! \details Key points are visited in order. Each one joins the lane whose mean feature is nearest if that
+//!          distance is at most the threshold, the last such lane on ties, and starts a new lane otherwise.
+//!          The mean feature of the joined lane is then updated with the new point.
+//!
+//!          Mean features are stored as a structure of arrays with one array per feature dimension, so
+//!          squared distances to four lanes at a time are evaluated in float with SSE2 or NEON. Only the few
+//!          lanes whose distance is within rounding of the smallest one are then compared the way the original
+//!          cv::Vec4f code did, in double against the float rounded minimum, so that points near ties or near
+//!          the threshold go to the same lanes as before. The tables are allocated once for capacity lanes,
+//!          which has to be at least the number of key points of a frame, i.e. the size of the output grid.
+//!
+class LaneClusterer
+{
+public:
+    explicit LaneClusterer(int32_t capacity = 0);
+
+    //!
+    //! \brief Assigns every key point to a lane.
+    //!
+    void cluster(KeyPoints const& keyPoints, float threshold);
+
+    int32_t getLaneCount() const
+    {
+        return mLaneCount;
+    }
+
+    //!
+    //! \brief Returns the lane of each key point, only the first keyPoints.count entries are valid.
+    //!
+    int32_t const* getAssignments() const
+    {
+        return mAssignments.data();
+    }
+
+    //!
+    //! \brief Returns the number of key points of each lane, only the first getLaneCount() entries are valid.
+    //!
+    int32_t const* getLaneSizes() const
+    {
+        return mLaneSizes.data();
+    }
+
+private:
+    //!
+    //! \brief Returns the nearest lane to feature and stores its distance, -1 if there is none.
+    //!
+    int32_t findNearestLane(float const* feature, float& distance);
+
+    int32_t mCapacity;
+    int32_t mLaneCount{0};
+    std::vector<float> mMeans[4];           //!< Mean feature of each lane, one array per feature dimension
+    std::vector<int32_t> mLaneSizes;        //!< Number of key points of each lane
+    std::vector<int32_t> mAssignments;      //!< Lane of each key point
+    std::vector<float> mSquaredDistances;   //!< Squared distance in float of the current feature to each lane
+};
+
+} // namespace pinet
+
+#endif // PINET_LANE_CLUSTERING_H
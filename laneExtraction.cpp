@@ -0,0 +1,71 @@
+#include "laneExtraction.h"
+
+#include <utility>
+
+namespace pinet
+{
+
+void resizeLaneLines(LaneLines& laneLines, LaneLines& spare, size_t count)
+{
+    while (laneLines.size() > count)
+    {
+        spare.push_back(std::move(laneLines.back()));
+        laneLines.pop_back();
+    }
+    while (laneLines.size() < count && !spare.empty())
+    {
+        laneLines.push_back(std::move(spare.back()));
+        spare.pop_back();
+    }
+    laneLines.resize(count);
+    for (auto& laneLine : laneLines)
+    {
+        laneLine.clear();
+    }
+}
+
+LaneExtractor::LaneExtractor(int32_t cellCount)
+    : mClusterer(cellCount)
+    , mLaneIndices(cellCount)
+{
+    mKeyPoints.reserve(cellCount);
+}
+
+void LaneExtractor::extract(PlanarView<float const> const& confidence, PlanarView<float const> const& offsets,
+    PlanarView<float const> const& features, float pointThreshold, float instanceThreshold, LaneLines& laneLines,
+    LaneLines& spare)
+{
+    extractKeyPoints(confidence, offsets, features, pointThreshold, mKeyPoints);
+    mClusterer.cluster(mKeyPoints, instanceThreshold);
+    if (mClusterer.getLaneCount() > static_cast<int32_t>(mLaneIndices.size()))
+    {
+        mLaneIndices.resize(mClusterer.getLaneCount());
+    }
+
+    int32_t const* laneSizes = mClusterer.getLaneSizes();
+    int32_t laneCount = 0;
+    for (int32_t lane = 0; lane < mClusterer.getLaneCount(); ++lane)
+    {
+        mLaneIndices[lane] = laneSizes[lane] < 2 ? -1 : laneCount++;
+    }
+    resizeLaneLines(laneLines, spare, laneCount);
+    for (int32_t lane = 0; lane < mClusterer.getLaneCount(); ++lane)
+    {
+        if (mLaneIndices[lane] >= 0)
+        {
+            laneLines[mLaneIndices[lane]].reserve(laneSizes[lane]);
+        }
+    }
+
+    int32_t const* assignments = mClusterer.getAssignments();
+    for (int32_t k = 0; k < mKeyPoints.count; ++k)
+    {
+        int32_t const lane = mLaneIndices[assignments[k]];
+        if (lane >= 0)
+        {
+            laneLines[lane].emplace_back(mKeyPoints.xs[k], mKeyPoints.ys[k]);
+        }
+    }
+}
+
+} // namespace pinet
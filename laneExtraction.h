@@ -0,0 +1,62 @@
+#ifndef PINET_LANE_EXTRACTION_H
+#define PINET_LANE_EXTRACTION_H
+
+#include "frame.h"
+#include "keyPoints.h"
+#include "laneClustering.h"
+#include "tensorView.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace pinet
+{
+
+constexpr float kPOINT_THRESHOLD = 0.81f;    //!< Confidence above which a cell holds a key point
+constexpr float kINSTANCE_THRESHOLD = 0.22f; //!< Feature distance below which key points are of the same lane
+
+//!
+//! \brief Resizes laneLines to count empty lane lines, keeping the capacity of their vectors.
+//!
+//! \details The vectors of dropped lane lines are moved to spare, last first, and growing takes them back from
+//!          spare before creating new ones, so every lane line gets back the vector it had and the capacity its
+//!          largest lanes needed.
+//!
+void resizeLaneLines(LaneLines& laneLines, LaneLines& spare, size_t count);
+
+//!
+//! \brief  The LaneExtractor class turns the confidence, offset and instance outputs of an image into lane lines.
+//!
+//! \details Key points above the confidence threshold are clustered by instance feature. Lanes of a single point
+//!          are dropped, the others keep their order and the order of their points. The buffers are allocated
+//!          once for the output grid and the lane lines are written into the vectors of earlier ones, so that
+//!          once they held as many lanes of as many points, extracting allocates nothing.
+//!
+class LaneExtractor
+{
+public:
+    //!
+    //! \param cellCount Size of the output grid.
+    //!
+    explicit LaneExtractor(int32_t cellCount = 0);
+
+    //!
+    //! \brief Stores the lane lines of an image in laneLines, spare holding vectors of earlier lane lines.
+    //!
+    //! \param confidence 1 x H x W confidence output.
+    //! \param offsets 2 x H x W offset output, x offset first.
+    //! \param features 4 x H x W instance feature output.
+    //!
+    void extract(PlanarView<float const> const& confidence, PlanarView<float const> const& offsets,
+        PlanarView<float const> const& features, float pointThreshold, float instanceThreshold, LaneLines& laneLines,
+        LaneLines& spare);
+
+private:
+    KeyPoints mKeyPoints;              //!< Key point candidates of the current image
+    LaneClusterer mClusterer;          //!< Lane of each key point
+    std::vector<int32_t> mLaneIndices; //!< Index in the lane lines of each cluster, -1 if dropped
+};
+
+} // namespace pinet
+
+#endif // PINET_LANE_EXTRACTION_H
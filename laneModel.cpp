@@ -0,0 +1,277 @@
+#include "laneModel.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr int32_t kMAX_TERMS = kLANE_MODEL_MAX_DEGREE + 1;
+
+//!
+//! \brief Solves the terms x terms system a x = b in place by Gaussian elimination with partial pivoting.
+//!
+//! \return false if a pivot is negligible against the largest entry of a, i.e. the system is singular
+//!
+bool solve(double (&a)[kMAX_TERMS][kMAX_TERMS], double (&b)[kMAX_TERMS], int32_t terms)
+{
+    double scale = 0.0;
+    for (int32_t i = 0; i < terms; ++i)
+    {
+        for (int32_t j = 0; j < terms; ++j)
+        {
+            scale = std::max(scale, std::abs(a[i][j]));
+        }
+    }
+
+    for (int32_t column = 0; column < terms; ++column)
+    {
+        int32_t pivot = column;
+        for (int32_t row = column + 1; row < terms; ++row)
+        {
+            if (std::abs(a[row][column]) > std::abs(a[pivot][column]))
+            {
+                pivot = row;
+            }
+        }
+        if (!(std::abs(a[pivot][column]) > 1e-10 * scale))
+        {
+            return false;
+        }
+        std::swap(a[column], a[pivot]);
+        std::swap(b[column], b[pivot]);
+        for (int32_t row = column + 1; row < terms; ++row)
+        {
+            double const factor = a[row][column] / a[column][column];
+            for (int32_t j = column; j < terms; ++j)
+            {
+                a[row][j] -= factor * a[column][j];
+            }
+            b[row] -= factor * b[column];
+        }
+    }
+
+    for (int32_t row = terms - 1; row >= 0; --row)
+    {
+        double sum = b[row];
+        for (int32_t j = row + 1; j < terms; ++j)
+        {
+            sum -= a[row][j] * b[j];
+        }
+        b[row] = sum / a[row][row];
+    }
+    return true;
+}
+
+template <typename T>
+uint8_t* put(uint8_t* buffer, T const& value)
+{
+    std::memcpy(buffer, &value, sizeof(T));
+    return buffer + sizeof(T);
+}
+
+template <typename T>
+uint8_t const* get(uint8_t const* data, T& value)
+{
+    std::memcpy(&value, data, sizeof(T));
+    return data + sizeof(T);
+}
+
+} // namespace
+
+bool fitLaneModel(cv::Point2f const* points, int32_t count, int32_t degree, LaneModel& model)
+{
+    if (count <= 0)
+    {
+        return false;
+    }
+
+    float yMin = points[0].y;
+    float yMax = points[0].y;
+    for (int32_t p = 1; p < count; ++p)
+    {
+        yMin = std::min(yMin, points[p].y);
+        yMax = std::max(yMax, points[p].y);
+    }
+    double const inverseSpan = yMax > yMin ? 1.0 / (static_cast<double>(yMax) - yMin) : 0.0;
+
+    // Sums of t^k up to twice the degree and of x t^k up to the degree
+    degree = std::max(0, std::min({degree, kLANE_MODEL_MAX_DEGREE, count - 1}));
+    double powerSums[2 * kLANE_MODEL_MAX_DEGREE + 1]{};
+    double momentSums[kMAX_TERMS]{};
+    for (int32_t p = 0; p < count; ++p)
+    {
+        double const t = (points[p].y - yMin) * inverseSpan;
+        double power = 1.0;
+        for (int32_t k = 0; k <= 2 * degree; ++k)
+        {
+            powerSums[k] += power;
+            if (k <= degree)
+            {
+                momentSums[k] += points[p].x * power;
+            }
+            power *= t;
+        }
+    }
+
+    // Points on too few rows leave the higher terms undetermined, the degree goes down until they are not
+    double solution[kMAX_TERMS]{};
+    for (;; --degree)
+    {
+        double normal[kMAX_TERMS][kMAX_TERMS];
+        for (int32_t i = 0; i <= degree; ++i)
+        {
+            for (int32_t j = 0; j <= degree; ++j)
+            {
+                normal[i][j] = powerSums[i + j];
+            }
+            solution[i] = momentSums[i];
+        }
+        if (solve(normal, solution, degree + 1) || degree == 0)
+        {
+            break;
+        }
+    }
+
+    model = LaneModel();
+    model.degree = degree;
+    model.yMin = yMin;
+    model.yMax = yMax;
+    model.support = count;
+    for (int32_t k = 0; k <= degree; ++k)
+    {
+        model.coefficients[k] = static_cast<float>(solution[k]);
+    }
+    double squares = 0.0;
+    for (int32_t p = 0; p < count; ++p)
+    {
+        double const distance = points[p].x - evaluateLaneModel(model, points[p].y);
+        squares += distance * distance;
+    }
+    model.residual = static_cast<float>(std::sqrt(squares / count));
+    return true;
+}
+
+float evaluateLaneModel(LaneModel const& model, float y)
+{
+    float const t = model.yMax > model.yMin ? (y - model.yMin) / (model.yMax - model.yMin) : 0.f;
+    float x = 0.f;
+    for (int32_t k = model.degree; k >= 0; --k)
+    {
+        x = x * t + model.coefficients[k];
+    }
+    return x;
+}
+
+size_t getSerializedSize(LaneModel const* models, int32_t count)
+{
+    size_t size = 1;
+    for (int32_t m = 0; m < std::min(count, kLANE_MODEL_MAX_COUNT); ++m)
+    {
+        size += 15 + 4 * (models[m].degree + 1);
+    }
+    return size;
+}
+
+size_t serializeLaneModels(LaneModel const* models, int32_t count, uint8_t* buffer)
+{
+    count = std::min(count, kLANE_MODEL_MAX_COUNT);
+    uint8_t* position = put(buffer, static_cast<uint8_t>(count));
+    for (int32_t m = 0; m < count; ++m)
+    {
+        LaneModel const& model = models[m];
+        position = put(position, static_cast<uint8_t>(model.degree));
+        position = put(position, static_cast<uint16_t>(std::min(model.support, static_cast<int32_t>(UINT16_MAX))));
+        position = put(position, model.yMin);
+        position = put(position, model.yMax);
+        position = put(position, model.residual);
+        for (int32_t k = 0; k <= model.degree; ++k)
+        {
+            position = put(position, model.coefficients[k]);
+        }
+    }
+    return position - buffer;
+}
+
+size_t deserializeLaneModels(uint8_t const* data, size_t size, LaneModel* models, int32_t& count)
+{
+    count = 0;
+    if (size < 1)
+    {
+        return 0;
+    }
+    uint8_t laneCount = 0;
+    uint8_t const* position = get(data, laneCount);
+    for (int32_t m = 0; m < laneCount; ++m)
+    {
+        size_t const offset = position - data;
+        if (offset + 15 > size)
+        {
+            return 0;
+        }
+        uint8_t degree = 0;
+        position = get(position, degree);
+        if (degree > kLANE_MODEL_MAX_DEGREE || offset + 15 + 4 * (degree + 1) > size)
+        {
+            return 0;
+        }
+        LaneModel& model = models[m];
+        model = LaneModel();
+        model.degree = degree;
+        uint16_t support = 0;
+        position = get(position, support);
+        model.support = support;
+        position = get(position, model.yMin);
+        position = get(position, model.yMax);
+        position = get(position, model.residual);
+        for (int32_t k = 0; k <= degree; ++k)
+        {
+            position = get(position, model.coefficients[k]);
+        }
+    }
+    count = laneCount;
+    return position - data;
+}
+
+bool LaneModelWriter::open(std::string const& fileName, int32_t gridWidth, int32_t gridHeight)
+{
+    mFile.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!mFile)
+    {
+        sample::gLogError << "Cannot create lane model file " << fileName << std::endl;
+        return false;
+    }
+    uint8_t header[16];
+    uint8_t* position = put(header, kLANE_MODEL_MAGIC);
+    position = put(position, kLANE_MODEL_VERSION);
+    position = put(position, gridWidth);
+    put(position, gridHeight);
+    mFile.write(reinterpret_cast<char const*>(header), sizeof(header));
+    return static_cast<bool>(mFile);
+}
+
+bool LaneModelWriter::write(int64_t frameIndex, std::vector<LaneModel> const& models)
+{
+    int32_t const count = static_cast<int32_t>(models.size());
+    size_t const size = sizeof(frameIndex) + getSerializedSize(models.data(), count);
+    if (mBuffer.size() < size)
+    {
+        mBuffer.resize(size);
+    }
+    put(mBuffer.data(), frameIndex);
+    serializeLaneModels(models.data(), count, mBuffer.data() + sizeof(frameIndex));
+    mFile.write(reinterpret_cast<char const*>(mBuffer.data()), size);
+    mModelBytes += size - sizeof(frameIndex);
+    for (auto const& model : models)
+    {
+        mPointBytes += model.support * sizeof(cv::Point2f);
+    }
+    return static_cast<bool>(mFile);
+}
+
+} // namespace pinet
@@ -0,0 +1,124 @@
+#ifndef PINET_LANE_MODEL_H
+#define PINET_LANE_MODEL_H
+
+#include <opencv2/core/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+constexpr int32_t kLANE_MODEL_MAX_DEGREE = 3;
+
+//!
+//! \brief The LaneModel structure is a lane line fitted with a polynomial of x in y, in output grid coordinates.
+//!
+//! \details x(y) = sum of coefficients[k] * t^k for k <= degree, with t = (y - yMin) / (yMax - yMin) in [0, 1]
+//!          over the rows the lane spans, or t = 0 if it spans a single row. Normalizing y keeps the fit well
+//!          conditioned whatever the degree.
+//!
+struct LaneModel
+{
+    int32_t degree{0};
+    float coefficients[kLANE_MODEL_MAX_DEGREE + 1]{};
+    float yMin{0.f};
+    float yMax{0.f};
+    float residual{0.f}; //!< Root mean square of the horizontal distances of the points to the curve
+    int32_t support{0};  //!< Number of points fitted
+};
+
+//!
+//! \brief Fits the points of a lane line with a polynomial of at most degree by least squares.
+//!
+//! \details The normal equations are accumulated and solved in double precision in fixed-size arrays, nothing
+//!          is allocated. The degree is lowered to what the points determine, i.e. below the number of points
+//!          and until the system is not singular.
+//!
+//! \return false if there is no point
+//!
+bool fitLaneModel(cv::Point2f const* points, int32_t count, int32_t degree, LaneModel& model);
+
+//!
+//! \brief Returns x of the model at y.
+//!
+float evaluateLaneModel(LaneModel const& model, float y);
+
+//!
+//! \brief Layout of a serialized frame of lane models, all fields little endian and packed:
+//!
+//!        uint8 number of lanes, then per lane: uint8 degree, uint16 support, float32 yMin, float32 yMax,
+//!        float32 residual, float32 coefficients[degree + 1].
+//!
+//!        A lane takes 15 bytes plus 4 per coefficient, e.g. 27 for a parabola, where its points take 8 each.
+//!
+constexpr size_t kLANE_MODEL_MAX_SIZE = 15 + 4 * (kLANE_MODEL_MAX_DEGREE + 1);
+constexpr int32_t kLANE_MODEL_MAX_COUNT = 255;
+
+//!
+//! \brief Returns the size of the serialized models, at most kLANE_MODEL_MAX_COUNT of them are serialized.
+//!
+size_t getSerializedSize(LaneModel const* models, int32_t count);
+
+//!
+//! \brief Serializes models into buffer, which has room for getSerializedSize() bytes.
+//!
+//! \return the number of bytes written
+//!
+size_t serializeLaneModels(LaneModel const* models, int32_t count, uint8_t* buffer);
+
+//!
+//! \brief Reads serialized models into models, which has room for kLANE_MODEL_MAX_COUNT models.
+//!
+//! \return the number of bytes read, 0 if data does not hold a valid frame of models
+//!
+size_t deserializeLaneModels(uint8_t const* data, size_t size, LaneModel* models, int32_t& count);
+
+//!
+//! \brief Layout of a file of lane models, all fields little endian:
+//!
+//!        uint32 magic ("PNLM"), uint32 version, int32 grid width, int32 grid height,
+//!        followed by frames, each holding an int64 frame index and the serialized frame of lane models.
+//!
+constexpr uint32_t kLANE_MODEL_MAGIC = 0x4d4c4e50; // "PNLM"
+constexpr uint32_t kLANE_MODEL_VERSION = 1;
+
+//!
+//! \brief  The LaneModelWriter class appends the lane models of frames to a file.
+//!
+class LaneModelWriter
+{
+public:
+    bool open(std::string const& fileName, int32_t gridWidth, int32_t gridHeight);
+
+    bool write(int64_t frameIndex, std::vector<LaneModel> const& models);
+
+    //!
+    //! \brief Returns the number of bytes of lane models written, headers excluded.
+    //!
+    int64_t getModelBytes() const
+    {
+        return mModelBytes;
+    }
+
+    //!
+    //! \brief Returns the number of bytes the points the written models were fitted to take as cv::Point2f.
+    //!
+    int64_t getPointBytes() const
+    {
+        return mPointBytes;
+    }
+
+private:
+    std::ofstream mFile;
+    std::vector<uint8_t> mBuffer; //!< Serialized frame, sized for the largest frame
+    int64_t mModelBytes{0};
+    int64_t mPointBytes{0};
+};
+
+} // namespace pinet
+
+#endif // PINET_LANE_MODEL_H
@@ -0,0 +1,277 @@
+#include "laneTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+namespace pinet
+{
+
+namespace
+{
+
+constexpr float kMAX_MATCH_DISTANCE = 2.f; //!< Mean distance in cells up to which lanes of two frames match
+constexpr int32_t kMIN_SHARED_ROWS = 3;    //!< Rows two lanes need in common to be compared
+constexpr float kSEARCH_CELLS = 1.5f;      //!< Distance in cells a marking is looked for on either side of a lane
+constexpr int32_t kMIN_CONTRAST = 30;      //!< Brightness a marking has above the mean of its search window
+constexpr int32_t kMIN_SUPPORTED_ROWS = 3; //!< Rows with a marking needed to shift a lane
+constexpr float kMAX_SHIFT = 1.f;          //!< Shift in cells the markings apply to a lane per frame
+
+float const kNONE = std::numeric_limits<float>::quiet_NaN();
+
+//!
+//! \brief Returns the mean of b - a over the rows both lanes reach, and their number.
+//!
+float meanDifference(std::vector<float> const& a, std::vector<float> const& b, int32_t& sharedRows)
+{
+    float sum = 0.f;
+    sharedRows = 0;
+    for (size_t r = 0; r < a.size(); ++r)
+    {
+        if (!std::isnan(a[r]) && !std::isnan(b[r]))
+        {
+            sum += b[r] - a[r];
+            ++sharedRows;
+        }
+    }
+    return sharedRows ? sum / sharedRows : 0.f;
+}
+
+float meanDistance(std::vector<float> const& a, std::vector<float> const& b, int32_t& sharedRows)
+{
+    float sum = 0.f;
+    sharedRows = 0;
+    for (size_t r = 0; r < a.size(); ++r)
+    {
+        if (!std::isnan(a[r]) && !std::isnan(b[r]))
+        {
+            sum += std::abs(b[r] - a[r]);
+            ++sharedRows;
+        }
+    }
+    return sharedRows ? sum / sharedRows : std::numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+void resampleLaneLine(LaneLine const& laneLine, int32_t height, std::vector<float>& xs)
+{
+    std::vector<float> sums(height);
+    std::vector<int32_t> counts(height);
+    for (auto const& point : laneLine)
+    {
+        int32_t const row = std::max(0, std::min(static_cast<int32_t>(point.y), height - 1));
+        sums[row] += point.x;
+        ++counts[row];
+    }
+
+    xs.assign(height, kNONE);
+    int32_t previous = -1;
+    for (int32_t r = 0; r < height; ++r)
+    {
+        if (!counts[r])
+        {
+            continue;
+        }
+        xs[r] = sums[r] / counts[r];
+        // Rows between two rows with points are interpolated
+        for (int32_t g = previous + 1; previous >= 0 && g < r; ++g)
+        {
+            float const t = static_cast<float>(g - previous) / (r - previous);
+            xs[g] = xs[previous] + t * (xs[r] - xs[previous]);
+        }
+        previous = r;
+    }
+}
+
+LaneTracker::LaneTracker(int32_t width, int32_t height)
+    : mWidth(width)
+    , mHeight(height)
+{
+}
+
+void LaneTracker::reset()
+{
+    mLanes.clear();
+    mFramesSinceUpdate = 0;
+    mReferenceImage = false;
+}
+
+void LaneTracker::update(LaneLines const& laneLines, cv::Mat const& image)
+{
+    std::vector<Lane> lanes(laneLines.size());
+    for (size_t l = 0; l < lanes.size(); ++l)
+    {
+        resampleLaneLine(laneLines[l], mHeight, lanes[l].xs);
+        lanes[l].keyXs = lanes[l].xs;
+        lanes[l].velocities.assign(mHeight, 0.f);
+    }
+
+    // Nearest pairs first, each lane is matched once
+    std::vector<std::tuple<float, size_t, size_t>> pairs;
+    for (size_t n = 0; n < lanes.size(); ++n)
+    {
+        for (size_t o = 0; o < mLanes.size(); ++o)
+        {
+            int32_t sharedRows = 0;
+            float const distance = meanDistance(mLanes[o].xs, lanes[n].xs, sharedRows);
+            if (sharedRows >= kMIN_SHARED_ROWS && distance <= kMAX_MATCH_DISTANCE)
+            {
+                pairs.emplace_back(distance, n, o);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<bool> matchedNew(lanes.size());
+    std::vector<bool> matchedOld(mLanes.size());
+    int32_t const frames = mFramesSinceUpdate + 1;
+    for (auto const& pair : pairs)
+    {
+        size_t const n = std::get<1>(pair);
+        size_t const o = std::get<2>(pair);
+        if (matchedNew[n] || matchedOld[o])
+        {
+            continue;
+        }
+        matchedNew[n] = true;
+        matchedOld[o] = true;
+        // Rows the previous reference does not reach move like the lane on average
+        Lane const& previous = mLanes[o];
+        int32_t sharedRows = 0;
+        float const meanMotion = meanDifference(previous.keyXs, lanes[n].keyXs, sharedRows) / frames;
+        for (int32_t r = 0; r < mHeight; ++r)
+        {
+            bool const shared = !std::isnan(previous.keyXs[r]) && !std::isnan(lanes[n].keyXs[r]);
+            float const motion = shared ? (lanes[n].keyXs[r] - previous.keyXs[r]) / frames : meanMotion;
+            lanes[n].velocities[r] = 0.5f * (motion + previous.velocities[r]);
+        }
+    }
+
+    for (auto& lane : lanes)
+    {
+        lane.bias = image.empty() ? 0.f : findMarkings(image, lane.xs, lane.supportedRows);
+    }
+    mLanes = std::move(lanes);
+    mFramesSinceUpdate = 0;
+    mReferenceImage = !image.empty();
+}
+
+float LaneTracker::propagate(cv::Mat const& image, LaneLines& laneLines)
+{
+    ++mFramesSinceUpdate;
+    laneLines.clear();
+    int32_t supportedRows = 0;
+    int32_t referenceRows = 0;
+    // Markings are found relative to those of the reference, without them the lanes only move
+    bool const refine = !image.empty() && mReferenceImage;
+    for (auto& lane : mLanes)
+    {
+        for (int32_t r = 0; r < mHeight; ++r)
+        {
+            lane.xs[r] += lane.velocities[r];
+        }
+
+        if (refine)
+        {
+            int32_t rows = 0;
+            float const offset = findMarkings(image, lane.xs, rows);
+            if (rows >= kMIN_SUPPORTED_ROWS)
+            {
+                float const shift = std::max(-kMAX_SHIFT, std::min(offset - lane.bias, kMAX_SHIFT));
+                for (auto& x : lane.xs)
+                {
+                    x += shift;
+                }
+            }
+            supportedRows += std::min(rows, lane.supportedRows);
+            referenceRows += lane.supportedRows;
+        }
+
+        // Rows which left the grid are dropped
+        LaneLine laneLine;
+        for (int32_t r = 0; r < mHeight; ++r)
+        {
+            float& x = lane.xs[r];
+            if (x < 0.f || x > mWidth)
+            {
+                x = kNONE;
+            }
+            if (!std::isnan(x))
+            {
+                laneLine.emplace_back(x, r + 0.5f);
+            }
+        }
+        if (laneLine.size() >= 2)
+        {
+            laneLines.push_back(std::move(laneLine));
+        }
+    }
+
+    if (laneLines.empty() || (!image.empty() && !mReferenceImage))
+    {
+        return 0.f;
+    }
+    return referenceRows ? static_cast<float>(supportedRows) / referenceRows : 1.f;
+}
+
+float LaneTracker::findMarkings(cv::Mat const& image, std::vector<float> const& xs, int32_t& supportedRows)
+{
+    supportedRows = 0;
+    if (image.channels() != 3)
+    {
+        return 0.f;
+    }
+
+    std::vector<float>& offsets = mOffsets;
+    offsets.clear();
+    float const scaleX = static_cast<float>(image.cols) / mWidth;
+    float const scaleY = static_cast<float>(image.rows) / mHeight;
+    int32_t const radius = std::max(2, static_cast<int32_t>(kSEARCH_CELLS * scaleX));
+    for (int32_t r = 0; r < mHeight; ++r)
+    {
+        if (std::isnan(xs[r]))
+        {
+            continue;
+        }
+        int32_t const y = std::min(static_cast<int32_t>((r + 0.5f) * scaleY), image.rows - 1);
+        int32_t const center = static_cast<int32_t>(xs[r] * scaleX);
+        int32_t const begin = std::max(0, center - radius);
+        int32_t const end = std::min(image.cols, center + radius + 1);
+        if (end - begin < 3)
+        {
+            continue;
+        }
+
+        // Green plus red, so that white and yellow markings both stand out of the road
+        uchar const* pixels = image.ptr<uchar>(y);
+        int32_t sum = 0;
+        int32_t brightest = -1;
+        int32_t brightestX = center;
+        for (int32_t x = begin; x < end; ++x)
+        {
+            int32_t const brightness = pixels[3 * x + 1] + pixels[3 * x + 2];
+            sum += brightness;
+            if (brightness > brightest)
+            {
+                brightest = brightness;
+                brightestX = x;
+            }
+        }
+        if (brightest * (end - begin) - sum >= 2 * kMIN_CONTRAST * (end - begin))
+        {
+            offsets.push_back((brightestX - center) / scaleX);
+        }
+    }
+
+    supportedRows = static_cast<int32_t>(offsets.size());
+    if (offsets.empty())
+    {
+        return 0.f;
+    }
+    auto const middle = offsets.begin() + offsets.size() / 2;
+    std::nth_element(offsets.begin(), middle, offsets.end());
+    return *middle;
+}
+
+} // namespace pinet
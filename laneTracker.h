@@ -0,0 +1,101 @@
+#ifndef PINET_LANE_TRACKER_H
+#define PINET_LANE_TRACKER_H
+
+#include "frame.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Resamples a lane line to one x per row of a grid of height rows, the mean x of its points in each row,
+//!        interpolated between rows, NaN above and below the lane.
+//!
+void resampleLaneLine(LaneLine const& laneLine, int32_t height, std::vector<float>& xs);
+
+//!
+//! \brief  The LaneTracker class carries the lane lines of an inferred frame over the following frames of a clip.
+//!
+//! \details Lanes are kept as one x per row of the output grid. On an inferred frame, the new lanes are matched
+//!          with the tracked ones by their mean horizontal distance, and the lateral motion per frame of each
+//!          matched lane is estimated row by row from how far it moved since the previous inferred frame, so
+//!          that near rows can move faster than far ones.
+//!
+//!          Each frame in between moves every lane by its motion, then refines it on the image: along each row
+//!          the brightest marking near the lane is looked for, and the lane is shifted by the median offset of
+//!          the rows where one stands out, less the offset found on the inferred frame. The share of rows with
+//!          a marking, relative to the inferred frame, is the confidence of the frame. Without an image lanes
+//!          are only moved and the confidence is 1.
+//!
+//!          Frames have to be passed in order, one clip after the other.
+//!
+class LaneTracker
+{
+public:
+    //!
+    //! \param width Width of the output grid the lane lines are given in.
+    //! \param height Height of the output grid.
+    //!
+    explicit LaneTracker(int32_t width = 64, int32_t height = 32);
+
+    //!
+    //! \brief Forgets every lane, e.g. at the start of a clip.
+    //!
+    void reset();
+
+    //!
+    //! \brief Takes the lane lines of an inferred frame as the new reference.
+    //!
+    //! \param image The image of the frame, or empty.
+    //!
+    void update(LaneLines const& laneLines, cv::Mat const& image);
+
+    //!
+    //! \brief Moves the lanes to the next frame and refines them on its image.
+    //!
+    //! \param image The image of the frame, or empty.
+    //! \param laneLines The tracked lanes, one point per row.
+    //!
+    //! \return the confidence of the frame, between 0 and 1, 0 if no lane is tracked or if the frame has an image
+    //!         but the last inferred frame had none, as its markings cannot be compared then
+    //!
+    float propagate(cv::Mat const& image, LaneLines& laneLines);
+
+    int32_t getLaneCount() const
+    {
+        return static_cast<int32_t>(mLanes.size());
+    }
+
+private:
+    //!
+    //! \brief The Lane structure is one tracked lane.
+    //!
+    struct Lane
+    {
+        std::vector<float> xs;         //!< x at each row, NaN where the lane does not reach
+        std::vector<float> keyXs;      //!< xs on the last inferred frame
+        std::vector<float> velocities; //!< Lateral motion per frame at each row
+        float bias{0.f};               //!< Median offset of the markings on the last inferred frame
+        int32_t supportedRows{0};      //!< Rows with a marking on the last inferred frame
+    };
+
+    //!
+    //! \brief Looks for markings along xs and returns their median offset in grid cells and number of rows.
+    //!
+    float findMarkings(cv::Mat const& image, std::vector<float> const& xs, int32_t& supportedRows);
+
+    int32_t mWidth;
+    int32_t mHeight;
+    int32_t mFramesSinceUpdate{0};
+    bool mReferenceImage{false}; //!< Whether the last inferred frame had an image, the biases are only known then
+    std::vector<Lane> mLanes;
+    std::vector<float> mOffsets; //!< Scratch of findMarkings()
+};
+
+} // namespace pinet
+
+#endif // PINET_LANE_TRACKER_H
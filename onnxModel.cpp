@@ -0,0 +1,487 @@
+#include "onnxModel.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+namespace pinet
+{
+
+namespace
+{
+
+bool readVarint(std::string const& data, size_t& offset, uint64_t& value)
+{
+    value = 0;
+    for (int32_t shift = 0; shift < 64 && offset < data.size(); shift += 7)
+    {
+        uint8_t const byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeVarint(std::string& data, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<char>(value));
+}
+
+void writeFixed(std::string& data, uint64_t value, int32_t bytes)
+{
+    for (int32_t b = 0; b < bytes; ++b)
+    {
+        data.push_back(static_cast<char>(value >> (8 * b)));
+    }
+}
+
+//!
+//! \brief Parses the graph of model.
+//!
+bool getGraph(ProtoMessage const& model, ProtoMessage& graph)
+{
+    if (!graph.parse(model.getString(onnx::kMODEL_GRAPH)))
+    {
+        sample::gLogError << "The model has no valid graph" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Replaces the graph of model.
+//!
+void setGraph(ProtoMessage& model, ProtoMessage const& graph)
+{
+    for (auto& field : model.getFields())
+    {
+        if (field.number == onnx::kMODEL_GRAPH)
+        {
+            field.bytes = graph.serialize();
+            return;
+        }
+    }
+    model.addBytes(onnx::kMODEL_GRAPH, graph.serialize());
+}
+
+//!
+//! \brief Returns the value of the name field numbered nameNumber of a serialized message.
+//!
+std::string getName(std::string const& message, int32_t nameNumber)
+{
+    ProtoMessage parsed;
+    return parsed.parse(message) ? parsed.getString(nameNumber) : std::string();
+}
+
+} // namespace
+
+bool ProtoMessage::parse(std::string const& data)
+{
+    mFields.clear();
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        uint64_t tag = 0;
+        if (!readVarint(data, offset, tag))
+        {
+            return false;
+        }
+        Field field;
+        field.number = static_cast<int32_t>(tag >> 3);
+        field.wireType = static_cast<WireType>(tag & 7);
+        switch (field.wireType)
+        {
+        case kVARINT:
+            if (!readVarint(data, offset, field.scalar))
+            {
+                return false;
+            }
+            break;
+        case kFIXED64:
+        case kFIXED32:
+        {
+            size_t const bytes = field.wireType == kFIXED64 ? 8 : 4;
+            if (offset + bytes > data.size())
+            {
+                return false;
+            }
+            for (size_t b = 0; b < bytes; ++b)
+            {
+                field.scalar |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + b])) << (8 * b);
+            }
+            offset += bytes;
+            break;
+        }
+        case kBYTES:
+        {
+            uint64_t length = 0;
+            if (!readVarint(data, offset, length) || length > data.size() - offset)
+            {
+                return false;
+            }
+            field.bytes.assign(data, offset, length);
+            offset += length;
+            break;
+        }
+        default: return false; // Groups are deprecated and not used by ONNX
+        }
+        mFields.push_back(std::move(field));
+    }
+    return true;
+}
+
+std::string ProtoMessage::serialize() const
+{
+    std::string data;
+    for (auto const& field : mFields)
+    {
+        writeVarint(data, (static_cast<uint64_t>(field.number) << 3) | field.wireType);
+        switch (field.wireType)
+        {
+        case kVARINT: writeVarint(data, field.scalar); break;
+        case kFIXED64: writeFixed(data, field.scalar, 8); break;
+        case kFIXED32: writeFixed(data, field.scalar, 4); break;
+        case kBYTES:
+            writeVarint(data, field.bytes.size());
+            data += field.bytes;
+            break;
+        }
+    }
+    return data;
+}
+
+std::string ProtoMessage::getString(int32_t number) const
+{
+    for (auto const& field : mFields)
+    {
+        if (field.number == number && field.wireType == kBYTES)
+        {
+            return field.bytes;
+        }
+    }
+    return std::string();
+}
+
+std::vector<std::string> ProtoMessage::getStrings(int32_t number) const
+{
+    std::vector<std::string> strings;
+    for (auto const& field : mFields)
+    {
+        if (field.number == number && field.wireType == kBYTES)
+        {
+            strings.push_back(field.bytes);
+        }
+    }
+    return strings;
+}
+
+int64_t ProtoMessage::getInt(int32_t number, int64_t fallback) const
+{
+    for (auto const& field : mFields)
+    {
+        if (field.number == number && field.wireType == kVARINT)
+        {
+            return static_cast<int64_t>(field.scalar);
+        }
+    }
+    return fallback;
+}
+
+std::vector<int64_t> ProtoMessage::getInts(int32_t number) const
+{
+    std::vector<int64_t> values;
+    for (auto const& field : mFields)
+    {
+        if (field.number != number)
+        {
+            continue;
+        }
+        if (field.wireType == kBYTES)
+        {
+            size_t offset = 0;
+            uint64_t value = 0;
+            while (offset < field.bytes.size() && readVarint(field.bytes, offset, value))
+            {
+                values.push_back(static_cast<int64_t>(value));
+            }
+        }
+        else
+        {
+            values.push_back(static_cast<int64_t>(field.scalar));
+        }
+    }
+    return values;
+}
+
+float ProtoMessage::getFloat(int32_t number, float fallback) const
+{
+    for (auto const& field : mFields)
+    {
+        if (field.number == number && field.wireType == kFIXED32)
+        {
+            uint32_t const bits = static_cast<uint32_t>(field.scalar);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+    return fallback;
+}
+
+void ProtoMessage::addBytes(int32_t number, std::string bytes)
+{
+    Field field;
+    field.number = number;
+    field.wireType = kBYTES;
+    field.bytes = std::move(bytes);
+    mFields.push_back(std::move(field));
+}
+
+void ProtoMessage::addVarint(int32_t number, uint64_t value)
+{
+    Field field;
+    field.number = number;
+    field.wireType = kVARINT;
+    field.scalar = value;
+    mFields.push_back(std::move(field));
+}
+
+void ProtoMessage::removeFields(int32_t number)
+{
+    mFields.erase(std::remove_if(mFields.begin(), mFields.end(),
+                      [number](Field const& field) { return field.number == number; }),
+        mFields.end());
+}
+
+bool readModel(std::string const& fileName, ProtoMessage& model)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        sample::gLogError << "Cannot open " << fileName << std::endl;
+        return false;
+    }
+    std::string const data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!model.parse(data))
+    {
+        sample::gLogError << fileName << " is not a valid ONNX model" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writeModel(std::string const& fileName, ProtoMessage const& model)
+{
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    std::string const data = model.serialize();
+    if (!file.write(data.data(), data.size()))
+    {
+        sample::gLogError << "Cannot write " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool getGraphOutputs(ProtoMessage const& model, std::vector<std::string>& names)
+{
+    ProtoMessage graph;
+    if (!getGraph(model, graph))
+    {
+        return false;
+    }
+    names.clear();
+    for (auto const& output : graph.getStrings(onnx::kGRAPH_OUTPUT))
+    {
+        names.push_back(getName(output, onnx::kVALUE_INFO_NAME));
+    }
+    return true;
+}
+
+bool getMetadata(ProtoMessage const& model, std::string const& key, std::string& value)
+{
+    for (auto const& data : model.getStrings(onnx::kMODEL_METADATA))
+    {
+        ProtoMessage entry;
+        if (entry.parse(data) && entry.getString(onnx::kMETADATA_KEY) == key)
+        {
+            value = entry.getString(onnx::kMETADATA_VALUE);
+            return true;
+        }
+    }
+    return false;
+}
+
+void setMetadata(ProtoMessage& model, std::string const& key, std::string const& value)
+{
+    // The other entries keep their place, the entry is appended after them
+    std::vector<ProtoMessage::Field> fields;
+    for (auto& field : model.getFields())
+    {
+        ProtoMessage entry;
+        if (field.number != onnx::kMODEL_METADATA || !entry.parse(field.bytes)
+            || entry.getString(onnx::kMETADATA_KEY) != key)
+        {
+            fields.push_back(std::move(field));
+        }
+    }
+    model.getFields() = std::move(fields);
+
+    ProtoMessage entry;
+    entry.addBytes(onnx::kMETADATA_KEY, key);
+    entry.addBytes(onnx::kMETADATA_VALUE, value);
+    model.addBytes(onnx::kMODEL_METADATA, entry.serialize());
+}
+
+std::vector<int64_t> getValueInfoDims(std::string const& valueInfo, int64_t symbolic)
+{
+    ProtoMessage info, type, tensorType, shape;
+    std::vector<int64_t> dims;
+    if (!info.parse(valueInfo) || !type.parse(info.getString(onnx::kVALUE_INFO_TYPE))
+        || !tensorType.parse(type.getString(onnx::kTYPE_TENSOR))
+        || !shape.parse(tensorType.getString(onnx::kTENSOR_TYPE_SHAPE)))
+    {
+        return dims;
+    }
+    for (auto const& data : shape.getStrings(onnx::kSHAPE_DIM))
+    {
+        ProtoMessage dim;
+        int64_t const value = dim.parse(data) ? dim.getInt(onnx::kDIMENSION_VALUE) : 0;
+        dims.push_back(value > 0 ? value : symbolic);
+    }
+    return dims;
+}
+
+bool getGraphInputs(ProtoMessage const& model, std::vector<std::string>& names,
+    std::vector<std::vector<int64_t>>& dims)
+{
+    ProtoMessage graph;
+    if (!getGraph(model, graph))
+    {
+        return false;
+    }
+    std::set<std::string> initializers;
+    for (auto const& initializer : graph.getStrings(onnx::kGRAPH_INITIALIZER))
+    {
+        initializers.insert(getName(initializer, onnx::kTENSOR_NAME));
+    }
+    names.clear();
+    dims.clear();
+    for (auto const& input : graph.getStrings(onnx::kGRAPH_INPUT))
+    {
+        std::string const name = getName(input, onnx::kVALUE_INFO_NAME);
+        if (!initializers.count(name))
+        {
+            names.push_back(name);
+            dims.push_back(getValueInfoDims(input));
+        }
+    }
+    return true;
+}
+
+bool pruneGraph(ProtoMessage& model, std::vector<std::string> const& outputs, PruneResult& result)
+{
+    ProtoMessage graph;
+    if (!getGraph(model, graph))
+    {
+        return false;
+    }
+
+    // Every output needs a value info to describe its type, from the current outputs or the value infos
+    std::vector<std::string> outputInfos;
+    for (auto const& name : outputs)
+    {
+        std::string info;
+        for (int32_t number : {onnx::kGRAPH_OUTPUT, onnx::kGRAPH_VALUE_INFO})
+        {
+            for (auto const& candidate : graph.getStrings(number))
+            {
+                if (info.empty() && getName(candidate, onnx::kVALUE_INFO_NAME) == name)
+                {
+                    info = candidate;
+                }
+            }
+        }
+        if (info.empty())
+        {
+            sample::gLogError << "No type information for output " << name << std::endl;
+            return false;
+        }
+        outputInfos.push_back(info);
+    }
+
+    std::set<std::string> needed(outputs.begin(), outputs.end());
+    std::vector<ProtoMessage::Field> kept;
+    auto& fields = graph.getFields();
+    for (auto field = fields.rbegin(); field != fields.rend(); ++field)
+    {
+        if (field->number == onnx::kGRAPH_NODE)
+        {
+            ++result.nodesBefore;
+            ProtoMessage node;
+            if (!node.parse(field->bytes))
+            {
+                sample::gLogError << "The graph holds an invalid node" << std::endl;
+                return false;
+            }
+            auto const nodeOutputs = node.getStrings(onnx::kNODE_OUTPUT);
+            bool const used = std::any_of(nodeOutputs.begin(), nodeOutputs.end(),
+                [&needed](std::string const& name) { return needed.count(name) != 0; });
+            if (!used)
+            {
+                continue;
+            }
+            ++result.nodesAfter;
+            for (auto const& input : node.getStrings(onnx::kNODE_INPUT))
+            {
+                needed.insert(input);
+            }
+        }
+        kept.push_back(std::move(*field));
+    }
+    std::reverse(kept.begin(), kept.end());
+
+    // Initializers, inputs and value infos are declared by name, they stay if a kept node reads them
+    fields.clear();
+    for (auto& field : kept)
+    {
+        bool keep = true;
+        switch (field.number)
+        {
+        case onnx::kGRAPH_INITIALIZER:
+            ++result.initializersBefore;
+            result.initializerBytesBefore += field.bytes.size();
+            keep = needed.count(getName(field.bytes, onnx::kTENSOR_NAME)) != 0;
+            result.initializersAfter += keep;
+            result.initializerBytesAfter += keep ? field.bytes.size() : 0;
+            break;
+        case onnx::kGRAPH_INPUT:
+        case onnx::kGRAPH_VALUE_INFO: keep = needed.count(getName(field.bytes, onnx::kVALUE_INFO_NAME)) != 0; break;
+        case onnx::kGRAPH_OUTPUT: keep = false; break;
+        default: break;
+        }
+        if (keep)
+        {
+            fields.push_back(std::move(field));
+        }
+    }
+    for (auto& info : outputInfos)
+    {
+        graph.addBytes(onnx::kGRAPH_OUTPUT, std::move(info));
+    }
+
+    setGraph(model, graph);
+    return true;
+}
+
+} // namespace pinet
@@ -0,0 +1,205 @@
+#ifndef PINET_ONNX_MODEL_H
+#define PINET_ONNX_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief  The ProtoMessage class holds a protobuf message as its list of raw fields.
+//!
+//! \details Only the wire format is decoded, so no generated code or protobuf library is needed and fields
+//!          this code does not know about survive a parse and serialize round trip unchanged. Nested
+//!          messages are kept as bytes and parsed on demand into their own ProtoMessage.
+//!
+class ProtoMessage
+{
+public:
+    enum WireType : int32_t
+    {
+        kVARINT = 0,
+        kFIXED64 = 1,
+        kBYTES = 2,
+        kFIXED32 = 5
+    };
+
+    struct Field
+    {
+        int32_t number{0};
+        WireType wireType{kVARINT};
+        uint64_t scalar{0}; //!< Value of varint and fixed size fields
+        std::string bytes;  //!< Value of length delimited fields, i.e. strings, bytes and nested messages
+    };
+
+    //!
+    //! \return false if data is not a well formed message
+    //!
+    bool parse(std::string const& data);
+
+    std::string serialize() const;
+
+    std::vector<Field>& getFields()
+    {
+        return mFields;
+    }
+
+    std::vector<Field> const& getFields() const
+    {
+        return mFields;
+    }
+
+    //!
+    //! \brief Returns the first length delimited field with number, empty if there is none.
+    //!
+    std::string getString(int32_t number) const;
+
+    //!
+    //! \brief Returns all length delimited fields with number, i.e. the items of a repeated field.
+    //!
+    std::vector<std::string> getStrings(int32_t number) const;
+
+    //!
+    //! \brief Returns the first varint field with number, fallback if there is none.
+    //!
+    int64_t getInt(int32_t number, int64_t fallback = 0) const;
+
+    //!
+    //! \brief Returns all integers of the repeated field number, whether they are packed or not.
+    //!
+    std::vector<int64_t> getInts(int32_t number) const;
+
+    //!
+    //! \brief Returns the first 32-bit float field with number, fallback if there is none.
+    //!
+    float getFloat(int32_t number, float fallback = 0.f) const;
+
+    void addBytes(int32_t number, std::string bytes);
+
+    void addVarint(int32_t number, uint64_t value);
+
+    //!
+    //! \brief Removes all fields with number.
+    //!
+    void removeFields(int32_t number);
+
+private:
+    std::vector<Field> mFields;
+};
+
+//!
+//! \brief Field numbers of the ONNX messages, see onnx.proto.
+//!
+namespace onnx
+{
+constexpr int32_t kMODEL_GRAPH = 7;
+constexpr int32_t kMODEL_METADATA = 14;
+constexpr int32_t kMETADATA_KEY = 1;
+constexpr int32_t kMETADATA_VALUE = 2;
+constexpr int32_t kGRAPH_NODE = 1;
+constexpr int32_t kGRAPH_INITIALIZER = 5;
+constexpr int32_t kGRAPH_INPUT = 11;
+constexpr int32_t kGRAPH_OUTPUT = 12;
+constexpr int32_t kGRAPH_VALUE_INFO = 13;
+constexpr int32_t kNODE_INPUT = 1;
+constexpr int32_t kNODE_OUTPUT = 2;
+constexpr int32_t kNODE_NAME = 3;
+constexpr int32_t kNODE_OP_TYPE = 4;
+constexpr int32_t kNODE_ATTRIBUTE = 5;
+constexpr int32_t kVALUE_INFO_NAME = 1;
+constexpr int32_t kVALUE_INFO_TYPE = 2;
+constexpr int32_t kTYPE_TENSOR = 1;
+constexpr int32_t kTENSOR_TYPE_SHAPE = 2;
+constexpr int32_t kSHAPE_DIM = 1;
+constexpr int32_t kDIMENSION_VALUE = 1;
+constexpr int32_t kATTRIBUTE_NAME = 1;
+constexpr int32_t kATTRIBUTE_FLOAT = 2;
+constexpr int32_t kATTRIBUTE_INT = 3;
+constexpr int32_t kATTRIBUTE_STRING = 4;
+constexpr int32_t kATTRIBUTE_TENSOR = 5;
+constexpr int32_t kATTRIBUTE_INTS = 8;
+constexpr int32_t kTENSOR_DIMS = 1;
+constexpr int32_t kTENSOR_DATA_TYPE = 2;
+constexpr int32_t kTENSOR_FLOAT_DATA = 4;
+constexpr int32_t kTENSOR_INT64_DATA = 7;
+constexpr int32_t kTENSOR_NAME = 8;
+constexpr int32_t kTENSOR_RAW_DATA = 9;
+constexpr int32_t kTENSOR_DATA_LOCATION = 14;
+constexpr int32_t kDATA_TYPE_FLOAT = 1; //!< Value of TensorProto.data_type for 32-bit floats
+constexpr int32_t kDATA_TYPE_INT64 = 7; //!< Value of TensorProto.data_type for 64-bit integers
+} // namespace onnx
+
+//!
+//! \brief Reads and parses an ONNX model.
+//!
+bool readModel(std::string const& fileName, ProtoMessage& model);
+
+//!
+//! \brief Serializes and writes an ONNX model.
+//!
+bool writeModel(std::string const& fileName, ProtoMessage const& model);
+
+//!
+//! \brief Returns the names of the outputs of the graph of model, in order.
+//!
+bool getGraphOutputs(ProtoMessage const& model, std::vector<std::string>& names);
+
+//!
+//! \brief Reads the value of key in the metadata_props of model.
+//!
+//! \return false if model has no metadata entry key
+//!
+bool getMetadata(ProtoMessage const& model, std::string const& key, std::string& value);
+
+//!
+//! \brief Sets the value of key in the metadata_props of model, replacing the entries with the same key.
+//!
+void setMetadata(ProtoMessage& model, std::string const& key, std::string const& value);
+
+//!
+//! \brief Reads the dimensions of a serialized ValueInfoProto.
+//!
+//! \param symbolic Value of the dimensions without a fixed size, e.g. a named batch dimension.
+//!
+//! \return the dimensions, empty if the value info describes no tensor shape
+//!
+std::vector<int64_t> getValueInfoDims(std::string const& valueInfo, int64_t symbolic = 1);
+
+//!
+//! \brief Returns the names and dimensions of the inputs of the graph of model which are not initializers.
+//!
+//! \details Older exporters list the initializers among the graph inputs as well, they are skipped.
+//!
+bool getGraphInputs(ProtoMessage const& model, std::vector<std::string>& names,
+    std::vector<std::vector<int64_t>>& dims);
+
+//!
+//! \brief The PruneResult structure summarizes what pruneGraph() removed.
+//!
+struct PruneResult
+{
+    int32_t nodesBefore{0};
+    int32_t nodesAfter{0};
+    int32_t initializersBefore{0};
+    int32_t initializersAfter{0};
+    int64_t initializerBytesBefore{0}; //!< Serialized size of the initializers
+    int64_t initializerBytesAfter{0};
+};
+
+//!
+//! \brief Truncates the graph of model to what outputs depend on.
+//!
+//! \details Nodes are visited backwards from the outputs, which relies on the topological order ONNX
+//!          requires. Nodes, initializers, inputs and value infos nothing in outputs depends on are dropped
+//!          and outputs become the graph outputs, in the given order. Subgraphs of control flow nodes are
+//!          not looked into, so names they capture from the outer graph are not kept alive.
+//!
+//! \return false if an output is neither produced in the graph nor described by a graph output or value info
+//!
+bool pruneGraph(ProtoMessage& model, std::vector<std::string> const& outputs, PruneResult& result);
+
+} // namespace pinet
+
+#endif // PINET_ONNX_MODEL_H
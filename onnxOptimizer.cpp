@@ -0,0 +1,1308 @@
+#include "onnxOptimizer.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace pinet
+{
+
+namespace
+{
+
+//!
+//! \brief The Constant structure holds a float or int64 tensor the optimizer computes with.
+//!
+//! \details Values are kept as doubles, which hold every float and every int64 used for shapes and indices
+//!          exactly, so that all operators are written once for both types.
+//!
+struct Constant
+{
+    int32_t dataType{onnx::kDATA_TYPE_FLOAT};
+    std::vector<int64_t> dims;
+    std::vector<double> values;
+};
+
+int64_t getVolume(std::vector<int64_t> const& dims)
+{
+    int64_t volume = 1;
+    for (int64_t d : dims)
+    {
+        volume *= d;
+    }
+    return volume;
+}
+
+//!
+//! \return false if the tensor holds neither floats nor int64 or is stored outside of the model
+//!
+bool readConstant(ProtoMessage const& tensor, Constant& constant)
+{
+    constant.dataType = static_cast<int32_t>(tensor.getInt(onnx::kTENSOR_DATA_TYPE));
+    constant.dims = tensor.getInts(onnx::kTENSOR_DIMS);
+    constant.values.clear();
+    bool const isFloat = constant.dataType == onnx::kDATA_TYPE_FLOAT;
+    if (tensor.getInt(onnx::kTENSOR_DATA_LOCATION) != 0 || (!isFloat && constant.dataType != onnx::kDATA_TYPE_INT64))
+    {
+        return false;
+    }
+
+    int64_t const volume = getVolume(constant.dims);
+    std::string const raw = tensor.getString(onnx::kTENSOR_RAW_DATA);
+    size_t const elementSize = isFloat ? sizeof(float) : sizeof(int64_t);
+    if (!raw.empty())
+    {
+        if (static_cast<int64_t>(raw.size()) != volume * static_cast<int64_t>(elementSize))
+        {
+            return false;
+        }
+        constant.values.resize(volume);
+        for (int64_t i = 0; i < volume; ++i)
+        {
+            float f;
+            int64_t n;
+            std::memcpy(isFloat ? static_cast<void*>(&f) : static_cast<void*>(&n), raw.data() + i * elementSize,
+                elementSize);
+            constant.values[i] = isFloat ? f : static_cast<double>(n);
+        }
+        return true;
+    }
+
+    if (!isFloat)
+    {
+        for (int64_t n : tensor.getInts(onnx::kTENSOR_INT64_DATA))
+        {
+            constant.values.push_back(static_cast<double>(n));
+        }
+        return static_cast<int64_t>(constant.values.size()) == volume;
+    }
+    // float_data is usually packed, but may also be a list of 32-bit fields
+    for (auto const& field : tensor.getFields())
+    {
+        if (field.number != onnx::kTENSOR_FLOAT_DATA)
+        {
+            continue;
+        }
+        if (field.wireType == ProtoMessage::kBYTES)
+        {
+            for (size_t offset = 0; offset + sizeof(float) <= field.bytes.size(); offset += sizeof(float))
+            {
+                float f;
+                std::memcpy(&f, field.bytes.data() + offset, sizeof(f));
+                constant.values.push_back(f);
+            }
+        }
+        else if (field.wireType == ProtoMessage::kFIXED32)
+        {
+            uint32_t const bits = static_cast<uint32_t>(field.scalar);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            constant.values.push_back(f);
+        }
+    }
+    return static_cast<int64_t>(constant.values.size()) == volume;
+}
+
+//!
+//! \brief Serializes constant as a TensorProto named name, its data as raw_data.
+//!
+std::string writeConstant(std::string const& name, Constant const& constant)
+{
+    ProtoMessage tensor;
+    for (int64_t d : constant.dims)
+    {
+        tensor.addVarint(onnx::kTENSOR_DIMS, static_cast<uint64_t>(d));
+    }
+    tensor.addVarint(onnx::kTENSOR_DATA_TYPE, static_cast<uint64_t>(constant.dataType));
+    tensor.addBytes(onnx::kTENSOR_NAME, name);
+
+    bool const isFloat = constant.dataType == onnx::kDATA_TYPE_FLOAT;
+    size_t const elementSize = isFloat ? sizeof(float) : sizeof(int64_t);
+    std::string raw(constant.values.size() * elementSize, '\0');
+    for (size_t i = 0; i < constant.values.size(); ++i)
+    {
+        float const f = static_cast<float>(constant.values[i]);
+        int64_t const n = static_cast<int64_t>(constant.values[i]);
+        std::memcpy(&raw[i * elementSize], isFloat ? static_cast<void const*>(&f) : static_cast<void const*>(&n),
+            elementSize);
+    }
+    tensor.addBytes(onnx::kTENSOR_RAW_DATA, std::move(raw));
+    return tensor.serialize();
+}
+
+//!
+//! \brief Replaces the values of the repeated field number of message, keeping its position among the fields.
+//!
+void setStrings(ProtoMessage& message, int32_t number, std::vector<std::string> const& values)
+{
+    std::vector<ProtoMessage::Field> fields;
+    bool written = false;
+    auto const writeValues = [&fields, &values, number]() {
+        for (auto const& value : values)
+        {
+            ProtoMessage::Field field;
+            field.number = number;
+            field.wireType = ProtoMessage::kBYTES;
+            field.bytes = value;
+            fields.push_back(std::move(field));
+        }
+    };
+    for (auto& field : message.getFields())
+    {
+        if (field.number != number)
+        {
+            fields.push_back(std::move(field));
+        }
+        else if (!written)
+        {
+            writeValues();
+            written = true;
+        }
+    }
+    if (!written)
+    {
+        writeValues();
+    }
+    message.getFields() = std::move(fields);
+}
+
+//!
+//! \brief Returns the attribute name of node, an empty message if it has none.
+//!
+ProtoMessage getAttribute(ProtoMessage const& node, std::string const& name)
+{
+    for (auto const& data : node.getStrings(onnx::kNODE_ATTRIBUTE))
+    {
+        ProtoMessage attribute;
+        if (attribute.parse(data) && attribute.getString(onnx::kATTRIBUTE_NAME) == name)
+        {
+            return attribute;
+        }
+    }
+    return ProtoMessage();
+}
+
+bool hasAttribute(ProtoMessage const& node, std::string const& name)
+{
+    return !getAttribute(node, name).getFields().empty();
+}
+
+int64_t getIntAttribute(ProtoMessage const& node, std::string const& name, int64_t fallback)
+{
+    return getAttribute(node, name).getInt(onnx::kATTRIBUTE_INT, fallback);
+}
+
+//!
+//! \brief Returns axis of a tensor of rank dimensions, counted from the end if negative, -1 if out of range.
+//!
+int64_t normalizeAxis(int64_t axis, size_t rank)
+{
+    int64_t const r = static_cast<int64_t>(rank);
+    axis = axis < 0 ? axis + r : axis;
+    return axis >= 0 && axis < r ? axis : -1;
+}
+
+//!
+//! \brief Returns the strides of a tensor of dims broadcast to rank dimensions, 0 along broadcast dimensions.
+//!
+std::vector<int64_t> getBroadcastStrides(std::vector<int64_t> const& dims, std::vector<int64_t> const& outDims)
+{
+    std::vector<int64_t> strides(outDims.size(), 0);
+    int64_t stride = 1;
+    for (size_t i = 0; i < dims.size(); ++i)
+    {
+        size_t const d = dims.size() - 1 - i;
+        size_t const o = outDims.size() - 1 - i;
+        strides[o] = dims[d] == 1 ? 0 : stride;
+        stride *= dims[d];
+    }
+    return strides;
+}
+
+//!
+//! \brief Applies a binary operator with numpy broadcasting.
+//!
+bool evaluateBinary(std::string const& op, Constant const& a, Constant const& b, Constant& output)
+{
+    if (a.dataType != b.dataType)
+    {
+        return false;
+    }
+    size_t const rank = std::max(a.dims.size(), b.dims.size());
+    output.dataType = a.dataType;
+    output.dims.assign(rank, 1);
+    for (size_t i = 0; i < rank; ++i)
+    {
+        int64_t const da = i < a.dims.size() ? a.dims[a.dims.size() - 1 - i] : 1;
+        int64_t const db = i < b.dims.size() ? b.dims[b.dims.size() - 1 - i] : 1;
+        if (da != db && da != 1 && db != 1)
+        {
+            return false;
+        }
+        output.dims[rank - 1 - i] = std::max(da, db);
+    }
+
+    bool const isInt = a.dataType == onnx::kDATA_TYPE_INT64;
+    std::function<double(double, double)> apply;
+    if (op == "Add")
+    {
+        apply = [](double x, double y) { return x + y; };
+    }
+    else if (op == "Sub")
+    {
+        apply = [](double x, double y) { return x - y; };
+    }
+    else if (op == "Mul")
+    {
+        apply = [](double x, double y) { return x * y; };
+    }
+    else if (op == "Div")
+    {
+        apply = [isInt](double x, double y) { return isInt ? std::trunc(x / y) : x / y; };
+    }
+    else
+    {
+        return false;
+    }
+
+    std::vector<int64_t> const aStrides = getBroadcastStrides(a.dims, output.dims);
+    std::vector<int64_t> const bStrides = getBroadcastStrides(b.dims, output.dims);
+    output.values.resize(getVolume(output.dims));
+    std::vector<int64_t> index(rank, 0);
+    for (size_t i = 0; i < output.values.size(); ++i)
+    {
+        int64_t aOffset = 0;
+        int64_t bOffset = 0;
+        for (size_t d = 0; d < rank; ++d)
+        {
+            aOffset += index[d] * aStrides[d];
+            bOffset += index[d] * bStrides[d];
+        }
+        output.values[i] = apply(a.values[aOffset], b.values[bOffset]);
+        for (size_t d = rank; d-- > 0 && ++index[d] == output.dims[d];)
+        {
+            index[d] = 0;
+        }
+    }
+    return true;
+}
+
+//!
+//! \brief Returns the axes of a Squeeze or Unsqueeze node, from its attribute up to opset 12 or its second input.
+//!
+std::vector<int64_t> getAxes(ProtoMessage const& node, std::vector<Constant const*> const& inputs)
+{
+    if (inputs.size() > 1)
+    {
+        return std::vector<int64_t>(inputs[1]->values.begin(), inputs[1]->values.end());
+    }
+    return getAttribute(node, "axes").getInts(onnx::kATTRIBUTE_INTS);
+}
+
+//!
+//! \brief Computes the output of node from its constant inputs.
+//!
+//! \return false if the operator or its attributes are not supported
+//!
+bool evaluate(ProtoMessage const& node, std::vector<Constant const*> const& inputs, Constant& output)
+{
+    std::string const op = node.getString(onnx::kNODE_OP_TYPE);
+    Constant const& data = *inputs[0];
+    output.dataType = data.dataType;
+    output.dims = data.dims;
+    output.values = data.values;
+
+    if (op == "Identity")
+    {
+        return true;
+    }
+    if (op == "Cast")
+    {
+        int64_t const to = getIntAttribute(node, "to", 0);
+        if (to != onnx::kDATA_TYPE_FLOAT && to != onnx::kDATA_TYPE_INT64)
+        {
+            return false;
+        }
+        output.dataType = static_cast<int32_t>(to);
+        for (double& value : output.values)
+        {
+            value = to == onnx::kDATA_TYPE_INT64 ? std::trunc(value) : static_cast<float>(value);
+        }
+        return true;
+    }
+    if (op == "Sqrt" || op == "Neg" || op == "Reciprocal")
+    {
+        for (double& value : output.values)
+        {
+            value = op == "Sqrt" ? std::sqrt(value) : op == "Neg" ? -value : 1.0 / value;
+        }
+        return data.dataType == onnx::kDATA_TYPE_FLOAT || op == "Neg";
+    }
+    if (op == "Add" || op == "Sub" || op == "Mul" || op == "Div")
+    {
+        return inputs.size() == 2 && evaluateBinary(op, data, *inputs[1], output);
+    }
+    if (op == "Reshape")
+    {
+        if (inputs.size() != 2)
+        {
+            return false;
+        }
+        bool const allowZero = getIntAttribute(node, "allowzero", 0) != 0;
+        output.dims.clear();
+        int64_t inferred = -1;
+        for (size_t i = 0; i < inputs[1]->values.size(); ++i)
+        {
+            int64_t d = static_cast<int64_t>(inputs[1]->values[i]);
+            if (d == 0 && !allowZero)
+            {
+                if (i >= data.dims.size())
+                {
+                    return false;
+                }
+                d = data.dims[i];
+            }
+            if (d == -1)
+            {
+                inferred = static_cast<int64_t>(output.dims.size());
+                d = 1;
+            }
+            output.dims.push_back(d);
+        }
+        int64_t const known = getVolume(output.dims);
+        if (inferred >= 0 && known > 0)
+        {
+            output.dims[inferred] = getVolume(data.dims) / known;
+        }
+        return getVolume(output.dims) == getVolume(data.dims);
+    }
+    if (op == "Flatten")
+    {
+        int64_t const axis = getIntAttribute(node, "axis", 1);
+        int64_t const split = axis < 0 ? axis + static_cast<int64_t>(data.dims.size()) : axis;
+        if (split < 0 || split > static_cast<int64_t>(data.dims.size()))
+        {
+            return false;
+        }
+        output.dims = {getVolume(std::vector<int64_t>(data.dims.begin(), data.dims.begin() + split)),
+            getVolume(std::vector<int64_t>(data.dims.begin() + split, data.dims.end()))};
+        return true;
+    }
+    if (op == "Squeeze")
+    {
+        std::vector<int64_t> axes = getAxes(node, inputs);
+        output.dims.clear();
+        for (size_t d = 0; d < data.dims.size(); ++d)
+        {
+            bool const listed = std::any_of(axes.begin(), axes.end(),
+                [&data, d](int64_t axis) { return normalizeAxis(axis, data.dims.size()) == static_cast<int64_t>(d); });
+            if (listed ? data.dims[d] != 1 : (axes.empty() && data.dims[d] == 1) ? false : true)
+            {
+                if (listed)
+                {
+                    return false;
+                }
+                output.dims.push_back(data.dims[d]);
+            }
+        }
+        return true;
+    }
+    if (op == "Unsqueeze")
+    {
+        std::vector<int64_t> axes = getAxes(node, inputs);
+        size_t const rank = data.dims.size() + axes.size();
+        std::vector<bool> inserted(rank, false);
+        for (int64_t axis : axes)
+        {
+            int64_t const a = normalizeAxis(axis, rank);
+            if (a < 0 || inserted[a])
+            {
+                return false;
+            }
+            inserted[a] = true;
+        }
+        output.dims.clear();
+        for (size_t d = 0, source = 0; d < rank; ++d)
+        {
+            output.dims.push_back(inserted[d] ? 1 : data.dims[source++]);
+        }
+        return true;
+    }
+    if (op == "Concat")
+    {
+        int64_t const axis = normalizeAxis(getIntAttribute(node, "axis", 0), data.dims.size());
+        if (axis < 0)
+        {
+            return false;
+        }
+        int64_t const outer = getVolume(std::vector<int64_t>(data.dims.begin(), data.dims.begin() + axis));
+        output.dims[axis] = 0;
+        for (auto const* input : inputs)
+        {
+            if (input->dataType != data.dataType || input->dims.size() != data.dims.size())
+            {
+                return false;
+            }
+            output.dims[axis] += input->dims[axis];
+        }
+        output.values.clear();
+        for (int64_t o = 0; o < outer; ++o)
+        {
+            for (auto const* input : inputs)
+            {
+                int64_t const chunk = static_cast<int64_t>(input->values.size()) / std::max<int64_t>(outer, 1);
+                output.values.insert(
+                    output.values.end(), input->values.begin() + o * chunk, input->values.begin() + (o + 1) * chunk);
+            }
+        }
+        return static_cast<int64_t>(output.values.size()) == getVolume(output.dims);
+    }
+    if (op == "Gather")
+    {
+        int64_t const axis = normalizeAxis(getIntAttribute(node, "axis", 0), data.dims.size());
+        if (inputs.size() != 2 || axis < 0)
+        {
+            return false;
+        }
+        Constant const& indices = *inputs[1];
+        int64_t const outer = getVolume(std::vector<int64_t>(data.dims.begin(), data.dims.begin() + axis));
+        int64_t const inner = getVolume(std::vector<int64_t>(data.dims.begin() + axis + 1, data.dims.end()));
+        output.dims.assign(data.dims.begin(), data.dims.begin() + axis);
+        output.dims.insert(output.dims.end(), indices.dims.begin(), indices.dims.end());
+        output.dims.insert(output.dims.end(), data.dims.begin() + axis + 1, data.dims.end());
+        output.values.clear();
+        for (int64_t o = 0; o < outer; ++o)
+        {
+            for (double const value : indices.values)
+            {
+                int64_t const index = static_cast<int64_t>(value) < 0 ? static_cast<int64_t>(value) + data.dims[axis]
+                                                                      : static_cast<int64_t>(value);
+                if (index < 0 || index >= data.dims[axis])
+                {
+                    return false;
+                }
+                auto const begin = data.values.begin() + (o * data.dims[axis] + index) * inner;
+                output.values.insert(output.values.end(), begin, begin + inner);
+            }
+        }
+        return true;
+    }
+    if (op == "Transpose")
+    {
+        size_t const rank = data.dims.size();
+        std::vector<int64_t> perm = getAttribute(node, "perm").getInts(onnx::kATTRIBUTE_INTS);
+        if (perm.empty())
+        {
+            for (size_t d = 0; d < rank; ++d)
+            {
+                perm.push_back(static_cast<int64_t>(rank - 1 - d));
+            }
+        }
+        if (perm.size() != rank)
+        {
+            return false;
+        }
+        std::vector<int64_t> strides(rank, 1);
+        for (size_t d = rank; d-- > 1;)
+        {
+            strides[d - 1] = strides[d] * data.dims[d];
+        }
+        std::vector<int64_t> permutedStrides(rank);
+        for (size_t d = 0; d < rank; ++d)
+        {
+            output.dims[d] = data.dims[perm[d]];
+            permutedStrides[d] = strides[perm[d]];
+        }
+        std::vector<int64_t> index(rank, 0);
+        for (size_t i = 0; i < output.values.size(); ++i)
+        {
+            int64_t offset = 0;
+            for (size_t d = 0; d < rank; ++d)
+            {
+                offset += index[d] * permutedStrides[d];
+            }
+            output.values[i] = data.values[offset];
+            for (size_t d = rank; d-- > 0 && ++index[d] == output.dims[d];)
+            {
+                index[d] = 0;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+//!
+//! \brief The Graph structure holds the nodes and initializers of a graph while the passes rewrite them.
+//!
+struct Graph
+{
+    ProtoMessage graph;                              //!< The graph, whose nodes and initializers are stale
+    std::vector<ProtoMessage> nodes;                 //!< Nodes in topological order
+    std::vector<std::string> initializerNames;       //!< Initializers in order, including removed ones
+    std::map<std::string, std::string> initializers; //!< Serialized TensorProto of each initializer
+    std::set<std::string> outputs;                   //!< Names of the graph outputs
+    std::map<std::string, std::vector<int64_t>> shapes; //!< Fixed shapes given by graph inputs and value infos
+
+    bool isInitializer(std::string const& name) const
+    {
+        return initializers.count(name) != 0;
+    }
+
+    void addInitializer(std::string const& name, std::string tensor)
+    {
+        if (!isInitializer(name))
+        {
+            initializerNames.push_back(name);
+        }
+        initializers[name] = std::move(tensor);
+    }
+
+    //!
+    //! \brief Returns the number of inputs of nodes reading each tensor.
+    //!
+    std::map<std::string, int32_t> countConsumers() const
+    {
+        std::map<std::string, int32_t> consumers;
+        for (auto const& node : nodes)
+        {
+            for (auto const& input : node.getStrings(onnx::kNODE_INPUT))
+            {
+                ++consumers[input];
+            }
+        }
+        return consumers;
+    }
+
+    //!
+    //! \brief Returns the index of the node producing each tensor.
+    //!
+    std::map<std::string, size_t> findProducers() const
+    {
+        std::map<std::string, size_t> producers;
+        for (size_t n = 0; n < nodes.size(); ++n)
+        {
+            for (auto const& output : nodes[n].getStrings(onnx::kNODE_OUTPUT))
+            {
+                producers[output] = n;
+            }
+        }
+        return producers;
+    }
+
+    //!
+    //! \brief Replaces the inputs named in renames by their new name, following chains of renames.
+    //!
+    void renameInputs(std::map<std::string, std::string> const& renames)
+    {
+        if (renames.empty())
+        {
+            return;
+        }
+        for (auto& node : nodes)
+        {
+            std::vector<std::string> inputs = node.getStrings(onnx::kNODE_INPUT);
+            bool changed = false;
+            for (auto& input : inputs)
+            {
+                for (auto rename = renames.find(input); rename != renames.end(); rename = renames.find(input))
+                {
+                    input = rename->second;
+                    changed = true;
+                }
+            }
+            if (changed)
+            {
+                setStrings(node, onnx::kNODE_INPUT, inputs);
+            }
+        }
+    }
+
+    //!
+    //! \brief Returns a name no tensor of the graph has, base itself if possible.
+    //!
+    std::string makeUniqueName(std::string const& base) const
+    {
+        std::set<std::string> used(initializerNames.begin(), initializerNames.end());
+        for (auto const& node : nodes)
+        {
+            for (int32_t number : {onnx::kNODE_INPUT, onnx::kNODE_OUTPUT})
+            {
+                for (auto const& name : node.getStrings(number))
+                {
+                    used.insert(name);
+                }
+            }
+        }
+        std::string name = base;
+        for (int32_t suffix = 1; used.count(name); ++suffix)
+        {
+            name = base + "_" + std::to_string(suffix);
+        }
+        return name;
+    }
+};
+
+bool readGraph(ProtoMessage const& model, Graph& graph)
+{
+    if (!graph.graph.parse(model.getString(onnx::kMODEL_GRAPH)))
+    {
+        sample::gLogError << "The model has no valid graph" << std::endl;
+        return false;
+    }
+    for (auto const& data : graph.graph.getStrings(onnx::kGRAPH_NODE))
+    {
+        graph.nodes.emplace_back();
+        if (!graph.nodes.back().parse(data))
+        {
+            sample::gLogError << "The graph holds an invalid node" << std::endl;
+            return false;
+        }
+    }
+    for (auto const& data : graph.graph.getStrings(onnx::kGRAPH_INITIALIZER))
+    {
+        ProtoMessage tensor;
+        if (!tensor.parse(data))
+        {
+            sample::gLogError << "The graph holds an invalid initializer" << std::endl;
+            return false;
+        }
+        graph.addInitializer(tensor.getString(onnx::kTENSOR_NAME), data);
+    }
+    for (int32_t number : {onnx::kGRAPH_INPUT, onnx::kGRAPH_VALUE_INFO, onnx::kGRAPH_OUTPUT})
+    {
+        for (auto const& data : graph.graph.getStrings(number))
+        {
+            ProtoMessage info;
+            info.parse(data);
+            std::string const name = info.getString(onnx::kVALUE_INFO_NAME);
+            std::vector<int64_t> const dims = getValueInfoDims(data, -1);
+            if (!dims.empty() && std::find(dims.begin(), dims.end(), -1) == dims.end())
+            {
+                graph.shapes[name] = dims;
+            }
+            if (number == onnx::kGRAPH_OUTPUT)
+            {
+                graph.outputs.insert(name);
+            }
+        }
+    }
+    return true;
+}
+
+//!
+//! \brief Writes the nodes and initializers back into the graph of model, where the first ones were.
+//!
+void writeGraph(Graph& graph, ProtoMessage& model)
+{
+    std::vector<ProtoMessage::Field> fields;
+    bool nodesWritten = false;
+    bool initializersWritten = false;
+    auto const add = [&fields](int32_t number, std::string bytes) {
+        ProtoMessage::Field field;
+        field.number = number;
+        field.wireType = ProtoMessage::kBYTES;
+        field.bytes = std::move(bytes);
+        fields.push_back(std::move(field));
+    };
+    auto const writeNodes = [&]() {
+        for (auto const& node : graph.nodes)
+        {
+            add(onnx::kGRAPH_NODE, node.serialize());
+        }
+        nodesWritten = true;
+    };
+    auto const writeInitializers = [&]() {
+        for (auto const& name : graph.initializerNames)
+        {
+            auto const initializer = graph.initializers.find(name);
+            if (initializer != graph.initializers.end())
+            {
+                add(onnx::kGRAPH_INITIALIZER, initializer->second);
+            }
+        }
+        initializersWritten = true;
+    };
+    for (auto& field : graph.graph.getFields())
+    {
+        if (field.number == onnx::kGRAPH_NODE)
+        {
+            if (!nodesWritten)
+            {
+                writeNodes();
+            }
+        }
+        else if (field.number == onnx::kGRAPH_INITIALIZER)
+        {
+            if (!initializersWritten)
+            {
+                writeInitializers();
+            }
+        }
+        else
+        {
+            fields.push_back(std::move(field));
+        }
+    }
+    if (!nodesWritten)
+    {
+        writeNodes();
+    }
+    if (!initializersWritten)
+    {
+        writeInitializers();
+    }
+    graph.graph.getFields() = std::move(fields);
+
+    model.removeFields(onnx::kMODEL_GRAPH);
+    model.addBytes(onnx::kMODEL_GRAPH, graph.graph.serialize());
+}
+
+//!
+//! \brief Replaces Constant nodes and nodes computing from initializers only by the initializers they compute.
+//!
+//! \return the number of nodes replaced
+//!
+int32_t foldConstants(Graph& graph)
+{
+    int32_t folded = 0;
+    std::vector<ProtoMessage> kept;
+    for (auto& node : graph.nodes)
+    {
+        std::string const op = node.getString(onnx::kNODE_OP_TYPE);
+        std::vector<std::string> const inputs = node.getStrings(onnx::kNODE_INPUT);
+        std::vector<std::string> const outputs = node.getStrings(onnx::kNODE_OUTPUT);
+        // A graph output stays the output of a node, parsers do not all accept an initializer there
+        bool const foldable = outputs.size() == 1 && !graph.outputs.count(outputs[0]);
+
+        if (foldable && op == "Constant" && hasAttribute(node, "value"))
+        {
+            ProtoMessage tensor;
+            tensor.parse(getAttribute(node, "value").getString(onnx::kATTRIBUTE_TENSOR));
+            tensor.removeFields(onnx::kTENSOR_NAME);
+            tensor.addBytes(onnx::kTENSOR_NAME, outputs[0]);
+            graph.addInitializer(outputs[0], tensor.serialize());
+            ++folded;
+            continue;
+        }
+
+        Constant output;
+        bool computed = false;
+        if (foldable && op == "Shape" && inputs.size() == 1 && graph.shapes.count(inputs[0]))
+        {
+            std::vector<int64_t> const& dims = graph.shapes[inputs[0]];
+            output.dataType = onnx::kDATA_TYPE_INT64;
+            output.dims = {static_cast<int64_t>(dims.size())};
+            output.values.assign(dims.begin(), dims.end());
+            computed = !hasAttribute(node, "start") && !hasAttribute(node, "end");
+        }
+        else if (foldable && !inputs.empty())
+        {
+            std::vector<Constant> constants(inputs.size());
+            std::vector<Constant const*> operands;
+            bool constant = true;
+            for (size_t i = 0; constant && i < inputs.size(); ++i)
+            {
+                ProtoMessage tensor;
+                constant = !inputs[i].empty() && graph.isInitializer(inputs[i])
+                    && tensor.parse(graph.initializers[inputs[i]]) && readConstant(tensor, constants[i]);
+                operands.push_back(&constants[i]);
+            }
+            computed = constant && evaluate(node, operands, output);
+        }
+        if (computed)
+        {
+            graph.addInitializer(outputs[0], writeConstant(outputs[0], output));
+            ++folded;
+            continue;
+        }
+        kept.push_back(std::move(node));
+    }
+    graph.nodes = std::move(kept);
+    return folded;
+}
+
+//!
+//! \brief Bypasses Identity and Dropout nodes.
+//!
+//! \return the number of nodes removed
+//!
+int32_t removeIdentities(Graph& graph)
+{
+    std::map<std::string, int32_t> const consumers = graph.countConsumers();
+    std::map<std::string, size_t> const producers = graph.findProducers();
+    std::map<std::string, std::string> renames;
+    std::vector<bool> removed(graph.nodes.size(), false);
+    for (size_t n = 0; n < graph.nodes.size(); ++n)
+    {
+        ProtoMessage const& node = graph.nodes[n];
+        std::string const op = node.getString(onnx::kNODE_OP_TYPE);
+        std::vector<std::string> const inputs = node.getStrings(onnx::kNODE_INPUT);
+        std::vector<std::string> const outputs = node.getStrings(onnx::kNODE_OUTPUT);
+        // The mask of a Dropout has to be unused, the ratio and training mode inputs do not matter in inference
+        bool const maskUsed = outputs.size() > 1 && (consumers.count(outputs[1]) || graph.outputs.count(outputs[1]));
+        if ((op != "Identity" && op != "Dropout") || inputs.empty() || outputs.empty() || maskUsed)
+        {
+            continue;
+        }
+
+        if (!graph.outputs.count(outputs[0]))
+        {
+            renames[outputs[0]] = inputs[0];
+            removed[n] = true;
+            continue;
+        }
+        // The output name has to survive, the node before takes it over if nothing else reads the input
+        auto const producer = producers.find(inputs[0]);
+        auto const readers = consumers.find(inputs[0]);
+        if (producer != producers.end() && !removed[producer->second] && !graph.outputs.count(inputs[0])
+            && readers != consumers.end() && readers->second == 1)
+        {
+            ProtoMessage& previous = graph.nodes[producer->second];
+            std::vector<std::string> previousOutputs = previous.getStrings(onnx::kNODE_OUTPUT);
+            std::replace(previousOutputs.begin(), previousOutputs.end(), inputs[0], outputs[0]);
+            setStrings(previous, onnx::kNODE_OUTPUT, previousOutputs);
+            removed[n] = true;
+        }
+    }
+
+    std::vector<ProtoMessage> kept;
+    for (size_t n = 0; n < graph.nodes.size(); ++n)
+    {
+        if (!removed[n])
+        {
+            kept.push_back(std::move(graph.nodes[n]));
+        }
+    }
+    graph.nodes = std::move(kept);
+    graph.renameInputs(renames);
+    return static_cast<int32_t>(std::count(removed.begin(), removed.end(), true));
+}
+
+//!
+//! \brief Makes every Reshape to a constant shape read the input of a reshaping node before it.
+//!
+//! \details The shape must not copy dimensions of the input with 0, those may differ between the two inputs.
+//!          The reshaping nodes skipped over are dropped with the dead nodes if nothing else reads them.
+//!
+//! \return the number of reshapes changed
+//!
+int32_t collapseReshapes(Graph& graph)
+{
+    std::set<std::string> const reshaping{"Reshape", "Flatten", "Squeeze", "Unsqueeze"};
+    std::map<std::string, size_t> const producers = graph.findProducers();
+    int32_t collapsed = 0;
+    for (auto& node : graph.nodes)
+    {
+        std::vector<std::string> inputs = node.getStrings(onnx::kNODE_INPUT);
+        if (node.getString(onnx::kNODE_OP_TYPE) != "Reshape" || inputs.size() != 2 || !graph.isInitializer(inputs[1]))
+        {
+            continue;
+        }
+        ProtoMessage tensor;
+        Constant shape;
+        if (!tensor.parse(graph.initializers[inputs[1]]) || !readConstant(tensor, shape)
+            || std::find(shape.values.begin(), shape.values.end(), 0.0) != shape.values.end())
+        {
+            continue;
+        }
+        for (auto producer = producers.find(inputs[0]); producer != producers.end();
+             producer = producers.find(inputs[0]))
+        {
+            ProtoMessage const& previous = graph.nodes[producer->second];
+            std::vector<std::string> const previousInputs = previous.getStrings(onnx::kNODE_INPUT);
+            if (!reshaping.count(previous.getString(onnx::kNODE_OP_TYPE)) || previousInputs.empty())
+            {
+                break;
+            }
+            inputs[0] = previousInputs[0];
+            ++collapsed;
+        }
+        setStrings(node, onnx::kNODE_INPUT, inputs);
+    }
+    return collapsed;
+}
+
+//!
+//! \brief Folds every BatchNormalization into the Conv or ConvTranspose producing its input.
+//!
+//! \details The convolution gets new weights and bias, the former ones may be shared with other nodes, and
+//!          takes over the output of the BatchNormalization. The convolution output must be read by nothing
+//!          else and must not be a graph output.
+//!
+//! \return the number of nodes folded
+//!
+int32_t foldBatchNorms(Graph& graph)
+{
+    std::map<std::string, int32_t> const consumers = graph.countConsumers();
+    std::map<std::string, size_t> const producers = graph.findProducers();
+    std::vector<bool> removed(graph.nodes.size(), false);
+    auto const readInitializer = [&graph](std::string const& name, Constant& constant) {
+        ProtoMessage tensor;
+        return graph.isInitializer(name) && tensor.parse(graph.initializers[name]) && readConstant(tensor, constant)
+            && constant.dataType == onnx::kDATA_TYPE_FLOAT;
+    };
+
+    for (size_t n = 0; n < graph.nodes.size(); ++n)
+    {
+        ProtoMessage const& norm = graph.nodes[n];
+        std::vector<std::string> const normInputs = norm.getStrings(onnx::kNODE_INPUT);
+        std::vector<std::string> const normOutputs = norm.getStrings(onnx::kNODE_OUTPUT);
+        if (norm.getString(onnx::kNODE_OP_TYPE) != "BatchNormalization" || normInputs.size() != 5
+            || normOutputs.size() != 1)
+        {
+            continue;
+        }
+        auto const producer = producers.find(normInputs[0]);
+        if (producer == producers.end() || removed[producer->second] || graph.outputs.count(normInputs[0])
+            || consumers.at(normInputs[0]) != 1)
+        {
+            continue;
+        }
+        ProtoMessage& conv = graph.nodes[producer->second];
+        std::string const op = conv.getString(onnx::kNODE_OP_TYPE);
+        std::vector<std::string> convInputs = conv.getStrings(onnx::kNODE_INPUT);
+        bool const transposed = op == "ConvTranspose";
+        int64_t const group = getIntAttribute(conv, "group", 1);
+        Constant weights;
+        if ((op != "Conv" && !transposed) || (transposed && group != 1) || convInputs.size() < 2
+            || !readInitializer(convInputs[1], weights) || weights.dims.size() < 3)
+        {
+            continue;
+        }
+
+        int64_t const outChannels = transposed ? weights.dims[1] : weights.dims[0];
+        Constant params[4];
+        bool valid = true;
+        for (int32_t i = 0; i < 4; ++i)
+        {
+            valid = valid && readInitializer(normInputs[i + 1], params[i])
+                && static_cast<int64_t>(params[i].values.size()) == outChannels;
+        }
+        Constant bias;
+        if (convInputs.size() > 2 && !convInputs[2].empty())
+        {
+            valid = valid && readInitializer(convInputs[2], bias)
+                && static_cast<int64_t>(bias.values.size()) == outChannels;
+        }
+        else
+        {
+            bias.dims = {outChannels};
+            bias.values.assign(outChannels, 0.0);
+        }
+        if (!valid)
+        {
+            continue;
+        }
+
+        // The factors are rounded to float as the runtimes would, the folded values are rounded once
+        float const epsilon = getAttribute(norm, "epsilon").getFloat(onnx::kATTRIBUTE_FLOAT, 1e-5f);
+        std::vector<double> scale(outChannels);
+        for (int64_t c = 0; c < outChannels; ++c)
+        {
+            scale[c] = params[0].values[c] / std::sqrt(params[3].values[c] + epsilon);
+            bias.values[c] = (bias.values[c] - params[2].values[c]) * scale[c] + params[1].values[c];
+        }
+        int64_t const kernelSize = getVolume(weights.dims) / (weights.dims[0] * weights.dims[1]);
+        int64_t const perOutput = getVolume(weights.dims) / weights.dims[0];
+        for (size_t i = 0; i < weights.values.size(); ++i)
+        {
+            int64_t const c = transposed ? static_cast<int64_t>(i) / kernelSize % outChannels
+                                         : static_cast<int64_t>(i) / perOutput;
+            weights.values[i] *= scale[c];
+        }
+
+        std::string const weightsName = graph.makeUniqueName(normOutputs[0] + "_weights");
+        graph.addInitializer(weightsName, writeConstant(weightsName, weights));
+        std::string const biasName = graph.makeUniqueName(normOutputs[0] + "_bias");
+        graph.addInitializer(biasName, writeConstant(biasName, bias));
+        convInputs.resize(3);
+        convInputs[1] = weightsName;
+        convInputs[2] = biasName;
+        setStrings(conv, onnx::kNODE_INPUT, convInputs);
+        std::vector<std::string> convOutputs = conv.getStrings(onnx::kNODE_OUTPUT);
+        convOutputs[0] = normOutputs[0];
+        setStrings(conv, onnx::kNODE_OUTPUT, convOutputs);
+        removed[n] = true;
+    }
+
+    std::vector<ProtoMessage> kept;
+    for (size_t n = 0; n < graph.nodes.size(); ++n)
+    {
+        if (!removed[n])
+        {
+            kept.push_back(std::move(graph.nodes[n]));
+        }
+    }
+    graph.nodes = std::move(kept);
+    return static_cast<int32_t>(std::count(removed.begin(), removed.end(), true));
+}
+
+//!
+//! \brief Makes the nodes read the first of the initializers holding the same tensor.
+//!
+//! \return the number of initializers merged into another one
+//!
+int32_t mergeInitializers(Graph& graph)
+{
+    std::map<std::string, std::string> firstOfContent;
+    std::map<std::string, std::string> renames;
+    for (auto const& name : graph.initializerNames)
+    {
+        auto const initializer = graph.initializers.find(name);
+        if (initializer == graph.initializers.end() || graph.outputs.count(name))
+        {
+            continue;
+        }
+        // The content is the tensor without its name
+        ProtoMessage tensor;
+        tensor.parse(initializer->second);
+        tensor.removeFields(onnx::kTENSOR_NAME);
+        std::string const content = tensor.serialize();
+        auto const first = firstOfContent.find(content);
+        if (first == firstOfContent.end())
+        {
+            firstOfContent[content] = name;
+        }
+        else
+        {
+            renames[name] = first->second;
+        }
+    }
+    for (auto const& rename : renames)
+    {
+        graph.initializers.erase(rename.first);
+    }
+    graph.renameInputs(renames);
+    return static_cast<int32_t>(renames.size());
+}
+
+} // namespace
+
+bool optimizeGraph(ProtoMessage& model, OptimizeOptions const& options, OptimizeResult& result)
+{
+    result = OptimizeResult();
+    Graph graph;
+    if (!readGraph(model, graph))
+    {
+        return false;
+    }
+    int32_t const nodesBefore = static_cast<int32_t>(graph.nodes.size());
+    int32_t const initializersBefore = static_cast<int32_t>(graph.initializers.size());
+    int64_t initializerBytesBefore = 0;
+    for (auto const& initializer : graph.initializers)
+    {
+        initializerBytesBefore += initializer.second.size();
+    }
+
+    std::vector<std::string> outputs = options.outputs;
+    if (outputs.empty() && !getGraphOutputs(model, outputs))
+    {
+        return false;
+    }
+
+    // Removing an identity may make a node constant and folding constants may leave identities
+    for (bool changed = true; changed;)
+    {
+        int32_t const folded = options.foldConstants ? foldConstants(graph) : 0;
+        int32_t const identities = options.removeIdentities ? removeIdentities(graph) : 0;
+        int32_t const reshapes = options.removeIdentities ? collapseReshapes(graph) : 0;
+        result.foldedConstants += folded;
+        result.removedIdentities += identities;
+        result.collapsedReshapes += reshapes;
+        changed = folded + identities + reshapes > 0;
+    }
+    if (options.foldBatchNorms)
+    {
+        result.foldedBatchNorms = foldBatchNorms(graph);
+    }
+    if (options.mergeInitializers)
+    {
+        result.mergedInitializers = mergeInitializers(graph);
+    }
+    writeGraph(graph, model);
+
+    // Dead nodes left by the passes, the weights they replaced and the outputs not asked for go away
+    if (!pruneGraph(model, outputs, result.pruned))
+    {
+        return false;
+    }
+    result.pruned.nodesBefore = nodesBefore;
+    result.pruned.initializersBefore = initializersBefore;
+    result.pruned.initializerBytesBefore = initializerBytesBefore;
+    return true;
+}
+
+std::string formatNormalization(NormalizeParams const& params)
+{
+    // 9 significant digits read back as the same float
+    std::ostringstream text;
+    text << std::setprecision(9) << "mean=" << params.mean[0] << "," << params.mean[1] << "," << params.mean[2]
+         << " std=" << params.std[0] << "," << params.std[1] << "," << params.std[2]
+         << " swap=" << (params.swapChannels ? 1 : 0);
+    return text.str();
+}
+
+bool parseNormalization(std::string const& text, NormalizeParams& params)
+{
+    NormalizeParams parsed;
+    int32_t swap = 0;
+    if (std::sscanf(text.c_str(), "mean=%f,%f,%f std=%f,%f,%f swap=%d", &parsed.mean[0], &parsed.mean[1],
+            &parsed.mean[2], &parsed.std[0], &parsed.std[1], &parsed.std[2], &swap)
+            != 7
+        || (swap != 0 && swap != 1) || !(parsed.std[0] > 0.f && parsed.std[1] > 0.f && parsed.std[2] > 0.f))
+    {
+        return false;
+    }
+    parsed.swapChannels = swap != 0;
+    params = parsed;
+    return true;
+}
+
+bool getInputNormalization(ProtoMessage const& model, NormalizeParams& params)
+{
+    params = NormalizeParams();
+    std::string value;
+    if (getMetadata(model, kINPUT_NORMALIZATION_KEY, value) && !parseNormalization(value, params))
+    {
+        sample::gLogError << "Invalid " << kINPUT_NORMALIZATION_KEY << " metadata: " << value << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool foldInputNormalization(ProtoMessage& model, NormalizeParams const& params, int32_t& foldedConvs)
+{
+    foldedConvs = 0;
+    std::string existing;
+    if (getMetadata(model, kINPUT_NORMALIZATION_KEY, existing))
+    {
+        sample::gLogError << "The model already expects the input normalization " << existing << std::endl;
+        return false;
+    }
+    std::vector<std::string> inputNames;
+    std::vector<std::vector<int64_t>> inputDims;
+    Graph graph;
+    if (!getGraphInputs(model, inputNames, inputDims) || !readGraph(model, graph))
+    {
+        return false;
+    }
+    if (inputNames.size() != 1 || inputDims[0].size() != 4 || inputDims[0][1] != 3
+        || graph.outputs.count(inputNames[0]))
+    {
+        sample::gLogError << "The normalization can only be folded into a model with a single NCHW input of 3 "
+                             "channels"
+                          << std::endl;
+        return false;
+    }
+    std::string const& input = inputNames[0];
+    bool const centered = params.mean[0] != 0.f || params.mean[1] != 0.f || params.mean[2] != 0.f;
+
+    for (auto& conv : graph.nodes)
+    {
+        std::vector<std::string> convInputs = conv.getStrings(onnx::kNODE_INPUT);
+        if (std::find(convInputs.begin(), convInputs.end(), input) == convInputs.end())
+        {
+            continue;
+        }
+        std::vector<int64_t> const pads = getAttribute(conv, "pads").getInts(onnx::kATTRIBUTE_INTS);
+        std::string const autoPad = getAttribute(conv, "auto_pad").getString(onnx::kATTRIBUTE_STRING);
+        bool const padded = std::any_of(pads.begin(), pads.end(), [](int64_t pad) { return pad != 0; })
+            || (!autoPad.empty() && autoPad != "NOTSET" && autoPad != "VALID");
+        Constant weights;
+        ProtoMessage tensor;
+        if (conv.getString(onnx::kNODE_OP_TYPE) != "Conv" || convInputs[0] != input
+            || std::count(convInputs.begin(), convInputs.end(), input) != 1 || getIntAttribute(conv, "group", 1) != 1
+            || !graph.isInitializer(convInputs[1]) || !tensor.parse(graph.initializers[convInputs[1]])
+            || !readConstant(tensor, weights) || weights.dataType != onnx::kDATA_TYPE_FLOAT
+            || weights.dims.size() != 4 || weights.dims[1] != 3)
+        {
+            sample::gLogError << "The input " << input << " is read by a node other than a Conv with constant "
+                                 "weights, the normalization cannot be folded"
+                              << std::endl;
+            return false;
+        }
+        if (centered && padded)
+        {
+            sample::gLogError << "The Conv reading " << input << " pads its input, a mean cannot be folded into it"
+                              << std::endl;
+            return false;
+        }
+
+        int64_t const outChannels = weights.dims[0];
+        Constant bias;
+        tensor = ProtoMessage();
+        if (convInputs.size() > 2 && !convInputs[2].empty())
+        {
+            if (!graph.isInitializer(convInputs[2]) || !tensor.parse(graph.initializers[convInputs[2]])
+                || !readConstant(tensor, bias) || static_cast<int64_t>(bias.values.size()) != outChannels)
+            {
+                sample::gLogError << "The bias of the Conv reading " << input << " is not constant" << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            bias.dims = {outChannels};
+            bias.values.assign(outChannels, 0.0);
+        }
+
+        // Source channel c of the image feeds the channel m the model was trained with
+        Constant folded = weights;
+        int64_t const kernelSize = weights.dims[2] * weights.dims[3];
+        for (int64_t o = 0; o < outChannels; ++o)
+        {
+            for (int32_t c = 0; c < 3; ++c)
+            {
+                int32_t const m = params.swapChannels ? 2 - c : c;
+                double const scale = 1.0 / (255.0 * params.std[c]);
+                double const shift = params.mean[c] / params.std[c];
+                for (int64_t k = 0; k < kernelSize; ++k)
+                {
+                    double const w = weights.values[(o * 3 + m) * kernelSize + k];
+                    folded.values[(o * 3 + c) * kernelSize + k] = w * scale;
+                    bias.values[o] -= w * shift;
+                }
+            }
+        }
+
+        std::string const output = conv.getStrings(onnx::kNODE_OUTPUT).front();
+        std::string const weightsName = graph.makeUniqueName(output + "_weights");
+        graph.addInitializer(weightsName, writeConstant(weightsName, folded));
+        std::string const biasName = graph.makeUniqueName(output + "_bias");
+        graph.addInitializer(biasName, writeConstant(biasName, bias));
+        convInputs.resize(3);
+        convInputs[1] = weightsName;
+        convInputs[2] = biasName;
+        setStrings(conv, onnx::kNODE_INPUT, convInputs);
+        ++foldedConvs;
+    }
+    if (foldedConvs == 0)
+    {
+        sample::gLogError << "No Conv reads the input " << input << std::endl;
+        return false;
+    }
+    writeGraph(graph, model);
+
+    // The former weights go away unless other nodes share them
+    PruneResult pruned;
+    std::vector<std::string> outputs;
+    if (!getGraphOutputs(model, outputs) || !pruneGraph(model, outputs, pruned))
+    {
+        return false;
+    }
+
+    NormalizeParams raw;
+    std::fill(raw.std, raw.std + 3, 1.f / 255.f);
+    setMetadata(model, kINPUT_NORMALIZATION_KEY, formatNormalization(raw));
+    return true;
+}
+
+} // namespace pinet
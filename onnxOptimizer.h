@@ -0,0 +1,100 @@
+#ifndef PINET_ONNX_OPTIMIZER_H
+#define PINET_ONNX_OPTIMIZER_H
+
+#include "onnxModel.h"
+#include "preprocess.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief The OptimizeOptions structure selects the passes optimizeGraph() runs.
+//!
+struct OptimizeOptions
+{
+    std::vector<std::string> outputs; //!< Outputs the model keeps, empty for all graph outputs
+    bool foldConstants{true};         //!< Compute the nodes whose inputs are all constant
+    bool removeIdentities{true};      //!< Bypass Identity and Dropout nodes and collapse chains of reshapes
+    bool foldBatchNorms{true};        //!< Fold BatchNormalization into the Conv or ConvTranspose before it
+    bool mergeInitializers{true};     //!< Keep one of the initializers holding the same tensor
+};
+
+//!
+//! \brief The OptimizeResult structure counts what optimizeGraph() changed.
+//!
+struct OptimizeResult
+{
+    int32_t foldedConstants{0};    //!< Nodes replaced by the initializer they compute
+    int32_t removedIdentities{0};  //!< Identity and Dropout nodes bypassed
+    int32_t collapsedReshapes{0};  //!< Reshapes reading the input of the reshape before them instead of its output
+    int32_t foldedBatchNorms{0};   //!< BatchNormalization nodes folded into a convolution
+    int32_t mergedInitializers{0}; //!< Initializers replaced by an identical one
+    PruneResult pruned;            //!< Nodes and initializers before the passes and after dropping the dead ones
+};
+
+//!
+//! \brief Rewrites the graph of model into an equivalent one which is smaller and quicker to parse and build.
+//!
+//! \details The passes run in this order, on the CPU and without any ONNX library:
+//!          - Constant nodes become initializers, and nodes of common shape and arithmetic operators whose
+//!            inputs are all initializers are computed into one. Shape is computed when the shape of its input
+//!            is fixed by the graph inputs or value infos.
+//!          - Identity and Dropout nodes are bypassed, and a Reshape to a constant shape reads the input of a
+//!            Reshape, Flatten, Squeeze or Unsqueeze before it rather than its output.
+//!          - A BatchNormalization following a Conv or ConvTranspose which nothing else reads is folded into
+//!            new weights and bias of the convolution.
+//!          - Initializers with the same type, dimensions and data are merged into the first one.
+//!          - Nodes, initializers, inputs and value infos which none of the outputs depends on are dropped
+//!            with pruneGraph().
+//!          Graph outputs keep their names, so the model runs with the same output names as before.
+//!
+//! \return false if the graph cannot be parsed or an output is not part of it
+//!
+bool optimizeGraph(ProtoMessage& model, OptimizeOptions const& options, OptimizeResult& result);
+
+//!
+//! \brief Key of the model metadata giving the normalization the input of the model expects.
+//!
+constexpr char const* kINPUT_NORMALIZATION_KEY = "pinet.input_normalization";
+
+//!
+//! \brief Formats params as the value of kINPUT_NORMALIZATION_KEY, e.g. "mean=0,0,0 std=1,1,1 swap=0".
+//!
+std::string formatNormalization(NormalizeParams const& params);
+
+//!
+//! \return false if text is not formatted as by formatNormalization() or a std is not positive
+//!
+bool parseNormalization(std::string const& text, NormalizeParams& params);
+
+//!
+//! \brief Returns the preprocessing the input of model expects, the plain division by 255 unless the metadata
+//!        of the model records another one.
+//!
+//! \return false if the metadata entry cannot be parsed
+//!
+bool getInputNormalization(ProtoMessage const& model, NormalizeParams& params);
+
+//!
+//! \brief Folds the normalization of the input into the convolutions reading it, so that the model takes pixel
+//!        values from 0 to 255 in the channel order of the images.
+//!
+//! \param params Normalization the model was trained with, which the runtime no longer applies.
+//!
+//! \details The weights of each Conv reading the input are divided by 255 * std and their input channels
+//!          reordered. A mean is subtracted through the bias, which is only exact if the convolution does not
+//!          pad its input: padding with zeros would no longer stand for the mean, so a mean is refused then.
+//!          The metadata entry kINPUT_NORMALIZATION_KEY records the preprocessing the model expects afterwards,
+//!          a std of 1/255 which turns the normalization into a plain uint8 to float conversion.
+//!
+//! \return false if the input is not read by convolutions only, or the normalization is already folded
+//!
+bool foldInputNormalization(ProtoMessage& model, NormalizeParams const& params, int32_t& foldedConvs);
+
+} // namespace pinet
+
+#endif // PINET_ONNX_OPTIMIZER_H
@@ -0,0 +1,154 @@
+#include "opencvBackend.h"
+#include "logger.h"
+#include "onnxModel.h"
+#include "stageTiming.h"
+
+#include <cstring>
+
+namespace pinet
+{
+
+char const* toString(DnnTarget target)
+{
+    switch (target)
+    {
+    case DnnTarget::kCPU: return "cpu";
+    case DnnTarget::kOPENCL: return "opencl";
+    case DnnTarget::kOPENCL_FP16: return "opencl_fp16";
+    case DnnTarget::kCUDA: return "cuda";
+    case DnnTarget::kCUDA_FP16: return "cuda_fp16";
+    }
+    return "unknown";
+}
+
+bool parseDnnTarget(std::string const& name, DnnTarget& target)
+{
+    for (auto const candidate :
+        {DnnTarget::kCPU, DnnTarget::kOPENCL, DnnTarget::kOPENCL_FP16, DnnTarget::kCUDA, DnnTarget::kCUDA_FP16})
+    {
+        if (name == toString(candidate))
+        {
+            target = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OpenCVBackend::load()
+{
+    // cv::dnn only knows the input shape once it is given a blob, it is read from the model instead
+    ProtoMessage model;
+    std::vector<std::string> inputNames;
+    std::vector<std::vector<int64_t>> inputDims;
+    if (!readModel(mFileName, model) || !getGraphInputs(model, inputNames, inputDims))
+    {
+        return false;
+    }
+    if (inputNames.size() != 1 || inputDims[0].size() != 4)
+    {
+        sample::gLogError << "The opencv backend needs a single NCHW input, " << mFileName << " does not have one"
+                          << std::endl;
+        return false;
+    }
+    mInput.name = inputNames[0];
+    mInput.dims.assign(inputDims[0].begin(), inputDims[0].end());
+    mInput.dims[0] = mBatchSize;
+    mInputBuffer.assign(mInput.volume(), 0.f);
+
+    try
+    {
+        mNet = cv::dnn::readNetFromONNX(mFileName);
+        switch (mTarget)
+        {
+        case DnnTarget::kCPU:
+            mNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            mNet.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+            break;
+        case DnnTarget::kOPENCL:
+            mNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            mNet.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
+            break;
+        case DnnTarget::kOPENCL_FP16:
+            mNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+            mNet.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL_FP16);
+            break;
+        case DnnTarget::kCUDA:
+            mNet.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+            mNet.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+            break;
+        case DnnTarget::kCUDA_FP16:
+            mNet.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+            mNet.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA_FP16);
+            break;
+        }
+    }
+    catch (cv::Exception const& e)
+    {
+        sample::gLogError << "cv::dnn cannot import " << mFileName << ": " << e.what() << std::endl;
+        return false;
+    }
+    if (mNet.empty())
+    {
+        sample::gLogError << "cv::dnn cannot import " << mFileName << std::endl;
+        return false;
+    }
+
+    // The first pass allocates the blobs and fuses the layers, outputs keep their shape afterwards
+    if (!forward())
+    {
+        return false;
+    }
+    mOutputs.clear();
+    mOutputBuffers.clear();
+    for (size_t o = 0; o < mBlobs.size(); ++o)
+    {
+        cv::Mat const& blob = mBlobs[o];
+        if (blob.dims != 4 || blob.size[0] != mBatchSize || blob.type() != CV_32F)
+        {
+            sample::gLogError << "Output " << mOutputNames[o] << " of " << mFileName
+                              << " is not a batch of CHW floats" << std::endl;
+            return false;
+        }
+        mOutputs.push_back(TensorDesc{mOutputNames[o], {blob.size[0], blob.size[1], blob.size[2], blob.size[3]}});
+        mOutputBuffers.emplace_back(mOutputs.back().volume(), 0.f);
+    }
+    return true;
+}
+
+bool OpenCVBackend::forward()
+{
+    try
+    {
+        // The blob wraps the input buffer without a copy, setInput copies it into the net
+        int32_t const dimCount = static_cast<int32_t>(mInput.dims.size());
+        cv::Mat const input(dimCount, mInput.dims.data(), CV_32F, mInputBuffer.data());
+        mNet.setInput(input);
+        mNet.forward(mBlobs, mOutputNames);
+    }
+    catch (cv::Exception const& e)
+    {
+        sample::gLogError << "cv::dnn failed to run " << mFileName << ": " << e.what() << std::endl;
+        return false;
+    }
+    return mBlobs.size() == mOutputNames.size();
+}
+
+bool OpenCVBackend::infer()
+{
+    // With an OpenCL or CUDA target the copies to and from the device are part of the forward pass
+    auto const start = Clock::now();
+    if (!forward())
+    {
+        return false;
+    }
+    for (size_t o = 0; o < mBlobs.size(); ++o)
+    {
+        cv::Mat const blob = mBlobs[o].isContinuous() ? mBlobs[o] : mBlobs[o].clone();
+        std::memcpy(mOutputBuffers[o].data(), blob.ptr<float>(), mOutputBuffers[o].size() * sizeof(float));
+    }
+    mLastTiming.execute = elapsedMs(start);
+    return true;
+}
+
+} // namespace pinet
@@ -0,0 +1,115 @@
+#ifndef PINET_OPENCV_BACKEND_H
+#define PINET_OPENCV_BACKEND_H
+
+#include "inferenceBackend.h"
+
+#include <opencv2/dnn.hpp>
+
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Devices and precisions cv::dnn runs the network with.
+//!
+enum class DnnTarget : int32_t
+{
+    kCPU,         //!< The OpenCV layers on the CPU
+    kOPENCL,      //!< The OpenCV layers as OpenCL kernels, falling back to the CPU without an OpenCL device
+    kOPENCL_FP16, //!< The OpenCV layers as OpenCL kernels in half precision
+    kCUDA,        //!< The CUDA backend of cv::dnn, falling back to the CPU if OpenCV was built without it
+    kCUDA_FP16,   //!< The CUDA backend in half precision
+};
+
+//!
+//! \brief Returns the name of target.
+//!
+char const* toString(DnnTarget target);
+
+//!
+//! \return false if name is none of cpu, opencl, opencl_fp16, cuda and cuda_fp16
+//!
+bool parseDnnTarget(std::string const& name, DnnTarget& target);
+
+//!
+//! \brief  The OpenCVBackend class runs the ONNX model with cv::dnn.
+//!
+//! \details It serves as a fallback on machines without TensorRT and as an executor independent of it to
+//!          cross-check the outputs with. Each backend imports the model into its own cv::dnn::Net, which
+//!          is not safe to run from several threads at once. The input buffer is handed to the net as a
+//!          blob without a copy and the outputs are copied from the blobs cv::dnn returns. cv::dnn spreads
+//!          the work of each layer over the threads set with cv::setNumThreads, which are shared by all
+//!          nets of the process.
+//!
+class OpenCVBackend : public InferenceBackend
+{
+public:
+    //!
+    //! \param outputNames Outputs of the model in the order the backend returns them.
+    //!
+    OpenCVBackend(std::string const& fileName, std::vector<std::string> const& outputNames, int32_t batchSize,
+        DnnTarget target)
+        : mFileName(fileName)
+        , mOutputNames(outputNames)
+        , mBatchSize(batchSize)
+        , mTarget(target)
+    {
+    }
+
+    //!
+    //! \brief Imports the model and runs it once on a zero input to set it up and find the output shapes.
+    //!
+    //! \return false if the model cannot be imported or run, or an output is not an NCHW tensor
+    //!
+    bool load();
+
+    std::string getName() const override
+    {
+        return "opencv";
+    }
+
+    TensorDesc const& getInput() const override
+    {
+        return mInput;
+    }
+
+    std::vector<TensorDesc> const& getOutputs() const override
+    {
+        return mOutputs;
+    }
+
+    float* getInputBuffer() override
+    {
+        return mInputBuffer.data();
+    }
+
+    float const* getOutputBuffer(int32_t index) const override
+    {
+        return mOutputBuffers[index].data();
+    }
+
+    bool infer() override;
+
+private:
+    //!
+    //! \brief Runs the net on the input buffer into mBlobs.
+    //!
+    bool forward();
+
+    std::string mFileName;
+    std::vector<std::string> mOutputNames;
+    int32_t mBatchSize;
+    DnnTarget mTarget;
+    cv::dnn::Net mNet;
+    TensorDesc mInput;
+    std::vector<TensorDesc> mOutputs;
+    std::vector<float> mInputBuffer;
+    std::vector<std::vector<float>> mOutputBuffers;
+    std::vector<cv::Mat> mBlobs; //!< Outputs of the last forward pass, owned by the net
+};
+
+} // namespace pinet
+
+#endif // PINET_OPENCV_BACKEND_H
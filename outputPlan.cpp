@@ -0,0 +1,91 @@
+#include "outputPlan.h"
+
+#include <algorithm>
+
+namespace pinet
+{
+
+char const* toString(OutputSelection selection)
+{
+    switch (selection)
+    {
+    case OutputSelection::kLANES: return "lanes";
+    case OutputSelection::kALL: return "all";
+    }
+    return "unknown";
+}
+
+bool parseOutputSelection(std::string const& name, OutputSelection& selection)
+{
+    for (auto const candidate : {OutputSelection::kLANES, OutputSelection::kALL})
+    {
+        if (name == toString(candidate))
+        {
+            selection = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool planOutputs(std::vector<std::string> const& networkOutputs, std::vector<std::string> const& laneOutputs,
+    OutputSelection selection, OutputPlan& plan)
+{
+    for (auto const& name : laneOutputs)
+    {
+        if (std::find(networkOutputs.begin(), networkOutputs.end(), name) == networkOutputs.end())
+        {
+            return false;
+        }
+    }
+
+    plan.bound.clear();
+    plan.unmarked.clear();
+    for (auto const& name : networkOutputs)
+    {
+        bool const read = std::find(laneOutputs.begin(), laneOutputs.end(), name) != laneOutputs.end();
+        if (read || selection == OutputSelection::kALL)
+        {
+            plan.bound.push_back(name);
+        }
+        else
+        {
+            plan.unmarked.push_back(name);
+        }
+    }
+    return true;
+}
+
+bool findLaneHeads(std::vector<TensorDesc> const& outputs, std::vector<std::string> const& laneOutputs,
+    LaneHeads& heads)
+{
+    if (laneOutputs.size() != 3)
+    {
+        return false;
+    }
+
+    int32_t* indices[3] = {&heads.confidence, &heads.offset, &heads.instance};
+    for (int32_t h = 0; h < 3; ++h)
+    {
+        auto const found = std::find_if(outputs.begin(), outputs.end(),
+            [&laneOutputs, h](TensorDesc const& desc) { return desc.name == laneOutputs[h]; });
+        if (found == outputs.end())
+        {
+            return false;
+        }
+        *indices[h] = static_cast<int32_t>(found - outputs.begin());
+    }
+    return true;
+}
+
+int64_t getOutputBytes(std::vector<TensorDesc> const& outputs)
+{
+    int64_t bytes = 0;
+    for (auto const& output : outputs)
+    {
+        bytes += output.volume() * static_cast<int64_t>(sizeof(float));
+    }
+    return bytes;
+}
+
+} // namespace pinet
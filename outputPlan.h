@@ -0,0 +1,73 @@
+#ifndef PINET_OUTPUT_PLAN_H
+#define PINET_OUTPUT_PLAN_H
+
+#include "inferenceBackend.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Which network outputs are kept marked, and thereby get buffers and are copied back to the host.
+//!
+enum class OutputSelection : int32_t
+{
+    kLANES, //!< Only the outputs read by post-processing
+    kALL    //!< All outputs, e.g. to record them
+};
+
+char const* toString(OutputSelection selection);
+
+//!
+//! \brief Parses lanes or all.
+//!
+bool parseOutputSelection(std::string const& name, OutputSelection& selection);
+
+//!
+//! \brief The LaneHeads structure holds the index of each output read by post-processing among the outputs
+//!        of a backend.
+//!
+struct LaneHeads
+{
+    int32_t confidence{-1};
+    int32_t offset{-1};
+    int32_t instance{-1};
+};
+
+//!
+//! \brief The OutputPlan structure splits the outputs of the network into those kept and those unmarked.
+//!
+struct OutputPlan
+{
+    std::vector<std::string> bound;    //!< Outputs kept marked, in network order
+    std::vector<std::string> unmarked; //!< Outputs unmarked when constructing the network
+};
+
+//!
+//! \brief Plans the outputs of the network given the names of the confidence, offset and instance
+//!        outputs read by post-processing.
+//!
+//! \return false if one of laneOutputs is not an output of the network
+//!
+bool planOutputs(std::vector<std::string> const& networkOutputs, std::vector<std::string> const& laneOutputs,
+    OutputSelection selection, OutputPlan& plan);
+
+//!
+//! \brief Finds the outputs named laneOutputs, in confidence, offset, instance order, among outputs.
+//!
+//! \return false if one of them is missing
+//!
+bool findLaneHeads(std::vector<TensorDesc> const& outputs, std::vector<std::string> const& laneOutputs,
+    LaneHeads& heads);
+
+//!
+//! \brief Returns the number of bytes of outputs, i.e. their host buffers and device to host copies.
+//!
+int64_t getOutputBytes(std::vector<TensorDesc> const& outputs);
+
+} // namespace pinet
+
+#endif // PINET_OUTPUT_PLAN_H
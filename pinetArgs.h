@@ -0,0 +1,409 @@
+#ifndef PINET_ARGS_H
+#define PINET_ARGS_H
+
+#include "annotationWriter.h"
+#include "argsParser.h"
+#include "inputCache.h"
+#include "opencvBackend.h"
+#include "outputPlan.h"
+#include "videoSource.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+#if PINET_WITH_TENSORRT
+constexpr char const* kDEFAULT_BACKEND = "tensorrt"; //!< Backend run without --backend
+#else
+constexpr char const* kDEFAULT_BACKEND = "cpu"; //!< Backend run without --backend, tensorrt is not built
+#endif
+
+//!
+//! \brief The Args structure extends the common sample arguments with the PINet specific ones.
+//!
+struct Args : public samplesCommon::Args
+{
+    std::string backend{kDEFAULT_BACKEND}; //!< Inference backend, tensorrt, cpu, opencv or replay
+    std::vector<std::string> shards; //!< Shards of packed images, read before the data directories
+    std::string recordOutputs;       //!< File the network outputs are recorded to
+    std::string replayOutputs;       //!< Recording replayed by the replay backend
+    int32_t decodeThreads{1};        //!< Number of workers of the decode stage
+    bool fullDecode{false};          //!< Decode images at full size instead of letting the JPEG decoder reduce them
+    std::string inputCache;          //!< Directory of the cached network inputs, empty to always preprocess
+    InputCacheFormat inputCacheFormat{InputCacheFormat::kUINT8}; //!< Element type of the cached inputs
+    int32_t inputCacheSize{4096};    //!< Size in MiB the cached inputs take at most
+    int32_t preprocessThreads{1};    //!< Number of workers of the preprocess stage
+    int32_t inferThreads{1};         //!< Number of workers of the infer stage
+    int32_t cpuThreads{0};           //!< Threads of each cpu backend, 0 to share the cores among the infer workers
+    DnnTarget dnnTarget{DnnTarget::kCPU}; //!< Device and precision of the opencv backend
+    int32_t dnnThreads{0};           //!< Threads cv::dnn runs on, 0 for the OpenCV default
+    int32_t postprocessThreads{1};   //!< Number of workers of the postprocess stage
+    int32_t queueSize{4};            //!< Capacity of the queues between stages
+    std::string engineCache;         //!< Directory of the serialized engines, empty to always build
+    OutputSelection outputSelection{OutputSelection::kLANES}; //!< Outputs kept by the network
+    std::string onnx{"pinet.onnx"};  //!< ONNX model the engine is built from
+    int32_t stack{2};                //!< Hourglass stack, 1 or 2, whose outputs post-processing reads
+    int32_t scanThreads{2};          //!< Number of threads listing the data directories
+    bool sortFiles{true};            //!< Process the images in name order rather than as they are found
+    std::string video;               //!< Video file, camera or synthetic source read instead of images
+    VideoOptions videoOptions;       //!< Overload policy, buffering and length of the video source
+    int32_t trackInterval{0};        //!< Frames of a clip between two inferred frames, 0 to infer every frame
+    float trackConfidence{0.5f};     //!< Tracking confidence below which the next frame is inferred
+    int32_t fitDegree{0};            //!< Degree of the polynomials lane lines are fitted with, 0 to skip fitting
+    std::string laneModels;          //!< File the fitted lane models are written to
+    AnnotationOptions annotation;    //!< Sampling and output directory of the annotated images
+    bool show{false};                //!< Show every annotated image in a window
+};
+
+//!
+//! \brief Long options without a short equivalent.
+//!
+enum LongOption : int32_t
+{
+    kOPT_BACKEND = 256,
+    kOPT_RECORD_OUTPUTS,
+    kOPT_REPLAY_OUTPUTS,
+    kOPT_DECODE_THREADS,
+    kOPT_PREPROCESS_THREADS,
+    kOPT_INFER_THREADS,
+    kOPT_POSTPROCESS_THREADS,
+    kOPT_QUEUE_SIZE,
+    kOPT_ENGINE_CACHE,
+    kOPT_NO_ENGINE_CACHE,
+    kOPT_OUTPUTS,
+    kOPT_ONNX,
+    kOPT_STACK,
+    kOPT_SCAN_THREADS,
+    kOPT_UNSORTED,
+    kOPT_FULL_DECODE,
+    kOPT_SHARD,
+    kOPT_INPUT_CACHE,
+    kOPT_INPUT_CACHE_FORMAT,
+    kOPT_INPUT_CACHE_SIZE,
+    kOPT_VIDEO,
+    kOPT_VIDEO_POLICY,
+    kOPT_VIDEO_BUFFER,
+    kOPT_VIDEO_FRAMES,
+    kOPT_VIDEO_REALTIME,
+    kOPT_TRACK,
+    kOPT_TRACK_CONFIDENCE,
+    kOPT_FIT_LANES,
+    kOPT_LANE_MODELS,
+    kOPT_SAVE_OUTPUTS,
+    kOPT_SAVE_EVERY,
+    kOPT_SAVE_ANOMALIES,
+    kOPT_SAVE_THREADS,
+    kOPT_SAVE_QUEUE,
+    kOPT_SHOW,
+    kOPT_CPU_THREADS,
+    kOPT_DNN_TARGET,
+    kOPT_DNN_THREADS,
+};
+
+//!
+//! \brief Parses a strictly positive integer option.
+//!
+inline bool parsePositive(char const* name, char const* value, int32_t& result)
+{
+    result = value ? std::atoi(value) : 0;
+    if (result <= 0)
+    {
+        std::cerr << "ERROR: --" << name << " requires a positive integer" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief Populates the Args struct with the provided command-line parameters.
+//!
+//! \return boolean If return value is true, execution can continue, otherwise program should exit
+//!
+inline bool parseArgs(Args& args, int32_t argc, char* argv[])
+{
+    while (1)
+    {
+        int32_t arg;
+        static struct option long_options[] = {{"help", no_argument, 0, 'h'}, {"datadir", required_argument, 0, 'd'},
+            {"int8", no_argument, 0, 'i'}, {"fp16", no_argument, 0, 'f'}, {"saveEngine", required_argument, 0, 's'},
+            {"loadEngine", required_argument, 0, 'o'}, {"useDLACore", required_argument, 0, 'u'},
+            {"batch", required_argument, 0, 'b'}, {"backend", required_argument, 0, kOPT_BACKEND},
+            {"recordOutputs", required_argument, 0, kOPT_RECORD_OUTPUTS},
+            {"replayOutputs", required_argument, 0, kOPT_REPLAY_OUTPUTS},
+            {"decodeThreads", required_argument, 0, kOPT_DECODE_THREADS},
+            {"preprocessThreads", required_argument, 0, kOPT_PREPROCESS_THREADS},
+            {"inferThreads", required_argument, 0, kOPT_INFER_THREADS},
+            {"postprocessThreads", required_argument, 0, kOPT_POSTPROCESS_THREADS},
+            {"queueSize", required_argument, 0, kOPT_QUEUE_SIZE},
+            {"engineCache", required_argument, 0, kOPT_ENGINE_CACHE},
+            {"noEngineCache", no_argument, 0, kOPT_NO_ENGINE_CACHE},
+            {"outputs", required_argument, 0, kOPT_OUTPUTS}, {"onnx", required_argument, 0, kOPT_ONNX},
+            {"stack", required_argument, 0, kOPT_STACK}, {"scanThreads", required_argument, 0, kOPT_SCAN_THREADS},
+            {"unsorted", no_argument, 0, kOPT_UNSORTED}, {"fullDecode", no_argument, 0, kOPT_FULL_DECODE},
+            {"shard", required_argument, 0, kOPT_SHARD}, {"inputCache", required_argument, 0, kOPT_INPUT_CACHE},
+            {"inputCacheFormat", required_argument, 0, kOPT_INPUT_CACHE_FORMAT},
+            {"inputCacheSize", required_argument, 0, kOPT_INPUT_CACHE_SIZE},
+            {"video", required_argument, 0, kOPT_VIDEO}, {"videoPolicy", required_argument, 0, kOPT_VIDEO_POLICY},
+            {"videoBuffer", required_argument, 0, kOPT_VIDEO_BUFFER},
+            {"videoFrames", required_argument, 0, kOPT_VIDEO_FRAMES},
+            {"videoRealtime", no_argument, 0, kOPT_VIDEO_REALTIME}, {"track", required_argument, 0, kOPT_TRACK},
+            {"trackConfidence", required_argument, 0, kOPT_TRACK_CONFIDENCE},
+            {"fitLanes", required_argument, 0, kOPT_FIT_LANES}, {"laneModels", required_argument, 0, kOPT_LANE_MODELS},
+            {"saveOutputs", required_argument, 0, kOPT_SAVE_OUTPUTS},
+            {"saveEvery", required_argument, 0, kOPT_SAVE_EVERY},
+            {"saveAnomalies", no_argument, 0, kOPT_SAVE_ANOMALIES},
+            {"saveThreads", required_argument, 0, kOPT_SAVE_THREADS},
+            {"saveQueue", required_argument, 0, kOPT_SAVE_QUEUE}, {"show", no_argument, 0, kOPT_SHOW},
+            {"cpuThreads", required_argument, 0, kOPT_CPU_THREADS},
+            {"dnnTarget", required_argument, 0, kOPT_DNN_TARGET},
+            {"dnnThreads", required_argument, 0, kOPT_DNN_THREADS},
+            {nullptr, 0, nullptr, 0}};
+        int32_t option_index = 0;
+        arg = getopt_long(argc, argv, "hd:iu", long_options, &option_index);
+        if (arg == -1)
+        {
+            break;
+        }
+
+        switch (arg)
+        {
+        case 'h': args.help = true; return true;
+        case 'd':
+            if (optarg)
+            {
+                args.dataDirs.push_back(optarg);
+            }
+            else
+            {
+                std::cerr << "ERROR: --datadir requires option argument" << std::endl;
+                return false;
+            }
+            break;
+        case 's':
+            if (optarg)
+            {
+                args.saveEngine = optarg;
+            }
+            break;
+        case 'o':
+            if (optarg)
+            {
+                args.loadEngine = optarg;
+            }
+            break;
+        case 'i': args.runInInt8 = true; break;
+        case 'f': args.runInFp16 = true; break;
+        case 'u':
+            if (optarg)
+            {
+                args.useDLACore = std::stoi(optarg);
+            }
+            break;
+        case 'b':
+            if (!parsePositive("batch", optarg, args.batch))
+            {
+                return false;
+            }
+            break;
+        case kOPT_BACKEND:
+            args.backend = optarg;
+            if (args.backend != "tensorrt" && args.backend != "cpu" && args.backend != "opencv"
+                && args.backend != "replay")
+            {
+                std::cerr << "ERROR: unknown backend " << args.backend << std::endl;
+                return false;
+            }
+#if !PINET_WITH_TENSORRT
+            if (args.backend == "tensorrt")
+            {
+                std::cerr << "ERROR: --backend=tensorrt needs a build with PINET_WITH_TENSORRT" << std::endl;
+                return false;
+            }
+#endif
+            break;
+        case kOPT_RECORD_OUTPUTS: args.recordOutputs = optarg; break;
+        case kOPT_REPLAY_OUTPUTS: args.replayOutputs = optarg; break;
+        case kOPT_DECODE_THREADS:
+            if (!parsePositive("decodeThreads", optarg, args.decodeThreads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_PREPROCESS_THREADS:
+            if (!parsePositive("preprocessThreads", optarg, args.preprocessThreads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_INFER_THREADS:
+            if (!parsePositive("inferThreads", optarg, args.inferThreads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_POSTPROCESS_THREADS:
+            if (!parsePositive("postprocessThreads", optarg, args.postprocessThreads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_QUEUE_SIZE:
+            if (!parsePositive("queueSize", optarg, args.queueSize))
+            {
+                return false;
+            }
+            break;
+        case kOPT_ENGINE_CACHE: args.engineCache = optarg; break;
+        case kOPT_NO_ENGINE_CACHE: args.engineCache.clear(); break;
+        case kOPT_OUTPUTS:
+            if (!parseOutputSelection(optarg, args.outputSelection))
+            {
+                std::cerr << "ERROR: --outputs must be lanes or all" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_ONNX: args.onnx = optarg; break;
+        case kOPT_STACK:
+            if (!parsePositive("stack", optarg, args.stack) || args.stack > 2)
+            {
+                std::cerr << "ERROR: --stack must be 1 or 2" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_SCAN_THREADS:
+            if (!parsePositive("scanThreads", optarg, args.scanThreads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_UNSORTED: args.sortFiles = false; break;
+        case kOPT_FULL_DECODE: args.fullDecode = true; break;
+        case kOPT_SHARD: args.shards.push_back(optarg); break;
+        case kOPT_INPUT_CACHE: args.inputCache = optarg; break;
+        case kOPT_INPUT_CACHE_FORMAT:
+            if (!parseInputCacheFormat(optarg, args.inputCacheFormat))
+            {
+                std::cerr << "ERROR: --inputCacheFormat must be uint8 or fp16" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_INPUT_CACHE_SIZE:
+            if (!parsePositive("inputCacheSize", optarg, args.inputCacheSize))
+            {
+                return false;
+            }
+            break;
+        case kOPT_VIDEO: args.video = optarg; break;
+        case kOPT_VIDEO_POLICY:
+            if (!parseOverloadPolicy(optarg, args.videoOptions.policy))
+            {
+                std::cerr << "ERROR: --videoPolicy must be block, dropOldest or latest" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_VIDEO_BUFFER:
+            if (!parsePositive("videoBuffer", optarg, args.videoOptions.bufferSize))
+            {
+                return false;
+            }
+            break;
+        case kOPT_VIDEO_FRAMES:
+        {
+            int32_t frames = 0;
+            if (!parsePositive("videoFrames", optarg, frames))
+            {
+                return false;
+            }
+            args.videoOptions.maxFrames = frames;
+            break;
+        }
+        case kOPT_VIDEO_REALTIME: args.videoOptions.realtime = true; break;
+        case kOPT_TRACK:
+            if (!parsePositive("track", optarg, args.trackInterval))
+            {
+                return false;
+            }
+            break;
+        case kOPT_TRACK_CONFIDENCE:
+            args.trackConfidence = optarg ? static_cast<float>(std::atof(optarg)) : -1.f;
+            if (!(args.trackConfidence >= 0.f && args.trackConfidence <= 1.f))
+            {
+                std::cerr << "ERROR: --trackConfidence must be between 0 and 1" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_FIT_LANES:
+            if (!parsePositive("fitLanes", optarg, args.fitDegree) || args.fitDegree > 3)
+            {
+                std::cerr << "ERROR: --fitLanes must be 1, 2 or 3" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_LANE_MODELS: args.laneModels = optarg; break;
+        case kOPT_SAVE_OUTPUTS: args.annotation.directory = optarg; break;
+        case kOPT_SAVE_EVERY:
+            if (!parsePositive("saveEvery", optarg, args.annotation.every))
+            {
+                return false;
+            }
+            break;
+        case kOPT_SAVE_ANOMALIES: args.annotation.anomalies = true; break;
+        case kOPT_SAVE_THREADS:
+            if (!parsePositive("saveThreads", optarg, args.annotation.threads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_SAVE_QUEUE:
+            if (!parsePositive("saveQueue", optarg, args.annotation.queueSize))
+            {
+                return false;
+            }
+            break;
+        case kOPT_SHOW: args.show = true; break;
+        case kOPT_CPU_THREADS:
+            if (!parsePositive("cpuThreads", optarg, args.cpuThreads))
+            {
+                return false;
+            }
+            break;
+        case kOPT_DNN_TARGET:
+            if (!parseDnnTarget(optarg, args.dnnTarget))
+            {
+                std::cerr << "ERROR: --dnnTarget must be cpu, opencl, opencl_fp16, cuda or cuda_fp16" << std::endl;
+                return false;
+            }
+            break;
+        case kOPT_DNN_THREADS:
+            if (!parsePositive("dnnThreads", optarg, args.dnnThreads))
+            {
+                return false;
+            }
+            break;
+        default: return false;
+        }
+    }
+
+    if (args.backend == "replay" && args.replayOutputs.empty())
+    {
+        std::cerr << "ERROR: --backend=replay requires --replayOutputs" << std::endl;
+        return false;
+    }
+    if (!args.laneModels.empty() && !args.fitDegree)
+    {
+        args.fitDegree = 2;
+    }
+    // Without a sampling option every frame is written
+    if (!args.annotation.every && !args.annotation.anomalies)
+    {
+        args.annotation.every = 1;
+    }
+    return true;
+}
+
+} // namespace pinet
+
+#endif // PINET_ARGS_H
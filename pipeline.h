@@ -0,0 +1,247 @@
+#ifndef PINET_PIPELINE_H
+#define PINET_PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief  The BoundedQueue class is a blocking multi-producer multi-consumer FIFO with a fixed capacity.
+//!
+//! \details push() blocks while the queue is full and pop() blocks while it is empty. Once close() is
+//!          called, push() fails and pop() drains the remaining items before failing.
+//!
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : mCapacity(capacity ? capacity : 1)
+    {
+    }
+
+    BoundedQueue(BoundedQueue const&) = delete;
+    BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+    //!
+    //! \return false if the queue was closed, item is left untouched in that case
+    //!
+    bool push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+        if (mClosed)
+        {
+            return false;
+        }
+        mItems.push_back(std::move(item));
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    //!
+    //! \brief Waits until push() would not block.
+    //!
+    //! \return false if the queue was closed
+    //!
+    bool waitForRoom()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+        return !mClosed;
+    }
+
+    //!
+    //! \return false if the queue is closed and empty
+    //!
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+        if (mItems.empty())
+        {
+            return false;
+        }
+        item = std::move(mItems.front());
+        mItems.pop_front();
+        mNotFull.notify_one();
+        return true;
+    }
+
+    //!
+    //! \brief Pops up to maxItems items, waiting for each of them until the queue is closed.
+    //!
+    //! \return false if the queue is closed and empty
+    //!
+    bool popBatch(std::vector<T>& items, size_t maxItems)
+    {
+        items.clear();
+        T item;
+        while (items.size() < maxItems && pop(item))
+        {
+            items.push_back(std::move(item));
+        }
+        return !items.empty();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+private:
+    size_t const mCapacity;
+    std::deque<T> mItems;
+    bool mClosed{false};
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+};
+
+//!
+//! \brief  The Pipeline class runs a chain of stages, each with its own pool of worker threads.
+//!
+//! \details Consecutive stages are connected by BoundedQueues, so a slow stage only back-pressures its
+//!          producers and the throughput is bounded by the slowest stage rather than by the sum of all
+//!          stages. Items are moved through the stages in completion order; a consumer that needs the
+//!          input order has to restore it itself.
+//!
+template <typename T>
+class Pipeline
+{
+public:
+    //!
+    //! \brief Work of a stage, called with the index of the worker thread in [0, workers) and the item.
+    //!
+    using Work = std::function<void(int32_t, T&)>;
+
+    //!
+    //! \brief Work of a batching stage, called with the index of the worker thread and up to batchSize items.
+    //!
+    using BatchWork = std::function<void(int32_t, std::vector<T>&)>;
+
+    explicit Pipeline(size_t queueSize)
+        : mQueueSize(queueSize)
+    {
+    }
+
+    //!
+    //! \brief Appends a stage run by the given number of worker threads.
+    //!
+    void addStage(std::string const& name, int32_t workers, Work work)
+    {
+        addBatchStage(name, workers, 1, [work](int32_t worker, std::vector<T>& items) {
+            for (auto& item : items)
+            {
+                work(worker, item);
+            }
+        });
+    }
+
+    //!
+    //! \brief Appends a stage whose workers take batchSize items at once.
+    //!
+    //! \details A worker waits until it holds batchSize items, only the last batch of the stream may be
+    //!          smaller.
+    //!
+    void addBatchStage(std::string const& name, int32_t workers, int32_t batchSize, BatchWork work)
+    {
+        mStages.push_back(Stage{name, workers > 0 ? workers : 1, batchSize > 0 ? batchSize : 1, std::move(work)});
+    }
+
+    //!
+    //! \brief Runs the pipeline until source is exhausted and all items reached sink.
+    //!
+    //! \param source Called on a dedicated thread, fills the next item and returns false when there is none.
+    //!        It is only called once the first stage has room for the item, so a live source hands out its
+    //!        latest item rather than one which waited for the pipeline.
+    //! \param sink Called on the calling thread for every item leaving the last stage.
+    //!
+    void run(std::function<bool(T&)> source, std::function<void(T&)> sink)
+    {
+        std::vector<std::unique_ptr<BoundedQueue<T>>> queues;
+        for (size_t i = 0; i <= mStages.size(); ++i)
+        {
+            queues.emplace_back(new BoundedQueue<T>(mQueueSize));
+        }
+
+        std::vector<std::thread> threads;
+        threads.emplace_back([&source, &queues] {
+            T item;
+            while (queues.front()->waitForRoom() && source(item) && queues.front()->push(std::move(item)))
+            {
+                item = T();
+            }
+            queues.front()->close();
+        });
+
+        std::vector<std::unique_ptr<std::atomic<int32_t>>> running;
+        for (size_t s = 0; s < mStages.size(); ++s)
+        {
+            Stage& stage = mStages[s];
+            running.emplace_back(new std::atomic<int32_t>(stage.workers));
+            BoundedQueue<T>& in = *queues[s];
+            BoundedQueue<T>& out = *queues[s + 1];
+            std::atomic<int32_t>& active = *running.back();
+            for (int32_t w = 0; w < stage.workers; ++w)
+            {
+                threads.emplace_back([&stage, &in, &out, &active, w] {
+                    std::vector<T> items;
+                    while (in.popBatch(items, stage.batchSize))
+                    {
+                        stage.work(w, items);
+                        for (auto& item : items)
+                        {
+                            out.push(std::move(item));
+                        }
+                    }
+                    // The last worker leaving the stage ends the stream of the next stage
+                    if (--active == 0)
+                    {
+                        out.close();
+                    }
+                });
+            }
+        }
+
+        T item;
+        while (queues.back()->pop(item))
+        {
+            sink(item);
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+private:
+    struct Stage
+    {
+        std::string name;
+        int32_t workers;
+        int32_t batchSize;
+        BatchWork work;
+    };
+
+    size_t mQueueSize;
+    std::vector<Stage> mStages;
+};
+
+} // namespace pinet
+
+#endif // PINET_PIPELINE_H
@@ -0,0 +1,409 @@
+#include "preprocess.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PINET_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PINET_NEON_SIMD 1
+#include <arm_neon.h>
+#endif
+
+namespace pinet
+{
+
+namespace
+{
+
+//!
+//! \brief Normalizes one row of width pixels into the three planes dst, channel c uses scale[c] and bias[c].
+//!
+using RowKernel = void (*)(
+    uint8_t const* src, int32_t width, float* const* dst, float const* scale, float const* bias);
+
+void normalizeRowScalar(uint8_t const* src, int32_t width, float* const* dst, float const* scale, float const* bias)
+{
+    float* d0 = dst[0];
+    float* d1 = dst[1];
+    float* d2 = dst[2];
+    for (int32_t x = 0; x < width; ++x, src += 3)
+    {
+        d0[x] = float(src[0]) * scale[0] + bias[0];
+        d1[x] = float(src[1]) * scale[1] + bias[1];
+        d2[x] = float(src[2]) * scale[2] + bias[2];
+    }
+}
+
+//!
+//! \brief Finishes a row with the scalar kernel from pixel x on.
+//!
+void normalizeRowTail(
+    uint8_t const* src, int32_t x, int32_t width, float* const* dst, float const* scale, float const* bias)
+{
+    float* const tail[3] = {dst[0] + x, dst[1] + x, dst[2] + x};
+    normalizeRowScalar(src + 3 * x, width - x, tail, scale, bias);
+}
+
+#if PINET_X86_SIMD
+
+//!
+//! \brief Splits 16 interleaved 3-channel pixels held in a, b and c into one vector per channel.
+//!
+__attribute__((target("ssse3"))) inline void deinterleave16(__m128i a, __m128i b, __m128i c, __m128i* channels)
+{
+    channels[0] = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(a, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(b, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+    channels[1] = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(a, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(b, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+    channels[2] = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(a, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(b, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(c, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+//!
+//! \brief Converts the 16 bytes of channel to floats and stores them normalized to dst.
+//!
+__attribute__((target("ssse3"))) inline void storeNormalizedSsse3(
+    __m128i channel, __m128 scale, __m128 bias, float* dst)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const lo = _mm_unpacklo_epi8(channel, zero);
+    __m128i const hi = _mm_unpackhi_epi8(channel, zero);
+    _mm_storeu_ps(dst, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale), bias));
+    _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale), bias));
+    _mm_storeu_ps(dst + 8, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale), bias));
+    _mm_storeu_ps(dst + 12, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale), bias));
+}
+
+__attribute__((target("ssse3"))) void normalizeRowSsse3(
+    uint8_t const* src, int32_t width, float* const* dst, float const* scale, float const* bias)
+{
+    float* const d0 = dst[0];
+    float* const d1 = dst[1];
+    float* const d2 = dst[2];
+    __m128 const scale0 = _mm_set1_ps(scale[0]);
+    __m128 const scale1 = _mm_set1_ps(scale[1]);
+    __m128 const scale2 = _mm_set1_ps(scale[2]);
+    __m128 const bias0 = _mm_set1_ps(bias[0]);
+    __m128 const bias1 = _mm_set1_ps(bias[1]);
+    __m128 const bias2 = _mm_set1_ps(bias[2]);
+
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8_t const* p = src + 3 * x;
+        __m128i channels[3];
+        deinterleave16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)),
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16)),
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 32)), channels);
+        storeNormalizedSsse3(channels[0], scale0, bias0, d0 + x);
+        storeNormalizedSsse3(channels[1], scale1, bias1, d1 + x);
+        storeNormalizedSsse3(channels[2], scale2, bias2, d2 + x);
+    }
+    normalizeRowTail(src, x, width, dst, scale, bias);
+}
+
+//!
+//! \brief AVX2 version of storeNormalizedSsse3, multiply and add are kept separate so that results match
+//!        the other implementations.
+//!
+__attribute__((target("avx2"))) inline void storeNormalizedAvx2(__m128i channel, __m256 scale, __m256 bias, float* dst)
+{
+    __m256 const f0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(channel));
+    __m256 const f1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(channel, 8)));
+    _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_mul_ps(f0, scale), bias));
+    _mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_mul_ps(f1, scale), bias));
+}
+
+__attribute__((target("avx2"))) void normalizeRowAvx2(
+    uint8_t const* src, int32_t width, float* const* dst, float const* scale, float const* bias)
+{
+    float* const d0 = dst[0];
+    float* const d1 = dst[1];
+    float* const d2 = dst[2];
+    __m256 const scale0 = _mm256_set1_ps(scale[0]);
+    __m256 const scale1 = _mm256_set1_ps(scale[1]);
+    __m256 const scale2 = _mm256_set1_ps(scale[2]);
+    __m256 const bias0 = _mm256_set1_ps(bias[0]);
+    __m256 const bias1 = _mm256_set1_ps(bias[1]);
+    __m256 const bias2 = _mm256_set1_ps(bias[2]);
+
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8_t const* p = src + 3 * x;
+        __m128i channels[3];
+        deinterleave16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)),
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16)),
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 32)), channels);
+        storeNormalizedAvx2(channels[0], scale0, bias0, d0 + x);
+        storeNormalizedAvx2(channels[1], scale1, bias1, d1 + x);
+        storeNormalizedAvx2(channels[2], scale2, bias2, d2 + x);
+    }
+    normalizeRowTail(src, x, width, dst, scale, bias);
+}
+
+#endif // PINET_X86_SIMD
+
+#if PINET_NEON_SIMD
+
+//!
+//! \brief Converts the 16 bytes of channel to floats and stores them normalized to dst.
+//!
+inline void storeNormalizedNeon(uint8x16_t channel, float32x4_t scale, float32x4_t bias, float* dst)
+{
+    uint16x8_t const lo = vmovl_u8(vget_low_u8(channel));
+    uint16x8_t const hi = vmovl_u8(vget_high_u8(channel));
+    vst1q_f32(dst, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), scale));
+    vst1q_f32(dst + 4, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+    vst1q_f32(dst + 8, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), scale));
+    vst1q_f32(dst + 12, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+}
+
+void normalizeRowNeon(uint8_t const* src, int32_t width, float* const* dst, float const* scale, float const* bias)
+{
+    float* const d0 = dst[0];
+    float* const d1 = dst[1];
+    float* const d2 = dst[2];
+    float32x4_t const scale0 = vdupq_n_f32(scale[0]);
+    float32x4_t const scale1 = vdupq_n_f32(scale[1]);
+    float32x4_t const scale2 = vdupq_n_f32(scale[2]);
+    float32x4_t const bias0 = vdupq_n_f32(bias[0]);
+    float32x4_t const bias1 = vdupq_n_f32(bias[1]);
+    float32x4_t const bias2 = vdupq_n_f32(bias[2]);
+
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16x3_t const pixels = vld3q_u8(src + 3 * x);
+        storeNormalizedNeon(pixels.val[0], scale0, bias0, d0 + x);
+        storeNormalizedNeon(pixels.val[1], scale1, bias1, d1 + x);
+        storeNormalizedNeon(pixels.val[2], scale2, bias2, d2 + x);
+    }
+    normalizeRowTail(src, x, width, dst, scale, bias);
+}
+
+#endif // PINET_NEON_SIMD
+
+RowKernel getRowKernel(SimdLevel level)
+{
+    switch (level)
+    {
+#if PINET_X86_SIMD
+    case SimdLevel::kSSSE3: return normalizeRowSsse3;
+    case SimdLevel::kAVX2: return normalizeRowAvx2;
+#endif
+#if PINET_NEON_SIMD
+    case SimdLevel::kNEON: return normalizeRowNeon;
+#endif
+    default: return normalizeRowScalar;
+    }
+}
+
+//!
+//! \brief Per-channel multiply-add and destination plane derived from NormalizeParams.
+//!
+struct ChannelTransform
+{
+    float scale[3];
+    float bias[3];
+    float* planes[3];
+};
+
+ChannelTransform getChannelTransform(NormalizeParams const& params, float* dst, size_t planeSize)
+{
+    ChannelTransform transform;
+    for (int32_t c = 0; c < 3; ++c)
+    {
+        transform.scale[c] = 1.f / (255.f * params.std[c]);
+        transform.bias[c] = -params.mean[c] / params.std[c];
+        transform.planes[c] = dst + (params.swapChannels ? 2 - c : c) * planeSize;
+    }
+    return transform;
+}
+
+//!
+//! \brief Fixed point precision of interpolation weights, the same as cv::resize uses for 8-bit images.
+//!
+constexpr int32_t kWEIGHT_BITS = 11;
+
+//!
+//! \brief The two source samples a destination coordinate is interpolated from.
+//!
+struct LinearTap
+{
+    int32_t index0;
+    int32_t index1;
+    int32_t weight0; //!< Weights scaled by 1 << kWEIGHT_BITS
+    int32_t weight1;
+};
+
+//!
+//! \brief Maps every destination coordinate to its source samples the way cv::resize does with INTER_LINEAR.
+//!
+std::vector<LinearTap> computeLinearTaps(int32_t srcSize, int32_t dstSize)
+{
+    double const scale = 1. / (static_cast<double>(dstSize) / srcSize);
+    float const one = static_cast<float>(1 << kWEIGHT_BITS);
+    std::vector<LinearTap> taps(dstSize);
+    for (int32_t d = 0; d < dstSize; ++d)
+    {
+        float position = static_cast<float>((d + 0.5) * scale - 0.5);
+        int32_t index = static_cast<int32_t>(std::floor(position));
+        float weight = position - index;
+        if (index < 0)
+        {
+            index = 0;
+            weight = 0.f;
+        }
+        if (index >= srcSize - 1)
+        {
+            index = srcSize - 1;
+            weight = 0.f;
+        }
+        taps[d] = LinearTap{index, std::min(index + 1, srcSize - 1),
+            static_cast<int32_t>(std::lrint((1.f - weight) * one)), static_cast<int32_t>(std::lrint(weight * one))};
+    }
+    return taps;
+}
+
+} // namespace
+
+char const* toString(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::kSCALAR: return "scalar";
+    case SimdLevel::kSSSE3: return "ssse3";
+    case SimdLevel::kAVX2: return "avx2";
+    case SimdLevel::kNEON: return "neon";
+    }
+    return "unknown";
+}
+
+bool isSupported(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::kSCALAR: return true;
+#if PINET_X86_SIMD
+    case SimdLevel::kSSSE3: return __builtin_cpu_supports("ssse3");
+    case SimdLevel::kAVX2: return __builtin_cpu_supports("avx2");
+#endif
+#if PINET_NEON_SIMD
+    case SimdLevel::kNEON: return true;
+#endif
+    default: return false;
+    }
+}
+
+SimdLevel getSimdLevel()
+{
+    static SimdLevel const level = [] {
+        for (SimdLevel candidate : {SimdLevel::kAVX2, SimdLevel::kNEON, SimdLevel::kSSSE3})
+        {
+            if (isSupported(candidate))
+            {
+                return candidate;
+            }
+        }
+        return SimdLevel::kSCALAR;
+    }();
+    return level;
+}
+
+void normalizeHwcToChw(uint8_t const* src, int32_t width, int32_t height, size_t srcStep, float* dst,
+    NormalizeParams const& params)
+{
+    normalizeHwcToChw(src, width, height, srcStep, dst, params, getSimdLevel());
+}
+
+void normalizeHwcToChw(uint8_t const* src, int32_t width, int32_t height, size_t srcStep, float* dst,
+    NormalizeParams const& params, SimdLevel level)
+{
+    RowKernel const kernel = getRowKernel(level);
+    ChannelTransform const transform = getChannelTransform(params, dst, static_cast<size_t>(width) * height);
+
+    for (int32_t y = 0; y < height; ++y)
+    {
+        float* const rows[3] = {transform.planes[0] + y * width, transform.planes[1] + y * width,
+            transform.planes[2] + y * width};
+        kernel(src + y * srcStep, width, rows, transform.scale, transform.bias);
+    }
+}
+
+void resizeNormalizeHwcToChw(uint8_t const* src, int32_t srcWidth, int32_t srcHeight, size_t srcStep, float* dst,
+    int32_t dstWidth, int32_t dstHeight, NormalizeParams const& params)
+{
+    if (srcWidth == dstWidth && srcHeight == dstHeight)
+    {
+        normalizeHwcToChw(src, srcWidth, srcHeight, srcStep, dst, params);
+        return;
+    }
+
+    ChannelTransform const transform = getChannelTransform(params, dst, static_cast<size_t>(dstWidth) * dstHeight);
+    std::vector<LinearTap> const xTaps = computeLinearTaps(srcWidth, dstWidth);
+    std::vector<LinearTap> const yTaps = computeLinearTaps(srcHeight, dstHeight);
+
+    // Interpolation yields 8-bit values, so normalization is a table lookup
+    float table[3][256];
+    for (int32_t c = 0; c < 3; ++c)
+    {
+        for (int32_t v = 0; v < 256; ++v)
+        {
+            table[c][v] = float(v) * transform.scale[c] + transform.bias[c];
+        }
+    }
+
+    cv::parallel_for_(cv::Range(0, dstHeight), [&](cv::Range const& range) {
+        int32_t const shift = 2 * kWEIGHT_BITS;
+        int32_t const half = 1 << (shift - 1);
+        for (int32_t y = range.start; y < range.end; ++y)
+        {
+            uint8_t const* row0 = src + yTaps[y].index0 * srcStep;
+            uint8_t const* row1 = src + yTaps[y].index1 * srcStep;
+            int32_t const wy0 = yTaps[y].weight0;
+            int32_t const wy1 = yTaps[y].weight1;
+            float* d0 = transform.planes[0] + y * dstWidth;
+            float* d1 = transform.planes[1] + y * dstWidth;
+            float* d2 = transform.planes[2] + y * dstWidth;
+
+            for (int32_t x = 0; x < dstWidth; ++x)
+            {
+                LinearTap const& tap = xTaps[x];
+                uint8_t const* p00 = row0 + 3 * tap.index0;
+                uint8_t const* p01 = row0 + 3 * tap.index1;
+                uint8_t const* p10 = row1 + 3 * tap.index0;
+                uint8_t const* p11 = row1 + 3 * tap.index1;
+                int32_t const wx0 = tap.weight0;
+                int32_t const wx1 = tap.weight1;
+
+                uint8_t pixel[3];
+                for (int32_t c = 0; c < 3; ++c)
+                {
+                    int32_t const top = p00[c] * wx0 + p01[c] * wx1;
+                    int32_t const bottom = p10[c] * wx0 + p11[c] * wx1;
+                    pixel[c] = static_cast<uint8_t>(std::min((top * wy0 + bottom * wy1 + half) >> shift, 255));
+                }
+                d0[x] = table[0][pixel[0]];
+                d1[x] = table[1][pixel[1]];
+                d2[x] = table[2][pixel[2]];
+            }
+        }
+    });
+}
+
+} // namespace pinet
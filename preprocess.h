@@ -0,0 +1,87 @@
+#ifndef PINET_PREPROCESS_H
+#define PINET_PREPROCESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pinet
+{
+
+//!
+//! \brief The NormalizeParams structure describes how 8-bit pixels are turned into network inputs.
+//!
+//! \details Each channel c is written as (pixel / 255 - mean[c]) / std[c]. The defaults reproduce the
+//!          plain division by 255 the network was trained with. mean and std are given in source
+//!          channel order.
+//!
+struct NormalizeParams
+{
+    float mean[3]{0.f, 0.f, 0.f};
+    float std[3]{1.f, 1.f, 1.f};
+    bool swapChannels{false}; //!< Write the channels in reverse order, e.g. BGR pixels into RGB planes
+};
+
+//!
+//! \brief Instruction sets the normalization kernel is implemented with.
+//!
+enum class SimdLevel : int32_t
+{
+    kSCALAR,
+    kSSSE3,
+    kAVX2,
+    kNEON,
+};
+
+//!
+//! \brief Returns the name of level.
+//!
+char const* toString(SimdLevel level);
+
+//!
+//! \brief Returns the best instruction set supported by the running CPU.
+//!
+SimdLevel getSimdLevel();
+
+//!
+//! \brief Returns whether the running CPU supports level.
+//!
+bool isSupported(SimdLevel level);
+
+//!
+//! \brief Deinterleaves a 3-channel HWC uint8 image into planar CHW floats and normalizes it.
+//!
+//! \param src First pixel of the image.
+//! \param width, height Size of the image in pixels.
+//! \param srcStep Distance between two rows of src in bytes.
+//! \param dst Three planes of width * height floats, back to back.
+//!
+//! \details Dispatches to the best implementation for the running CPU. All implementations compute
+//!          pixel * scale + bias and agree with the scalar one, which itself differs from a division
+//!          by 255 by at most one ulp.
+//!
+void normalizeHwcToChw(uint8_t const* src, int32_t width, int32_t height, size_t srcStep, float* dst,
+    NormalizeParams const& params = NormalizeParams());
+
+//!
+//! \brief Same as normalizeHwcToChw but forces the implementation, level has to be supported.
+//!
+void normalizeHwcToChw(uint8_t const* src, int32_t width, int32_t height, size_t srcStep, float* dst,
+    NormalizeParams const& params, SimdLevel level);
+
+//!
+//! \brief Resizes a 3-channel HWC uint8 image bilinearly and writes it normalized into planar CHW floats.
+//!
+//! \param dst Three planes of dstWidth * dstHeight floats, back to back.
+//!
+//! \details Fuses cv::resize with INTER_LINEAR and normalizeHwcToChw into a single pass without an
+//!          intermediate image. Samples are interpolated at the positions and with the 11-bit fixed point
+//!          weights of cv::resize, so the result matches the two-step path up to the rounding of the
+//!          vectorized code paths of OpenCV, i.e. by one step of 1 / (255 * std) at most. Rows of dst are
+//!          computed in parallel with cv::parallel_for_.
+//!
+void resizeNormalizeHwcToChw(uint8_t const* src, int32_t srcWidth, int32_t srcHeight, size_t srcStep, float* dst,
+    int32_t dstWidth, int32_t dstHeight, NormalizeParams const& params = NormalizeParams());
+
+} // namespace pinet
+
+#endif // PINET_PREPROCESS_H
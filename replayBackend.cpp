@@ -0,0 +1,211 @@
+#include "replayBackend.h"
+#include "logger.h"
+#include "stageTiming.h"
+
+#include <algorithm>
+
+namespace pinet
+{
+
+namespace
+{
+
+template <typename T>
+void writeValue(std::ostream& os, T const& value)
+{
+    os.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& is, T& value)
+{
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void writeTensorDesc(std::ostream& os, TensorDesc const& desc)
+{
+    writeValue(os, static_cast<int32_t>(desc.name.size()));
+    os.write(desc.name.data(), desc.name.size());
+    writeValue(os, static_cast<int32_t>(desc.dims.size()));
+    for (int32_t d : desc.dims)
+    {
+        writeValue(os, d);
+    }
+}
+
+bool readTensorDesc(std::istream& is, TensorDesc& desc)
+{
+    int32_t nameLength{0};
+    if (!readValue(is, nameLength) || nameLength <= 0 || nameLength > 4096)
+    {
+        return false;
+    }
+    desc.name.resize(nameLength);
+    if (!is.read(&desc.name[0], nameLength))
+    {
+        return false;
+    }
+
+    int32_t nbDims{0};
+    if (!readValue(is, nbDims) || nbDims <= 0 || nbDims > 8)
+    {
+        return false;
+    }
+    desc.dims.resize(nbDims);
+    for (auto& d : desc.dims)
+    {
+        if (!readValue(is, d) || d <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool OutputRecorder::open(std::string const& fileName, TensorDesc const& input, std::vector<TensorDesc> const& outputs)
+{
+    mFile.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!mFile)
+    {
+        sample::gLogError << "Cannot create output recording " << fileName << std::endl;
+        return false;
+    }
+
+    writeValue(mFile, kRECORDING_MAGIC);
+    writeValue(mFile, kRECORDING_VERSION);
+    writeValue(mFile, static_cast<int32_t>(outputs.size() + 1));
+    writeTensorDesc(mFile, input);
+    for (auto const& output : outputs)
+    {
+        writeTensorDesc(mFile, output);
+    }
+    mFrameCount = 0;
+    return static_cast<bool>(mFile);
+}
+
+bool OutputRecorder::write(std::vector<std::vector<float>> const& outputs)
+{
+    for (auto const& output : outputs)
+    {
+        mFile.write(reinterpret_cast<char const*>(output.data()), output.size() * sizeof(float));
+    }
+    ++mFrameCount;
+    return static_cast<bool>(mFile);
+}
+
+bool ReplayBackend::load()
+{
+    std::ifstream file(mFileName, std::ios::binary);
+    if (!file)
+    {
+        sample::gLogError << "Cannot open output recording " << mFileName << std::endl;
+        return false;
+    }
+
+    uint32_t magic{0}, version{0};
+    int32_t nbTensors{0};
+    if (!readValue(file, magic) || magic != kRECORDING_MAGIC || !readValue(file, version)
+        || version != kRECORDING_VERSION || !readValue(file, nbTensors) || nbTensors < 2)
+    {
+        sample::gLogError << mFileName << " is not a PINet output recording" << std::endl;
+        return false;
+    }
+
+    mOutputs.resize(nbTensors - 1);
+    bool valid = readTensorDesc(file, mInput);
+    for (auto& output : mOutputs)
+    {
+        valid = valid && readTensorDesc(file, output);
+    }
+    if (!valid)
+    {
+        sample::gLogError << "Corrupted tensor description in " << mFileName << std::endl;
+        return false;
+    }
+    if (mInput.dims[0] != 1)
+    {
+        sample::gLogError << mFileName << " was not recorded per image" << std::endl;
+        return false;
+    }
+
+    mFrameVolume = 0;
+    for (auto const& output : mOutputs)
+    {
+        mFrameVolume += output.volume();
+    }
+
+    // Expose the tensors with the requested batch size
+    mInput.dims[0] = mBatchSize;
+    mInputBuffer.assign(mInput.volume(), 0.f);
+    mOutputBuffers.resize(mOutputs.size());
+    for (size_t i = 0; i < mOutputs.size(); ++i)
+    {
+        mOutputs[i].dims[0] = mBatchSize;
+        mOutputBuffers[i].assign(mOutputs[i].volume(), 0.f);
+    }
+
+    auto const dataBegin = file.tellg();
+    file.seekg(0, std::ios::end);
+    int64_t const dataBytes = static_cast<int64_t>(file.tellg() - dataBegin);
+    file.seekg(dataBegin);
+
+    mFrameCount = dataBytes / (mFrameVolume * static_cast<int64_t>(sizeof(float)));
+    if (mFrameCount == 0)
+    {
+        sample::gLogError << mFileName << " holds no recorded frame" << std::endl;
+        return false;
+    }
+    if (dataBytes % (mFrameVolume * static_cast<int64_t>(sizeof(float))))
+    {
+        sample::gLogWarning << mFileName << " ends with a truncated frame, it is ignored" << std::endl;
+    }
+
+    std::shared_ptr<std::vector<float>> frames{new std::vector<float>(mFrameCount * mFrameVolume)};
+    if (!file.read(reinterpret_cast<char*>(frames->data()), frames->size() * sizeof(float)))
+    {
+        sample::gLogError << "Cannot read recorded frames from " << mFileName << std::endl;
+        return false;
+    }
+    mFrames = frames;
+
+    mNextFrame = 0;
+    sample::gLogInfo << "Loaded " << mFrameCount << " recorded frames from " << mFileName << std::endl;
+    return true;
+}
+
+bool ReplayBackend::infer()
+{
+    if (mFrameCount == 0)
+    {
+        return false;
+    }
+
+    auto const start = Clock::now();
+    for (int32_t b = 0; b < mBatchSize; ++b)
+    {
+        if (mSequenceCount > 0)
+        {
+            if (b >= mSequenceCount)
+            {
+                break; // Padding of a partial batch
+            }
+            mNextFrame = mSequence[b] % mFrameCount;
+        }
+
+        float const* frame = mFrames->data() + mNextFrame * mFrameVolume;
+        for (auto& buffer : mOutputBuffers)
+        {
+            size_t const imageVolume = buffer.size() / mBatchSize;
+            std::copy(frame, frame + imageVolume, buffer.begin() + b * imageVolume);
+            frame += imageVolume;
+        }
+        mNextFrame = (mNextFrame + 1) % mFrameCount;
+    }
+    mSequenceCount = 0;
+    mLastTiming.execute = elapsedMs(start);
+    return true;
+}
+
+} // namespace pinet
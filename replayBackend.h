@@ -0,0 +1,135 @@
+#ifndef PINET_REPLAY_BACKEND_H
+#define PINET_REPLAY_BACKEND_H
+
+#include "inferenceBackend.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief Layout of a recording of output tensors, all fields little endian:
+//!
+//!        uint32 magic ("PNTR"), uint32 version, int32 number of tensors (input first, then outputs),
+//!        per tensor: int32 name length, name bytes, int32 nbDims, int32 dims[nbDims],
+//!        followed by frames, each holding the float data of all outputs in output order.
+//!
+//!        The input tensor is described only, its data is not recorded.
+//!
+constexpr uint32_t kRECORDING_MAGIC = 0x52544e50; // "PNTR"
+constexpr uint32_t kRECORDING_VERSION = 1;
+
+//!
+//! \brief  The OutputRecorder class appends the outputs of a backend to a recording after every inference.
+//!
+class OutputRecorder
+{
+public:
+    //!
+    //! \brief Creates the recording file and writes the tensor descriptions of a single image.
+    //!
+    bool open(std::string const& fileName, TensorDesc const& input, std::vector<TensorDesc> const& outputs);
+
+    //!
+    //! \brief Appends the outputs of one image as one frame, in the order given to open().
+    //!
+    bool write(std::vector<std::vector<float>> const& outputs);
+
+    int64_t getFrameCount() const
+    {
+        return mFrameCount;
+    }
+
+private:
+    std::ofstream mFile;
+    int64_t mFrameCount{0};
+};
+
+//!
+//! \brief  The ReplayBackend class is a deterministic CPU stand-in for the network.
+//!
+//! \details It loads a recording written by OutputRecorder and, on each call to infer(), copies the next
+//!          recorded frame into its output buffers, wrapping around after the last frame. The input buffer
+//!          is accepted but ignored, so the whole pipeline can be run and profiled without CUDA.
+//!          setSequenceNumber() selects the frames, so the n-th input always gets the n-th recorded frame.
+//!          Frames are recorded per image, a batch of several images is filled from consecutive frames.
+//!          Copies share the loaded frames, one copy is meant to be used per worker thread.
+//!
+class ReplayBackend : public InferenceBackend
+{
+public:
+    explicit ReplayBackend(std::string const& fileName, int32_t batchSize = 1)
+        : mFileName(fileName)
+        , mBatchSize(batchSize)
+        , mSequence(batchSize)
+    {
+    }
+
+    //!
+    //! \brief Reads the recording into memory.
+    //!
+    //! \return true if the recording is valid and holds at least one frame
+    //!
+    bool load();
+
+    std::string getName() const override
+    {
+        return "replay";
+    }
+
+    TensorDesc const& getInput() const override
+    {
+        return mInput;
+    }
+
+    std::vector<TensorDesc> const& getOutputs() const override
+    {
+        return mOutputs;
+    }
+
+    float* getInputBuffer() override
+    {
+        return mInputBuffer.data();
+    }
+
+    float const* getOutputBuffer(int32_t index) const override
+    {
+        return mOutputBuffers[index].data();
+    }
+
+    bool infer() override;
+
+    void setSequenceNumber(int32_t slot, int64_t sequence) override
+    {
+        mSequence[slot] = sequence;
+        mSequenceCount = std::max(mSequenceCount, slot + 1);
+    }
+
+    int64_t getFrameCount() const
+    {
+        return mFrameCount;
+    }
+
+private:
+    std::string mFileName;
+    int32_t mBatchSize;
+    TensorDesc mInput;
+    std::vector<TensorDesc> mOutputs;
+    std::vector<float> mInputBuffer;
+    std::vector<std::vector<float>> mOutputBuffers;
+    std::shared_ptr<std::vector<float> const> mFrames; //!< All recorded frames back to back
+    int64_t mFrameVolume{0};                            //!< Number of floats per frame
+    int64_t mFrameCount{0};
+    int64_t mNextFrame{0};
+    std::vector<int64_t> mSequence; //!< Frames of the next batch, one per slot
+    int32_t mSequenceCount{0};      //!< Number of slots set, consecutive frames from mNextFrame if 0
+};
+
+} // namespace pinet
+
+#endif // PINET_REPLAY_BACKEND_H
@@ -0,0 +1,107 @@
+#include "stageTiming.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace pinet
+{
+
+namespace
+{
+
+//!
+//! \brief Summary of the latencies of a stage, with the semantics of sample::getPerformanceResult.
+//!
+struct StageSummary
+{
+    float min{0.f};
+    float mean{0.f};
+    float median{0.f};
+    float p90{0.f};
+    float p99{0.f};
+    float max{0.f};
+};
+
+//!
+//! \brief Returns the value below which percent of the sorted times lie, the one trtexec reports.
+//!
+float findPercentile(std::vector<float> const& sorted, float percent)
+{
+    int32_t const all = static_cast<int32_t>(sorted.size());
+    int32_t const exclude = static_cast<int32_t>((1 - percent / 100) * all);
+    return sorted[std::max(all - 1 - exclude, 0)];
+}
+
+StageSummary summarize(std::vector<float> times)
+{
+    std::sort(times.begin(), times.end());
+    size_t const middle = times.size() / 2;
+    StageSummary summary;
+    summary.min = times.front();
+    summary.max = times.back();
+    summary.mean = std::accumulate(times.begin(), times.end(), 0.f) / times.size();
+    summary.median = times.size() % 2 ? times[middle] : (times[middle - 1] + times[middle]) / 2;
+    summary.p90 = findPercentile(times, 90.f);
+    summary.p99 = findPercentile(times, 99.f);
+    return summary;
+}
+
+} // namespace
+
+char const* toString(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::kDECODE: return "decode";
+    case Stage::kPREPROCESS: return "preprocess";
+    case Stage::kH2D: return "h2d";
+    case Stage::kEXECUTE: return "execute";
+    case Stage::kD2H: return "d2h";
+    case Stage::kPOSTPROCESS: return "postprocess";
+    case Stage::kTRACK: return "track";
+    case Stage::kFIT: return "fit";
+    case Stage::kFRAME: return "frame";
+    case Stage::kGLASS: return "glass";
+    case Stage::kCOUNT: break;
+    }
+    return "unknown";
+}
+
+void LatencyReport::add(FrameTime const& time)
+{
+    for (int32_t s = 0; s < static_cast<int32_t>(Stage::kCOUNT); ++s)
+    {
+        if (time.stages[s] >= 0.f)
+        {
+            mTimes[s].push_back(time.stages[s]);
+        }
+    }
+}
+
+void LatencyReport::print(std::ostream& os) const
+{
+    auto const flags = os.flags();
+    auto const precision = os.precision();
+    os << "=== Latency per stage (ms) ===" << std::endl;
+    os << std::left << std::setw(12) << "stage" << std::right << std::setw(8) << "frames" << std::setw(10) << "min"
+       << std::setw(10) << "mean" << std::setw(10) << "median" << std::setw(10) << "p90" << std::setw(10) << "p99"
+       << std::setw(10) << "max" << std::endl;
+    for (int32_t s = 0; s < static_cast<int32_t>(Stage::kCOUNT); ++s)
+    {
+        auto const& times = mTimes[s];
+        if (times.empty())
+        {
+            continue;
+        }
+        StageSummary const summary = summarize(times);
+        os << std::left << std::setw(12) << toString(static_cast<Stage>(s)) << std::right << std::setw(8)
+           << times.size() << std::fixed << std::setprecision(3) << std::setw(10) << summary.min << std::setw(10)
+           << summary.mean << std::setw(10) << summary.median << std::setw(10) << summary.p90 << std::setw(10)
+           << summary.p99 << std::setw(10) << summary.max << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+} // namespace pinet
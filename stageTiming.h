@@ -0,0 +1,96 @@
+#ifndef PINET_STAGE_TIMING_H
+#define PINET_STAGE_TIMING_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace pinet
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+//!
+//! \brief Returns the milliseconds elapsed since start.
+//!
+inline float elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+//!
+//! \brief The steps a frame goes through, timed separately.
+//!
+enum class Stage : int32_t
+{
+    kDECODE,      //!< Reading and decoding the image
+    kPREPROCESS,  //!< Resizing and normalizing into the network input
+    kH2D,         //!< Copying the input batch to the device
+    kEXECUTE,     //!< Running the network on the batch
+    kD2H,         //!< Copying the output batch to the host
+    kPOSTPROCESS, //!< Extracting the lane lines from the outputs
+    kTRACK,       //!< Carrying the lane lines over to a frame which is not inferred, or taking those of one which is
+    kFIT,         //!< Fitting the lane lines with polynomials
+    kFRAME,       //!< From the creation of the frame until it reaches the sink, queueing included
+    kGLASS,       //!< From the capture of a video frame until it reaches the sink, capture buffering included
+    kCOUNT
+};
+
+//!
+//! \brief Returns the name of stage used in reports.
+//!
+char const* toString(Stage stage);
+
+//!
+//! \brief The FrameTime structure holds the time each stage spent on one frame, in milliseconds.
+//!
+//! \details Modeled on sample::InferenceTime. Stages working on a batch attribute the time of the whole
+//!          batch to each of its frames, since that is the latency every one of them sees. Stages a frame
+//!          did not reach keep a negative time and are left out of the statistics.
+//!
+struct FrameTime
+{
+    FrameTime()
+    {
+        for (auto& ms : stages)
+        {
+            ms = -1.f;
+        }
+    }
+
+    float& operator[](Stage stage)
+    {
+        return stages[static_cast<int32_t>(stage)];
+    }
+
+    float operator[](Stage stage) const
+    {
+        return stages[static_cast<int32_t>(stage)];
+    }
+
+    float stages[static_cast<int32_t>(Stage::kCOUNT)];
+};
+
+//!
+//! \brief  The LatencyReport class collects the FrameTime of every frame and summarizes it per stage.
+//!
+//! \details Not thread-safe, frames are meant to be added by the sink of the pipeline only.
+//!
+class LatencyReport
+{
+public:
+    void add(FrameTime const& time);
+
+    //!
+    //! \brief Prints min, mean, median, p90 and p99 of every stage, computed as trtexec does.
+    //!
+    void print(std::ostream& os) const;
+
+private:
+    std::vector<float> mTimes[static_cast<int32_t>(Stage::kCOUNT)];
+};
+
+} // namespace pinet
+
+#endif // PINET_STAGE_TIMING_H
@@ -0,0 +1,77 @@
+#ifndef PINET_TENSOR_VIEW_H
+#define PINET_TENSOR_VIEW_H
+
+#include "inferenceBackend.h"
+
+#include <cassert>
+#include <cstdint>
+
+namespace pinet
+{
+
+//!
+//! \brief  The PlanarView class reads a CHW tensor of one image in place.
+//!
+//! \details It does not own the data and only stores a pointer and the three dimensions, so it is meant
+//!          to be created on the stack for every frame. Element (c, y, x) lives at
+//!          data[(c * height + y) * width + x].
+//!
+template <typename T>
+class PlanarView
+{
+public:
+    PlanarView(T* data, int32_t channels, int32_t height, int32_t width)
+        : mData(data)
+        , mChannels(channels)
+        , mHeight(height)
+        , mWidth(width)
+    {
+    }
+
+    //!
+    //! \brief Views data with the dimensions of desc, which has to describe a single NCHW image.
+    //!
+    PlanarView(T* data, TensorDesc const& desc)
+        : PlanarView(data, desc.dims[1], desc.dims[2], desc.dims[3])
+    {
+        assert(desc.dims.size() == 4 && desc.dims[0] == 1);
+    }
+
+    T& operator()(int32_t c, int32_t y, int32_t x) const
+    {
+        return mData[(static_cast<int64_t>(c) * mHeight + y) * mWidth + x];
+    }
+
+    //!
+    //! \brief Returns the first element of channel c, its height * width elements are contiguous.
+    //!
+    T* plane(int32_t c) const
+    {
+        return mData + static_cast<int64_t>(c) * mHeight * mWidth;
+    }
+
+    int32_t channels() const
+    {
+        return mChannels;
+    }
+
+    int32_t height() const
+    {
+        return mHeight;
+    }
+
+    int32_t width() const
+    {
+        return mWidth;
+    }
+
+private:
+    T* mData;
+    int32_t mChannels;
+    int32_t mHeight;
+    int32_t mWidth;
+};
+
+} // namespace pinet
+
+#endif // PINET_TENSOR_VIEW_H
@@ -0,0 +1,76 @@
+#include "tensorrtBackend.h"
+#include "common.h"
+#include "stageTiming.h"
+
+namespace pinet
+{
+
+namespace
+{
+
+TensorDesc makeTensorDesc(nvinfer1::ICudaEngine const& engine, std::string const& name)
+{
+    TensorDesc desc;
+    desc.name = name;
+    int32_t const index = engine.getBindingIndex(name.c_str());
+    ASSERT(index != -1);
+    nvinfer1::Dims const dims = engine.getBindingDimensions(index);
+    desc.dims.assign(dims.d, dims.d + dims.nbDims);
+    return desc;
+}
+
+} // namespace
+
+TensorRTBackend::TensorRTBackend(std::shared_ptr<nvinfer1::ICudaEngine> engine, std::string const& inputName,
+    std::vector<std::string> const& outputNames)
+    : mEngine(engine)
+    , mContext(engine->createExecutionContext())
+    , mBuffers(engine)
+{
+    mInput = makeTensorDesc(*mEngine, inputName);
+    for (auto const& name : outputNames)
+    {
+        mOutputs.push_back(makeTensorDesc(*mEngine, name));
+    }
+}
+
+float* TensorRTBackend::getInputBuffer()
+{
+    return static_cast<float*>(mBuffers.getHostBuffer(mInput.name));
+}
+
+float const* TensorRTBackend::getOutputBuffer(int32_t index) const
+{
+    return static_cast<float const*>(mBuffers.getHostBuffer(mOutputs[index].name));
+}
+
+bool TensorRTBackend::infer()
+{
+    // The context could not be created with the session
+    if (!mContext)
+    {
+        return false;
+    }
+
+    // Memcpy from host input buffers to device input buffers, the copies are synchronous
+    auto start = Clock::now();
+    mBuffers.copyInputToDevice();
+    mLastTiming.h2d = elapsedMs(start);
+
+    start = Clock::now();
+    bool status = mContext->executeV2(mBuffers.getDeviceBindings().data());
+    if (!status)
+    {
+        return false;
+    }
+    mLastTiming.execute = elapsedMs(start);
+
+    // Memcpy from device output buffers to host output buffers
+    start = Clock::now();
+    mBuffers.copyOutputToHost();
+    mLastTiming.d2h = elapsedMs(start);
+
+    return true;
+}
+
+} // namespace pinet
@@ -0,0 +1,62 @@
+#ifndef PINET_TENSORRT_BACKEND_H
+#define PINET_TENSORRT_BACKEND_H
+
+#include "buffers.h"
+#include "inferenceBackend.h"
+
+#include "NvInfer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pinet
+{
+
+//!
+//! \brief  The TensorRTBackend class runs a deserialized TensorRT engine.
+//!
+//! \details A backend is the inference session of one worker. Its execution context and the host and
+//!          device buffers of all bindings, handled by a samplesCommon::BufferManager, are created once
+//!          by the constructor and reused by every call to infer(), so running a batch allocates nothing.
+//!          infer() copies the input to the device, calls IExecutionContext::executeV2 and copies
+//!          the outputs back to the host.
+//!
+class TensorRTBackend : public InferenceBackend
+{
+public:
+    TensorRTBackend(std::shared_ptr<nvinfer1::ICudaEngine> engine, std::string const& inputName,
+        std::vector<std::string> const& outputNames);
+
+    std::string getName() const override
+    {
+        return "tensorrt";
+    }
+
+    TensorDesc const& getInput() const override
+    {
+        return mInput;
+    }
+
+    std::vector<TensorDesc> const& getOutputs() const override
+    {
+        return mOutputs;
+    }
+
+    float* getInputBuffer() override;
+
+    float const* getOutputBuffer(int32_t index) const override;
+
+    bool infer() override;
+
+private:
+    std::shared_ptr<nvinfer1::ICudaEngine> mEngine; //!< The TensorRT engine used to run the network
+    samplesCommon::SampleUniquePtr<nvinfer1::IExecutionContext> mContext; //!< Context of the session, null on failure
+    samplesCommon::BufferManager mBuffers;          //!< Host and device buffers of all bindings
+    TensorDesc mInput;                              //!< The network input
+    std::vector<TensorDesc> mOutputs;               //!< The network outputs
+};
+
+} // namespace pinet
+
+#endif // PINET_TENSORRT_BACKEND_H
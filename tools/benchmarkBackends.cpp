@@ -0,0 +1,216 @@
+//!
+//! benchmarkBackends.cpp
+//! Compares the throughput and the outputs of the backends which run the network without TensorRT: the built-in
+//! CPU engine of --backend=cpu and cv::dnn of --backend=opencv.
+//! It can be run as: ./benchmarkBackends [model] [clip directory] [threads] [runs] [dnn target]...
+//! The images of the clip directory, data/1492638000682869180 by default, are decoded and preprocessed once as
+//! PINetTensorrt does, then every backend runs the model, pinet.onnx by default, on all of them runs times, 3 by
+//! default, one image per call on threads threads, all cores by default. cv::dnn runs with each given target,
+//! cpu by default. The outputs of every backend are compared with those of the CPU engine.
+//! Fails if the model or the images cannot be read, a backend cannot run the model, or an output differs from
+//! that of the CPU engine by more than 1e-3 of its largest magnitude, 1e-2 for half precision targets.
+//!
+
+#include "checkHarness.h"
+#include "cpuEngine.h"
+#include "directoryScanner.h"
+#include "imageDecode.h"
+#include "onnxModel.h"
+#include "onnxOptimizer.h"
+#include "opencvBackend.h"
+#include "preprocess.h"
+#include "stageTiming.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+//!
+//! \brief The outputs of every image, in the order of the backend outputs.
+//!
+using Outputs = std::vector<std::vector<std::vector<float>>>;
+
+//!
+//! \brief Runs backend on all inputs runs times after a warm up call, and keeps the outputs of the first run.
+//!
+//! \return the milliseconds per image, or a negative value if an inference failed
+//!
+double run(pinet::InferenceBackend& backend, std::vector<std::vector<float>> const& inputs, int32_t runs,
+    Outputs& outputs)
+{
+    float* input = backend.getInputBuffer();
+    std::copy(inputs[0].begin(), inputs[0].end(), input);
+    if (!backend.infer())
+    {
+        return -1.0;
+    }
+
+    outputs.assign(inputs.size(), {});
+    auto const start = pinet::Clock::now();
+    for (int32_t r = 0; r < runs; ++r)
+    {
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            std::copy(inputs[i].begin(), inputs[i].end(), input);
+            if (!backend.infer())
+            {
+                return -1.0;
+            }
+            for (size_t o = 0; r == 0 && o < backend.getOutputs().size(); ++o)
+            {
+                float const* output = backend.getOutputBuffer(static_cast<int32_t>(o));
+                outputs[i].emplace_back(output, output + backend.getOutputs()[o].volume());
+            }
+        }
+    }
+    return pinet::elapsedMs(start) / (static_cast<double>(runs) * inputs.size());
+}
+
+//!
+//! \brief Returns the largest difference between the outputs of one output index, relative to the largest
+//!        magnitude of the expected output of the same image.
+//!
+double getRelativeError(Outputs const& actual, Outputs const& expected, size_t output)
+{
+    double error = 0.0;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        std::vector<float> const& a = actual[i][output];
+        std::vector<float> const& e = expected[i][output];
+        double magnitude = 1e-6;
+        double difference = 0.0;
+        for (size_t k = 0; k < e.size(); ++k)
+        {
+            magnitude = std::max(magnitude, static_cast<double>(std::fabs(e[k])));
+            difference = std::max(difference, static_cast<double>(std::fabs(a[k] - e[k])));
+        }
+        error = std::max(error, difference / magnitude);
+    }
+    return error;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string const model = argc > 1 ? argv[1] : "pinet.onnx";
+    std::string const clip = argc > 2 ? argv[2] : "data/1492638000682869180";
+    int32_t const cores = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+    int32_t const threads = argc > 3 ? std::max(1, std::atoi(argv[3])) : cores;
+    int32_t const runs = argc > 4 ? std::max(1, std::atoi(argv[4])) : 3;
+    std::vector<pinet::DnnTarget> targets;
+    for (int32_t a = 5; a < argc; ++a)
+    {
+        targets.emplace_back();
+        if (!pinet::parseDnnTarget(argv[a], targets.back()))
+        {
+            std::cerr << "Unknown cv::dnn target " << argv[a] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (targets.empty())
+    {
+        targets.push_back(pinet::DnnTarget::kCPU);
+    }
+
+    pinet::ProtoMessage proto;
+    std::vector<std::string> outputNames;
+    pinet::NormalizeParams normalize;
+    auto network = std::make_shared<pinet::CpuNetwork>();
+    if (!pinet::readModel(model, proto) || !pinet::getGraphOutputs(proto, outputNames)
+        || !pinet::getInputNormalization(proto, normalize) || !network->load(model, outputNames))
+    {
+        return EXIT_FAILURE;
+    }
+    pinet::CpuBackend cpu(network, 1, threads);
+    std::vector<int32_t> const& dims = cpu.getInput().dims;
+
+    // Images are preprocessed as PINetTensorrt::processInput does, in the order PINetTensorrt reads them in
+    std::vector<std::vector<float>> inputs;
+    pinet::DirectoryScanner scanner({clip}, ".jpg", 1, true);
+    std::vector<uint8_t> buffer;
+    for (std::string fileName; scanner.next(fileName);)
+    {
+        cv::Mat image;
+        if (!pinet::decodeImage(fileName, dims[3], dims[2], buffer, image))
+        {
+            std::cerr << "Cannot read " << fileName << std::endl;
+            return EXIT_FAILURE;
+        }
+        inputs.emplace_back(cpu.getInput().volume());
+        pinet::resizeNormalizeHwcToChw(
+            image.ptr<uchar>(), image.cols, image.rows, image.step, inputs.back().data(), dims[3], dims[2], normalize);
+    }
+    if (inputs.empty())
+    {
+        std::cerr << "No image in " << clip << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << inputs.size() << " images of " << clip << ", " << runs << " runs on " << threads << " threads"
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    Outputs expected;
+    double const cpuMs = run(cpu, inputs, runs, expected);
+    check(cpuMs >= 0.0, "The CPU engine runs " + model);
+    if (cpuMs < 0.0)
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "cpu:                 " << cpuMs << " ms per image, " << 1000.0 / cpuMs << " images/s, GEMM with "
+              << (pinet::isGemmVectorized() ? "AVX2" : "plain loops") << std::endl;
+
+    cv::setNumThreads(threads);
+    for (pinet::DnnTarget const target : targets)
+    {
+        std::string const name = std::string("opencv ") + pinet::toString(target);
+        pinet::OpenCVBackend opencv(model, outputNames, 1, target);
+        Outputs outputs;
+        double const ms = opencv.load() ? run(opencv, inputs, runs, outputs) : -1.0;
+        check(ms >= 0.0, "cv::dnn runs " + model + " on the " + pinet::toString(target) + " target");
+        if (ms < 0.0)
+        {
+            continue;
+        }
+        std::cout << std::left << std::setw(21) << (name + ":") << std::right << ms << " ms per image, "
+                  << 1000.0 / ms << " images/s, " << cpuMs / ms << "x the CPU engine" << std::endl;
+
+        bool sameShapes = true;
+        for (size_t o = 0; o < outputNames.size(); ++o)
+        {
+            sameShapes = sameShapes && opencv.getOutputs()[o].dims == cpu.getOutputs()[o].dims;
+        }
+        check(sameShapes, name + " has the output shapes of the CPU engine");
+        if (!sameShapes)
+        {
+            continue;
+        }
+
+        bool const half = target == pinet::DnnTarget::kOPENCL_FP16 || target == pinet::DnnTarget::kCUDA_FP16;
+        double const tolerance = half ? 1e-2 : 1e-3;
+        for (size_t o = 0; o < outputNames.size(); ++o)
+        {
+            double const error = getRelativeError(outputs, expected, o);
+            std::ostringstream what;
+            what << std::scientific << std::setprecision(2) << name << " " << outputNames[o]
+                 << " matches the CPU engine within " << error;
+            check(error <= tolerance, what.str());
+        }
+    }
+
+    return pinet::reportChecks();
+}
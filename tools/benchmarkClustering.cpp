@@ -0,0 +1,279 @@
+//!
+//! benchmarkClustering.cpp
+//! Compares pinet::LaneClusterer with the clustering generateLaneLine used before it, frame by frame.
+//! It can be run as: ./benchmarkClustering [recording] [iterations]
+//! The recording is written by PINetTensorrt --recordOutputs, random lanes are generated without it, followed by
+//! frames whose points lie within rounding of the threshold distance from a lane or of the same distance from two
+//! lanes, where only computing the distances as before assigns them as before.
+//! Fails if any key point is assigned to another lane than before.
+//!
+
+#include "checkHarness.h"
+#include "keyPoints.h"
+#include "laneClustering.h"
+#include "outputPlan.h"
+#include "replayBackend.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+constexpr float kTHRESHOLD_POINT = 0.81f;
+constexpr float kTHRESHOLD_INSTANCE = 0.22f;
+
+//!
+//! \brief The confidence, offset and instance outputs of one image.
+//!
+struct FrameOutputs
+{
+    std::vector<float> confidence;
+    std::vector<float> offsets;
+    std::vector<float> features;
+};
+
+//!
+//! \brief The clustering of generateLaneLine before LaneClusterer, returns the lane of each key point.
+//!
+std::vector<int32_t> clusterLegacy(pinet::KeyPoints const& keyPoints)
+{
+    std::vector<int32_t> assignments;
+    std::vector<size_t> laneSizes;
+    std::vector<cv::Vec4f> laneFeatures;
+
+    auto findNearestFeature = [&laneFeatures](const cv::Vec4f& feature) -> std::pair<int, float> {
+        int index = -1;
+        float min_feature_dis = 10000.;
+        for (int i = 0; i < laneFeatures.size(); ++i)
+        {
+            auto delta = laneFeatures[i] - feature;
+            auto alpha = pow(delta[0], 2) + pow(delta[1], 2) + pow(delta[2], 2) + pow(delta[3], 2);
+            if (sqrt(alpha) <= min_feature_dis)
+            {
+                index = i;
+                min_feature_dis = sqrt(alpha);
+            }
+        }
+        return std::pair<int, float>(index, min_feature_dis);
+    };
+
+    for (int32_t k = 0; k < keyPoints.count; ++k)
+    {
+        const cv::Vec4f feature(keyPoints.features[0][k], keyPoints.features[1][k], keyPoints.features[2][k],
+            keyPoints.features[3][k]);
+        std::pair<int, float> lane_index = findNearestFeature(feature);
+        if (lane_index.first != -1 && lane_index.second <= kTHRESHOLD_INSTANCE)
+        {
+            auto& lanefeature = laneFeatures[lane_index.first];
+            auto point_size = laneSizes[lane_index.first];
+            lanefeature = lanefeature.mul(cv::Vec4f::all(point_size)) + feature;
+            lanefeature = lanefeature.mul(cv::Vec4f::all(1.f / (point_size + 1)));
+            ++laneSizes[lane_index.first];
+            assignments.push_back(lane_index.first);
+        }
+        else
+        {
+            assignments.push_back(static_cast<int32_t>(laneFeatures.size()));
+            laneFeatures.emplace_back(feature);
+            laneSizes.push_back(1);
+        }
+    }
+    return assignments;
+}
+
+//!
+//! \brief Reads the outputs read by post-processing of every frame of a loaded recording.
+//!
+void readRecording(pinet::ReplayBackend& replay, pinet::LaneHeads const& heads, std::vector<FrameOutputs>& frames)
+{
+    int32_t const indices[3] = {heads.confidence, heads.offset, heads.instance};
+    for (int64_t f = 0; f < replay.getFrameCount(); ++f)
+    {
+        replay.infer();
+        FrameOutputs frame;
+        std::vector<float>* outputs[3] = {&frame.confidence, &frame.offsets, &frame.features};
+        for (int32_t o = 0; o < 3; ++o)
+        {
+            float const* data = replay.getOutputBuffer(indices[o]);
+            outputs[o]->assign(data, data + replay.getOutputs()[indices[o]].volume());
+        }
+        frames.push_back(std::move(frame));
+    }
+}
+
+//!
+//! \brief Generates frames with a few lanes of noisy features plus scattered outliers.
+//!
+void generateFrames(int32_t height, int32_t width, int32_t count, std::vector<FrameOutputs>& frames)
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    std::normal_distribution<float> noise(0.f, 0.04f);
+    int32_t const cells = height * width;
+    for (int32_t f = 0; f < count; ++f)
+    {
+        FrameOutputs frame;
+        frame.confidence.resize(cells);
+        frame.offsets.resize(2 * cells);
+        frame.features.resize(4 * cells);
+
+        std::vector<cv::Vec4f> laneFeatures(3 + f % 4);
+        for (auto& feature : laneFeatures)
+        {
+            feature = cv::Vec4f(uniform(generator), uniform(generator), uniform(generator), uniform(generator));
+        }
+        for (int32_t c = 0; c < cells; ++c)
+        {
+            int32_t const x = c % width;
+            int32_t const lane = x * static_cast<int32_t>(laneFeatures.size()) / width;
+            bool const outlier = uniform(generator) < 0.05f;
+            frame.confidence[c] = uniform(generator) < 0.2f || outlier ? 0.9f : 0.1f;
+            frame.offsets[c] = uniform(generator);
+            frame.offsets[cells + c] = uniform(generator);
+            for (int32_t d = 0; d < 4; ++d)
+            {
+                frame.features[d * cells + c]
+                    = outlier ? uniform(generator) : laneFeatures[lane][d] + noise(generator);
+            }
+        }
+        frames.push_back(std::move(frame));
+    }
+}
+
+//!
+//! \brief Generates frames of unrelated groups of three key points. The first two start lanes, the third lies
+//!        within a few ulps of the threshold distance from the first or halfway between both.
+//!
+void generateBoundaryFrames(int32_t height, int32_t width, int32_t count, std::vector<FrameOutputs>& frames)
+{
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    std::uniform_real_distribution<float> direction(-1.f, 1.f);
+    int32_t const cells = height * width;
+    for (int32_t f = 0; f < count; ++f)
+    {
+        FrameOutputs frame;
+        frame.confidence.assign(cells, 0.9f);
+        frame.offsets.assign(2 * cells, 0.5f);
+        frame.features.resize(4 * cells);
+        for (int32_t c = 0; c + 3 <= cells; c += 3)
+        {
+            // Groups lie two units apart, far beyond the threshold from each other
+            int32_t const group = c / 3;
+            float const base[4]
+                = {2.f * (group % 8), 2.f * (group / 8 % 8), 2.f * (group / 64 % 8), 2.f * (group / 512)};
+            float first[4];
+            float step[4];
+            float norm = 0.f;
+            for (int32_t d = 0; d < 4; ++d)
+            {
+                first[d] = base[d] + 0.5f * uniform(generator);
+                step[d] = direction(generator);
+                norm += step[d] * step[d];
+            }
+            bool const tie = group % 2 == 1;
+            float const length = kTHRESHOLD_INSTANCE * (1.f + 4e-7f * direction(generator));
+            for (int32_t d = 0; d < 4; ++d)
+            {
+                float const unit = step[d] / std::sqrt(norm);
+                float const second = first[d] + (tie ? 0.3f : -0.3f) * unit;
+                frame.features[d * cells + c] = first[d];
+                frame.features[d * cells + c + 1] = second;
+                frame.features[d * cells + c + 2]
+                    = tie ? 0.5f * (first[d] + second) + 1e-7f * direction(generator) : first[d] + length * unit;
+            }
+        }
+        frames.push_back(std::move(frame));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int32_t const iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    if (iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [recording] [iterations]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<FrameOutputs> frames;
+    pinet::TensorDesc const syntheticDescs[3] = {{"confidence", {1, 1, 32, 64}}, {"offset", {1, 2, 32, 64}},
+        {"instance", {1, 4, 32, 64}}};
+    pinet::TensorDesc const* descs = syntheticDescs;
+    pinet::TensorDesc recordedDescs[3];
+    std::unique_ptr<pinet::ReplayBackend> replay;
+    if (argc > 1)
+    {
+        replay.reset(new pinet::ReplayBackend(argv[1]));
+        pinet::LaneHeads heads;
+        if (!replay->load() || !pinet::findLaneHeads(replay->getOutputs(), {"input.1332", "1686", "1693"}, heads))
+        {
+            std::cerr << argv[1] << " is not a recording of the outputs read by post-processing" << std::endl;
+            return EXIT_FAILURE;
+        }
+        readRecording(*replay, heads, frames);
+        recordedDescs[0] = replay->getOutputs()[heads.confidence];
+        recordedDescs[1] = replay->getOutputs()[heads.offset];
+        recordedDescs[2] = replay->getOutputs()[heads.instance];
+        descs = recordedDescs;
+    }
+    else
+    {
+        generateFrames(32, 64, 100, frames);
+        generateBoundaryFrames(32, 64, 20, frames);
+    }
+
+    pinet::KeyPoints keyPoints;
+    pinet::LaneClusterer clusterer(descs[0].dims[2] * descs[0].dims[3]);
+    double legacyMs = 0.;
+    double clustererMs = 0.;
+    int64_t keyPointCount = 0;
+    int32_t mismatches = 0;
+    for (auto const& frame : frames)
+    {
+        pinet::extractKeyPoints(pinet::PlanarView<float const>(frame.confidence.data(), descs[0]),
+            pinet::PlanarView<float const>(frame.offsets.data(), descs[1]),
+            pinet::PlanarView<float const>(frame.features.data(), descs[2]), kTHRESHOLD_POINT, keyPoints);
+        keyPointCount += keyPoints.count;
+
+        std::vector<int32_t> expected;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int32_t i = 0; i < iterations; ++i)
+        {
+            expected = clusterLegacy(keyPoints);
+        }
+        auto middle = std::chrono::high_resolution_clock::now();
+        for (int32_t i = 0; i < iterations; ++i)
+        {
+            clusterer.cluster(keyPoints, kTHRESHOLD_INSTANCE);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        legacyMs += std::chrono::duration<double, std::milli>(middle - start).count() / iterations;
+        clustererMs += std::chrono::duration<double, std::milli>(end - middle).count() / iterations;
+
+        mismatches += !std::equal(expected.begin(), expected.end(), clusterer.getAssignments());
+    }
+
+    std::cout << frames.size() << " frames, " << keyPointCount / static_cast<double>(frames.size())
+              << " key points per frame" << std::endl;
+    std::cout << "legacy:    " << legacyMs / frames.size() << " ms per frame" << std::endl;
+    std::cout << "clusterer: " << clustererMs / frames.size() << " ms per frame, speedup "
+              << legacyMs / clustererMs << "x" << std::endl;
+    check(mismatches == 0, std::to_string(mismatches) + " frames with different lane assignments");
+    return pinet::reportChecks();
+}
@@ -0,0 +1,174 @@
+//!
+//! benchmarkDecode.cpp
+//! Compares decoding JPEG images at full size with decoding them scaled down by the decoder, each followed by
+//! the fused resize and normalization to the network input.
+//! It can be run as: ./benchmarkDecode [image directory] [width] [height] [iterations]
+//! The directory defaults to the bundled images and the size to the network input, 512x256.
+//! Prints the time of both paths and how far the network inputs they produce are from each other and from an
+//! area average of the full size image, which does not alias. Fails if a reduced image does not cover the
+//! network input or its input differs from the full decode by more than 4 / 255 on average.
+//!
+
+#include "directoryScanner.h"
+#include "imageDecode.h"
+#include "preprocess.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+template <typename Function>
+double measureMs(int32_t iterations, Function function)
+{
+    // One untimed call warms up the caches and the file system
+    function();
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (int32_t i = 0; i < iterations; ++i)
+    {
+        function();
+    }
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+//!
+//! \brief Accumulates the absolute differences between two network inputs.
+//!
+struct Difference
+{
+    double sum{0.0};
+    int64_t count{0};
+    float max{0.f};
+
+    void add(std::vector<float> const& a, std::vector<float> const& b)
+    {
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            float const diff = std::abs(a[i] - b[i]);
+            sum += diff;
+            max = std::max(max, diff);
+        }
+        count += a.size();
+    }
+
+    double mean() const
+    {
+        return count ? sum / count : 0.0;
+    }
+};
+
+std::ostream& operator<<(std::ostream& stream, Difference const& difference)
+{
+    return stream << "mean abs diff " << difference.mean() * 255 << " / 255, max " << difference.max * 255
+                  << " / 255";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string const directory = argc > 1 ? argv[1] : "data/1492638000682869180";
+    int32_t const width = argc > 2 ? std::atoi(argv[2]) : 512;
+    int32_t const height = argc > 3 ? std::atoi(argv[3]) : 256;
+    int32_t const iterations = argc > 4 ? std::atoi(argv[4]) : 20;
+    if (width <= 0 || height <= 0 || iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [image directory] [width] [height] [iterations]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> files;
+    pinet::DirectoryScanner scanner({directory}, ".jpg", 1, true);
+    for (std::string file; scanner.next(file);)
+    {
+        files.push_back(file);
+    }
+    if (files.empty())
+    {
+        std::cerr << "No .jpg image in " << directory << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    size_t const volume = static_cast<size_t>(width) * height * 3;
+    std::vector<float> full(volume);
+    std::vector<float> reduced(volume);
+    std::vector<float> area(volume);
+    std::vector<uint8_t> buffer;
+    double fullMs = 0.0;
+    double reducedMs = 0.0;
+    Difference reducedToFull;
+    Difference fullToArea;
+    Difference reducedToArea;
+    bool covered = true;
+    std::vector<int32_t> scales(9, 0);
+
+    for (auto const& file : files)
+    {
+        cv::Mat fullImage;
+        fullMs += measureMs(iterations, [&] {
+            fullImage = cv::imread(file, cv::IMREAD_COLOR);
+            pinet::resizeNormalizeHwcToChw(
+                fullImage.ptr<uint8_t>(), fullImage.cols, fullImage.rows, fullImage.step, full.data(), width, height);
+        });
+        cv::Mat reducedImage;
+        int32_t scale = 1;
+        reducedMs += measureMs(iterations, [&] {
+            pinet::decodeImage(file, width, height, buffer, reducedImage, &scale);
+            pinet::resizeNormalizeHwcToChw(reducedImage.ptr<uint8_t>(), reducedImage.cols, reducedImage.rows,
+                reducedImage.step, reduced.data(), width, height);
+        });
+        ++scales[scale];
+        covered = covered && reducedImage.cols >= width && reducedImage.rows >= height;
+
+        int32_t jpegWidth = 0;
+        int32_t jpegHeight = 0;
+        if (!pinet::getJpegSize(buffer.data(), buffer.size(), jpegWidth, jpegHeight) || jpegWidth != fullImage.cols
+            || jpegHeight != fullImage.rows)
+        {
+            std::cout << file << ": the JPEG header does not give the decoded size" << std::endl;
+        }
+
+        cv::Mat areaImage;
+        cv::resize(fullImage, areaImage, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+        pinet::normalizeHwcToChw(areaImage.ptr<uint8_t>(), width, height, areaImage.step, area.data());
+
+        reducedToFull.add(reduced, full);
+        fullToArea.add(full, area);
+        reducedToArea.add(reduced, area);
+    }
+
+    std::cout << files.size() << " images to " << width << "x" << height << ", " << iterations << " iterations"
+              << std::endl;
+    for (int32_t scale = 1; scale <= 8; scale *= 2)
+    {
+        if (scales[scale])
+        {
+            std::cout << "reduced by " << scale << ": " << scales[scale] << " images" << std::endl;
+        }
+    }
+    std::cout << "full decode + resize:    " << fullMs / files.size() << " ms per image" << std::endl;
+    std::cout << "reduced decode + resize: " << reducedMs / files.size() << " ms per image, speedup "
+              << fullMs / reducedMs << "x" << std::endl;
+    std::cout << "reduced vs full: " << reducedToFull << std::endl;
+    std::cout << "full vs area:    " << fullToArea << std::endl;
+    std::cout << "reduced vs area: " << reducedToArea << std::endl;
+
+    bool const ok = covered && reducedToFull.mean() <= 4.0 / 255.0;
+    if (!covered)
+    {
+        std::cout << "A reduced image does not cover the network input" << std::endl;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,327 @@
+//!
+//! benchmarkLaneFit.cpp
+//! Checks and times the lane models of PINetTensorrt --fitLanes, and compares their serialized size with the
+//! points of the lane lines.
+//! It can be run as: ./benchmarkLaneFit [recording] [iterations]
+//! The recording is written by PINetTensorrt --recordOutputs and gives the lane lines of every frame, random
+//! lanes are generated without it. Each degree fits every lane iterations times.
+//! Fails if exact polynomials are not recovered, if degenerate lanes are not fitted with a lower degree, or if
+//! the serialized models do not read back as written.
+//!
+
+#include "checkHarness.h"
+#include "frame.h"
+#include "keyPoints.h"
+#include "laneClustering.h"
+#include "laneModel.h"
+#include "outputPlan.h"
+#include "replayBackend.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+constexpr float kTHRESHOLD_POINT = 0.81f;
+constexpr float kTHRESHOLD_INSTANCE = 0.22f;
+constexpr int32_t kGRID_WIDTH = 64;
+constexpr int32_t kGRID_HEIGHT = 32;
+
+//!
+//! \brief Extracts the lane lines of one recorded frame as generateLaneLine does.
+//!
+pinet::LaneLines getLaneLines(pinet::ReplayBackend& replay, pinet::LaneHeads const& heads, pinet::KeyPoints& keyPoints,
+    pinet::LaneClusterer& clusterer)
+{
+    auto const& outputs = replay.getOutputs();
+    pinet::extractKeyPoints(
+        pinet::PlanarView<float const>(replay.getOutputBuffer(heads.confidence), outputs[heads.confidence]),
+        pinet::PlanarView<float const>(replay.getOutputBuffer(heads.offset), outputs[heads.offset]),
+        pinet::PlanarView<float const>(replay.getOutputBuffer(heads.instance), outputs[heads.instance]),
+        kTHRESHOLD_POINT, keyPoints);
+    clusterer.cluster(keyPoints, kTHRESHOLD_INSTANCE);
+
+    // Lanes of a single point are dropped
+    pinet::LaneLines all(clusterer.getLaneCount());
+    for (int32_t k = 0; k < keyPoints.count; ++k)
+    {
+        all[clusterer.getAssignments()[k]].emplace_back(keyPoints.xs[k], keyPoints.ys[k]);
+    }
+    pinet::LaneLines laneLines;
+    for (auto& laneLine : all)
+    {
+        if (laneLine.size() >= 2)
+        {
+            laneLines.push_back(std::move(laneLine));
+        }
+    }
+    return laneLines;
+}
+
+//!
+//! \brief Generates a lane of one point per key point row, a parabola seen in perspective plus noise.
+//!
+pinet::LaneLine generateLane(std::mt19937& generator, float noise)
+{
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    std::normal_distribution<float> jitter(0.f, noise);
+    int32_t const top = static_cast<int32_t>(uniform(generator) * kGRID_HEIGHT / 2);
+    float const bottomX = uniform(generator) * kGRID_WIDTH;
+    float const vanishingX = kGRID_WIDTH / 2 + (uniform(generator) - 0.5f) * 8.f;
+    float const bend = (uniform(generator) - 0.5f) * 8.f;
+
+    pinet::LaneLine lane;
+    for (int32_t row = top; row < kGRID_HEIGHT; ++row)
+    {
+        float const t = (row + 0.5f - top) / (kGRID_HEIGHT - top);
+        float const x = vanishingX + (bottomX - vanishingX) * t + bend * t * (1.f - t) + jitter(generator);
+        lane.emplace_back(x, row + 0.5f);
+    }
+    return lane;
+}
+
+//!
+//! \brief Checks that points taken from a polynomial in y of each degree are fitted exactly.
+//!
+void checkExactFits()
+{
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> coefficient(-1.f, 1.f);
+    for (int32_t degree = 0; degree <= pinet::kLANE_MODEL_MAX_DEGREE; ++degree)
+    {
+        // Coefficients of x in y, scaled so that x stays within a few grid widths
+        double coefficients[pinet::kLANE_MODEL_MAX_DEGREE + 1]{};
+        for (int32_t k = 0; k <= degree; ++k)
+        {
+            coefficients[k] = coefficient(generator) * kGRID_WIDTH / std::pow(kGRID_HEIGHT, k);
+        }
+        pinet::LaneLine points;
+        for (int32_t row = 3; row < kGRID_HEIGHT; row += 2)
+        {
+            double x = 0.0;
+            for (int32_t k = degree; k >= 0; --k)
+            {
+                x = x * (row + 0.5) + coefficients[k];
+            }
+            points.emplace_back(static_cast<float>(x), row + 0.5f);
+        }
+
+        pinet::LaneModel model;
+        bool const fitted = pinet::fitLaneModel(points.data(), static_cast<int32_t>(points.size()), degree, model);
+        float worst = 0.f;
+        for (auto const& point : points)
+        {
+            worst = std::max(worst, std::abs(pinet::evaluateLaneModel(model, point.y) - point.x));
+        }
+        check(fitted && model.degree == degree && worst < 1e-3f && model.residual < 1e-3f
+                && model.support == static_cast<int32_t>(points.size()),
+            "degree " + std::to_string(degree) + " polynomial is recovered, worst error " + std::to_string(worst));
+
+        // Fitting with a higher degree than the points follow leaves the extra terms near 0
+        pinet::LaneModel higher;
+        pinet::fitLaneModel(points.data(), static_cast<int32_t>(points.size()), pinet::kLANE_MODEL_MAX_DEGREE, higher);
+        float higherWorst = 0.f;
+        for (auto const& point : points)
+        {
+            higherWorst = std::max(higherWorst, std::abs(pinet::evaluateLaneModel(higher, point.y) - point.x));
+        }
+        check(higherWorst < 1e-3f, "degree " + std::to_string(degree) + " polynomial is recovered by a cubic");
+    }
+}
+
+//!
+//! \brief Checks that lanes which do not determine the requested degree are fitted with a lower one.
+//!
+void checkDegenerateFits()
+{
+    pinet::LaneModel model;
+    check(!pinet::fitLaneModel(nullptr, 0, 2, model), "no point is not fitted");
+
+    cv::Point2f const single(12.5f, 20.5f);
+    check(pinet::fitLaneModel(&single, 1, 2, model) && model.degree == 0
+            && pinet::evaluateLaneModel(model, 7.f) == single.x,
+        "a single point is fitted with a constant");
+
+    cv::Point2f const two[] = {{10.f, 4.5f}, {20.f, 24.5f}};
+    check(pinet::fitLaneModel(two, 2, 3, model) && model.degree == 1
+            && std::abs(pinet::evaluateLaneModel(model, 14.5f) - 15.f) < 1e-4f,
+        "two points are fitted with a line");
+
+    // Points on two rows determine a line whatever their number
+    cv::Point2f const rows[] = {{10.f, 4.5f}, {11.f, 4.5f}, {20.f, 24.5f}, {21.f, 24.5f}, {22.f, 24.5f}};
+    check(pinet::fitLaneModel(rows, 5, 3, model) && model.degree == 1
+            && std::abs(pinet::evaluateLaneModel(model, 4.5f) - 10.5f) < 1e-4f
+            && std::abs(pinet::evaluateLaneModel(model, 24.5f) - 21.f) < 1e-4f,
+        "points on two rows are fitted with a line through the mean of each row");
+
+    cv::Point2f const row[] = {{10.f, 4.5f}, {12.f, 4.5f}, {17.f, 4.5f}};
+    check(pinet::fitLaneModel(row, 3, 2, model) && model.degree == 0 && model.yMin == model.yMax
+            && std::abs(pinet::evaluateLaneModel(model, 4.5f) - 13.f) < 1e-4f,
+        "points on a single row are fitted with their mean");
+}
+
+bool sameModel(pinet::LaneModel const& a, pinet::LaneModel const& b)
+{
+    return a.degree == b.degree && a.support == b.support && a.yMin == b.yMin && a.yMax == b.yMax
+        && a.residual == b.residual
+        && std::equal(a.coefficients, a.coefficients + a.degree + 1, b.coefficients);
+}
+
+//!
+//! \brief Checks that serialized models read back as written and that damaged frames are rejected.
+//!
+void checkSerialization()
+{
+    std::mt19937 generator(9);
+    std::vector<pinet::LaneModel> models;
+    for (int32_t degree = 0; degree <= pinet::kLANE_MODEL_MAX_DEGREE; ++degree)
+    {
+        pinet::LaneLine const lane = generateLane(generator, 0.2f);
+        models.emplace_back();
+        pinet::fitLaneModel(lane.data(), static_cast<int32_t>(lane.size()), degree, models.back());
+    }
+
+    int32_t const count = static_cast<int32_t>(models.size());
+    size_t const size = pinet::getSerializedSize(models.data(), count);
+    std::vector<uint8_t> buffer(size);
+    check(pinet::serializeLaneModels(models.data(), count, buffer.data()) == size,
+        "serialized models take " + std::to_string(size) + " bytes for " + std::to_string(count) + " lanes");
+
+    std::vector<pinet::LaneModel> read(pinet::kLANE_MODEL_MAX_COUNT);
+    int32_t readCount = 0;
+    bool same = pinet::deserializeLaneModels(buffer.data(), size, read.data(), readCount) == size && readCount == count;
+    for (int32_t m = 0; same && m < count; ++m)
+    {
+        same = sameModel(models[m], read[m]);
+    }
+    check(same, "serialized models read back as written");
+
+    uint8_t const empty = 0;
+    check(pinet::getSerializedSize(nullptr, 0) == 1
+            && pinet::deserializeLaneModels(&empty, 1, read.data(), readCount) == 1 && readCount == 0,
+        "a frame without lanes takes 1 byte");
+
+    bool truncated = true;
+    for (size_t s = 0; s < size; ++s)
+    {
+        truncated = truncated && pinet::deserializeLaneModels(buffer.data(), s, read.data(), readCount) == 0;
+    }
+    check(truncated, "truncated frames are rejected");
+
+    std::vector<uint8_t> damaged = buffer;
+    damaged[1] = pinet::kLANE_MODEL_MAX_DEGREE + 1;
+    check(pinet::deserializeLaneModels(damaged.data(), size, read.data(), readCount) == 0,
+        "a degree above the maximum is rejected");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int32_t const iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    if (iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [recording] [iterations]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    checkExactFits();
+    checkDegenerateFits();
+    checkSerialization();
+
+    // Lane lines of the recording, or generated ones with the spread of key points of PINet
+    std::vector<pinet::LaneLine> lanes;
+    if (argc > 1)
+    {
+        pinet::ReplayBackend replay(argv[1]);
+        pinet::LaneHeads heads;
+        if (!replay.load()
+            || (!pinet::findLaneHeads(replay.getOutputs(), {"input.1332", "1686", "1693"}, heads)
+                && !pinet::findLaneHeads(replay.getOutputs(), {"input.672", "1438", "1445"}, heads)))
+        {
+            std::cerr << argv[1] << " is not a recording of the outputs read by post-processing" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::vector<int32_t> const& grid = replay.getOutputs()[heads.confidence].dims;
+        pinet::KeyPoints keyPoints;
+        pinet::LaneClusterer clusterer(grid[2] * grid[3]);
+        for (int64_t f = 0; f < replay.getFrameCount(); ++f)
+        {
+            replay.infer();
+            for (auto& laneLine : getLaneLines(replay, heads, keyPoints, clusterer))
+            {
+                lanes.push_back(std::move(laneLine));
+            }
+        }
+        std::cout << replay.getFrameCount() << " frames of " << argv[1] << ", ";
+    }
+    else
+    {
+        std::mt19937 generator(3);
+        for (int32_t l = 0; l < 1000; ++l)
+        {
+            lanes.push_back(generateLane(generator, 0.3f));
+        }
+        std::cout << "Random lanes, ";
+    }
+    int64_t pointCount = 0;
+    for (auto const& lane : lanes)
+    {
+        pointCount += lane.size();
+    }
+    std::cout << lanes.size() << " lanes, " << pointCount / std::max<double>(lanes.size(), 1.) << " points per lane"
+              << std::endl;
+    if (lanes.empty())
+    {
+        return pinet::reportChecks();
+    }
+
+    int64_t const pointBytes = pointCount * sizeof(cv::Point2f);
+    std::vector<pinet::LaneModel> models(lanes.size());
+    for (int32_t degree = 1; degree <= pinet::kLANE_MODEL_MAX_DEGREE; ++degree)
+    {
+        auto const start = std::chrono::high_resolution_clock::now();
+        for (int32_t i = 0; i < iterations; ++i)
+        {
+            for (size_t l = 0; l < lanes.size(); ++l)
+            {
+                pinet::fitLaneModel(lanes[l].data(), static_cast<int32_t>(lanes[l].size()), degree, models[l]);
+            }
+        }
+        double const fitUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start)
+                                 .count()
+            / (static_cast<double>(iterations) * lanes.size());
+
+        double residual = 0.;
+        for (auto const& model : models)
+        {
+            residual += model.residual;
+        }
+        // Lanes take the same bytes whatever frame they are in, frames only add their lane count
+        int64_t modelBytes = 0;
+        for (auto const& model : models)
+        {
+            modelBytes += pinet::getSerializedSize(&model, 1) - 1;
+        }
+        std::cout << "degree " << degree << ": " << std::fixed << std::setprecision(3) << fitUs << " us per lane, "
+                  << residual / models.size() << " cells residual, " << modelBytes << " bytes of models for "
+                  << pointBytes << " bytes of points (" << std::setprecision(1) << 100. * modelBytes / pointBytes
+                  << "%)" << std::endl;
+    }
+
+    return pinet::reportChecks();
+}
@@ -0,0 +1,173 @@
+//!
+//! benchmarkPreprocess.cpp
+//! Compares the preprocessing of preprocess.h with the code PINetTensorrt used before it: the normalization
+//! kernels with the per-pixel loop, and the fused resize with cv::resize followed by normalization.
+//! It can be run as: ./benchmarkPreprocess [width] [height] [iterations] [image]
+//! The image defaults to random 1280x720 pixels, the size of the bundled images.
+//!
+
+#include "preprocess.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+//!
+//! \brief The per-pixel division PINetTensorrt::processInput used to run.
+//!
+void normalizeReference(uint8_t const* src, int32_t width, int32_t height, float* dst)
+{
+    int32_t const inputC = 3;
+    for (int32_t c = 0; c < inputC; ++c)
+    {
+        for (int32_t j = 0, volChl = width * height; j < volChl; ++j)
+        {
+            dst[c * volChl + j] = float(src[j * inputC + c]) / 255.f;
+        }
+    }
+}
+
+template <typename Function>
+double measureMs(int32_t iterations, Function function)
+{
+    // One untimed call warms up the caches and the dispatch
+    function();
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (int32_t i = 0; i < iterations; ++i)
+    {
+        function();
+    }
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+float maxAbsDiff(std::vector<float> const& a, std::vector<float> const& b)
+{
+    float diff = 0.f;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+bool benchmarkNormalize(int32_t width, int32_t height, int32_t iterations)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int32_t> pixel(0, 255);
+    std::vector<uint8_t> image(static_cast<size_t>(width) * height * 3);
+    for (auto& value : image)
+    {
+        value = static_cast<uint8_t>(pixel(generator));
+    }
+
+    size_t const volume = static_cast<size_t>(width) * height * 3;
+    std::vector<float> reference(volume);
+    std::vector<float> output(volume);
+
+    double const referenceMs
+        = measureMs(iterations, [&] { normalizeReference(image.data(), width, height, reference.data()); });
+    std::cout << "normalize " << width << "x" << height << ", " << iterations << " iterations, best kernel is "
+              << pinet::toString(pinet::getSimdLevel()) << std::endl;
+    std::cout << "reference: " << referenceMs << " ms" << std::endl;
+
+    bool ok = true;
+    for (pinet::SimdLevel level :
+        {pinet::SimdLevel::kSCALAR, pinet::SimdLevel::kSSSE3, pinet::SimdLevel::kAVX2, pinet::SimdLevel::kNEON})
+    {
+        if (!pinet::isSupported(level))
+        {
+            continue;
+        }
+        double const ms = measureMs(iterations, [&] {
+            pinet::normalizeHwcToChw(
+                image.data(), width, height, width * 3, output.data(), pinet::NormalizeParams(), level);
+        });
+        float const diff = maxAbsDiff(reference, output);
+        std::cout << pinet::toString(level) << ": " << ms << " ms, speedup " << referenceMs / ms
+                  << "x, max abs diff " << diff << std::endl;
+        // pixel / 255 and pixel * (1 / 255) differ by at most one ulp of values in [0, 1]
+        ok = ok && diff <= 1e-7f;
+    }
+    return ok;
+}
+
+bool benchmarkResizeNormalize(cv::Mat const& image, int32_t width, int32_t height, int32_t iterations)
+{
+    size_t const volume = static_cast<size_t>(width) * height * 3;
+    std::vector<float> reference(volume);
+    std::vector<float> output(volume);
+
+    double const referenceMs = measureMs(iterations, [&] {
+        cv::Mat resized;
+        cv::resize(image, resized, cv::Size(width, height));
+        pinet::normalizeHwcToChw(resized.ptr<uint8_t>(), width, height, resized.step, reference.data());
+    });
+    double const fusedMs = measureMs(iterations, [&] {
+        pinet::resizeNormalizeHwcToChw(
+            image.ptr<uint8_t>(), image.cols, image.rows, image.step, output.data(), width, height);
+    });
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < volume; ++i)
+    {
+        mismatches += reference[i] != output[i];
+    }
+    float const diff = maxAbsDiff(reference, output);
+    std::cout << "resize " << image.cols << "x" << image.rows << " to " << width << "x" << height << ", "
+              << iterations << " iterations" << std::endl;
+    std::cout << "cv::resize + normalize: " << referenceMs << " ms" << std::endl;
+    std::cout << "fused: " << fusedMs << " ms, speedup " << referenceMs / fusedMs << "x, max abs diff " << diff
+              << ", " << mismatches << " of " << volume << " values differ" << std::endl;
+    // Only the rounding of the 8-bit intermediate may differ from the fixed point weights of cv::resize
+    return diff <= 1.f / 255.f + 1e-6f;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // Defaults are the network input size
+    int32_t const width = argc > 1 ? std::atoi(argv[1]) : 512;
+    int32_t const height = argc > 2 ? std::atoi(argv[2]) : 256;
+    int32_t const iterations = argc > 3 ? std::atoi(argv[3]) : 1000;
+    if (width <= 0 || height <= 0 || iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [width] [height] [iterations] [image]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    cv::Mat image;
+    if (argc > 4)
+    {
+        image = cv::imread(argv[4], cv::IMREAD_COLOR);
+        if (image.empty())
+        {
+            std::cerr << "Cannot read " << argv[4] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        image.create(720, 1280, CV_8UC3);
+        cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+    }
+
+    bool ok = benchmarkNormalize(width, height, iterations);
+    std::cout << std::endl;
+    ok = benchmarkResizeNormalize(image, width, height, iterations) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,241 @@
+//!
+//! checkAllocations.cpp
+//! Counts the heap allocations of the inference session in steady state, on the replay stand-in backend.
+//! It can be run as: ./checkAllocations [batch] [iterations]
+//! A synthetic recording with the output shapes of PINet is written to /tmp and replayed. Every iteration
+//! takes the frames of a batch from a pinet::FramePool as the source of the pipeline does, fills their inputs,
+//! packs them, runs the backend and unpacks the outputs into them as the infer workers do, extracts their lane
+//! lines and fits and serializes the lane models as the postprocess workers do, and hands the frames back to
+//! the pool as the sink does.
+//! Fails if any allocation happens once the session and the recycled frames are warmed up.
+//!
+
+#include "batching.h"
+#include "checkHarness.h"
+#include "framePool.h"
+#include "laneExtraction.h"
+#include "laneModel.h"
+#include "replayBackend.h"
+#include "tensorView.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+std::atomic<int64_t> gAllocations{0};
+
+constexpr int32_t kRECORDED_FRAMES = 8;
+constexpr int32_t kOUTPUT_BASE_INDEX = 3;
+constexpr float kTHRESHOLD_POINT = 0.81f;
+constexpr float kTHRESHOLD_INSTANCE = 0.22f;
+
+//!
+//! \brief Writes frameCount frames of random outputs shaped like those of PINet for one image.
+//!
+bool writeRecording(std::string const& fileName, int32_t frameCount)
+{
+    pinet::TensorDesc const input{"input.1", {1, 3, 256, 512}};
+    std::vector<pinet::TensorDesc> outputs;
+    for (auto const& prefix : {"first", "second"})
+    {
+        outputs.push_back({std::string(prefix) + ".confidence", {1, 1, 32, 64}});
+        outputs.push_back({std::string(prefix) + ".offset", {1, 2, 32, 64}});
+        outputs.push_back({std::string(prefix) + ".instance", {1, 4, 32, 64}});
+    }
+
+    pinet::OutputRecorder recorder;
+    if (!recorder.open(fileName, input, outputs))
+    {
+        return false;
+    }
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    std::vector<std::vector<float>> frame(outputs.size());
+    for (int32_t f = 0; f < frameCount; ++f)
+    {
+        for (size_t o = 0; o < outputs.size(); ++o)
+        {
+            frame[o].resize(outputs[o].volume());
+            for (auto& value : frame[o])
+            {
+                value = uniform(generator);
+            }
+        }
+        if (!recorder.write(frame))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    ++gAllocations;
+    if (void* pointer = std::malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int main(int argc, char** argv)
+{
+    int32_t const batchSize = argc > 1 ? std::atoi(argv[1]) : 1;
+    int32_t const iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    if (batchSize <= 0 || iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [batch] [iterations]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string const recording = "/tmp/checkAllocations" + std::to_string(getpid()) + ".bin";
+    if (!writeRecording(recording, kRECORDED_FRAMES))
+    {
+        return EXIT_FAILURE;
+    }
+
+    int64_t const setupStart = gAllocations;
+    pinet::ReplayBackend backend(recording, batchSize);
+    bool const loaded = backend.load();
+    std::remove(recording.c_str());
+    if (!loaded)
+    {
+        return EXIT_FAILURE;
+    }
+
+    pinet::TensorDesc const input = pinet::imageDesc(backend.getInput());
+    std::vector<pinet::TensorDesc> outputs;
+    for (auto const& output : backend.getOutputs())
+    {
+        outputs.push_back(pinet::imageDesc(output));
+    }
+    int32_t const cellCount = outputs[kOUTPUT_BASE_INDEX].dims[2] * outputs[kOUTPUT_BASE_INDEX].dims[3];
+
+    pinet::FramePool framePool;
+    std::vector<std::unique_ptr<pinet::Frame>> frames(batchSize);
+    std::vector<pinet::Frame*> batch(batchSize);
+    pinet::LaneExtractor extractor(cellCount);
+    std::vector<uint8_t> serialized(1 + pinet::kLANE_MODEL_MAX_COUNT * pinet::kLANE_MODEL_MAX_SIZE);
+    int64_t const setupAllocations = gAllocations - setupStart;
+
+    int64_t nextIndex = 0;
+    int64_t laneCount = 0;
+    auto runBatch = [&]() {
+        for (int32_t b = 0; b < batchSize; ++b)
+        {
+            frames[b] = framePool.acquire();
+            batch[b] = frames[b].get();
+            batch[b]->index = nextIndex++;
+            batch[b]->input.resize(input.volume());
+            std::fill(batch[b]->input.begin(), batch[b]->input.end(), 0.5f);
+        }
+        pinet::packBatch(batch, backend);
+        if (!backend.infer())
+        {
+            return false;
+        }
+        pinet::unpackBatch(backend, batch);
+        // As verifyOutput() and fitLaneLines() do
+        for (auto* frame : batch)
+        {
+            extractor.extract(
+                pinet::PlanarView<float const>(frame->outputs[kOUTPUT_BASE_INDEX].data(), outputs[kOUTPUT_BASE_INDEX]),
+                pinet::PlanarView<float const>(
+                    frame->outputs[kOUTPUT_BASE_INDEX + 1].data(), outputs[kOUTPUT_BASE_INDEX + 1]),
+                pinet::PlanarView<float const>(
+                    frame->outputs[kOUTPUT_BASE_INDEX + 2].data(), outputs[kOUTPUT_BASE_INDEX + 2]),
+                kTHRESHOLD_POINT, kTHRESHOLD_INSTANCE, frame->laneLines, frame->spareLaneLines);
+            laneCount += frame->laneLines.size();
+
+            int32_t const lanes = std::min(static_cast<int32_t>(frame->laneLines.size()), pinet::kLANE_MODEL_MAX_COUNT);
+            frame->laneModels.resize(lanes);
+            for (int32_t l = 0; l < lanes; ++l)
+            {
+                pinet::LaneLine const& laneLine = frame->laneLines[l];
+                pinet::fitLaneModel(laneLine.data(), static_cast<int32_t>(laneLine.size()), 2, frame->laneModels[l]);
+            }
+            pinet::serializeLaneModels(frame->laneModels.data(), lanes, serialized.data());
+        }
+        for (auto& frame : frames)
+        {
+            framePool.release(std::move(frame));
+        }
+        return true;
+    };
+
+    // The first batch creates the frames and sizes their outputs, the lane lines of a frame grow until it held
+    // every recorded frame, which takes at most as many batches as there are recorded frames
+    int64_t const warmupStart = gAllocations;
+    for (int32_t i = 0; i < kRECORDED_FRAMES; ++i)
+    {
+        if (!runBatch())
+        {
+            std::cerr << "Inference failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    int64_t const warmupAllocations = gAllocations - warmupStart;
+
+    int64_t const steadyStart = gAllocations;
+    for (int32_t i = 0; i < iterations; ++i)
+    {
+        if (!runBatch())
+        {
+            std::cerr << "Inference failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    int64_t const steadyAllocations = gAllocations - steadyStart;
+    int64_t const frameCount = static_cast<int64_t>(iterations) * batchSize;
+
+    std::cout << "batch " << batchSize << ", " << frameCount << " frames, "
+              << laneCount / static_cast<double>(frameCount + kRECORDED_FRAMES * batchSize) << " lanes per frame"
+              << std::endl;
+    std::cout << "session setup: " << setupAllocations << " allocations" << std::endl;
+    std::cout << "warm-up:       " << warmupAllocations << " allocations" << std::endl;
+    std::cout << "steady state:  " << steadyAllocations << " allocations, "
+              << steadyAllocations / static_cast<double>(frameCount) << " per frame" << std::endl;
+    check(steadyAllocations == 0, "No allocation once the frames are recycled");
+    return pinet::reportChecks();
+}
@@ -0,0 +1,175 @@
+//!
+//! checkAnnotationWriter.cpp
+//! Checks the names, the sampling and the non-blocking queue of the annotation writer of PINetTensorrt
+//! --saveOutputs, writing to a directory in /tmp.
+//! It can be run as: ./checkAnnotationWriter
+//! Fails if inputs of different directories, shards or videos share a name, if other frames than the sampled
+//! ones are written, if lane lines are not drawn, or if submitting frames to a full queue blocks.
+//!
+
+#include "annotationWriter.h"
+#include "checkHarness.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+constexpr int32_t kGRID_WIDTH = 64;
+constexpr int32_t kGRID_HEIGHT = 32;
+
+bool exists(std::string const& fileName)
+{
+    struct stat status;
+    return stat(fileName.c_str(), &status) == 0;
+}
+
+//!
+//! \brief Returns a frame of a 512x256 image with a vertical lane in the middle of the grid.
+//!
+pinet::Frame makeFrame(int64_t index, std::string const& fileName)
+{
+    pinet::Frame frame;
+    frame.index = index;
+    frame.fileName = fileName;
+    frame.image = cv::Mat(256, 512, CV_8UC3, cv::Scalar(0, 0, 0));
+    frame.laneLines.emplace_back();
+    for (int32_t row = 0; row < kGRID_HEIGHT; ++row)
+    {
+        frame.laneLines.back().emplace_back(kGRID_WIDTH / 2.f, row + 0.5f);
+    }
+    return frame;
+}
+
+//!
+//! \brief Submits count frames named frame<index>.jpg, frames whose index is in anomalies with an anomaly.
+//!
+//! \return the names of the files written, removed from directory
+//!
+std::vector<std::string> run(pinet::AnnotationOptions const& options, int32_t count,
+    std::vector<int64_t> const& anomalies, pinet::AnnotationWriter::Statistics& statistics)
+{
+    std::vector<std::string> written;
+    pinet::AnnotationWriter writer;
+    if (!writer.open(options, kGRID_WIDTH, kGRID_HEIGHT))
+    {
+        return written;
+    }
+    for (int64_t f = 0; f < count; ++f)
+    {
+        bool const anomaly = std::find(anomalies.begin(), anomalies.end(), f) != anomalies.end();
+        writer.submit(makeFrame(f, "frame" + std::to_string(f) + ".jpg"), anomaly);
+    }
+    writer.close();
+    statistics = writer.getStatistics();
+
+    for (int64_t f = 0; f < count; ++f)
+    {
+        std::string const name = pinet::getAnnotatedName(options.directory, "frame" + std::to_string(f) + ".jpg");
+        if (exists(name))
+        {
+            written.push_back(name);
+            std::remove(name.c_str());
+        }
+    }
+    return written;
+}
+
+} // namespace
+
+int main()
+{
+    check(pinet::getAnnotatedName("out", "data/clip/1.jpg") == "out/data_clip_1.jpg", "paths are flattened");
+    check(pinet::getAnnotatedName("out", "./data/clip/1.jpg") == "out/data_clip_1.jpg"
+            && pinet::getAnnotatedName("out", "/data/clip/1.jpg") == "out/data_clip_1.jpg",
+        "leading ./ and / are dropped");
+    check(pinet::getAnnotatedName("out", "a/1.jpg") != pinet::getAnnotatedName("out", "b/1.jpg"),
+        "images of the same name in different directories get different names");
+    check(pinet::getAnnotatedName("out", "tusimple.shard:clip/1.jpg") == "out/tusimple.shard_clip_1.jpg",
+        "images of a shard are named after the shard and their name in it");
+    check(pinet::getAnnotatedName("out", "drive.mp4#12") == "out/drive.mp4_12.jpg",
+        "video frames are named after the video and their position, as JPEG");
+
+    std::string const directory = "/tmp/checkAnnotationWriter" + std::to_string(getpid());
+    pinet::AnnotationOptions options;
+    options.directory = directory;
+    options.queueSize = 64;
+    pinet::AnnotationWriter::Statistics statistics;
+
+    options.every = 3;
+    std::vector<std::string> written = run(options, 30, {}, statistics);
+    check(written.size() == 10 && statistics.written == 10 && statistics.dropped == 0,
+        "every 3rd frame of 30 writes 10 frames, wrote " + std::to_string(written.size()));
+    check(!written.empty() && written.front() == directory + "/frame0.jpg", "sampling starts with the first frame");
+
+    options.every = 0;
+    options.anomalies = true;
+    written = run(options, 30, {5, 7, 20}, statistics);
+    check(written.size() == 3, "anomalies only writes the 3 anomalies, wrote " + std::to_string(written.size()));
+
+    options.every = 10;
+    written = run(options, 30, {5, 10}, statistics);
+    check(written.size() == 4, "every 10th frame and anomalies write 4 frames, wrote " + std::to_string(written.size()));
+
+    // The lane is drawn onto the image shared with the frame once the writer is done with it
+    {
+        options.every = 1;
+        options.anomalies = false;
+        pinet::AnnotationWriter writer;
+        pinet::Frame const frame = makeFrame(0, "drawn.jpg");
+        bool const opened = writer.open(options, kGRID_WIDTH, kGRID_HEIGHT);
+        writer.submit(frame, false);
+        writer.close();
+        int32_t const y = static_cast<int32_t>(15.5f * frame.image.rows / kGRID_HEIGHT);
+        uchar const* pixel = frame.image.ptr<uchar>(y) + 3 * (frame.image.cols / 2);
+        check(opened && pixel[0] == 255 && pixel[1] == 0 && pixel[2] == 0, "lane lines are drawn onto the image");
+        std::remove(pinet::getAnnotatedName(directory, "drawn.jpg").c_str());
+    }
+
+    // A queue of 2 frames filled faster than one thread writes them drops the frames in excess
+    {
+        options.every = 1;
+        options.threads = 1;
+        options.queueSize = 2;
+        pinet::AnnotationWriter writer;
+        writer.open(options, kGRID_WIDTH, kGRID_HEIGHT);
+        std::vector<pinet::Frame> frames;
+        for (int64_t f = 0; f < 100; ++f)
+        {
+            frames.push_back(makeFrame(f, "burst" + std::to_string(f) + ".jpg"));
+        }
+        double slowestMs = 0.0;
+        for (auto const& frame : frames)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            writer.submit(frame, false);
+            slowestMs = std::max(slowestMs,
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        writer.close();
+        statistics = writer.getStatistics();
+        check(statistics.dropped > 0 && statistics.written + statistics.dropped == 100,
+            std::to_string(statistics.written) + " written and " + std::to_string(statistics.dropped)
+                + " dropped of 100 frames");
+        check(slowestMs < 5.0, "submit never waits for the writer, slowest " + std::to_string(slowestMs) + " ms");
+        for (auto const& frame : frames)
+        {
+            std::remove(pinet::getAnnotatedName(directory, frame.fileName).c_str());
+        }
+    }
+    rmdir(directory.c_str());
+
+    return pinet::reportChecks();
+}
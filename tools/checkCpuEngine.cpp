@@ -0,0 +1,532 @@
+//!
+//! checkCpuEngine.cpp
+//! Checks the kernels and the network of the CPU engine of PINetTensorrt --backend=cpu and times its layers.
+//! It can be run as: ./checkCpuEngine [model] [threads] [runs]
+//! The GEMM, convolution, transposed convolution and pooling kernels are compared with plain loops on random
+//! operands of awkward sizes, on 1 and 3 threads. The model, pinet.onnx by default, is then run on a random
+//! input by the engine and by a plain interpreter of its ONNX graph which folds and fuses nothing. Finally the
+//! engine runs the model runs times, 10 by default, on threads threads, all cores by default, and prints the
+//! time spent per layer.
+//! Fails if a kernel differs from the plain loops by more than 1e-5 of the largest value it computes, or an
+//! output of the network by more than 1e-4.
+//!
+
+#include "checkHarness.h"
+#include "cpuEngine.h"
+#include "onnxModel.h"
+#include "stageTiming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+std::mt19937 gGenerator(5);
+
+std::vector<float> makeRandom(int64_t count)
+{
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<float> values(count);
+    for (auto& value : values)
+    {
+        value = uniform(gGenerator);
+    }
+    return values;
+}
+
+//!
+//! \brief Returns the largest difference between actual and expected, relative to the largest expected magnitude.
+//!
+double getRelativeError(float const* actual, std::vector<float> const& expected)
+{
+    double error = 0.0;
+    double magnitude = 1e-6;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        error = std::max(error, static_cast<double>(std::abs(actual[i] - expected[i])));
+        magnitude = std::max(magnitude, static_cast<double>(std::abs(expected[i])));
+    }
+    return error / magnitude;
+}
+
+//!
+//! \brief Runs a convolution on one image with plain loops, weights and bias being in ONNX layout.
+//!
+std::vector<float> referenceConvolve(pinet::ConvGeometry const& g, bool transposed, int32_t inChannels,
+    int32_t outChannels, std::vector<float> const& weights, float const* bias, bool relu, float const* input,
+    int32_t height, int32_t width, int32_t& outHeight, int32_t& outWidth)
+{
+    outHeight = g.getOutputSize(0, height, transposed);
+    outWidth = g.getOutputSize(1, width, transposed);
+    std::vector<double> sums(static_cast<size_t>(outChannels) * outHeight * outWidth, 0.0);
+    for (int32_t o = 0; o < outChannels; ++o)
+    {
+        std::fill(sums.begin() + o * outHeight * outWidth, sums.begin() + (o + 1) * outHeight * outWidth,
+            bias ? bias[o] : 0.f);
+    }
+    for (int32_t c = 0; c < inChannels; ++c)
+    {
+        for (int32_t o = 0; o < outChannels; ++o)
+        {
+            for (int32_t ky = 0; ky < g.kernel[0]; ++ky)
+            {
+                for (int32_t kx = 0; kx < g.kernel[1]; ++kx)
+                {
+                    int32_t const first = transposed ? c : o;
+                    int32_t const second = transposed ? o : c;
+                    int32_t const secondCount = transposed ? outChannels : inChannels;
+                    double const w = weights[((first * secondCount + second) * g.kernel[0] + ky) * g.kernel[1] + kx];
+                    // Output (oy, ox) reads input (iy, ix) when iy = oy * stride + ky * dilation - pad, transposed
+                    // convolutions swap the roles of the input and the output
+                    int32_t const rows = transposed ? height : outHeight;
+                    int32_t const cols = transposed ? width : outWidth;
+                    for (int32_t y = 0; y < rows; ++y)
+                    {
+                        for (int32_t x = 0; x < cols; ++x)
+                        {
+                            int32_t const py = y * g.strides[0] + ky * g.dilations[0] - g.pads[0];
+                            int32_t const px = x * g.strides[1] + kx * g.dilations[1] - g.pads[1];
+                            if (transposed && py >= 0 && py < outHeight && px >= 0 && px < outWidth)
+                            {
+                                sums[(o * outHeight + py) * outWidth + px] += w * input[(c * height + y) * width + x];
+                            }
+                            else if (!transposed && py >= 0 && py < height && px >= 0 && px < width)
+                            {
+                                sums[(o * outHeight + y) * outWidth + x] += w * input[(c * height + py) * width + px];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::vector<float> output(sums.size());
+    for (size_t i = 0; i < sums.size(); ++i)
+    {
+        output[i] = relu ? std::max(static_cast<float>(sums[i]), 0.f) : static_cast<float>(sums[i]);
+    }
+    return output;
+}
+
+void checkGemm(pinet::CpuThreadPool& pool)
+{
+    for (int32_t const rows : {1, 6, 13, 64})
+    {
+        for (int32_t const n : {1, 15, 16, 300})
+        {
+            for (int32_t const depth : {3, 257, 600})
+            {
+                std::vector<float> const a = makeRandom(rows * depth);
+                std::vector<float> const b = makeRandom(depth * n);
+                std::vector<float> const bias = makeRandom(rows);
+                std::vector<float> expected(rows * n);
+                for (int32_t r = 0; r < rows; ++r)
+                {
+                    for (int32_t j = 0; j < n; ++j)
+                    {
+                        double sum = bias[r];
+                        for (int32_t k = 0; k < depth; ++k)
+                        {
+                            sum += static_cast<double>(a[r * depth + k]) * b[k * n + j];
+                        }
+                        expected[r * n + j] = std::max(static_cast<float>(sum), 0.f);
+                    }
+                }
+
+                std::vector<float> c(rows * n, -1.f);
+                pinet::gemm(pinet::packMatrix(a.data(), rows, depth, depth, 1), b.data(), n, n, c.data(), n,
+                    bias.data(), true, pool);
+                double const error = getRelativeError(c.data(), expected);
+                if (error > 1e-5)
+                {
+                    check(false,
+                        "gemm " + std::to_string(rows) + "x" + std::to_string(depth) + " by " + std::to_string(depth)
+                            + "x" + std::to_string(n) + " with bias and ReLU, error " + std::to_string(error));
+                }
+            }
+        }
+    }
+}
+
+void checkConvolutions(pinet::CpuThreadPool& pool)
+{
+    struct Case
+    {
+        char const* name;
+        pinet::ConvGeometry geometry;
+        bool transposed;
+    };
+    std::vector<Case> cases;
+    auto const makeCase = [&cases](char const* name, int32_t kernelH, int32_t kernelW, int32_t stride,
+                              std::vector<int32_t> const& pads, int32_t dilation, int32_t outputPadding,
+                              bool transposed) {
+        pinet::ConvGeometry g;
+        g.kernel[0] = kernelH;
+        g.kernel[1] = kernelW;
+        g.strides[0] = g.strides[1] = stride;
+        std::copy(pads.begin(), pads.end(), g.pads);
+        g.dilations[0] = g.dilations[1] = dilation;
+        g.outputPadding[0] = g.outputPadding[1] = outputPadding;
+        cases.push_back(Case{name, g, transposed});
+    };
+    makeCase("1x1", 1, 1, 1, {0, 0, 0, 0}, 1, 0, false);
+    makeCase("1x1 stride 2", 1, 1, 2, {0, 0, 0, 0}, 1, 0, false);
+    makeCase("3x3 pad 1", 3, 3, 1, {1, 1, 1, 1}, 1, 0, false);
+    makeCase("3x3 stride 2 pad 1", 3, 3, 2, {1, 1, 1, 1}, 1, 0, false);
+    makeCase("7x7 stride 2 pad 3", 7, 7, 2, {3, 3, 3, 3}, 1, 0, false);
+    makeCase("2x3 uneven pads", 2, 3, 1, {0, 2, 1, 0}, 1, 0, false);
+    makeCase("3x3 dilation 2", 3, 3, 1, {2, 2, 2, 2}, 2, 0, false);
+    makeCase("transposed 3x3 stride 2 pad 1 output padding 1", 3, 3, 2, {1, 1, 1, 1}, 1, 1, true);
+    makeCase("transposed 2x2 stride 2", 2, 2, 2, {0, 0, 0, 0}, 1, 0, true);
+    makeCase("transposed 4x4 stride 2 pad 1", 4, 4, 2, {1, 1, 1, 1}, 1, 0, true);
+
+    int32_t const inChannels = 5;
+    int32_t const outChannels = 7;
+    int32_t const height = 11;
+    int32_t const width = 19;
+    for (auto const& c : cases)
+    {
+        int32_t const kernelSize = c.geometry.kernel[0] * c.geometry.kernel[1];
+        std::vector<float> const weights = makeRandom(inChannels * outChannels * kernelSize);
+        std::vector<float> const bias = makeRandom(outChannels);
+        std::vector<float> const input = makeRandom(inChannels * height * width);
+        for (bool const relu : {false, true})
+        {
+            int32_t outHeight, outWidth;
+            std::vector<float> const expected = referenceConvolve(c.geometry, c.transposed, inChannels, outChannels,
+                weights, bias.data(), relu, input.data(), height, width, outHeight, outWidth);
+
+            pinet::ConvWeights const conv = pinet::packConvolution(
+                c.geometry, inChannels, outChannels, c.transposed, weights.data(), bias.data());
+            std::vector<float> scratch(pinet::getConvScratchSize(conv, height, width));
+            std::vector<float> output(expected.size(), -1.f);
+            pinet::convolve(conv, relu, input.data(), height, width, output.data(), scratch.data(), pool);
+            double const error = getRelativeError(output.data(), expected);
+            if (error > 1e-5)
+            {
+                check(false, std::string("convolution ") + c.name + (relu ? " with ReLU" : "") + ", error "
+                        + std::to_string(error));
+            }
+        }
+    }
+
+    // Pooling windows never overlap the padding only, so the maximum is always taken over input values
+    std::vector<float> const input = makeRandom(3 * height * width);
+    for (auto const& c : cases)
+    {
+        if (c.transposed || c.geometry.pads[0] >= c.geometry.kernel[0] || c.geometry.pads[1] >= c.geometry.kernel[1])
+        {
+            continue;
+        }
+        pinet::ConvGeometry const& g = c.geometry;
+        int32_t const outHeight = g.getOutputSize(0, height, false);
+        int32_t const outWidth = g.getOutputSize(1, width, false);
+        std::vector<float> expected(3 * outHeight * outWidth, -1e30f);
+        for (int32_t p = 0; p < 3; ++p)
+        {
+            for (int32_t y = 0; y < outHeight; ++y)
+            {
+                for (int32_t x = 0; x < outWidth; ++x)
+                {
+                    for (int32_t ky = 0; ky < g.kernel[0]; ++ky)
+                    {
+                        for (int32_t kx = 0; kx < g.kernel[1]; ++kx)
+                        {
+                            int32_t const iy = y * g.strides[0] + ky * g.dilations[0] - g.pads[0];
+                            int32_t const ix = x * g.strides[1] + kx * g.dilations[1] - g.pads[1];
+                            if (iy >= 0 && iy < height && ix >= 0 && ix < width)
+                            {
+                                float& value = expected[(p * outHeight + y) * outWidth + x];
+                                value = std::max(value, input[(p * height + iy) * width + ix]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        std::vector<float> output(expected.size());
+        pinet::maxPool(g, input.data(), 3, height, width, output.data(), pool);
+        if (getRelativeError(output.data(), expected) != 0.0)
+        {
+            check(false, std::string("max pooling ") + c.name);
+        }
+    }
+}
+
+//!
+//! \brief The Reference structure is a plain interpreter of the ONNX graphs of PINet.
+//!
+struct Reference
+{
+    struct Tensor
+    {
+        std::vector<int64_t> dims;
+        std::vector<float> data;
+    };
+    std::map<std::string, Tensor> tensors;
+
+    static std::vector<int64_t> getInts(std::map<std::string, pinet::ProtoMessage> const& attributes,
+        std::string const& name, std::vector<int64_t> const& fallback)
+    {
+        auto const attribute = attributes.find(name);
+        return attribute == attributes.end() ? fallback : attribute->second.getInts(pinet::onnx::kATTRIBUTE_INTS);
+    }
+
+    static pinet::ConvGeometry getGeometry(
+        std::map<std::string, pinet::ProtoMessage> const& attributes, std::vector<int64_t> const& kernel)
+    {
+        pinet::ConvGeometry g;
+        std::vector<int64_t> const strides = getInts(attributes, "strides", {1, 1});
+        std::vector<int64_t> const pads = getInts(attributes, "pads", {0, 0, 0, 0});
+        std::vector<int64_t> const dilations = getInts(attributes, "dilations", {1, 1});
+        std::vector<int64_t> const outputPadding = getInts(attributes, "output_padding", {0, 0});
+        for (int32_t axis = 0; axis < 2; ++axis)
+        {
+            g.kernel[axis] = static_cast<int32_t>(kernel[axis]);
+            g.strides[axis] = static_cast<int32_t>(strides[axis]);
+            g.dilations[axis] = static_cast<int32_t>(dilations[axis]);
+            g.outputPadding[axis] = static_cast<int32_t>(outputPadding[axis]);
+            g.pads[axis] = static_cast<int32_t>(pads[axis]);
+            g.pads[axis + 2] = static_cast<int32_t>(pads[axis + 2]);
+        }
+        return g;
+    }
+
+    //!
+    //! \brief Runs the graph of fileName on input, an image of the input shape of the graph.
+    //!
+    bool run(std::string const& fileName, std::vector<int64_t> const& inputDims, std::vector<float> const& input)
+    {
+        pinet::ProtoMessage model, graph;
+        if (!pinet::readModel(fileName, model) || !graph.parse(model.getString(pinet::onnx::kMODEL_GRAPH)))
+        {
+            return false;
+        }
+        for (auto const& data : graph.getStrings(pinet::onnx::kGRAPH_INITIALIZER))
+        {
+            pinet::ProtoMessage message;
+            message.parse(data);
+            Tensor& tensor = tensors[message.getString(pinet::onnx::kTENSOR_NAME)];
+            tensor.dims = message.getInts(pinet::onnx::kTENSOR_DIMS);
+            std::string const raw = message.getString(pinet::onnx::kTENSOR_RAW_DATA);
+            tensor.data.resize(raw.size() / sizeof(float));
+            std::memcpy(tensor.data.data(), raw.data(), tensor.data.size() * sizeof(float));
+        }
+        for (auto const& data : graph.getStrings(pinet::onnx::kGRAPH_INPUT))
+        {
+            pinet::ProtoMessage message;
+            message.parse(data);
+            std::string const name = message.getString(pinet::onnx::kVALUE_INFO_NAME);
+            if (!tensors.count(name))
+            {
+                tensors[name] = Tensor{inputDims, input};
+            }
+        }
+
+        for (auto const& data : graph.getStrings(pinet::onnx::kGRAPH_NODE))
+        {
+            pinet::ProtoMessage node;
+            node.parse(data);
+            std::string const op = node.getString(pinet::onnx::kNODE_OP_TYPE);
+            std::vector<std::string> const inputs = node.getStrings(pinet::onnx::kNODE_INPUT);
+            std::map<std::string, pinet::ProtoMessage> attributes;
+            for (auto const& attribute : node.getStrings(pinet::onnx::kNODE_ATTRIBUTE))
+            {
+                pinet::ProtoMessage message;
+                message.parse(attribute);
+                attributes[message.getString(pinet::onnx::kATTRIBUTE_NAME)] = message;
+            }
+            Tensor const& x = tensors.at(inputs[0]);
+            Tensor y;
+            if (op == "Conv" || op == "ConvTranspose")
+            {
+                bool const transposed = op == "ConvTranspose";
+                Tensor const& w = tensors.at(inputs[1]);
+                int32_t const outChannels = static_cast<int32_t>(w.dims[transposed ? 1 : 0]);
+                float const* bias = inputs.size() > 2 ? tensors.at(inputs[2]).data.data() : nullptr;
+                int32_t outHeight, outWidth;
+                y.data = referenceConvolve(getGeometry(attributes, {w.dims[2], w.dims[3]}), transposed,
+                    static_cast<int32_t>(x.dims[1]), outChannels, w.data, bias, false, x.data.data(),
+                    static_cast<int32_t>(x.dims[2]), static_cast<int32_t>(x.dims[3]), outHeight, outWidth);
+                y.dims = {1, outChannels, outHeight, outWidth};
+            }
+            else if (op == "BatchNormalization")
+            {
+                float const epsilon = attributes.count("epsilon")
+                    ? attributes["epsilon"].getFloat(pinet::onnx::kATTRIBUTE_FLOAT, 1e-5f)
+                    : 1e-5f;
+                y = x;
+                int64_t const planeSize = x.dims[2] * x.dims[3];
+                for (size_t i = 0; i < y.data.size(); ++i)
+                {
+                    size_t const c = i / planeSize;
+                    y.data[i] = (x.data[i] - tensors.at(inputs[3]).data[c])
+                            / std::sqrt(tensors.at(inputs[4]).data[c] + epsilon) * tensors.at(inputs[1]).data[c]
+                        + tensors.at(inputs[2]).data[c];
+                }
+            }
+            else if (op == "Relu")
+            {
+                y = x;
+                for (auto& value : y.data)
+                {
+                    value = std::max(value, 0.f);
+                }
+            }
+            else if (op == "Add")
+            {
+                y = x;
+                for (size_t i = 0; i < y.data.size(); ++i)
+                {
+                    y.data[i] += tensors.at(inputs[1]).data[i];
+                }
+            }
+            else if (op == "MaxPool")
+            {
+                pinet::ConvGeometry const g = getGeometry(attributes, getInts(attributes, "kernel_shape", {}));
+                int32_t const height = static_cast<int32_t>(x.dims[2]);
+                int32_t const width = static_cast<int32_t>(x.dims[3]);
+                y.dims = {1, x.dims[1], g.getOutputSize(0, height, false), g.getOutputSize(1, width, false)};
+                y.data.assign(y.dims[1] * y.dims[2] * y.dims[3], -1e30f);
+                for (int64_t c = 0; c < y.dims[1]; ++c)
+                {
+                    for (int64_t i = 0; i < y.dims[2] * y.dims[3]; ++i)
+                    {
+                        int32_t const oy = static_cast<int32_t>(i / y.dims[3]);
+                        int32_t const ox = static_cast<int32_t>(i % y.dims[3]);
+                        for (int32_t ky = 0; ky < g.kernel[0]; ++ky)
+                        {
+                            for (int32_t kx = 0; kx < g.kernel[1]; ++kx)
+                            {
+                                int32_t const iy = oy * g.strides[0] + ky - g.pads[0];
+                                int32_t const ix = ox * g.strides[1] + kx - g.pads[1];
+                                if (iy >= 0 && iy < height && ix >= 0 && ix < width)
+                                {
+                                    float& value = y.data[c * y.dims[2] * y.dims[3] + i];
+                                    value = std::max(value, x.data[(c * height + iy) * width + ix]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            else
+            {
+                std::cout << "The reference interpreter does not run " << op << std::endl;
+                return false;
+            }
+            tensors[node.getStrings(pinet::onnx::kNODE_OUTPUT)[0]] = std::move(y);
+        }
+        return true;
+    }
+};
+
+void checkNetwork(std::string const& fileName, int32_t threads, int32_t runs)
+{
+    auto network = std::make_shared<pinet::CpuNetwork>();
+    bool const loaded = network->load(fileName);
+    check(loaded, "the CPU engine loads " + fileName);
+    if (!loaded)
+    {
+        return;
+    }
+
+    int64_t macs = 0;
+    int64_t bufferFloats = 0;
+    for (auto const& layer : network->getLayers())
+    {
+        macs += layer.macs;
+    }
+    for (int64_t size : network->getSlotSizes())
+    {
+        bufferFloats += size;
+    }
+    std::cout << network->getNodeCount() << " nodes run as " << network->getLayers().size() << " layers, "
+              << network->getTensors().size() << " tensors in " << network->getSlotSizes().size() << " buffers of "
+              << bufferFloats * sizeof(float) / (1 << 20) << " MiB, " << macs / 1e9 << " GMAC per image, GEMM "
+              << (pinet::isGemmVectorized() ? "on AVX2 and FMA" : "in plain loops") << std::endl;
+
+    pinet::CpuBackend backend(network, 1, threads);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    float* input = backend.getInputBuffer();
+    for (int64_t i = 0; i < backend.getInput().volume(); ++i)
+    {
+        input[i] = uniform(gGenerator);
+    }
+    std::vector<int64_t> const inputDims(backend.getInput().dims.begin(), backend.getInput().dims.end());
+    std::vector<float> const inputCopy(input, input + backend.getInput().volume());
+    check(backend.infer(), "the CPU engine runs the network");
+
+    auto const referenceStart = pinet::Clock::now();
+    Reference reference;
+    bool const ran = reference.run(fileName, inputDims, inputCopy);
+    check(ran, "the reference interpreter runs the network in " + std::to_string(pinet::elapsedMs(referenceStart))
+            + " ms");
+    for (size_t o = 0; ran && o < backend.getOutputs().size(); ++o)
+    {
+        pinet::TensorDesc const& output = backend.getOutputs()[o];
+        auto const expected = reference.tensors.find(output.name);
+        bool const found = expected != reference.tensors.end() && static_cast<int64_t>(expected->second.data.size()) == output.volume();
+        double const error = found ? getRelativeError(backend.getOutputBuffer(o), expected->second.data) : 1.0;
+        check(found && error <= 1e-4, "output " + output.name + " matches the reference, error " + std::to_string(error));
+    }
+
+    pinet::CpuBackend timed(network, 1, threads);
+    timed.infer();
+    float totalMs = 0.f;
+    for (int32_t r = 0; r < runs; ++r)
+    {
+        timed.infer();
+        totalMs += timed.getLastTiming().execute;
+    }
+    std::cout << runs << " runs on " << threads << " threads: " << totalMs / runs << " ms per image, "
+              << macs / (1e6 * totalMs / runs) << " GMAC/s" << std::endl;
+    std::vector<pinet::LayerTiming> timings = timed.getLayerTimings();
+    for (auto& timing : timings)
+    {
+        // Leave the warm-up run out
+        timing.totalMs = timing.totalMs * runs / (runs + 1);
+        timing.runs = runs;
+    }
+    pinet::printLayerTimings(timings, 15, std::cout);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string const fileName = argc > 1 ? argv[1] : "pinet.onnx";
+    int32_t const threads = argc > 2 ? std::atoi(argv[2]) : std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+    int32_t const runs = argc > 3 ? std::atoi(argv[3]) : 10;
+    if (threads <= 0 || runs <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [model] [threads] [runs]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (int32_t const poolThreads : {1, 3})
+    {
+        pinet::CpuThreadPool pool(poolThreads);
+        int32_t const failures = pinet::getFailedChecks();
+        checkGemm(pool);
+        checkConvolutions(pool);
+        check(pinet::getFailedChecks() == failures,
+            "kernels match plain loops on " + std::to_string(poolThreads) + " threads, GEMM "
+                + (pinet::isGemmVectorized() ? "on AVX2 and FMA" : "in plain loops"));
+    }
+
+    checkNetwork(fileName, threads, runs);
+
+    return pinet::reportChecks();
+}
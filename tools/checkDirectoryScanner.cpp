@@ -0,0 +1,159 @@
+//!
+//! checkDirectoryScanner.cpp
+//! Checks the DirectoryScanner on a tree it creates in a temporary directory, and optionally times it on a data
+//! directory.
+//! It can be run as: ./checkDirectoryScanner [data directory]
+//! With a data directory, prints the time to the first image and to the full scan for 1, 2, 4 and 8 threads.
+//! Fails if an image of the tree is missed or returned twice, if the sorted order depends on the threads, or if
+//! numbered names are not sorted by value.
+//!
+
+#include "checkHarness.h"
+#include "directoryScanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+std::vector<std::string> scan(std::vector<std::string> const& roots, int32_t threads, bool sorted)
+{
+    pinet::DirectoryScanner scanner(roots, ".jpg", threads, sorted);
+    std::vector<std::string> files;
+    std::string path;
+    while (scanner.next(path))
+    {
+        files.push_back(path);
+    }
+    return files;
+}
+
+void touch(std::string const& path)
+{
+    std::ofstream(path.c_str()).put('\0');
+}
+
+void time(std::string const& root, int32_t threads)
+{
+    using Clock = std::chrono::steady_clock;
+    auto const start = Clock::now();
+    pinet::DirectoryScanner scanner({root}, ".jpg", threads, true);
+    std::string path;
+    int64_t count = 0;
+    double first = 0;
+    while (scanner.next(path))
+    {
+        if (count++ == 0)
+        {
+            first = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+    }
+    double const total = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << threads << " threads: " << count << " images, first after " << first << " ms, all after " << total
+              << " ms" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    char base[] = "/tmp/checkDirectoryScannerXXXXXX";
+    if (!mkdtemp(base))
+    {
+        std::cerr << "Cannot create a temporary directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const root = base;
+
+    // Names with several dots, upper case extensions, links to files and directories and a link cycle
+    for (auto const& dir : {"/a", "/a/b", "/c", "/d.jpg"})
+    {
+        mkdir((root + dir).c_str(), 0755);
+    }
+    for (auto const& file : {"/1.jpg", "/2.JPG", "/a/3.v2.jpg", "/a/4.jpg.png", "/a/b/5.jpg", "/c/6.jpeg", "/c/.jpg",
+             "/d.jpg/7.jpg", "/8.png.jpg"})
+    {
+        touch(root + file);
+    }
+    symlink((root + "/1.jpg").c_str(), (root + "/c/9.jpg").c_str());
+    symlink((root + "/a/b").c_str(), (root + "/c/b").c_str());
+    symlink(root.c_str(), (root + "/a/b/loop").c_str());
+    symlink((root + "/missing.jpg").c_str(), (root + "/c/dangling.jpg").c_str());
+
+    std::vector<std::string> expected = {"/1.jpg", "/2.JPG", "/8.png.jpg", "/a/3.v2.jpg", "/a/b/5.jpg", "/c/9.jpg",
+        "/d.jpg/7.jpg"};
+    for (auto& file : expected)
+    {
+        file = root + file;
+    }
+
+    std::vector<std::string> const sorted = scan({root + "/"}, 1, true);
+    for (auto const& file : sorted)
+    {
+        std::cout << "  " << file.substr(root.size()) << std::endl;
+    }
+    check(sorted == expected, "a sorted scan returns each image once, in name order");
+
+    bool same = true;
+    for (int32_t threads : {2, 4, 8})
+    {
+        for (int32_t repeat = 0; repeat < 20; ++repeat)
+        {
+            same = same && scan({root}, threads, true) == expected;
+        }
+    }
+    check(same, "the sorted order does not depend on the threads");
+
+    // Unsorted, a directory reached through several links may be found through any of them
+    std::vector<std::string> found = scan({root}, 4, false);
+    std::vector<std::string> names = expected;
+    for (auto* files : {&found, &names})
+    {
+        for (auto& file : *files)
+        {
+            file = file.substr(file.rfind('/'));
+        }
+        std::sort(files->begin(), files->end());
+    }
+    check(found == names, "an unsorted scan returns the same images");
+
+    std::vector<std::string> roots = expected;
+    std::rotate(roots.begin(), roots.end() - 1, roots.end());
+    check(scan({root + "/d.jpg", root}, 2, true) == roots, "roots are scanned in order, each directory once");
+
+    std::vector<std::string> frames = {"10.jpg", "b.jpg", "2.jpg", "a10.jpg", "1.jpg", "a9.jpg", "01.jpg", "a09x.jpg"};
+    std::sort(frames.begin(), frames.end(), pinet::naturalLess);
+    std::vector<std::string> const byValue = {"01.jpg", "1.jpg", "2.jpg", "10.jpg", "a9.jpg", "a09x.jpg", "a10.jpg",
+        "b.jpg"};
+    check(frames == byValue, "numbered names are sorted by value");
+
+    pinet::DirectoryScanner missing({root + "/missing"}, ".jpg", 1, true);
+    std::string path;
+    check(!missing.next(path) && missing.getErrors().size() == 1, "a missing directory is reported");
+
+    std::string const command = "rm -rf " + root;
+    if (std::system(command.c_str()) != 0)
+    {
+        std::cerr << "Cannot remove " << root << std::endl;
+    }
+
+    if (argc > 1)
+    {
+        for (int32_t threads : {1, 2, 4, 8})
+        {
+            time(argv[1], threads);
+        }
+    }
+
+    return pinet::reportChecks();
+}
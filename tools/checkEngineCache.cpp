@@ -0,0 +1,153 @@
+//!
+//! checkEngineCache.cpp
+//! Checks the engine cache on the CPU: the key derivation and the store, no GPU or engine build involved.
+//! It can be run as: ./checkEngineCache [onnx]
+//! Keys are derived from the given model, pinet.onnx by default, the plans stored are dummy bytes.
+//! Fails if two different build options share a cache file, a plan does not round trip or files other than the
+//! plans are left in the cache directory.
+//!
+
+#include "checkHarness.h"
+#include "engineCache.h"
+
+#include "NvInfer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+//!
+//! \brief Returns the names in directory, . and .. excluded.
+//!
+std::set<std::string> listDirectory(std::string const& directory)
+{
+    std::set<std::string> names;
+    if (DIR* dir = opendir(directory.c_str()))
+    {
+        while (dirent const* entry = readdir(dir))
+        {
+            std::string const name = entry->d_name;
+            if (name != "." && name != "..")
+            {
+                names.insert(name);
+            }
+        }
+        closedir(dir);
+    }
+    return names;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string const onnxFileName = argc > 1 ? argv[1] : "pinet.onnx";
+
+    pinet::EngineKey key;
+    if (!pinet::hashFile(onnxFileName, key.modelHash, key.modelSize))
+    {
+        return EXIT_FAILURE;
+    }
+    key.builderVersion = getInferLibVersion();
+    std::cout << onnxFileName << ": " << pinet::toFileName(key) << std::endl;
+
+    uint64_t hash = 0;
+    int64_t size = 0;
+    check(pinet::hashFile(onnxFileName, hash, size) && hash == key.modelHash && size == key.modelSize,
+        "hashing is deterministic");
+
+    char directoryTemplate[] = "/tmp/pinetEngineCacheXXXXXX";
+    if (!mkdtemp(directoryTemplate))
+    {
+        std::cerr << "Cannot create a temporary directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const directory = directoryTemplate;
+
+    // A copy of the model with one byte changed has to hash differently
+    {
+        std::ifstream source(onnxFileName, std::ios::binary);
+        std::vector<char> model((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+        if (model.empty())
+        {
+            std::cerr << onnxFileName << " is empty" << std::endl;
+            return EXIT_FAILURE;
+        }
+        model[model.size() / 2] ^= 1;
+        std::string const modified = directory + "/modified.onnx";
+        std::ofstream(modified, std::ios::binary).write(model.data(), model.size());
+        check(pinet::hashFile(modified, hash, size) && hash != key.modelHash && size == key.modelSize,
+            "a modified model changes the hash");
+        std::remove(modified.c_str());
+    }
+
+    // Every option has to lead to its own file
+    std::vector<pinet::EngineKey> keys(8, key);
+    keys[1].fp16 = true;
+    keys[2].int8 = true;
+    keys[3].fp16 = keys[3].int8 = true;
+    keys[4].dlaCore = 0;
+    keys[5].batchSize = 4;
+    keys[6].builderVersion = key.builderVersion + 1;
+    keys[7].outputsHash = pinet::hashNames({"input.1332", "1686", "1693"});
+    std::set<std::string> names;
+    for (auto const& k : keys)
+    {
+        names.insert(pinet::toFileName(k));
+    }
+    check(names.size() == keys.size(), "build options map to distinct cache files");
+
+    pinet::EngineCache const cache(directory + "/cache");
+    std::vector<char> plan;
+    check(!cache.load(key, plan), "an empty cache misses");
+
+    std::vector<char> stored(4096);
+    for (size_t i = 0; i < stored.size(); ++i)
+    {
+        stored[i] = static_cast<char>(i * 31);
+    }
+    check(cache.store(key, stored.data(), stored.size()), "a plan is stored, creating the directory");
+    check(cache.load(key, plan) && plan == stored, "the stored plan is loaded back");
+    check(!cache.load(keys[1], plan), "other options still miss");
+    check(listDirectory(directory + "/cache") == std::set<std::string>{pinet::toFileName(key)},
+        "no temporary or lock file is left behind");
+
+    stored.resize(1000);
+    stored[0] ^= 1;
+    check(cache.store(key, stored.data(), stored.size()) && cache.load(key, plan) && plan == stored,
+        "storing again replaces the plan");
+
+    std::string const savedFileName = directory + "/saved.plan";
+    check(pinet::writePlan(savedFileName, stored.data(), stored.size()) && pinet::readPlan(savedFileName, plan)
+            && plan == stored,
+        "plans round trip through --saveEngine and --loadEngine files");
+
+    // Plans are read without a lock, so a read-only directory of engines can be loaded from
+    std::string const readOnly = directory + "/readOnly";
+    check(mkdir(readOnly.c_str(), 0755) == 0 && pinet::writePlan(readOnly + "/saved.plan", stored.data(), stored.size())
+            && chmod(readOnly.c_str(), 0555) == 0 && pinet::readPlan(readOnly + "/saved.plan", plan) && plan == stored
+            && listDirectory(readOnly) == std::set<std::string>{"saved.plan"},
+        "plans are loaded from a read-only directory without writing to it");
+    chmod(readOnly.c_str(), 0755);
+
+    std::string const command = "rm -rf " + directory;
+    if (std::system(command.c_str()) != 0)
+    {
+        std::cerr << "Cannot remove " << directory << std::endl;
+    }
+
+    return pinet::reportChecks();
+}
@@ -0,0 +1,46 @@
+#ifndef PINET_CHECK_HARNESS_H
+#define PINET_CHECK_HARNESS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace pinet
+{
+
+//!
+//! \brief Returns the number of checks of the tool which failed so far.
+//!
+inline int32_t& getFailedChecks()
+{
+    static int32_t failures = 0;
+    return failures;
+}
+
+//!
+//! \brief Prints what, preceded by [ OK ] if condition holds and by [FAIL] otherwise, and counts the failures.
+//!
+//! \return condition
+//!
+inline bool check(bool condition, std::string const& what)
+{
+    std::cout << (condition ? "[ OK ] " : "[FAIL] ") << what << std::endl;
+    getFailedChecks() += !condition;
+    return condition;
+}
+
+//!
+//! \brief Prints the number of failed checks.
+//!
+//! \return the exit status of the tool, EXIT_FAILURE if any check failed
+//!
+inline int reportChecks()
+{
+    std::cout << getFailedChecks() << " failed checks" << std::endl;
+    return getFailedChecks() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+} // namespace pinet
+
+#endif // PINET_CHECK_HARNESS_H
@@ -0,0 +1,163 @@
+//!
+//! checkInputCache.cpp
+//! Checks the input cache in a temporary directory, with inputs of the network input size.
+//! It can be run as: ./checkInputCache
+//! Fails if a uint8 entry does not give back the exact input, an fp16 entry is off by more than half float
+//! rounding, a changed image or setting hits a stale entry, or the size cap does not evict the least recently
+//! used entries.
+//!
+
+#include "checkHarness.h"
+#include "inputCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+std::vector<int32_t> const kDIMS = {3, 256, 512};
+size_t const kVOLUME = 3 * 256 * 512;
+
+//!
+//! \brief Returns the input preprocessing computes from random pixels, pixel * scale + bias per source channel.
+//!
+std::vector<float> makeInput(pinet::NormalizeParams const& params, uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int32_t> pixel(0, 255);
+    std::vector<float> input(kVOLUME);
+    size_t const planeSize = kVOLUME / 3;
+    for (int32_t c = 0; c < 3; ++c)
+    {
+        float const scale = 1.f / (255.f * params.std[c]);
+        float const bias = -params.mean[c] / params.std[c];
+        float* plane = input.data() + (params.swapChannels ? 2 - c : c) * planeSize;
+        for (size_t i = 0; i < planeSize; ++i)
+        {
+            plane[i] = float(pixel(generator)) * scale + bias;
+        }
+    }
+    return input;
+}
+
+float maxRelativeDiff(std::vector<float> const& a, std::vector<float> const& b)
+{
+    float diff = 0.f;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        diff = std::max(diff, std::abs(a[i] - b[i]) / std::max(std::abs(a[i]), 1e-3f));
+    }
+    return diff;
+}
+
+} // namespace
+
+int main()
+{
+    char base[] = "/tmp/checkInputCacheXXXXXX";
+    if (!mkdtemp(base))
+    {
+        std::cerr << "Cannot create a temporary directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const directory = base;
+    int64_t const maxBytes = 1 << 30;
+
+    pinet::NormalizeParams imagenet;
+    imagenet.mean[0] = 0.485f;
+    imagenet.mean[1] = 0.456f;
+    imagenet.mean[2] = 0.406f;
+    imagenet.std[0] = 0.229f;
+    imagenet.std[1] = 0.224f;
+    imagenet.std[2] = 0.225f;
+    imagenet.swapChannels = true;
+
+    std::vector<float> output(kVOLUME);
+    for (auto const& params : {pinet::NormalizeParams(), imagenet})
+    {
+        for (auto const format : {pinet::InputCacheFormat::kUINT8, pinet::InputCacheFormat::kFP16})
+        {
+            pinet::InputCache cache;
+            check(cache.open(directory + "/" + pinet::toString(format), format, maxBytes, kDIMS, params, "test"),
+                "the cache is opened");
+            std::vector<float> const input = makeInput(params, 1);
+            uint64_t const key = cache.getKey("1.jpg", 1000, 2000);
+            check(!cache.load(key, output.data()), "a new key misses");
+            check(cache.store(key, input.data()) && cache.load(key, output.data()), "a stored input is loaded");
+            if (format == pinet::InputCacheFormat::kUINT8)
+            {
+                check(output == input, "uint8 gives back the exact input");
+            }
+            else
+            {
+                float const diff = maxRelativeDiff(input, output);
+                std::cout << "fp16 max relative diff " << diff << std::endl;
+                check(diff <= 1.f / 2048.f, "fp16 is within half float rounding");
+            }
+        }
+    }
+
+    pinet::InputCache cache;
+    cache.open(directory + "/keys", pinet::InputCacheFormat::kUINT8, maxBytes, kDIMS, pinet::NormalizeParams(), "a");
+    uint64_t const key = cache.getKey("1.jpg", 1000, 2000);
+    check(key != cache.getKey("2.jpg", 1000, 2000) && key != cache.getKey("1.jpg", 1001, 2000)
+            && key != cache.getKey("1.jpg", 1000, 2001),
+        "the key changes with the name, modification time and size of the image");
+    pinet::InputCache other;
+    other.open(directory + "/keys", pinet::InputCacheFormat::kUINT8, maxBytes, kDIMS, pinet::NormalizeParams(), "b");
+    check(key != other.getKey("1.jpg", 1000, 2000), "the key changes with the preprocessing settings");
+
+    std::vector<float> const input = makeInput(pinet::NormalizeParams(), 2);
+    cache.store(key, input.data());
+    pinet::InputCache reopened;
+    reopened.open(directory + "/keys", pinet::InputCacheFormat::kUINT8, maxBytes, kDIMS, pinet::NormalizeParams(), "a");
+    check(reopened.getStatistics().bytes > 0 && reopened.load(key, output.data()) && output == input,
+        "entries are found again by the next run");
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "/keys/%016llx.pnic", static_cast<unsigned long long>(key));
+    {
+        std::ofstream truncated(directory + name, std::ios::binary | std::ios::trunc);
+        truncated << "PNIC";
+    }
+    check(!reopened.load(key, output.data()), "a damaged entry misses");
+
+    // Room for three entries, the fourth evicts the least recently used one
+    int64_t const entryBytes = reopened.getStatistics().bytes;
+    pinet::InputCache capped;
+    capped.open(directory + "/capped", pinet::InputCacheFormat::kUINT8, 3 * entryBytes + entryBytes / 2, kDIMS,
+        pinet::NormalizeParams(), "a");
+    std::vector<uint64_t> keys;
+    for (int32_t i = 0; i < 5; ++i)
+    {
+        keys.push_back(capped.getKey(std::to_string(i) + ".jpg", 0, 0));
+    }
+    capped.store(keys[0], input.data());
+    capped.store(keys[1], input.data());
+    capped.store(keys[2], input.data());
+    capped.load(keys[0], output.data());
+    capped.store(keys[3], input.data());
+    check(capped.load(keys[0], output.data()) && !capped.load(keys[1], output.data()),
+        "the least recently used entry is evicted");
+    capped.store(keys[4], input.data());
+    pinet::InputCache::Statistics const statistics = capped.getStatistics();
+    check(statistics.evictions == 2 && statistics.bytes <= 3 * entryBytes + entryBytes / 2,
+        "the entries stay below the size cap");
+
+    std::string const command = "rm -rf " + directory;
+    if (std::system(command.c_str()) != 0)
+    {
+        std::cerr << "Cannot remove " << directory << std::endl;
+    }
+
+    return pinet::reportChecks();
+}
@@ -0,0 +1,96 @@
+//!
+//! checkOutputPlan.cpp
+//! Checks the planning of the network outputs on the CPU, with the output names and shapes of pinet.onnx.
+//! It can be run as: ./checkOutputPlan
+//! Prints the outputs kept and the bytes copied to the host per image for each selection.
+//! Fails if post-processing would miss one of its outputs or an unread head would be kept by lanes.
+//!
+
+#include "checkHarness.h"
+#include "outputPlan.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+//!
+//! \brief Returns the descriptions of the planned outputs, in the order a backend exposes them.
+//!
+std::vector<pinet::TensorDesc> describe(std::vector<pinet::TensorDesc> const& network, pinet::OutputPlan const& plan)
+{
+    std::vector<pinet::TensorDesc> outputs;
+    for (auto const& desc : network)
+    {
+        for (auto const& name : plan.bound)
+        {
+            if (desc.name == name)
+            {
+                outputs.push_back(desc);
+            }
+        }
+    }
+    return outputs;
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<pinet::TensorDesc> const network = {{"input.672", {1, 1, 32, 64}}, {"1438", {1, 2, 32, 64}},
+        {"1445", {1, 4, 32, 64}}, {"input.1332", {1, 1, 32, 64}}, {"1686", {1, 2, 32, 64}},
+        {"1693", {1, 4, 32, 64}}};
+    std::vector<std::string> networkNames;
+    for (auto const& desc : network)
+    {
+        networkNames.push_back(desc.name);
+    }
+    std::vector<std::string> const laneOutputs = {"input.1332", "1686", "1693"};
+
+    int64_t const allBytes = pinet::getOutputBytes(network);
+    for (auto const selection : {pinet::OutputSelection::kLANES, pinet::OutputSelection::kALL})
+    {
+        pinet::OutputPlan plan;
+        check(pinet::planOutputs(networkNames, laneOutputs, selection, plan), "the outputs are planned");
+        std::vector<pinet::TensorDesc> const outputs = describe(network, plan);
+
+        pinet::LaneHeads heads;
+        bool const found = pinet::findLaneHeads(outputs, laneOutputs, heads);
+        check(found && outputs[heads.confidence].name == "input.1332" && outputs[heads.offset].name == "1686"
+                && outputs[heads.instance].name == "1693",
+            "post-processing finds its outputs");
+        check(plan.bound.size() + plan.unmarked.size() == networkNames.size(), "every output is kept or unmarked");
+
+        int64_t const bytes = pinet::getOutputBytes(outputs);
+        std::cout << pinet::toString(selection) << ": " << plan.bound.size() << " outputs kept, " << bytes
+                  << " of " << allBytes << " bytes copied to the host per image" << std::endl;
+        if (selection == pinet::OutputSelection::kLANES)
+        {
+            check(plan.bound == laneOutputs, "lanes keeps only the outputs read by post-processing");
+            check(2 * bytes == allBytes, "lanes halves the bytes copied to the host");
+        }
+        else
+        {
+            check(plan.bound == networkNames && plan.unmarked.empty(), "all keeps every output in network order");
+        }
+    }
+
+    pinet::OutputPlan plan;
+    check(!pinet::planOutputs(networkNames, {"input.1332", "1686", "missing"}, pinet::OutputSelection::kLANES, plan),
+        "planning fails when post-processing reads an unknown output");
+    pinet::LaneHeads heads;
+    check(!pinet::findLaneHeads({network.begin(), network.begin() + 3}, laneOutputs, heads),
+        "a backend without the outputs read by post-processing is rejected");
+
+    pinet::OutputSelection selection;
+    check(pinet::parseOutputSelection("all", selection) && selection == pinet::OutputSelection::kALL
+            && !pinet::parseOutputSelection("some", selection),
+        "--outputs accepts lanes and all only");
+
+    return pinet::reportChecks();
+}
@@ -0,0 +1,114 @@
+//!
+//! checkVideoSource.cpp
+//! Checks the overload policies of the video source with a synthetic camera which is faster than its consumer.
+//! It can be run as: ./checkVideoSource
+//! The consumer waits for the camera to capture kCAPTURES_PER_READ frames before each read, so that it is slower
+//! by the same factor however loaded the machine is. The ages of the delivered frames are only printed.
+//! Fails if block loses a frame, dropOldest or latest do not drop the frames the consumer has no time for,
+//! frames are delivered out of order, or latest delivers an older frame than the last one captured.
+//!
+
+#include "checkHarness.h"
+#include "videoSource.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using pinet::check;
+
+namespace
+{
+
+constexpr int64_t kFRAMES = 60;           //!< Frames the camera captures
+constexpr int32_t kBUFFER_SIZE = 4;       //!< Frames buffered by block and dropOldest
+constexpr int64_t kCAPTURES_PER_READ = 4; //!< Frames the camera captures for each one the consumer reads
+
+//!
+//! \brief The Consumed structure summarizes what a slow consumer got from a source.
+//!
+struct Consumed
+{
+    int64_t delivered{0};
+    bool ordered{true};
+    bool newest{true};     //!< Every frame was at least as new as the last one captured before reading it
+    double meanAgeMs{0.0}; //!< Mean time from capture to delivery
+    pinet::VideoSource::Statistics statistics;
+};
+
+//!
+//! \brief Reads kFRAMES frames of a 200 fps synthetic camera, one for every kCAPTURES_PER_READ captured.
+//!
+Consumed consume(pinet::OverloadPolicy policy)
+{
+    pinet::VideoOptions options;
+    options.policy = policy;
+    options.bufferSize = kBUFFER_SIZE;
+    options.maxFrames = kFRAMES;
+    pinet::VideoSource source;
+    Consumed consumed;
+    if (!source.open("synthetic:64x32@200", options))
+    {
+        consumed.ordered = false;
+        return consumed;
+    }
+
+    pinet::CapturedFrame frame;
+    int64_t previous = -1;
+    double totalAge = 0.0;
+    for (int64_t read = 1;; ++read)
+    {
+        // A blocked camera counts the frame it waits to buffer but captures no more
+        int64_t target = std::min(kFRAMES, read * kCAPTURES_PER_READ);
+        if (policy == pinet::OverloadPolicy::kBLOCK)
+        {
+            target = std::min(target, consumed.delivered + kBUFFER_SIZE + 1);
+        }
+        int64_t captured = 0;
+        while ((captured = source.getStatistics().captured) < target)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!source.next(frame))
+        {
+            break;
+        }
+        totalAge += pinet::elapsedMs(frame.captured);
+        consumed.ordered = consumed.ordered && frame.sequence > previous && !frame.image.empty();
+        consumed.newest = consumed.newest && frame.sequence >= captured - 1;
+        previous = frame.sequence;
+        ++consumed.delivered;
+    }
+    consumed.meanAgeMs = consumed.delivered ? totalAge / consumed.delivered : 0.0;
+    consumed.statistics = source.getStatistics();
+    std::cout << pinet::toString(policy) << ": " << consumed.statistics.captured << " captured, "
+              << consumed.statistics.dropped << " dropped, " << consumed.delivered << " delivered, mean age "
+              << consumed.meanAgeMs << " ms" << std::endl;
+    return consumed;
+}
+
+} // namespace
+
+int main()
+{
+    Consumed const block = consume(pinet::OverloadPolicy::kBLOCK);
+    check(block.ordered && block.delivered == kFRAMES && block.statistics.dropped == 0,
+        "block delivers every frame in order");
+
+    Consumed const dropOldest = consume(pinet::OverloadPolicy::kDROP_OLDEST);
+    check(dropOldest.ordered && dropOldest.statistics.dropped > 0
+            && dropOldest.delivered + dropOldest.statistics.dropped == dropOldest.statistics.captured,
+        "dropOldest drops frames and delivers the others in order");
+
+    Consumed const latest = consume(pinet::OverloadPolicy::kLATEST);
+    check(latest.ordered && latest.statistics.dropped > 0
+            && latest.delivered + latest.statistics.dropped == latest.statistics.captured,
+        "latest drops frames and delivers the others in order");
+    check(latest.newest, "latest delivers the newest frame captured before each read");
+
+    pinet::VideoSource invalid;
+    check(!invalid.open("synthetic:64x32", pinet::VideoOptions()), "a synthetic source without a rate is refused");
+
+    return pinet::reportChecks();
+}
@@ -0,0 +1,113 @@
+//!
+//! compareOutputs.cpp
+//! Compares the network outputs of two recordings of the same images, e.g. of two backends.
+//! It can be run as: ./compareOutputs <reference> <recording> [tolerance]
+//! Both recordings are written by PINetTensorrt --recordOutputs, e.g. with the tensorrt backend on a machine with
+//! a GPU and with --backend=cpu on one without. Outputs are matched by name and the frames both recordings hold
+//! are compared in order. For each output the largest absolute difference and the largest difference relative
+//! to the largest magnitude of the reference frame are printed.
+//! Fails if a recording cannot be read, an output of the reference is missing or has other dimensions, or the
+//! relative difference of an output exceeds the tolerance, 1e-3 by default.
+//!
+
+#include "checkHarness.h"
+#include "replayBackend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+//!
+//! \brief The Difference structure accumulates the differences of one output over the frames.
+//!
+struct Difference
+{
+    double absolute{0.0};
+    double relative{0.0};
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: ./compareOutputs <reference> <recording> [tolerance]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    double const tolerance = argc > 3 ? std::atof(argv[3]) : 1e-3;
+
+    pinet::ReplayBackend reference(argv[1]);
+    pinet::ReplayBackend candidate(argv[2]);
+    if (!reference.load() || !candidate.load())
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Index in the candidate of each output of the reference, -1 if it is missing
+    auto const& outputs = reference.getOutputs();
+    std::vector<int32_t> matches;
+    for (auto const& output : outputs)
+    {
+        auto const& others = candidate.getOutputs();
+        auto const found = std::find_if(others.begin(), others.end(),
+            [&output](pinet::TensorDesc const& other) { return other.name == output.name; });
+        bool const same = found != others.end() && found->dims == output.dims;
+        check(same, output.name + " is recorded with the same dimensions");
+        matches.push_back(same ? static_cast<int32_t>(found - others.begin()) : -1);
+    }
+
+    int64_t const frameCount = std::min(reference.getFrameCount(), candidate.getFrameCount());
+    std::cout << frameCount << " frames compared, " << reference.getFrameCount() << " in " << argv[1] << ", "
+              << candidate.getFrameCount() << " in " << argv[2] << std::endl;
+
+    std::vector<Difference> differences(outputs.size());
+    for (int64_t f = 0; f < frameCount; ++f)
+    {
+        reference.setSequenceNumber(0, f);
+        candidate.setSequenceNumber(0, f);
+        reference.infer();
+        candidate.infer();
+        for (size_t o = 0; o < outputs.size(); ++o)
+        {
+            if (matches[o] < 0)
+            {
+                continue;
+            }
+            float const* expected = reference.getOutputBuffer(static_cast<int32_t>(o));
+            float const* actual = candidate.getOutputBuffer(matches[o]);
+            double magnitude = 1e-6;
+            double absolute = 0.0;
+            for (int64_t i = 0; i < outputs[o].volume(); ++i)
+            {
+                magnitude = std::max(magnitude, static_cast<double>(std::fabs(expected[i])));
+                absolute = std::max(absolute, static_cast<double>(std::fabs(actual[i] - expected[i])));
+            }
+            differences[o].absolute = std::max(differences[o].absolute, absolute);
+            differences[o].relative = std::max(differences[o].relative, absolute / magnitude);
+        }
+    }
+
+    for (size_t o = 0; o < outputs.size(); ++o)
+    {
+        if (matches[o] >= 0 && frameCount > 0)
+        {
+            std::ostringstream what;
+            what << outputs[o].name << " differs by at most " << differences[o].absolute << ", "
+                 << differences[o].relative << " of its largest magnitude";
+            check(differences[o].relative <= tolerance, what.str());
+        }
+    }
+    check(frameCount > 0, "The recordings hold frames to compare");
+
+    return pinet::reportChecks();
+}
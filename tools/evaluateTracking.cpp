@@ -0,0 +1,217 @@
+//!
+//! evaluateTracking.cpp
+//! Measures how far the lane lines carried over by pinet::LaneTracker are from those of inferring every frame.
+//! It can be run as: ./evaluateTracking <recording> <clip directory> [interval]...
+//! The recording is written by PINetTensorrt --recordOutputs on the images of the clip directory, e.g.
+//! data/1492638000682869180, and gives the lane lines of every frame. For each interval, default 2, 3, 5 and 10,
+//! frames are inferred as PINetTensorrt --track does and the other ones are compared with their recorded lane
+//! lines, for the tracker and for keeping the lane lines of the last inferred frame.
+//! Fails if the recording or the images cannot be read.
+//!
+
+#include "directoryScanner.h"
+#include "imageDecode.h"
+#include "laneExtraction.h"
+#include "laneTracker.h"
+#include "outputPlan.h"
+#include "replayBackend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr float kTHRESHOLD_CONFIDENCE = 0.5f; //!< Default of --trackConfidence
+constexpr float kMATCH_DISTANCE = 1.f;       //!< Mean distance in cells a lane is found within
+constexpr int32_t kMIN_SHARED_ROWS = 3;
+
+//!
+//! \brief Extracts the lane lines of one recorded frame with the extractor and thresholds of generateLaneLine.
+//!
+pinet::LaneLines getLaneLines(
+    pinet::ReplayBackend& replay, pinet::LaneHeads const& heads, pinet::LaneExtractor& extractor)
+{
+    auto const& outputs = replay.getOutputs();
+    pinet::LaneLines laneLines;
+    pinet::LaneLines spare;
+    extractor.extract(
+        pinet::PlanarView<float const>(replay.getOutputBuffer(heads.confidence), outputs[heads.confidence]),
+        pinet::PlanarView<float const>(replay.getOutputBuffer(heads.offset), outputs[heads.offset]),
+        pinet::PlanarView<float const>(replay.getOutputBuffer(heads.instance), outputs[heads.instance]),
+        pinet::kPOINT_THRESHOLD, pinet::kINSTANCE_THRESHOLD, laneLines, spare);
+    return laneLines;
+}
+
+//!
+//! \brief The Score structure sums the comparisons of lane lines with the recorded ones.
+//!
+struct Score
+{
+    int64_t lanes{0};    //!< Recorded lanes
+    int64_t found{0};    //!< Recorded lanes with a lane within kMATCH_DISTANCE
+    double distance{0.}; //!< Sum over the found lanes of their mean distance in cells
+
+    //!
+    //! \brief Compares lane lines with the recorded ones of the same frame.
+    //!
+    void add(pinet::LaneLines const& laneLines, pinet::LaneLines const& recorded, int32_t height)
+    {
+        std::vector<std::vector<float>> xs(laneLines.size());
+        for (size_t l = 0; l < laneLines.size(); ++l)
+        {
+            pinet::resampleLaneLine(laneLines[l], height, xs[l]);
+        }
+        std::vector<float> expected;
+        for (auto const& laneLine : recorded)
+        {
+            pinet::resampleLaneLine(laneLine, height, expected);
+            float best = INFINITY;
+            for (auto const& candidate : xs)
+            {
+                float sum = 0.f;
+                int32_t shared = 0;
+                for (int32_t r = 0; r < height; ++r)
+                {
+                    if (!std::isnan(expected[r]) && !std::isnan(candidate[r]))
+                    {
+                        sum += std::abs(candidate[r] - expected[r]);
+                        ++shared;
+                    }
+                }
+                if (shared >= kMIN_SHARED_ROWS)
+                {
+                    best = std::min(best, sum / shared);
+                }
+            }
+            ++lanes;
+            if (best <= kMATCH_DISTANCE)
+            {
+                ++found;
+                distance += best;
+            }
+        }
+    }
+
+    void print(char const* name) const
+    {
+        std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(6) << (lanes ? 100. * found / lanes : 0.) << "% of the lanes found, mean distance "
+                  << std::setprecision(3) << (found ? distance / found : 0.) << " cells" << std::endl;
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <recording> <clip directory> [interval]..." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<int32_t> intervals;
+    for (int32_t a = 3; a < argc; ++a)
+    {
+        intervals.push_back(std::max(1, std::atoi(argv[a])));
+    }
+    if (intervals.empty())
+    {
+        intervals = {2, 3, 5, 10};
+    }
+
+    pinet::ReplayBackend replay(argv[1]);
+    pinet::LaneHeads heads;
+    if (!replay.load()
+        || (!pinet::findLaneHeads(replay.getOutputs(), {"input.1332", "1686", "1693"}, heads)
+            && !pinet::findLaneHeads(replay.getOutputs(), {"input.672", "1438", "1445"}, heads)))
+    {
+        std::cerr << argv[1] << " is not a recording of the outputs read by post-processing" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Images come in the order PINetTensorrt reads them in, which is the order of the recording
+    std::vector<std::string> fileNames;
+    pinet::DirectoryScanner scanner({argv[2]}, ".jpg", 1, true);
+    for (std::string fileName; scanner.next(fileName);)
+    {
+        fileNames.push_back(fileName);
+    }
+    int64_t const frameCount = std::min<int64_t>(replay.getFrameCount(), fileNames.size());
+    if (frameCount == 0)
+    {
+        std::cerr << "No image of " << argv[2] << " is recorded in " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<int32_t> const& grid = replay.getOutputs()[heads.confidence].dims;
+    std::vector<int32_t> const& input = replay.getInput().dims;
+    pinet::LaneExtractor extractor(grid[2] * grid[3]);
+    std::vector<pinet::LaneLines> recorded;
+    std::vector<cv::Mat> images;
+    std::vector<uint8_t> buffer;
+    for (int64_t f = 0; f < frameCount; ++f)
+    {
+        replay.infer();
+        recorded.push_back(getLaneLines(replay, heads, extractor));
+        images.emplace_back();
+        if (!pinet::decodeImage(fileNames[f], input[3], input[2], buffer, images.back()))
+        {
+            std::cerr << "Cannot read " << fileNames[f] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << frameCount << " frames of " << argv[2] << ", " << grid[3] << "x" << grid[2] << " grid" << std::endl;
+
+    for (int32_t const interval : intervals)
+    {
+        pinet::LaneTracker tracker(grid[3], grid[2]);
+        pinet::LaneTracker motionOnly(grid[3], grid[2]);
+        pinet::LaneLines tracked;
+        pinet::LaneLines moved;
+        pinet::LaneLines const* kept = nullptr;
+        Score trackerScore;
+        Score motionScore;
+        Score keptScore;
+        int64_t inferred = 0;
+        int32_t sinceInferred = 0;
+        bool lost = false;
+        double trackMs = 0.;
+        for (int64_t f = 0; f < frameCount; ++f)
+        {
+            if (f == 0 || ++sinceInferred >= interval || lost)
+            {
+                tracker.update(recorded[f], images[f]);
+                motionOnly.update(recorded[f], cv::Mat());
+                kept = &recorded[f];
+                sinceInferred = 0;
+                lost = false;
+                ++inferred;
+                continue;
+            }
+            auto const start = std::chrono::high_resolution_clock::now();
+            lost = tracker.propagate(images[f], tracked) < kTHRESHOLD_CONFIDENCE;
+            trackMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start)
+                           .count();
+            motionOnly.propagate(cv::Mat(), moved);
+            trackerScore.add(tracked, recorded[f], grid[2]);
+            motionScore.add(moved, recorded[f], grid[2]);
+            keptScore.add(*kept, recorded[f], grid[2]);
+        }
+
+        int64_t const trackedFrames = frameCount - inferred;
+        std::cout << "interval " << interval << ": " << inferred << " of " << frameCount << " frames inferred, "
+                  << std::setprecision(3) << (trackedFrames ? trackMs / trackedFrames : 0.)
+                  << " ms per tracked frame" << std::endl;
+        trackerScore.print("tracker");
+        motionScore.print("motion");
+        keptScore.print("kept");
+    }
+    return EXIT_SUCCESS;
+}
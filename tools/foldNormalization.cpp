@@ -0,0 +1,126 @@
+//!
+//! foldNormalization.cpp
+//! Folds the normalization of the network input into the first convolution of an ONNX model, on the CPU.
+//! It can be run as: ./foldNormalization <input.onnx> <output.onnx> [mean] [std] [swap]
+//! mean and std are comma separated values per channel of the images, 0,0,0 and 1,1,1 by default, and swap is 1
+//! if the model was trained on channels in the reverse order of the images, 0 by default. The defaults fold the
+//! division by 255 pinet.onnx was trained with. The written model takes pixel values from 0 to 255 and records so
+//! in its metadata, which PINetTensorrt reads to skip the normalization. Both models are then run by the built-in
+//! CPU engine on the same random images to check that the folded one computes the same outputs.
+//! Fails if the model cannot be read, folded or written, or an output of the folded model differs from that of
+//! the input model by more than 1e-4 of its largest magnitude.
+//!
+
+#include "checkHarness.h"
+#include "cpuEngine.h"
+#include "onnxModel.h"
+#include "onnxOptimizer.h"
+#include "preprocess.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pinet::check;
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.onnx> <output.onnx> [mean] [std] [swap]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const input = argv[1];
+    std::string const output = argv[2];
+    std::string const text = std::string("mean=") + (argc > 3 ? argv[3] : "0,0,0") + " std="
+        + (argc > 4 ? argv[4] : "1,1,1") + " swap=" + (argc > 5 ? argv[5] : "0");
+    pinet::NormalizeParams params;
+    if (!pinet::parseNormalization(text, params))
+    {
+        std::cerr << "Invalid normalization " << text << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    pinet::ProtoMessage model;
+    int32_t foldedConvs = 0;
+    if (!pinet::readModel(input, model) || !pinet::foldInputNormalization(model, params, foldedConvs)
+        || !pinet::writeModel(output, model))
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "Folded " << pinet::formatNormalization(params) << " into " << foldedConvs << " Conv" << std::endl;
+    std::cout << "Wrote " << output << std::endl;
+
+    pinet::ProtoMessage written;
+    pinet::NormalizeParams expects;
+    check(pinet::readModel(output, written) && pinet::getInputNormalization(written, expects)
+            && expects.std[0] * 255.f == 1.f && expects.mean[0] == 0.f && !expects.swapChannels,
+        "The metadata of " + output + " asks for pixel values from 0 to 255");
+
+    std::vector<std::string> outputs;
+    pinet::getGraphOutputs(model, outputs);
+    auto original = std::make_shared<pinet::CpuNetwork>();
+    auto folded = std::make_shared<pinet::CpuNetwork>();
+    check(original->load(input, outputs) && folded->load(output, outputs), "The CPU engine loads both models");
+    if (pinet::getFailedChecks())
+    {
+        return pinet::reportChecks();
+    }
+
+    int32_t const threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+    pinet::CpuBackend expected(original, 1, threads);
+    pinet::CpuBackend actual(folded, 1, threads);
+    std::vector<int32_t> const& dims = expected.getInput().dims;
+    int64_t const planeSize = static_cast<int64_t>(dims[2]) * dims[3];
+
+    // Random images, normalized for the input model as the preprocessing would and given as is to the folded one
+    std::mt19937 random(2024);
+    std::uniform_int_distribution<int32_t> distribution(0, 255);
+    std::vector<double> errors(outputs.size(), 0.0);
+    bool ran = true;
+    for (int32_t i = 0; ran && i < 3; ++i)
+    {
+        for (int32_t c = 0; c < 3; ++c)
+        {
+            int32_t const plane = params.swapChannels ? 2 - c : c;
+            for (int64_t p = 0; p < planeSize; ++p)
+            {
+                float const pixel = static_cast<float>(distribution(random));
+                actual.getInputBuffer()[c * planeSize + p] = pixel;
+                expected.getInputBuffer()[plane * planeSize + p] = (pixel / 255.f - params.mean[c]) / params.std[c];
+            }
+        }
+        ran = expected.infer() && actual.infer();
+        for (size_t o = 0; ran && o < outputs.size(); ++o)
+        {
+            float const* e = expected.getOutputBuffer(static_cast<int32_t>(o));
+            float const* a = actual.getOutputBuffer(static_cast<int32_t>(o));
+            double magnitude = 1e-6;
+            double difference = 0.0;
+            for (int64_t k = 0; k < expected.getOutputs()[o].volume(); ++k)
+            {
+                magnitude = std::max(magnitude, static_cast<double>(std::fabs(e[k])));
+                difference = std::max(difference, static_cast<double>(std::fabs(a[k] - e[k])));
+            }
+            errors[o] = std::max(errors[o], difference / magnitude);
+        }
+    }
+    check(ran, "The CPU engine runs both models");
+    for (size_t o = 0; ran && o < outputs.size(); ++o)
+    {
+        std::ostringstream what;
+        what << std::scientific << std::setprecision(2) << outputs[o] << " matches the input model within "
+             << errors[o];
+        check(errors[o] <= 1e-4, what.str());
+    }
+
+    return pinet::reportChecks();
+}
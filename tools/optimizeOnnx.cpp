@@ -0,0 +1,160 @@
+//!
+//! optimizeOnnx.cpp
+//! Rewrites an ONNX model into an equivalent one which is smaller and quicker to parse and build, on the CPU.
+//! It can be run as: ./optimizeOnnx <input.onnx> <output.onnx> [output names...]
+//! The passes of pinet::optimizeGraph() run on the model, keeping the given outputs or all of them without names.
+//! Both models are then run by the built-in CPU engine on the same random inputs to check that the optimized one
+//! computes the same outputs, and the time the engine takes to load each of them is printed.
+//! Fails if the model cannot be read, optimized or written, or an output of the optimized model differs from
+//! that of the input model by more than 1e-4 of its largest magnitude.
+//!
+
+#include "checkHarness.h"
+#include "cpuEngine.h"
+#include "onnxModel.h"
+#include "onnxOptimizer.h"
+#include "stageTiming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pinet::check;
+
+namespace
+{
+
+int64_t getFileSize(std::string const& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return file ? static_cast<int64_t>(file.tellg()) : 0;
+}
+
+//!
+//! \brief Loads fileName into the CPU engine, keeping outputs.
+//!
+//! \return the milliseconds the load took, or a negative value if it failed
+//!
+double loadNetwork(std::string const& fileName, std::vector<std::string> const& outputs,
+    std::shared_ptr<pinet::CpuNetwork>& network)
+{
+    network = std::make_shared<pinet::CpuNetwork>();
+    auto const start = pinet::Clock::now();
+    return network->load(fileName, outputs) ? pinet::elapsedMs(start) : -1.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.onnx> <output.onnx> [output names...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const input = argv[1];
+    std::string const output = argv[2];
+
+    pinet::OptimizeOptions options;
+    options.outputs.assign(argv + 3, argv + argc);
+    pinet::ProtoMessage model;
+    pinet::OptimizeResult result;
+    if (!pinet::readModel(input, model) || !pinet::optimizeGraph(model, options, result)
+        || !pinet::writeModel(output, model))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> outputs = options.outputs;
+    if (outputs.empty())
+    {
+        pinet::getGraphOutputs(model, outputs);
+    }
+    pinet::PruneResult const& pruned = result.pruned;
+    std::cout << "folded constants:    " << result.foldedConstants << std::endl;
+    std::cout << "removed identities:  " << result.removedIdentities << std::endl;
+    std::cout << "collapsed reshapes:  " << result.collapsedReshapes << std::endl;
+    std::cout << "folded batch norms:  " << result.foldedBatchNorms << std::endl;
+    std::cout << "merged initializers: " << result.mergedInitializers << std::endl;
+    std::cout << "nodes:        " << pruned.nodesBefore << " -> " << pruned.nodesAfter << std::endl;
+    std::cout << "initializers: " << pruned.initializersBefore << " -> " << pruned.initializersAfter << " ("
+              << pruned.initializerBytesBefore / 1024 << " KiB -> " << pruned.initializerBytesAfter / 1024 << " KiB)"
+              << std::endl;
+    std::cout << "file:         " << getFileSize(input) / 1024 << " KiB -> " << getFileSize(output) / 1024 << " KiB"
+              << std::endl;
+    std::cout << "Wrote " << output << std::endl;
+
+    // Both models run in the CPU engine, which executes the graph as written without fusing anything
+    std::shared_ptr<pinet::CpuNetwork> original;
+    std::shared_ptr<pinet::CpuNetwork> optimized;
+    double const originalMs = loadNetwork(input, outputs, original);
+    double const optimizedMs = loadNetwork(output, outputs, optimized);
+    check(originalMs >= 0.0 && optimizedMs >= 0.0, "The CPU engine loads both models");
+    if (originalMs < 0.0 || optimizedMs < 0.0)
+    {
+        return pinet::reportChecks();
+    }
+    std::cout << std::fixed << std::setprecision(2) << "load:         " << originalMs << " ms -> " << optimizedMs
+              << " ms" << std::endl;
+
+    int32_t const threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+    pinet::CpuBackend expected(original, 1, threads);
+    pinet::CpuBackend actual(optimized, 1, threads);
+    check(expected.getInput().dims == actual.getInput().dims, "The input keeps its shape");
+    bool sameShapes = expected.getOutputs().size() == actual.getOutputs().size();
+    for (size_t o = 0; sameShapes && o < expected.getOutputs().size(); ++o)
+    {
+        sameShapes = expected.getOutputs()[o].dims == actual.getOutputs()[o].dims;
+    }
+    check(sameShapes, "The outputs keep their shapes");
+    if (pinet::getFailedChecks())
+    {
+        return pinet::reportChecks();
+    }
+
+    // Images preprocessed by PINetTensorrt lie in [0, 1]
+    std::mt19937 random(2024);
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+    std::vector<double> errors(outputs.size(), 0.0);
+    bool ran = true;
+    for (int32_t i = 0; ran && i < 3; ++i)
+    {
+        float* expectedInput = expected.getInputBuffer();
+        std::generate(expectedInput, expectedInput + expected.getInput().volume(),
+            [&random, &distribution]() { return distribution(random); });
+        std::copy(expectedInput, expectedInput + expected.getInput().volume(), actual.getInputBuffer());
+        ran = expected.infer() && actual.infer();
+        for (size_t o = 0; ran && o < outputs.size(); ++o)
+        {
+            float const* e = expected.getOutputBuffer(static_cast<int32_t>(o));
+            float const* a = actual.getOutputBuffer(static_cast<int32_t>(o));
+            double magnitude = 1e-6;
+            double difference = 0.0;
+            for (int64_t k = 0; k < expected.getOutputs()[o].volume(); ++k)
+            {
+                magnitude = std::max(magnitude, static_cast<double>(std::fabs(e[k])));
+                difference = std::max(difference, static_cast<double>(std::fabs(a[k] - e[k])));
+            }
+            errors[o] = std::max(errors[o], difference / magnitude);
+        }
+    }
+    check(ran, "The CPU engine runs both models");
+    for (size_t o = 0; ran && o < outputs.size(); ++o)
+    {
+        std::ostringstream what;
+        what << std::scientific << std::setprecision(2) << outputs[o] << " matches the input model within "
+             << errors[o];
+        check(errors[o] <= 1e-4, what.str());
+    }
+
+    return pinet::reportChecks();
+}
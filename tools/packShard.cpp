@@ -0,0 +1,130 @@
+//!
+//! packShard.cpp
+//! Packs the .jpg images of directories into one shard which PINetTensorrt reads with --shard, see imageShard.h.
+//! It can be run as: ./packShard <output.shard> <image directory>...
+//! Images are stored in the order PINetTensorrt reads the directories in, the clip of an image is the path of
+//! its directory as scanned from the given directories and its frame id the number its file is named after, e.g.
+//! data/1492638000682869180 and 7 for data/1492638000682869180/7.jpg, or else its position in the clip. The shard
+//! is read back and compared with the files. Fails if a file cannot be read, two images share a clip and frame id
+//! or the shard does not match.
+//!
+
+#include "directoryScanner.h"
+#include "imageShard.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+bool readFile(std::string const& fileName, std::vector<char>& data)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return file.good() || file.eof();
+}
+
+//!
+//! \brief Splits the path of an image into the path of its directory and the stem of its file name.
+//!
+//! \details The directory keeps the packed directory it was found under, so that directories of the same name
+//!          under two packed directories stay apart. Repeated slashes and leading ./ are dropped.
+//!
+void splitPath(std::string const& path, std::string& clip, std::string& stem)
+{
+    size_t const slash = path.rfind('/');
+    std::string const directory = slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+    clip.clear();
+    for (char const c : directory)
+    {
+        if (c != '/' || clip.empty() || clip.back() != '/')
+        {
+            clip.push_back(c);
+        }
+    }
+    while (clip.size() > 2 && clip.compare(0, 2, "./") == 0)
+    {
+        clip.erase(0, 2);
+    }
+    std::string const name = path.substr(slash + 1);
+    stem = name.substr(0, name.rfind('.'));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output.shard> <image directory>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const shardName = argv[1];
+    std::vector<std::string> const directories(argv + 2, argv + argc);
+
+    pinet::ShardWriter writer;
+    if (!writer.open(shardName))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> files;
+    std::map<std::string, uint32_t> clipSizes;
+    pinet::DirectoryScanner scanner(directories, ".jpg", 4, true);
+    std::vector<char> data;
+    int64_t bytes = 0;
+    for (std::string file; scanner.next(file);)
+    {
+        if (!readFile(file, data))
+        {
+            std::cerr << "Cannot read " << file << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string clip;
+        std::string stem;
+        splitPath(file, clip, stem);
+        uint32_t const position = clipSizes[clip]++;
+        bool const numbered = !stem.empty() && stem.size() < 10 && stem.find_first_not_of("0123456789") == std::string::npos;
+        if (!writer.add(clip, numbered ? static_cast<uint32_t>(std::stoul(stem)) : position, data.data(), data.size()))
+        {
+            return EXIT_FAILURE;
+        }
+        files.push_back(file);
+        bytes += data.size();
+    }
+    for (auto const& error : scanner.getErrors())
+    {
+        std::cerr << "Cannot read directory " << error << std::endl;
+    }
+    if (!writer.finish())
+    {
+        return EXIT_FAILURE;
+    }
+
+    pinet::ShardReader reader;
+    if (!reader.open(shardName) || reader.getImageCount() != static_cast<int64_t>(files.size()))
+    {
+        std::cerr << shardName << " does not hold the packed images" << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        readFile(files[i], data);
+        if (reader.getImage(i).size != data.size() || std::memcmp(reader.getData(i), data.data(), data.size()) != 0)
+        {
+            std::cerr << shardName << ": " << reader.getName(i) << " differs from " << files[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "Packed " << files.size() << " images of " << clipSizes.size() << " clips, " << bytes / 1024
+              << " KiB, into " << shardName << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+//!
+//! pruneOnnx.cpp
+//! Truncates an ONNX model to the nodes some of its outputs depend on, on the CPU.
+//! It can be run as: ./pruneOnnx <input.onnx> <output.onnx> [output names...]
+//! Without output names the model is cut after the first hourglass stack of PINet, keeping the confidence,
+//! offset and instance heads read by PINetTensorrt --stack=1.
+//!
+
+#include "onnxModel.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.onnx> <output.onnx> [output names...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> outputs(argv + 3, argv + argc);
+    if (outputs.empty())
+    {
+        outputs = {"input.672", "1438", "1445"};
+    }
+
+    pinet::ProtoMessage model;
+    if (!pinet::readModel(argv[1], model))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> before;
+    pinet::getGraphOutputs(model, before);
+
+    pinet::PruneResult result;
+    if (!pinet::pruneGraph(model, outputs, result) || !pinet::writeModel(argv[2], model))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "outputs:      " << before.size() << " -> " << outputs.size() << std::endl;
+    std::cout << "nodes:        " << result.nodesBefore << " -> " << result.nodesAfter << std::endl;
+    std::cout << "initializers: " << result.initializersBefore << " -> " << result.initializersAfter << " ("
+              << result.initializerBytesBefore / 1024 << " KiB -> " << result.initializerBytesAfter / 1024 << " KiB)"
+              << std::endl;
+    std::cout << "Wrote " << argv[2] << std::endl;
+    return EXIT_SUCCESS;
+}
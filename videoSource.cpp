@@ -0,0 +1,209 @@
+#include "videoSource.h"
+#include "logger.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace pinet
+{
+
+char const* toString(OverloadPolicy policy)
+{
+    switch (policy)
+    {
+    case OverloadPolicy::kBLOCK: return "block";
+    case OverloadPolicy::kDROP_OLDEST: return "dropOldest";
+    case OverloadPolicy::kLATEST: return "latest";
+    }
+    return "unknown";
+}
+
+bool parseOverloadPolicy(std::string const& name, OverloadPolicy& policy)
+{
+    for (auto const candidate : {OverloadPolicy::kBLOCK, OverloadPolicy::kDROP_OLDEST, OverloadPolicy::kLATEST})
+    {
+        if (name == toString(candidate))
+        {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+VideoSource::~VideoSource()
+{
+    stop();
+}
+
+bool VideoSource::open(std::string const& input, VideoOptions const& options)
+{
+    mOptions = options;
+    if (mOptions.policy == OverloadPolicy::kLATEST || mOptions.bufferSize < 1)
+    {
+        mOptions.bufferSize = 1;
+    }
+
+    if (input.compare(0, 9, "synthetic") == 0)
+    {
+        int32_t width = 1280;
+        int32_t height = 720;
+        double fps = 30.0;
+        if (input.size() > 9
+            && (input[9] != ':' || std::sscanf(input.c_str() + 10, "%dx%d@%lf", &width, &height, &fps) != 3
+                || width <= 0 || height <= 0 || fps <= 0.0))
+        {
+            sample::gLogError << "Expected synthetic:<width>x<height>@<fps>, got " << input << std::endl;
+            return false;
+        }
+        mSynthetic = true;
+        mSyntheticSize = cv::Size(width, height);
+        mFrameRate = fps;
+    }
+    else
+    {
+        bool const isIndex = !input.empty() && input.find_first_not_of("0123456789") == std::string::npos;
+        bool const opened = isIndex ? mCapture.open(std::atoi(input.c_str()), cv::CAP_ANY) : mCapture.open(input);
+        if (!opened || !mCapture.isOpened())
+        {
+            sample::gLogError << "Cannot open video " << input << std::endl;
+            return false;
+        }
+        mFrameRate = mCapture.get(cv::CAP_PROP_FPS);
+    }
+
+    sample::gLogInfo << "Capturing " << input << " at " << mFrameRate << " fps, overload policy "
+                     << toString(mOptions.policy) << ", " << mOptions.bufferSize << " frames buffered" << std::endl;
+    mThread = std::thread(&VideoSource::capture, this);
+    return true;
+}
+
+bool VideoSource::next(CapturedFrame& frame)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mChanged.wait(lock, [this] { return !mFrames.empty() || mEnded; });
+    if (mFrames.empty())
+    {
+        return false;
+    }
+    frame = std::move(mFrames.front());
+    mFrames.pop_front();
+    mChanged.notify_all();
+    return true;
+}
+
+void VideoSource::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mChanged.notify_all();
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+VideoSource::Statistics VideoSource::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
+
+bool VideoSource::grab(CapturedFrame& frame)
+{
+    if (mSynthetic)
+    {
+        frame.captured = Clock::now();
+        drawSynthetic(frame.image, frame.sequence);
+        return true;
+    }
+    // The timestamp is taken once the frame arrived, decoding it is part of its latency
+    if (!mCapture.grab())
+    {
+        return false;
+    }
+    frame.captured = Clock::now();
+    return mCapture.retrieve(frame.image) && !frame.image.empty();
+}
+
+void VideoSource::capture()
+{
+    // Synthetic frames come at their rate like a camera, files only if asked to
+    bool const paced = mSynthetic || (mOptions.realtime && mFrameRate > 0.0);
+    auto const period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(paced ? 1.0 / mFrameRate : 0.0));
+    auto const start = Clock::now();
+
+    for (int64_t sequence = 0; mOptions.maxFrames == 0 || sequence < mOptions.maxFrames; ++sequence)
+    {
+        if (paced)
+        {
+            std::this_thread::sleep_until(start + sequence * period);
+        }
+        CapturedFrame frame;
+        frame.sequence = sequence;
+        bool const grabbed = grab(frame);
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!grabbed || mStop)
+        {
+            break;
+        }
+        ++mStatistics.captured;
+        if (mOptions.policy == OverloadPolicy::kBLOCK)
+        {
+            mChanged.wait(lock, [this] { return mStop || mFrames.size() < static_cast<size_t>(mOptions.bufferSize); });
+            if (mStop)
+            {
+                break;
+            }
+        }
+        while (mFrames.size() >= static_cast<size_t>(mOptions.bufferSize))
+        {
+            mFrames.pop_front();
+            ++mStatistics.dropped;
+        }
+        mFrames.push_back(std::move(frame));
+        mChanged.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEnded = true;
+    mChanged.notify_all();
+}
+
+void VideoSource::drawSynthetic(cv::Mat& image, int64_t sequence) const
+{
+    int32_t const width = mSyntheticSize.width;
+    int32_t const height = mSyntheticSize.height;
+    image.create(height, width, CV_8UC3);
+    image.setTo(cv::Scalar(150, 130, 110));
+
+    // A road from the horizon down, with four lane markings whose dashes move towards the camera
+    int32_t const horizon = height * 2 / 5;
+    cv::Point const vanishing(width / 2, horizon);
+    cv::rectangle(image, cv::Point(0, horizon), cv::Point(width, height), cv::Scalar(70, 70, 70), cv::FILLED);
+    int32_t const dashes = 8;
+    double const phase = (sequence % 30) / 30.0;
+    for (int32_t lane = 0; lane < 4; ++lane)
+    {
+        cv::Point const bottom(width * (2 * lane + 1) / 8, height);
+        for (int32_t d = 0; d < dashes; ++d)
+        {
+            // Perspective squeezes the dashes near the horizon
+            double const t0 = std::pow((d + phase) / dashes, 2.0);
+            double const t1 = std::pow((d + phase + 0.5) / dashes, 2.0);
+            cv::Point const p0 = vanishing + (bottom - vanishing) * t0;
+            cv::Point const p1 = vanishing + (bottom - vanishing) * t1;
+            cv::line(image, p0, p1, cv::Scalar(230, 230, 230), std::max(2, static_cast<int32_t>(12 * t1)), cv::LINE_AA);
+        }
+    }
+}
+
+} // namespace pinet
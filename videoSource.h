@@ -0,0 +1,141 @@
+#ifndef PINET_VIDEO_SOURCE_H
+#define PINET_VIDEO_SOURCE_H
+
+#include "stageTiming.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace pinet
+{
+
+//!
+//! \brief What the capture does with a new frame while the pipeline has not taken the previous ones yet.
+//!
+enum class OverloadPolicy : int32_t
+{
+    kBLOCK,       //!< Wait for room, no frame is lost but frames age, a camera drops them in its driver instead
+    kDROP_OLDEST, //!< Drop the oldest buffered frame to make room
+    kLATEST,      //!< Keep only the latest frame, the pipeline always gets the freshest one
+};
+
+//!
+//! \brief Returns the name of policy.
+//!
+char const* toString(OverloadPolicy policy);
+
+//!
+//! \return false if name is neither block, dropOldest nor latest
+//!
+bool parseOverloadPolicy(std::string const& name, OverloadPolicy& policy);
+
+//!
+//! \brief The VideoOptions structure configures a VideoSource.
+//!
+struct VideoOptions
+{
+    OverloadPolicy policy{OverloadPolicy::kBLOCK};
+    int32_t bufferSize{4};  //!< Frames buffered between the capture and the pipeline, 1 for kLATEST
+    int64_t maxFrames{0};   //!< Frames captured before the source ends, 0 to run until the input ends
+    bool realtime{false};   //!< Read video files at their frame rate, like a camera, rather than at once
+};
+
+//!
+//! \brief The CapturedFrame structure is one frame of a video source.
+//!
+struct CapturedFrame
+{
+    cv::Mat image;
+    Clock::time_point captured; //!< When the frame was grabbed from the input
+    int64_t sequence{0};        //!< Position of the frame in the input, dropped frames included
+};
+
+//!
+//! \brief  The VideoSource class captures frames on its own thread and hands them to the pipeline according
+//!         to an overload policy.
+//!
+//! \details The input is anything cv::VideoCapture opens, i.e. a video file, a device path such as
+//!          /dev/video0, a stream URL or a camera index, or synthetic[:<width>x<height>@<fps>], a generator
+//!          of road-like frames at a steady rate which stands in for a camera. Defaults are 1280x720@30.
+//!
+//!          Frames are timestamped when they are grabbed, before they are decoded, so their latency
+//!          includes the decoding, the buffering and the whole pipeline.
+//!
+class VideoSource
+{
+public:
+    VideoSource() = default;
+
+    ~VideoSource();
+
+    VideoSource(VideoSource const&) = delete;
+    VideoSource& operator=(VideoSource const&) = delete;
+
+    //!
+    //! \brief Opens input and starts capturing.
+    //!
+    bool open(std::string const& input, VideoOptions const& options);
+
+    //!
+    //! \brief Waits for the next frame.
+    //!
+    //! \return false once the input ended and every buffered frame was returned
+    //!
+    bool next(CapturedFrame& frame);
+
+    //!
+    //! \brief Stops capturing, the frames already buffered are still returned.
+    //!
+    void stop();
+
+    //!
+    //! \brief Returns the nominal frame rate of the input, 0 if it is unknown.
+    //!
+    double getFrameRate() const
+    {
+        return mFrameRate;
+    }
+
+    //!
+    //! \brief The Statistics structure counts the frames of the source.
+    //!
+    struct Statistics
+    {
+        int64_t captured{0};
+        int64_t dropped{0}; //!< Frames replaced by newer ones before the pipeline took them
+    };
+
+    Statistics getStatistics() const;
+
+private:
+    bool grab(CapturedFrame& frame);
+
+    void capture();
+
+    void drawSynthetic(cv::Mat& image, int64_t sequence) const;
+
+    VideoOptions mOptions;
+    cv::VideoCapture mCapture;
+    bool mSynthetic{false};
+    cv::Size mSyntheticSize{1280, 720};
+    double mFrameRate{0.0};
+
+    mutable std::mutex mMutex;
+    std::condition_variable mChanged;
+    std::deque<CapturedFrame> mFrames;
+    bool mEnded{false};
+    bool mStop{false};
+    Statistics mStatistics;
+    std::thread mThread;
+};
+
+} // namespace pinet
+
+#endif // PINET_VIDEO_SOURCE_H